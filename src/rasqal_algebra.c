@@ -147,6 +147,37 @@ rasqal_new_triples_algebra_node(rasqal_query* query,
 }
 
 
+/*
+ * rasqal_new_path_algebra_node:
+ * @query: #rasqal_query query object
+ * @triples: triples sequence (SHARED)
+ * @column: property path triple
+ *
+ * INTERNAL - Create a new algebra node for a property path triple pattern
+ * 
+ * Return value: a new #rasqal_algebra_node object or NULL on failure
+ **/
+rasqal_algebra_node*
+rasqal_new_path_algebra_node(rasqal_query* query,
+                             raptor_sequence* triples, int column)
+{
+  rasqal_algebra_node* node;
+
+  if(!query || !triples)
+    return NULL;
+  
+  node = rasqal_new_algebra_node(query, RASQAL_ALGEBRA_OPERATOR_PATH);
+  if(!node)
+    return NULL;
+
+  node->triples = triples;
+  node->start_column = column;
+  node->end_column = column;
+
+  return node;
+}
+
+
 /*
  * rasqal_new_empty_algebra_node:
  * @query: #rasqal_query query object
@@ -420,6 +451,40 @@ rasqal_new_distinct_algebra_node(rasqal_query* query,
 }
 
 
+/*
+ * rasqal_new_reduced_algebra_node:
+ * @query: #rasqal_query query object
+ * @node1: inner algebra node
+ *
+ * INTERNAL - Create a new REDUCED algebra node for an inner node
+ * 
+ * The input @node becomes owned by the new node
+ *
+ * Return value: a new #rasqal_algebra_node object or NULL on failure
+ **/
+rasqal_algebra_node*
+rasqal_new_reduced_algebra_node(rasqal_query* query,
+                                rasqal_algebra_node* node1)
+{
+  rasqal_algebra_node* node;
+
+  if(!query || !node1)
+    goto fail;
+
+  node = rasqal_new_algebra_node(query, RASQAL_ALGEBRA_OPERATOR_REDUCED);
+  if(node) {
+    node->node1 = node1;
+    return node;
+  }
+
+  fail:
+  if(node1)
+    rasqal_free_algebra_node(node1);
+
+  return NULL;
+}
+
+
 /*
  * rasqal_new_graph_algebra_node:
  * @query: #rasqal_query query object
@@ -796,7 +861,8 @@ static struct {
   { "Aggregate", 9 },
   { "Having", 6 },
   { "Values", 6 },
-  { "Service", 7 }
+  { "Service", 7 },
+  { "Path", 4 }
 };
 
 
@@ -864,7 +930,8 @@ rasqal_algebra_algebra_node_write_internal(rasqal_algebra_node *node,
   indent += indent_delta;
   rasqal_algebra_write_indent(iostr, indent);
 
-  if(node->op == RASQAL_ALGEBRA_OPERATOR_BGP) {
+  if(node->op == RASQAL_ALGEBRA_OPERATOR_BGP ||
+     node->op == RASQAL_ALGEBRA_OPERATOR_PATH) {
     int i;
     
     for(i = node->start_column; i <= node->end_column; i++) {
@@ -1307,6 +1374,29 @@ rasqal_algebra_group_graph_pattern_to_algebra(rasqal_query* query,
           true_expr = NULL; /* now owned by gnode */
         }
       } /* end for all optional */
+    } else if(egp->op == RASQAL_GRAPH_PATTERN_OPERATOR_MINUS) {
+      /* If E is of the form MINUS{P} */
+      rasqal_graph_pattern* sgp;
+      rasqal_algebra_node* anode;
+
+      sgp = rasqal_graph_pattern_get_sub_graph_pattern(egp, 0);
+      if(!sgp)
+        goto fail;
+
+      /* Let A := Transform(P) */
+      anode = rasqal_algebra_graph_pattern_to_algebra(query, sgp);
+      if(!anode) {
+        RASQAL_DEBUG1("rasqal_algebra_graph_pattern_to_algebra() failed\n");
+        goto fail;
+      }
+
+      /* G := Minus(G, A) */
+      gnode = rasqal_new_2op_algebra_node(query, RASQAL_ALGEBRA_OPERATOR_DIFF,
+                                          gnode, anode);
+      if(!gnode) {
+        RASQAL_DEBUG1("rasqal_new_2op_algebra_node() failed\n");
+        goto fail;
+      }
     } else {
       /* If E is any other form:*/
       rasqal_algebra_node* anode;
@@ -1579,6 +1669,12 @@ rasqal_algebra_graph_pattern_to_algebra(rasqal_query* query,
       node = rasqal_algebra_service_graph_pattern_to_algebra(query, gp);
       break;
 
+    case RASQAL_GRAPH_PATTERN_OPERATOR_PATH:
+      node = rasqal_new_path_algebra_node(query,
+                                          rasqal_query_get_triple_sequence(query),
+                                          gp->start_column);
+      break;
+
     case RASQAL_GRAPH_PATTERN_OPERATOR_MINUS:
 
     case RASQAL_GRAPH_PATTERN_OPERATOR_UNKNOWN:
@@ -1622,6 +1718,181 @@ rasqal_algebra_node_is_empty(rasqal_algebra_node* node)
 }
 
 
+typedef struct {
+  rasqal_query* query;
+
+  /* array of query variables count: non-0 if the variable is mentioned */
+  char* marks;
+} rasqal_algebra_variable_marks;
+
+
+static void
+rasqal_algebra_mark_literal_variable(rasqal_algebra_variable_marks* vm,
+                                     rasqal_literal* l)
+{
+  rasqal_variable* v;
+
+  if(!l)
+    return;
+
+  v = rasqal_literal_as_variable(l);
+  if(v)
+    vm->marks[v->offset] = 1;
+}
+
+
+static int
+rasqal_algebra_mark_expression_variables(void *user_data, rasqal_expression *e)
+{
+  rasqal_algebra_variable_marks* vm = (rasqal_algebra_variable_marks*)user_data;
+
+  if(e->op == RASQAL_EXPR_LITERAL)
+    rasqal_algebra_mark_literal_variable(vm, e->literal);
+  else if(e->op == RASQAL_EXPR_EXISTS || e->op == RASQAL_EXPR_NOT_EXISTS) {
+    /* the graph pattern may use any variable */
+    int size;
+
+    size = rasqal_variables_table_get_total_variables_count(vm->query->vars_table);
+    memset(vm->marks, 1, RASQAL_GOOD_CAST(size_t, size));
+  }
+
+  return 0;
+}
+
+
+static void
+rasqal_algebra_mark_expressions_variables(rasqal_algebra_variable_marks* vm,
+                                          raptor_sequence* seq)
+{
+  rasqal_expression* e;
+  int i;
+
+  for(i = 0; (e = (rasqal_expression*)raptor_sequence_get_at(seq, i)); i++)
+    rasqal_expression_visit(e, rasqal_algebra_mark_expression_variables, vm);
+}
+
+
+/*
+ * rasqal_algebra_node_mark_variables:
+ * @vm: variable marks
+ * @node: algebra node tree
+ * @skip: algebra node subtree to skip or NULL
+ *
+ * INTERNAL - Mark the variables mentioned in an algebra node tree
+ *
+ * Marks the variables of triples, expressions, assignments, GRAPH
+ * and VALUES but not those only projected.
+ */
+static void
+rasqal_algebra_node_mark_variables(rasqal_algebra_variable_marks* vm,
+                                   rasqal_algebra_node* node,
+                                   rasqal_algebra_node* skip)
+{
+  if(!node || node == skip)
+    return;
+
+  if(node->triples) {
+    int column;
+
+    for(column = node->start_column; column <= node->end_column; column++) {
+      rasqal_triple* t;
+
+      t = (rasqal_triple*)raptor_sequence_get_at(node->triples, column);
+      if(!t)
+        continue;
+      rasqal_algebra_mark_literal_variable(vm, t->subject);
+      rasqal_algebra_mark_literal_variable(vm, t->predicate);
+      rasqal_algebra_mark_literal_variable(vm, t->object);
+      rasqal_algebra_mark_literal_variable(vm, t->origin);
+    }
+  }
+
+  if(node->expr)
+    rasqal_expression_visit(node->expr,
+                            rasqal_algebra_mark_expression_variables, vm);
+
+  if(node->seq)
+    rasqal_algebra_mark_expressions_variables(vm, node->seq);
+
+  if(node->var)
+    vm->marks[node->var->offset] = 1;
+
+  if(node->graph)
+    rasqal_algebra_mark_literal_variable(vm, node->graph);
+
+  if(node->bindings) {
+    rasqal_variable* v;
+    int i;
+
+    for(i = 0;
+        (v = (rasqal_variable*)raptor_sequence_get_at(node->bindings->variables, i));
+        i++)
+      vm->marks[v->offset] = 1;
+  }
+
+  rasqal_algebra_node_mark_variables(vm, node->node1, skip);
+  rasqal_algebra_node_mark_variables(vm, node->node2, skip);
+}
+
+
+/*
+ * rasqal_algebra_node_is_correlated:
+ * @root: algebra node tree
+ * @node: algebra node subtree of @root
+ *
+ * INTERNAL - Check if a subtree mentions a variable that is also mentioned outside it
+ *
+ * Rowsources read the values of variables bound outside them from
+ * the shared variables so such a subtree may return different rows
+ * each time it is executed.
+ *
+ * Return value: non-0 if correlated or on failure
+ */
+int
+rasqal_algebra_node_is_correlated(rasqal_algebra_node* root,
+                                  rasqal_algebra_node* node)
+{
+  rasqal_query* query = node->query;
+  rasqal_algebra_variable_marks inside;
+  rasqal_algebra_variable_marks outside;
+  size_t size;
+  size_t i;
+  int correlated = 0;
+
+  size = RASQAL_GOOD_CAST(size_t,
+                          rasqal_variables_table_get_total_variables_count(query->vars_table));
+  if(!size)
+    return 0;
+
+  inside.query = query;
+  inside.marks = RASQAL_CALLOC(char*, size, sizeof(char));
+  outside.query = query;
+  outside.marks = RASQAL_CALLOC(char*, size, sizeof(char));
+  if(!inside.marks || !outside.marks) {
+    correlated = 1;
+    goto tidy;
+  }
+
+  rasqal_algebra_node_mark_variables(&inside, node, NULL);
+  rasqal_algebra_node_mark_variables(&outside, root, node);
+
+  for(i = 0; i < size; i++) {
+    if(inside.marks[i] && outside.marks[i]) {
+      correlated = 1;
+      break;
+    }
+  }
+
+  tidy:
+  if(inside.marks)
+    RASQAL_FREE(char*, inside.marks);
+  if(outside.marks)
+    RASQAL_FREE(char*, outside.marks);
+
+  return correlated;
+}
+
+
 static int
 rasqal_algebra_remove_znodes(rasqal_query* query, rasqal_algebra_node* node,
                              void* data)
@@ -2018,6 +2289,34 @@ rasqal_algebra_query_to_algebra(rasqal_query* query)
 }
 
 
+/**
+ * rasqal_algebra_exists_graph_pattern_to_algebra:
+ * @query: #rasqal_query to operate on
+ * @gp: graph pattern of an EXISTS or NOT EXISTS expression
+ *
+ * INTERNAL - Turn the graph pattern of an EXISTS expression into query algebra
+ *
+ * Return value: algebra expression or NULL on failure
+ */
+rasqal_algebra_node*
+rasqal_algebra_exists_graph_pattern_to_algebra(rasqal_query* query,
+                                               rasqal_graph_pattern* gp)
+{
+  rasqal_algebra_node* node;
+  int modified = 0;
+
+  node = rasqal_algebra_graph_pattern_to_algebra(query, gp);
+  if(!node)
+    return NULL;
+
+  rasqal_algebra_node_visit(query, node, 
+                            rasqal_algebra_remove_znodes,
+                            &modified);
+
+  return node;
+}
+
+
 void
 rasqal_free_algebra_aggregate(rasqal_algebra_aggregate* ae)
 {
@@ -2067,6 +2366,57 @@ rasqal_algebra_replace_aggregate_expressions(rasqal_query* query,
 }
 
 
+/* Copy a sequence of #rasqal_variable as new variable references */
+static raptor_sequence*
+rasqal_algebra_copy_variables_sequence(raptor_sequence* vars_seq)
+{
+  raptor_sequence* seq;
+  rasqal_variable* v;
+  int i;
+
+  seq = raptor_new_sequence((raptor_data_free_handler)rasqal_free_variable,
+                            (raptor_data_print_handler)rasqal_variable_print);
+  if(!seq)
+    return NULL;
+
+  for(i = 0; (v = (rasqal_variable*)raptor_sequence_get_at(vars_seq, i)); i++) {
+    if(raptor_sequence_push(seq, rasqal_new_variable_from_variable(v))) {
+      raptor_free_sequence(seq);
+      return NULL;
+    }
+  }
+
+  return seq;
+}
+
+
+/*
+ * rasqal_algebra_aggregate_copy_saved:
+ * @ae: aggregate expression data
+ *
+ * INTERNAL - Fill aggregate expression data from the query saved extraction
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_algebra_aggregate_copy_saved(rasqal_algebra_aggregate* ae)
+{
+  rasqal_query* query = ae->query;
+
+  ae->agg_exprs = rasqal_expression_copy_expression_sequence(query->agg_exprs);
+  if(!ae->agg_exprs)
+    return 1;
+
+  ae->agg_vars_seq = rasqal_algebra_copy_variables_sequence(query->agg_vars);
+  if(!ae->agg_vars_seq)
+    return 1;
+
+  ae->counter = raptor_sequence_size(ae->agg_exprs);
+
+  return 0;
+}
+
+
 /**
  * rasqal_algebra_query_prepare_aggregates:
  * @query: #rasqal_query to read from
@@ -2076,6 +2426,11 @@ rasqal_algebra_replace_aggregate_expressions(rasqal_query* query,
  *
  * INTERNAL - prepare query aggregates
  *
+ * The first call rewrites the aggregate expressions in @projection
+ * and the HAVING conditions into internal variables and saves the
+ * extracted expressions in the query.  Later calls for the same
+ * query, when the algebra is built again, return those instead.
+ *
  * Return value: aggregate expression data or NULL on failure
  */
 rasqal_algebra_aggregate*
@@ -2090,6 +2445,18 @@ rasqal_algebra_query_prepare_aggregates(rasqal_query* query,
   if(!ae)
     return NULL;
 
+  ae->query = query;
+
+  if(query->agg_exprs) {
+    /* already extracted by an earlier algebra build */
+    if(rasqal_algebra_aggregate_copy_saved(ae)) {
+      rasqal_free_algebra_aggregate(ae);
+      rasqal_free_algebra_node(node);
+      return NULL;
+    }
+    return ae;
+  }
+
   if(rasqal_algebra_extract_aggregate_expressions(query, node, ae, projection)) {
     RASQAL_DEBUG1("rasqal_algebra_extract_aggregate_expressions() failed\n");
     rasqal_free_algebra_aggregate(ae);
@@ -2133,6 +2500,16 @@ rasqal_algebra_query_prepare_aggregates(rasqal_query* query,
       return NULL;
     }
   }
+
+  if(ae->counter) {
+    query->agg_exprs = rasqal_expression_copy_expression_sequence(ae->agg_exprs);
+    query->agg_vars = rasqal_algebra_copy_variables_sequence(ae->agg_vars_seq);
+    if(!query->agg_exprs || !query->agg_vars) {
+      rasqal_free_algebra_aggregate(ae);
+      rasqal_free_algebra_node(node);
+      return NULL;
+    }
+  }
   
   return ae;
 }
@@ -2470,7 +2847,16 @@ rasqal_algebra_query_add_distinct(rasqal_query* query,
   if(!projection)
     return node;
 
-  if(projection->distinct) {
+  if(projection->distinct == RASQAL_PROJECTION_REDUCED) {
+    /* SPARQL REDUCED */
+    node = rasqal_new_reduced_algebra_node(query, node);
+
+#if defined(RASQAL_DEBUG) && RASQAL_DEBUG > 1
+    RASQAL_DEBUG1("modified after adding reduced node, algebra node now:\n  ");
+    rasqal_algebra_node_print(node, stderr);
+    fputs("\n", stderr);
+#endif
+  } else if(projection->distinct) {
     node = rasqal_new_distinct_algebra_node(query, node);
 
 #if defined(RASQAL_DEBUG) && RASQAL_DEBUG > 1
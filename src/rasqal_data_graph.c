@@ -41,6 +41,8 @@
 #include "rasqal_internal.h"
 
 
+#ifndef STANDALONE
+
 static rasqal_data_graph*
 rasqal_new_data_graph_common(rasqal_world* world,
                              raptor_uri* uri,
@@ -177,6 +179,56 @@ rasqal_new_data_graph_from_iostream(rasqal_world* world,
 }
 
 
+/**
+ * rasqal_new_data_graph_from_triples:
+ * @world: rasqal_world object
+ * @name_uri: name of graph (or NULL)
+ * @flags: %RASQAL_DATA_GRAPH_NAMED or %RASQAL_DATA_GRAPH_BACKGROUND
+ *
+ * Constructor - create a new empty #rasqal_data_graph held in memory
+ *
+ * Triples are added with rasqal_data_graph_add_triples() or
+ * rasqal_data_graph_add_statements() and are used directly by the
+ * built-in triples store without serializing and parsing them.
+ *
+ * The @name_uri is used when the flags are %RASQAL_DATA_GRAPH_NAMED.
+ * Graph names of quads added to the data graph are named graphs of
+ * the query dataset.
+ *
+ * Executing a query with such a data graph fails when a triples
+ * source factory other than the built-in one has been set with
+ * rasqal_set_triples_source_factory().
+ *
+ * Return value: a new #rasqal_data_graph or NULL on failure.
+ **/
+rasqal_data_graph*
+rasqal_new_data_graph_from_triples(rasqal_world* world,
+                                   raptor_uri* name_uri,
+                                   unsigned int flags)
+{
+  rasqal_data_graph* dg;
+
+  RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(world, rasqal_world, NULL);
+
+  dg = rasqal_new_data_graph_common(world,
+                                    /* uri */ NULL,
+                                    /* iostr */ NULL, /* base URI */ NULL,
+                                    name_uri, flags,
+                                    NULL, NULL, NULL);
+  if(!dg)
+    return NULL;
+
+  dg->triples = RASQAL_CALLOC(struct rasqal_data_graph_triples_s*, 1,
+                              sizeof(*dg->triples));
+  if(!dg->triples) {
+    rasqal_free_data_graph(dg);
+    return NULL;
+  }
+
+  return dg;
+}
+
+
 /**
  * rasqal_new_data_graph_from_data_graph:
  * @dg: #rasqal_data_graph object to copy or NULL
@@ -222,6 +274,22 @@ rasqal_free_data_graph(rasqal_data_graph* dg)
     raptor_free_uri(dg->format_uri);
   if(dg->base_uri)
     raptor_free_uri(dg->base_uri);
+  if(dg->triples) {
+    int i;
+
+    for(i = 0; i < dg->triples->count; i++) {
+      rasqal_triple* t = &dg->triples->triples[i];
+
+      rasqal_free_literal(t->subject);
+      rasqal_free_literal(t->predicate);
+      rasqal_free_literal(t->object);
+      if(t->origin)
+        rasqal_free_literal(t->origin);
+    }
+    if(dg->triples->triples)
+      RASQAL_FREE(rasqal_triple*, dg->triples->triples);
+    RASQAL_FREE(rasqal_data_graph_triples, dg->triples);
+  }
 
   RASQAL_FREE(rasqal_data_graph, dg);
 }
@@ -244,7 +312,15 @@ rasqal_data_graph_print(rasqal_data_graph* dg, FILE* fh)
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(dg, rasqal_data_graph, 1);
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(fh, FILE*, 1);
 
-  if(dg->iostr) {
+  if(dg->triples) {
+    if(dg->name_uri)
+      fprintf(fh, "data graph(from %d triples, named as %s, flags %u",
+              dg->triples->count, raptor_uri_as_string(dg->name_uri),
+              dg->flags);
+    else
+      fprintf(fh, "data graph(from %d triples, flags %u",
+              dg->triples->count, dg->flags);
+  } else if(dg->iostr) {
     if(dg->name_uri)
       fprintf(fh, "data graph(from iostream, named as %s, flags %u",
               raptor_uri_as_string(dg->name_uri), dg->flags);
@@ -277,3 +353,521 @@ rasqal_data_graph_print(rasqal_data_graph* dg, FILE* fh)
   
   return 0;
 }
+
+
+/*
+ * rasqal_data_graph_ensure_triples:
+ * @dg: #rasqal_data_graph object held in memory
+ * @count: number of triples to be added
+ *
+ * INTERNAL - Make room for more triples in a data graph
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_data_graph_ensure_triples(rasqal_data_graph* dg, int count)
+{
+  struct rasqal_data_graph_triples_s* dgt = dg->triples;
+  rasqal_triple* new_triples;
+  int new_size;
+
+  if(dgt->count + count <= dgt->size)
+    return 0;
+
+  new_size = dgt->size ? dgt->size : 1024;
+  while(new_size < dgt->count + count)
+    new_size *= 2;
+
+  new_triples = RASQAL_CALLOC(rasqal_triple*, RASQAL_GOOD_CAST(size_t, new_size),
+                              sizeof(rasqal_triple));
+  if(!new_triples)
+    return 1;
+
+  if(dgt->triples) {
+    memcpy(new_triples, dgt->triples,
+           RASQAL_GOOD_CAST(size_t, dgt->count) * sizeof(rasqal_triple));
+    RASQAL_FREE(rasqal_triple*, dgt->triples);
+  }
+  dgt->triples = new_triples;
+  dgt->size = new_size;
+
+  return 0;
+}
+
+
+/**
+ * rasqal_data_graph_add_triples:
+ * @dg: #rasqal_data_graph object from rasqal_new_data_graph_from_triples()
+ * @triples: array of triples
+ * @count: number of triples in @triples
+ *
+ * Add triples to a data graph held in memory
+ *
+ * The subject, predicate and object literals of each triple are
+ * required.  A triple with an origin literal is a quad in that graph
+ * rather than in the data graph.  The data graph takes new references
+ * to the literals; @triples is not changed.
+ *
+ * On failure the triples before the failing one have been added.
+ *
+ * Return value: non-0 on failure
+ **/
+int
+rasqal_data_graph_add_triples(rasqal_data_graph* dg,
+                              rasqal_triple* triples, int count)
+{
+  int i;
+
+  RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(dg, rasqal_data_graph, 1);
+
+  if(!dg->triples || count < 0 || (count && !triples))
+    return 1;
+
+  if(rasqal_data_graph_ensure_triples(dg, count))
+    return 1;
+
+  for(i = 0; i < count; i++) {
+    rasqal_triple* from = &triples[i];
+    rasqal_triple* t;
+
+    if(!from->subject || !from->predicate || !from->object)
+      return 1;
+
+    t = &dg->triples->triples[dg->triples->count++];
+    t->subject = rasqal_new_literal_from_literal(from->subject);
+    t->predicate = rasqal_new_literal_from_literal(from->predicate);
+    t->object = rasqal_new_literal_from_literal(from->object);
+    if(from->origin)
+      t->origin = rasqal_new_literal_from_literal(from->origin);
+  }
+
+  return 0;
+}
+
+
+/**
+ * rasqal_data_graph_add_statements:
+ * @dg: #rasqal_data_graph object from rasqal_new_data_graph_from_triples()
+ * @statements: array of statements
+ * @count: number of statements in @statements
+ *
+ * Add raptor statements to a data graph held in memory
+ *
+ * A statement with a graph term is a quad in that graph rather than
+ * in the data graph.  A term equal to the one in the same position of
+ * the statement before shares its literal so input sorted by subject
+ * makes fewer literals.  @statements is not changed.
+ *
+ * On failure the statements before the failing one have been added.
+ *
+ * Return value: non-0 on failure
+ **/
+int
+rasqal_data_graph_add_statements(rasqal_data_graph* dg,
+                                 raptor_statement* statements, int count)
+{
+  raptor_term* prev_terms[4] = { NULL, NULL, NULL, NULL };
+  rasqal_literal* prev_literals[4] = { NULL, NULL, NULL, NULL };
+  int i;
+
+  RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(dg, rasqal_data_graph, 1);
+
+  if(!dg->triples || count < 0 || (count && !statements))
+    return 1;
+
+  if(rasqal_data_graph_ensure_triples(dg, count))
+    return 1;
+
+  for(i = 0; i < count; i++) {
+    raptor_statement* statement = &statements[i];
+    raptor_term* terms[4];
+    rasqal_literal* literals[4];
+    rasqal_triple* t;
+    int j;
+
+    terms[0] = statement->subject;
+    terms[1] = statement->predicate;
+    terms[2] = statement->object;
+    terms[3] = statement->graph;
+
+    if(!terms[0] || !terms[1] || !terms[2])
+      return 1;
+
+    for(j = 0; j < 4; j++) {
+      literals[j] = NULL;
+      if(!terms[j])
+        continue;
+
+      if(prev_terms[j] &&
+         (prev_terms[j] == terms[j] || raptor_term_equals(prev_terms[j], terms[j])))
+        literals[j] = rasqal_new_literal_from_literal(prev_literals[j]);
+      else
+        literals[j] = rasqal_new_literal_from_term(dg->world, terms[j]);
+
+      if(!literals[j]) {
+        while(j-- > 0) {
+          if(literals[j])
+            rasqal_free_literal(literals[j]);
+        }
+        return 1;
+      }
+    }
+
+    t = &dg->triples->triples[dg->triples->count++];
+    t->subject = literals[0];
+    t->predicate = literals[1];
+    t->object = literals[2];
+    t->origin = literals[3];
+
+    /* the literals are held by the triple so can be borrowed here */
+    for(j = 0; j < 4; j++) {
+      prev_terms[j] = terms[j];
+      prev_literals[j] = literals[j];
+    }
+  }
+
+  return 0;
+}
+
+
+/*
+ * rasqal_data_graph_add_graph_name:
+ * @names: sequence of #raptor_uri graph names
+ * @uri: graph name
+ *
+ * INTERNAL - Add a copy of a graph name to a sequence unless it is there
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_data_graph_add_graph_name(raptor_sequence* names, raptor_uri* uri)
+{
+  raptor_uri* name;
+  int i;
+
+  for(i = 0; (name = (raptor_uri*)raptor_sequence_get_at(names, i)); i++) {
+    if(raptor_uri_equals(name, uri))
+      return 0;
+  }
+
+  return raptor_sequence_push(names, raptor_uri_copy(uri));
+}
+
+
+/*
+ * rasqal_data_graph_add_graph_names:
+ * @dg: #rasqal_data_graph object
+ * @names: sequence of #raptor_uri graph names
+ *
+ * INTERNAL - Add the graph names of a data graph to a sequence
+ *
+ * The name of a named data graph is added as are the graph names of
+ * the quads of a data graph held in memory.  Names already in @names
+ * are not added again.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_data_graph_add_graph_names(rasqal_data_graph* dg,
+                                  raptor_sequence* names)
+{
+  rasqal_literal* prev_origin = NULL;
+  int i;
+
+  if(dg->name_uri &&
+     rasqal_data_graph_add_graph_name(names, dg->name_uri))
+    return 1;
+
+  if(!dg->triples)
+    return 0;
+
+  for(i = 0; i < dg->triples->count; i++) {
+    rasqal_literal* origin = dg->triples->triples[i].origin;
+
+    /* quads are usually grouped by graph */
+    if(!origin || origin == prev_origin ||
+       origin->type != RASQAL_LITERAL_URI)
+      continue;
+    prev_origin = origin;
+
+    if(rasqal_data_graph_add_graph_name(names, origin->value.uri))
+      return 1;
+  }
+
+  return 0;
+}
+
+
+/*
+ * rasqal_data_graph_has_graph_name:
+ * @dg: #rasqal_data_graph object
+ * @uri: graph name
+ *
+ * INTERNAL - Test if a data graph is or contains a graph with a name
+ *
+ * Return value: non-0 if @dg is named @uri or holds quads in graph @uri
+ */
+int
+rasqal_data_graph_has_graph_name(rasqal_data_graph* dg, raptor_uri* uri)
+{
+  int i;
+
+  if(dg->name_uri && raptor_uri_equals(dg->name_uri, uri))
+    return 1;
+
+  if(!dg->triples)
+    return 0;
+
+  for(i = 0; i < dg->triples->count; i++) {
+    rasqal_literal* origin = dg->triples->triples[i].origin;
+
+    if(origin && origin->type == RASQAL_LITERAL_URI &&
+       raptor_uri_equals(origin->value.uri, uri))
+      return 1;
+  }
+
+  return 0;
+}
+
+
+#endif /* not STANDALONE */
+
+
+
+#ifdef STANDALONE
+
+/* one more prototype */
+int main(int argc, char *argv[]);
+
+
+#define EX_NS "http://example.org/"
+
+
+/*
+ * Run a query over one data graph returning the number of result
+ * rows or -1 on failure
+ */
+static int
+data_graph_test_query(rasqal_world* world, rasqal_data_graph* dg,
+                      const char* query_string)
+{
+  rasqal_query* query;
+  rasqal_query_results* results = NULL;
+  int count = -1;
+
+  query = rasqal_new_query(world, "sparql", NULL);
+  if(!query)
+    return -1;
+
+  if(rasqal_query_prepare(query,
+                          RASQAL_GOOD_CAST(const unsigned char*, query_string),
+                          NULL))
+    goto tidy;
+
+  if(rasqal_query_add_data_graph(query, rasqal_new_data_graph_from_data_graph(dg)))
+    goto tidy;
+
+  results = rasqal_query_execute(query);
+  if(!results)
+    goto tidy;
+
+  count = 0;
+  while(!rasqal_query_results_finished(results)) {
+    count++;
+    rasqal_query_results_next(results);
+  }
+
+  tidy:
+  if(results)
+    rasqal_free_query_results(results);
+  rasqal_free_query(query);
+
+  return count;
+}
+
+
+static raptor_term*
+data_graph_test_uri_term(raptor_world* raptor_world_ptr, const char* uri_string)
+{
+  raptor_uri* uri;
+  raptor_term* term;
+
+  uri = raptor_new_uri(raptor_world_ptr,
+                       RASQAL_GOOD_CAST(const unsigned char*, uri_string));
+  if(!uri)
+    return NULL;
+
+  term = raptor_new_term_from_uri(raptor_world_ptr, uri);
+  raptor_free_uri(uri);
+
+  return term;
+}
+
+
+#define DATA_GRAPH_QUERIES_COUNT 5
+
+static const struct {
+  const char* query_string;
+  int expected_triples;
+  int expected_statements;
+} data_graph_queries[DATA_GRAPH_QUERIES_COUNT] = {
+  /* triples in the background graph */
+  { "SELECT ?s ?o WHERE { ?s <" EX_NS "p> ?o }", 2, 2 },
+  /* all graph names bound from the data */
+  { "SELECT ?g ?s WHERE { GRAPH ?g { ?s ?p ?o } }", 1, 2 },
+  /* all graph names enumerated by the graph rowsource */
+  { "SELECT ?g ?s WHERE { GRAPH ?g { ?s ?p ?o FILTER(BOUND(?s)) } }", 1, 2 },
+  /* a quad graph name */
+  { "SELECT ?s WHERE { GRAPH <" EX_NS "g1> { ?s ?p ?o } }", 1, 1 },
+  /* a missing graph name */
+  { "SELECT ?s WHERE { GRAPH <" EX_NS "g3> { ?s ?p ?o } }", 0, 0 }
+};
+
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  rasqal_world* world = NULL;
+  raptor_world* raptor_world_ptr;
+  rasqal_data_graph* triples_dg = NULL;
+  rasqal_data_graph* statements_dg = NULL;
+  rasqal_literal* l[6] = { NULL, NULL, NULL, NULL, NULL, NULL };
+  rasqal_triple triples[3];
+  raptor_statement statements[4];
+  raptor_term* terms[7] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+  int failures = 0;
+  int i;
+
+  world = rasqal_new_world();
+  if(!world || rasqal_world_open(world)) {
+    fprintf(stderr, "%s: rasqal_world init failed\n", program);
+    return 1;
+  }
+  raptor_world_ptr = rasqal_world_get_raptor(world);
+
+  terms[0] = data_graph_test_uri_term(raptor_world_ptr, EX_NS "s1");
+  terms[1] = data_graph_test_uri_term(raptor_world_ptr, EX_NS "s2");
+  terms[2] = data_graph_test_uri_term(raptor_world_ptr, EX_NS "p");
+  terms[3] = data_graph_test_uri_term(raptor_world_ptr, EX_NS "q");
+  terms[4] = raptor_new_term_from_literal(raptor_world_ptr,
+                                          RASQAL_GOOD_CAST(const unsigned char*, "o"),
+                                          NULL, NULL);
+  terms[5] = data_graph_test_uri_term(raptor_world_ptr, EX_NS "g1");
+  terms[6] = data_graph_test_uri_term(raptor_world_ptr, EX_NS "g2");
+  for(i = 0; i < 7; i++) {
+    if(!terms[i]) {
+      fprintf(stderr, "%s: failed to create term %d\n", program, i);
+      failures++;
+      goto tidy;
+    }
+  }
+
+  /* s1 p o ; s2 p o ; s1 q o in graph g1 */
+  for(i = 0; i < 6; i++) {
+    l[i] = rasqal_new_literal_from_term(world, terms[i]);
+    if(!l[i]) {
+      fprintf(stderr, "%s: failed to create literal %d\n", program, i);
+      failures++;
+      goto tidy;
+    }
+  }
+
+  memset(triples, '\0', sizeof(triples));
+  triples[0].subject = l[0]; triples[0].predicate = l[2];
+  triples[0].object = l[4];
+  triples[1].subject = l[1]; triples[1].predicate = l[2];
+  triples[1].object = l[4];
+  triples[2].subject = l[0]; triples[2].predicate = l[3];
+  triples[2].object = l[4]; triples[2].origin = l[5];
+
+  triples_dg = rasqal_new_data_graph_from_triples(world, NULL,
+                                                  RASQAL_DATA_GRAPH_BACKGROUND);
+  if(!triples_dg) {
+    fprintf(stderr, "%s: rasqal_new_data_graph_from_triples() failed\n",
+            program);
+    failures++;
+    goto tidy;
+  }
+
+  /* two calls to check adding grows the graph */
+  if(rasqal_data_graph_add_triples(triples_dg, triples, 1) ||
+     rasqal_data_graph_add_triples(triples_dg, &triples[1], 2)) {
+    fprintf(stderr, "%s: rasqal_data_graph_add_triples() failed\n", program);
+    failures++;
+    goto tidy;
+  }
+
+  /* a triple without an object is rejected */
+  triples[0].object = NULL;
+  if(!rasqal_data_graph_add_triples(triples_dg, triples, 1)) {
+    fprintf(stderr,
+            "%s: rasqal_data_graph_add_triples() accepted a partial triple\n",
+            program);
+    failures++;
+  }
+  triples[0].object = l[4];
+
+  /* the same data as statements with a second quad in graph g2 */
+  memset(statements, '\0', sizeof(statements));
+  for(i = 0; i < 4; i++)
+    statements[i].world = raptor_world_ptr;
+  statements[0].subject = terms[0]; statements[0].predicate = terms[2];
+  statements[0].object = terms[4];
+  statements[1].subject = terms[1]; statements[1].predicate = terms[2];
+  statements[1].object = terms[4];
+  statements[2].subject = terms[0]; statements[2].predicate = terms[3];
+  statements[2].object = terms[4]; statements[2].graph = terms[5];
+  statements[3].subject = terms[1]; statements[3].predicate = terms[3];
+  statements[3].object = terms[4]; statements[3].graph = terms[6];
+
+  statements_dg = rasqal_new_data_graph_from_triples(world, NULL,
+                                                     RASQAL_DATA_GRAPH_BACKGROUND);
+  if(!statements_dg ||
+     rasqal_data_graph_add_statements(statements_dg, statements, 4)) {
+    fprintf(stderr, "%s: rasqal_data_graph_add_statements() failed\n",
+            program);
+    failures++;
+    goto tidy;
+  }
+
+  for(i = 0; i < DATA_GRAPH_QUERIES_COUNT; i++) {
+    const char* query_string = data_graph_queries[i].query_string;
+    int count;
+
+    count = data_graph_test_query(world, triples_dg, query_string);
+    if(count != data_graph_queries[i].expected_triples) {
+      fprintf(stderr,
+              "%s: query %d over triples returned %d rows, expected %d\n",
+              program, i, count, data_graph_queries[i].expected_triples);
+      failures++;
+    }
+
+    count = data_graph_test_query(world, statements_dg, query_string);
+    if(count != data_graph_queries[i].expected_statements) {
+      fprintf(stderr,
+              "%s: query %d over statements returned %d rows, expected %d\n",
+              program, i, count, data_graph_queries[i].expected_statements);
+      failures++;
+    }
+  }
+
+  tidy:
+  for(i = 0; i < 7; i++) {
+    if(terms[i])
+      raptor_free_term(terms[i]);
+  }
+  for(i = 0; i < 6; i++) {
+    if(l[i])
+      rasqal_free_literal(l[i]);
+  }
+  if(triples_dg)
+    rasqal_free_data_graph(triples_dg);
+  if(statements_dg)
+    rasqal_free_data_graph(statements_dg);
+  rasqal_free_world(world);
+
+  return failures;
+}
+
+#endif /* STANDALONE */
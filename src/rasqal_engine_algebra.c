@@ -47,7 +47,7 @@ typedef struct {
   rasqal_query* query;
   rasqal_query_results* query_results;
 
-  /* query algebra representation of query */
+  /* query algebra representation of query SHARED with query */
   rasqal_algebra_node* algebra_node;
 
   /* number of nodes in #algebra_node tree */
@@ -57,6 +57,13 @@ typedef struct {
   rasqal_rowsource* rowsource;
 
   rasqal_triples_source* triples_source;
+
+  /* algebra nodes of FILTER EXISTS patterns used by the rowsources */
+  raptor_sequence* exists_nodes;
+
+  /* batch of result rows read from #rowsource and next row to return */
+  rasqal_row_batch* batch;
+  int batch_index;
 } rasqal_engine_algebra_data;
 
 
@@ -89,6 +96,123 @@ rasqal_algebra_basic_algebra_node_to_rowsource(rasqal_engine_algebra_data* execu
 }
 
 
+static rasqal_rowsource*
+rasqal_algebra_path_algebra_node_to_rowsource(rasqal_engine_algebra_data* execution_data,
+                                              rasqal_algebra_node* node,
+                                              rasqal_engine_error *error_p)
+{
+  rasqal_query *query = execution_data->query;
+  
+  return rasqal_new_path_rowsource(query->world, query,
+                                   execution_data->triples_source,
+                                   node->triples, node->start_column);
+}
+
+
+/*
+ * rasqal_algebra_filter_split_conjuncts:
+ * @e: FILTER expression
+ * @exists_seq: sequence to add EXISTS conjuncts to
+ * @other_seq: sequence to add all other conjuncts to
+ *
+ * INTERNAL - Split a FILTER expression into AND conjuncts
+ *
+ * EXISTS, NOT EXISTS and their negations with ! go into @exists_seq
+ * so that they can be evaluated as semi-joins and anti-joins.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_algebra_filter_split_conjuncts(rasqal_expression* e,
+                                      raptor_sequence* exists_seq,
+                                      raptor_sequence* other_seq)
+{
+  raptor_sequence* seq = other_seq;
+
+  if(e->op == RASQAL_EXPR_AND)
+    return rasqal_algebra_filter_split_conjuncts(e->arg1, exists_seq,
+                                                 other_seq) ||
+           rasqal_algebra_filter_split_conjuncts(e->arg2, exists_seq,
+                                                 other_seq);
+
+  if(e->op == RASQAL_EXPR_EXISTS || e->op == RASQAL_EXPR_NOT_EXISTS ||
+     (e->op == RASQAL_EXPR_BANG &&
+      (e->arg1->op == RASQAL_EXPR_EXISTS ||
+       e->arg1->op == RASQAL_EXPR_NOT_EXISTS)))
+    seq = exists_seq;
+
+  e = rasqal_new_expression_from_expression(e);
+  if(!e)
+    return 1;
+
+  return raptor_sequence_push(seq, e);
+}
+
+
+/*
+ * rasqal_algebra_exists_to_rowsource:
+ * @execution_data: execution data
+ * @rs: input rowsource
+ * @e: EXISTS, NOT EXISTS or negated EXISTS expression
+ * @error_p: pointer to error
+ *
+ * INTERNAL - Make a semi-join or anti-join rowsource for an EXISTS conjunct
+ *
+ * The @rs rowsource becomes owned by the new rowsource
+ *
+ * Return value: new rowsource or NULL on failure
+ */
+static rasqal_rowsource*
+rasqal_algebra_exists_to_rowsource(rasqal_engine_algebra_data* execution_data,
+                                   rasqal_rowsource* rs,
+                                   rasqal_expression* e,
+                                   rasqal_engine_error *error_p)
+{
+  rasqal_query *query = execution_data->query;
+  rasqal_algebra_node* inner_node;
+  rasqal_rowsource* inner_rs;
+  int negate = 0;
+
+  if(e->op == RASQAL_EXPR_BANG) {
+    negate = 1;
+    e = e->arg1;
+  }
+  if(e->op == RASQAL_EXPR_NOT_EXISTS)
+    negate = !negate;
+
+  if(!execution_data->exists_nodes) {
+    execution_data->exists_nodes = raptor_new_sequence((raptor_data_free_handler)rasqal_free_algebra_node, NULL);
+    if(!execution_data->exists_nodes)
+      goto fail;
+  }
+
+  inner_node = rasqal_algebra_exists_graph_pattern_to_algebra(query,
+                                                              e->graph_pattern);
+  if(!inner_node)
+    goto fail;
+
+  /* kept until execution finishes since rowsources may share its parts */
+  if(raptor_sequence_push(execution_data->exists_nodes, inner_node))
+    goto fail;
+
+  inner_rs = rasqal_algebra_node_to_rowsource(execution_data, inner_node,
+                                              error_p);
+  if((error_p && *error_p) || !inner_rs) {
+    if(inner_rs)
+      rasqal_free_rowsource(inner_rs);
+    goto fail;
+  }
+
+  return rasqal_new_exists_rowsource(query->world, query,
+                                     execution_data->triples_source,
+                                     rs, inner_rs, e->graph_pattern, negate);
+
+  fail:
+  rasqal_free_rowsource(rs);
+  return NULL;
+}
+
+
 static rasqal_rowsource*
 rasqal_algebra_filter_algebra_node_to_rowsource(rasqal_engine_algebra_data* execution_data,
                                                 rasqal_algebra_node* node,
@@ -96,6 +220,11 @@ rasqal_algebra_filter_algebra_node_to_rowsource(rasqal_engine_algebra_data* exec
 {
   rasqal_query *query = execution_data->query;
   rasqal_rowsource *rs;
+  raptor_sequence* exists_seq = NULL;
+  raptor_sequence* other_seq = NULL;
+  rasqal_expression* expr = NULL;
+  rasqal_expression* e;
+  int i;
 
   if(node->node1) {
     rs = rasqal_algebra_node_to_rowsource(execution_data, node->node1, error_p);
@@ -110,7 +239,61 @@ rasqal_algebra_filter_algebra_node_to_rowsource(rasqal_engine_algebra_data* exec
   if(!rs)
     return NULL;
 
-  return rasqal_new_filter_rowsource(query->world, query, rs, node->expr);
+  exists_seq = raptor_new_sequence((raptor_data_free_handler)rasqal_free_expression, NULL);
+  other_seq = raptor_new_sequence((raptor_data_free_handler)rasqal_free_expression, NULL);
+  if(!exists_seq || !other_seq ||
+     rasqal_algebra_filter_split_conjuncts(node->expr, exists_seq, other_seq))
+    goto fail;
+
+  if(!raptor_sequence_size(exists_seq)) {
+    raptor_free_sequence(exists_seq);
+    raptor_free_sequence(other_seq);
+    return rasqal_new_filter_rowsource(query->world, query, rs, node->expr);
+  }
+
+  /* Remaining conjuncts are cheaper so they are applied first */
+  while((e = (rasqal_expression*)raptor_sequence_unshift(other_seq))) {
+    if(expr) {
+      expr = rasqal_new_2op_expression(query->world, RASQAL_EXPR_AND, expr, e);
+      if(!expr)
+        goto fail;
+    } else
+      expr = e;
+  }
+
+  if(expr) {
+    e = expr;
+    expr = NULL;
+    /* the filter rowsource takes its own reference to the expression */
+    rs = rasqal_new_filter_rowsource(query->world, query, rs, e);
+    if(!rs)
+      goto tidy;
+    rasqal_free_expression(e);
+  }
+
+  for(i = 0; (e = (rasqal_expression*)raptor_sequence_get_at(exists_seq, i)); i++) {
+    rs = rasqal_algebra_exists_to_rowsource(execution_data, rs, e, error_p);
+    if(!rs)
+      goto tidy;
+  }
+
+  goto tidy;
+
+  fail:
+  if(rs) {
+    rasqal_free_rowsource(rs);
+    rs = NULL;
+  }
+
+  tidy:
+  if(expr)
+    rasqal_free_expression(expr);
+  if(exists_seq)
+    raptor_free_sequence(exists_seq);
+  if(other_seq)
+    raptor_free_sequence(other_seq);
+
+  return rs;
 }
 
 
@@ -173,6 +356,39 @@ rasqal_algebra_project_algebra_node_to_rowsource(rasqal_engine_algebra_data* exe
 }
 
 
+/*
+ * rasqal_algebra_node_is_correlated_in_execution:
+ * @execution_data: execution data
+ * @node: algebra node
+ *
+ * INTERNAL - Check if an algebra node uses variables bound outside it in the query or a FILTER EXISTS pattern
+ *
+ * Return value: non-0 if correlated
+ */
+static int
+rasqal_algebra_node_is_correlated_in_execution(rasqal_engine_algebra_data* execution_data,
+                                               rasqal_algebra_node* node)
+{
+  rasqal_algebra_node* root;
+  int i;
+
+  if(rasqal_algebra_node_is_correlated(execution_data->algebra_node, node))
+    return 1;
+
+  if(!execution_data->exists_nodes)
+    return 0;
+
+  for(i = 0;
+      (root = (rasqal_algebra_node*)raptor_sequence_get_at(execution_data->exists_nodes, i));
+      i++) {
+    if(rasqal_algebra_node_is_correlated(root, node))
+      return 1;
+  }
+
+  return 0;
+}
+
+
 static rasqal_rowsource*
 rasqal_algebra_leftjoin_algebra_node_to_rowsource(rasqal_engine_algebra_data* execution_data,
                                                   rasqal_algebra_node* node,
@@ -194,6 +410,11 @@ rasqal_algebra_leftjoin_algebra_node_to_rowsource(rasqal_engine_algebra_data* ex
     return NULL;
   }
 
+  /* the right rowsource is read again for each left row */
+  if(rasqal_algebra_node_is_correlated_in_execution(execution_data,
+                                                    node->node2))
+    rasqal_rowsource_set_correlated(right_rs);
+
   return rasqal_new_join_rowsource(query->world, query, left_rs, right_rs, RASQAL_JOIN_TYPE_LEFT, node->expr);
 }
 
@@ -206,6 +427,8 @@ rasqal_algebra_join_algebra_node_to_rowsource(rasqal_engine_algebra_data* execut
   rasqal_query *query = execution_data->query;
   rasqal_rowsource *left_rs;
   rasqal_rowsource *right_rs;
+  rasqal_variable* left_key;
+  rasqal_variable* right_key;
 
   left_rs = rasqal_algebra_node_to_rowsource(execution_data, node->node1,
                                              error_p);
@@ -219,10 +442,52 @@ rasqal_algebra_join_algebra_node_to_rowsource(rasqal_engine_algebra_data* execut
     return NULL;
   }
 
+  /* the right rowsource is read again for each left row */
+  if(rasqal_algebra_node_is_correlated_in_execution(execution_data,
+                                                    node->node2))
+    rasqal_rowsource_set_correlated(right_rs);
+
+  /* both inputs sorted on the same variable: join them in one pass */
+  left_key = rasqal_rowsource_get_order(left_rs);
+  right_key = rasqal_rowsource_get_order(right_rs);
+  if(left_key && right_key &&
+     !strcmp(RASQAL_GOOD_CAST(const char*, left_key->name),
+             RASQAL_GOOD_CAST(const char*, right_key->name))) {
+    RASQAL_DEBUG2("merge joining on sorted variable %s\n", left_key->name);
+    return rasqal_new_merge_join_rowsource(query->world, query,
+                                           left_rs, right_rs, left_key,
+                                           node->expr);
+  }
+
   return rasqal_new_join_rowsource(query->world, query, left_rs, right_rs, RASQAL_JOIN_TYPE_NATURAL, node->expr);
 }
 
 
+static rasqal_rowsource*
+rasqal_algebra_diff_algebra_node_to_rowsource(rasqal_engine_algebra_data* execution_data,
+                                              rasqal_algebra_node* node,
+                                              rasqal_engine_error *error_p)
+{
+  rasqal_query *query = execution_data->query;
+  rasqal_rowsource *left_rs;
+  rasqal_rowsource *right_rs;
+
+  left_rs = rasqal_algebra_node_to_rowsource(execution_data, node->node1,
+                                             error_p);
+  if((error_p && *error_p) || !left_rs)
+    return NULL;
+
+  right_rs = rasqal_algebra_node_to_rowsource(execution_data, node->node2,
+                                              error_p);
+  if((error_p && *error_p) || !right_rs) {
+    rasqal_free_rowsource(left_rs);
+    return NULL;
+  }
+
+  return rasqal_new_minus_rowsource(query->world, query, left_rs, right_rs);
+}
+
+
 static rasqal_rowsource*
 rasqal_algebra_assignment_algebra_node_to_rowsource(rasqal_engine_algebra_data* execution_data,
                                                     rasqal_algebra_node* node,
@@ -243,7 +508,8 @@ rasqal_algebra_visitor_set_origin(rasqal_query* query,
   rasqal_literal *origin = (rasqal_literal*)user_data;
   int i;
   
-  if(node->op != RASQAL_ALGEBRA_OPERATOR_BGP)
+  if(node->op != RASQAL_ALGEBRA_OPERATOR_BGP &&
+     node->op != RASQAL_ALGEBRA_OPERATOR_PATH)
     return 0;
 
   for(i = node->start_column; i <= node->end_column; i++) {
@@ -271,6 +537,43 @@ rasqal_algebra_node_set_origin(rasqal_query *query,
 }
 
 
+/*
+ * rasqal_algebra_graph_binds_from_data:
+ * @node: inner algebra node of a GRAPH
+ * @v: GRAPH variable
+ *
+ * INTERNAL - Test if a GRAPH ?var inner node can bind ?var from the data
+ *
+ * A basic graph pattern that does not use the variable as a triple
+ * term can match every named graph in one pass with the variable as
+ * the origin of its triple patterns.
+ *
+ * Return value: non-0 if @node can bind @v itself
+ */
+static int
+rasqal_algebra_graph_binds_from_data(rasqal_algebra_node* node,
+                                     rasqal_variable* v)
+{
+  int i;
+
+  if(node->op != RASQAL_ALGEBRA_OPERATOR_BGP || !node->triples ||
+     node->start_column > node->end_column)
+    return 0;
+
+  for(i = node->start_column; i <= node->end_column; i++) {
+    rasqal_triple *t;
+
+    t = (rasqal_triple*)raptor_sequence_get_at(node->triples, i);
+    if(rasqal_literal_as_variable(t->subject) == v ||
+       rasqal_literal_as_variable(t->predicate) == v ||
+       rasqal_literal_as_variable(t->object) == v)
+      return 0;
+  }
+
+  return 1;
+}
+
+
 static rasqal_rowsource*
 rasqal_algebra_graph_algebra_node_to_rowsource(rasqal_engine_algebra_data* execution_data,
                                                rasqal_algebra_node* node,
@@ -280,6 +583,7 @@ rasqal_algebra_graph_algebra_node_to_rowsource(rasqal_engine_algebra_data* execu
   rasqal_rowsource *rs;
   rasqal_literal *graph = node->graph;
   rasqal_variable* v;
+  int bind_from_data;
 
   if(!graph) {
     RASQAL_DEBUG1("graph algebra node has NULL graph\n");
@@ -332,10 +636,11 @@ eval(D(G), Graph(IRI,P)) = the empty multiset
       rs = rasqal_algebra_node_to_rowsource(execution_data, node->node1,
                                             error_p);
     } else {
-      /* case #2 - IRI is not a graph name in D - return empty rowsource */
-      rasqal_free_algebra_node(node->node1);
-      node->node1 = NULL;
-      
+      /* case #2 - IRI is not a graph name in D - return empty rowsource
+       *
+       * node->node1 is kept since the algebra is reused by later
+       * executions of the query.
+       */
       rs = rasqal_new_empty_rowsource(query->world, query);
     }
 
@@ -353,7 +658,32 @@ eval(D(G), Graph(IRI,P)) = the empty multiset
   if((error_p && *error_p) || !rs)
     return NULL;
 
-  return rasqal_new_graph_rowsource(query->world, query, rs, v);
+  /* Match all graphs at once binding the variable from the triples
+   * instead of re-reading the inner rowsource for each graph */
+  bind_from_data = rasqal_algebra_graph_binds_from_data(node->node1, v);
+  if(bind_from_data && rasqal_rowsource_set_origin(rs, graph)) {
+    rasqal_free_rowsource(rs);
+    return NULL;
+  }
+
+  return rasqal_new_graph_rowsource(query->world, query, rs, v,
+                                    bind_from_data);
+}
+
+
+static rasqal_rowsource*
+rasqal_algebra_reduced_algebra_node_to_rowsource(rasqal_engine_algebra_data* execution_data,
+                                                 rasqal_algebra_node* node,
+                                                 rasqal_engine_error *error_p)
+{
+  rasqal_query *query = execution_data->query;
+  rasqal_rowsource *rs;
+
+  rs = rasqal_algebra_node_to_rowsource(execution_data, node->node1, error_p);
+  if((error_p && *error_p) || !rs)
+    return NULL;
+
+  return rasqal_new_reduced_rowsource(query->world, query, rs);
 }
 
 
@@ -395,13 +725,25 @@ rasqal_algebra_aggregation_algebra_node_to_rowsource(rasqal_engine_algebra_data*
                                                      rasqal_engine_error *error_p)
 {
   rasqal_query *query = execution_data->query;
+  rasqal_algebra_node *input_node = node->node1;
+  raptor_sequence* group_exprs_seq = NULL;
   rasqal_rowsource *rs;
 
-  rs = rasqal_algebra_node_to_rowsource(execution_data, node->node1, error_p);
+  /* Aggregate directly over the GROUP input so that the group rows
+   * are not all stored before aggregating */
+  if(input_node->op == RASQAL_ALGEBRA_OPERATOR_GROUP && input_node->seq &&
+     raptor_sequence_size(input_node->seq) > 0 &&
+     rasqal_aggregation_expressions_can_stream(node->seq)) {
+    group_exprs_seq = input_node->seq;
+    input_node = input_node->node1;
+  }
+
+  rs = rasqal_algebra_node_to_rowsource(execution_data, input_node, error_p);
   if((error_p && *error_p) || !rs)
     return NULL;
 
   return rasqal_new_aggregation_rowsource(query->world, query, rs,
+                                          group_exprs_seq,
                                           node->seq,
                                           node->vars_seq);
 }
@@ -514,6 +856,11 @@ rasqal_algebra_node_to_rowsource(rasqal_engine_algebra_data* execution_data,
                                                              node, error_p);
       break;
 
+    case RASQAL_ALGEBRA_OPERATOR_REDUCED:
+      rs = rasqal_algebra_reduced_algebra_node_to_rowsource(execution_data,
+                                                            node, error_p);
+      break;
+
     case RASQAL_ALGEBRA_OPERATOR_JOIN:
       rs = rasqal_algebra_join_algebra_node_to_rowsource(execution_data,
                                                          node, error_p);
@@ -554,10 +901,18 @@ rasqal_algebra_node_to_rowsource(rasqal_engine_algebra_data* execution_data,
                                                             node, error_p);
       break;
 
-    case RASQAL_ALGEBRA_OPERATOR_UNKNOWN:
     case RASQAL_ALGEBRA_OPERATOR_DIFF:
+      rs = rasqal_algebra_diff_algebra_node_to_rowsource(execution_data,
+                                                         node, error_p);
+      break;
+
+    case RASQAL_ALGEBRA_OPERATOR_PATH:
+      rs = rasqal_algebra_path_algebra_node_to_rowsource(execution_data,
+                                                         node, error_p);
+      break;
+
+    case RASQAL_ALGEBRA_OPERATOR_UNKNOWN:
     case RASQAL_ALGEBRA_OPERATOR_TOLIST:
-    case RASQAL_ALGEBRA_OPERATOR_REDUCED:
     default:
       RASQAL_DEBUG2("Unsupported algebra node operator %s\n",
                     rasqal_algebra_node_operator_as_counted_string(node->op,
@@ -573,81 +928,107 @@ rasqal_algebra_node_to_rowsource(rasqal_engine_algebra_data* execution_data,
 
 
 
-static int
-rasqal_query_engine_algebra_execute_init(void* ex_data,
-                                         rasqal_query* query,
-                                         rasqal_query_results* query_results,
-                                         int flags,
-                                         rasqal_engine_error *error_p)
+/*
+ * rasqal_query_engine_algebra_build_algebra:
+ * @query: query
+ *
+ * INTERNAL - Build the full query algebra for a query including
+ * solution modifiers.
+ *
+ * Return value: algebra node or NULL on failure
+ */
+static rasqal_algebra_node*
+rasqal_query_engine_algebra_build_algebra(rasqal_query* query)
 {
-  rasqal_engine_algebra_data* execution_data;
-  rasqal_engine_error error;
-  int rc = 0;
   rasqal_projection* projection;
   rasqal_solution_modifier* modifier;
   rasqal_algebra_node* node;
   rasqal_algebra_aggregate* ae;
-  
-  execution_data = (rasqal_engine_algebra_data*)ex_data;
-
-  /* initialise the execution_data fields */
-  execution_data->query = query;
-  execution_data->query_results = query_results;
-
-  if(!execution_data->triples_source) {
-    execution_data->triples_source = rasqal_new_triples_source(execution_data->query);
-    if(!execution_data->triples_source) {
-      *error_p = RASQAL_ENGINE_FAILED;
-      return 1;
-    }
-  }
 
   projection = rasqal_query_get_projection(query);
   modifier = query->modifier;
 
   node = rasqal_algebra_query_to_algebra(query);
   if(!node)
-    return 1;
+    return NULL;
 
   node = rasqal_algebra_query_add_group_by(query, node, modifier);
   if(!node)
-    return 1;
+    return NULL;
 
   ae = rasqal_algebra_query_prepare_aggregates(query, node, projection,
                                                modifier);
   if(!ae)
-    return 1;
+    return NULL;
 
   if(ae) {
     node = rasqal_algebra_query_add_aggregation(query, ae, node);
     ae = NULL;
     if(!node)
-      return 1;
+      return NULL;
   }
 
   node = rasqal_algebra_query_add_having(query, node, modifier);
   if(!node)
-    return 1;
+    return NULL;
 
   if(query->verb == RASQAL_QUERY_VERB_SELECT) {
     node = rasqal_algebra_query_add_projection(query, node, projection);
     if(!node)
-      return 1;
+      return NULL;
   } else if(query->verb == RASQAL_QUERY_VERB_CONSTRUCT) {
     node = rasqal_algebra_query_add_construct_projection(query, node);
     if(!node)
-      return 1;
+      return NULL;
   }
 
   node = rasqal_algebra_query_add_orderby(query, node, projection, modifier);
   if(!node)
-    return 1;
+    return NULL;
 
   node = rasqal_algebra_query_add_distinct(query, node, projection);
-  if(!node)
-    return 1;
+
+  return node;
+}
 
 
+static int
+rasqal_query_engine_algebra_execute_init(void* ex_data,
+                                         rasqal_query* query,
+                                         rasqal_query_results* query_results,
+                                         int flags,
+                                         rasqal_engine_error *error_p)
+{
+  rasqal_engine_algebra_data* execution_data;
+  rasqal_engine_error error;
+  int rc = 0;
+  rasqal_algebra_node* node;
+  
+  execution_data = (rasqal_engine_algebra_data*)ex_data;
+
+  /* initialise the execution_data fields */
+  execution_data->query = query;
+  execution_data->query_results = query_results;
+
+  if(!execution_data->triples_source) {
+    execution_data->triples_source = rasqal_new_triples_source(execution_data->query);
+    if(!execution_data->triples_source) {
+      *error_p = RASQAL_ENGINE_FAILED;
+      return 1;
+    }
+  }
+
+  /* The algebra is built once per query and saved in the query for
+   * later executions since building it parses nothing but does walk
+   * and rewrite the whole query structure.
+   */
+  if(!query->algebra_node) {
+    query->algebra_node = rasqal_query_engine_algebra_build_algebra(query);
+    if(!query->algebra_node)
+      return 1;
+  }
+  node = query->algebra_node;
+
   execution_data->algebra_node = node;
 
   /* count final number of nodes */
@@ -713,12 +1094,79 @@ rasqal_query_engine_algebra_get_row(void* ex_data,
   
   execution_data = (rasqal_engine_algebra_data*)ex_data;
 
-  if(execution_data->rowsource) {
+  if(!execution_data->rowsource) {
+    *error_p = RASQAL_ENGINE_FAILED;
+    return NULL;
+  }
+
+  /* Only read through a batch when the root rowsource makes batches
+   * itself; otherwise the batch would just copy every row again */
+  if(!execution_data->batch &&
+     !rasqal_rowsource_has_read_batch(execution_data->rowsource)) {
     row = rasqal_rowsource_read_row(execution_data->rowsource);
     if(!row)
       *error_p = RASQAL_ENGINE_FINISHED;
-  } else
+    return row;
+  }
+
+  if(!execution_data->batch) {
+    rasqal_query* query = execution_data->query;
+    int capacity = RASQAL_ROW_BATCH_SIZE;
+    int limit;
+
+    /* ASK needs one row; a LIMIT needs at most LIMIT + OFFSET rows */
+    if(query->verb == RASQAL_QUERY_VERB_ASK)
+      capacity = 1;
+    else {
+      limit = rasqal_query_get_limit(query);
+      if(limit >= 0) {
+        int offset = rasqal_query_get_offset(query);
+        if(offset > 0)
+          limit += offset;
+        if(limit < capacity)
+          capacity = limit > 0 ? limit : 1;
+      }
+    }
+
+    execution_data->batch = rasqal_new_row_batch(execution_data->rowsource,
+                                                 capacity);
+    if(!execution_data->batch) {
+      *error_p = RASQAL_ENGINE_FAILED;
+      return NULL;
+    }
+    execution_data->batch_index = 0;
+  }
+
+  if(execution_data->batch_index >= execution_data->batch->count) {
+    int count;
+
+    count = rasqal_rowsource_read_batch(execution_data->rowsource,
+                                        execution_data->batch);
+    if(count < 0) {
+      *error_p = RASQAL_ENGINE_FAILED;
+      return NULL;
+    }
+    if(!count) {
+      *error_p = RASQAL_ENGINE_FINISHED;
+      return NULL;
+    }
+    execution_data->batch_index = 0;
+  }
+
+  row = rasqal_row_batch_get_row(execution_data->batch,
+                                 execution_data->batch_index++);
+  if(!row) {
+    *error_p = RASQAL_ENGINE_FAILED;
+    return NULL;
+  }
+
+  /* bind the variables as reading the row from the rowsource would,
+   * for CONSTRUCT templates which use the variable values */
+  if(rasqal_row_bind_variables(row, execution_data->query->vars_table)) {
+    rasqal_free_row(row);
     *error_p = RASQAL_ENGINE_FAILED;
+    return NULL;
+  }
 
   return row;
 }
@@ -733,16 +1181,25 @@ rasqal_query_engine_algebra_execute_finish(void* ex_data,
   execution_data = (rasqal_engine_algebra_data*)ex_data;
 
   if(execution_data) {
-    if(execution_data->algebra_node)
-      rasqal_free_algebra_node(execution_data->algebra_node);
+    /* execution_data->algebra_node is owned by the query */
 
     if(execution_data->triples_source) {
       rasqal_free_triples_source(execution_data->triples_source);
       execution_data->triples_source = NULL;
     }
 
+    if(execution_data->batch) {
+      rasqal_free_row_batch(execution_data->batch);
+      execution_data->batch = NULL;
+    }
+
     if(execution_data->rowsource)
       rasqal_free_rowsource(execution_data->rowsource);
+
+    if(execution_data->exists_nodes) {
+      raptor_free_sequence(execution_data->exists_nodes);
+      execution_data->exists_nodes = NULL;
+    }
   }
 
   return 0;
@@ -94,12 +94,27 @@ rasqal_engine_rowsort_row_compare(void* user_data, const void *a, const void *b)
   }
   
   /* now order it */
-  if(rcd->order_conditions_sequence)
-    result = rasqal_literal_array_compare(row_a->order_values,
-                                          row_b->order_values,
-                                          rcd->order_conditions_sequence,
-                                          row_a->order_size,
-                                          rcd->compare_flags);
+  if(rcd->order_conditions_sequence) {
+    int decided = 0;
+
+    if(row_a->order_key && row_b->order_key) {
+      size_t len = row_a->order_key_len;
+
+      if(row_b->order_key_len < len)
+        len = row_b->order_key_len;
+
+      result = memcmp(row_a->order_key, row_b->order_key, len);
+      decided = (result ||
+                 (row_a->order_key_complete && row_b->order_key_complete));
+    }
+
+    if(!decided)
+      result = rasqal_literal_array_compare(row_a->order_values,
+                                            row_b->order_values,
+                                            rcd->order_conditions_sequence,
+                                            row_a->order_size,
+                                            rcd->compare_flags);
+  }
 
 
   /* still equal?  make sort stable by using the original order */
@@ -113,6 +128,27 @@ rasqal_engine_rowsort_row_compare(void* user_data, const void *a, const void *b)
 }
 
 
+/*
+ * rasqal_engine_rowsort_compare_flags:
+ * @is_distinct: non-0 if sorting for DISTINCT
+ * @compare_flags: query comparison flags
+ *
+ * INTERNAL - Get the literal comparison flags used to sort rows
+ *
+ * Return value: comparison flags
+ */
+static int
+rasqal_engine_rowsort_compare_flags(int is_distinct, int compare_flags)
+{
+  if(is_distinct) {
+    compare_flags &= ~RASQAL_COMPARE_XQUERY;
+    compare_flags |= RASQAL_COMPARE_RDF;
+  }
+
+  return compare_flags;
+}
+
+
 static int
 rasqal_engine_rowsort_map_print_row(void *object, FILE *fh)
 {
@@ -142,11 +178,8 @@ rasqal_engine_new_rowsort_map(int is_distinct, int compare_flags,
     return NULL;
   
   rcd->is_distinct = is_distinct;
-  if(is_distinct) {
-    compare_flags &= ~RASQAL_COMPARE_XQUERY;
-    compare_flags |= RASQAL_COMPARE_RDF;
-  }
-  rcd->compare_flags = compare_flags;
+  rcd->compare_flags = rasqal_engine_rowsort_compare_flags(is_distinct,
+                                                           compare_flags);
   rcd->order_conditions_sequence = order_conditions_sequence;
   
   return rasqal_new_map(rasqal_engine_rowsort_row_compare, rcd,
@@ -209,22 +242,94 @@ rasqal_engine_rowsort_map_to_sequence(rasqal_map* map, raptor_sequence* seq)
 }
 
 
+/* compare pointers to two #rasqal_row for rasqal_sequence_as_sorted() */
+static int
+rasqal_engine_rowsort_row_compare_arg(const void *a, const void *b, void *arg)
+{
+  return rasqal_engine_rowsort_row_compare(arg, *(void* const*)a,
+                                           *(void* const*)b);
+}
+
+
+/**
+ * rasqal_engine_rowsort_sort_sequence:
+ * @seq: sequence of rows with calculated order values
+ * @compare_flags: query comparison flags
+ * @order_conditions_sequence: order conditions
+ *
+ * INTERNAL - Sort rows into ORDER BY order without DISTINCT
+ *
+ * Uses a stable merge sort rather than inserting into a rowsort map,
+ * which is an unbalanced tree and slow for input that is already
+ * nearly in order.
+ *
+ * Return value: new sorted sequence of the rows or NULL on failure
+ */
+raptor_sequence*
+rasqal_engine_rowsort_sort_sequence(raptor_sequence* seq, int compare_flags,
+                                    raptor_sequence* order_conditions_sequence)
+{
+  rowsort_compare_data rcd;
+  raptor_sequence* sorted_seq;
+  void** array;
+  int i;
+
+  rcd.is_distinct = 0;
+  rcd.compare_flags = rasqal_engine_rowsort_compare_flags(0, compare_flags);
+  rcd.order_conditions_sequence = order_conditions_sequence;
+
+  sorted_seq = raptor_new_sequence((raptor_data_free_handler)rasqal_free_row,
+                                   (raptor_data_print_handler)rasqal_row_print);
+  if(!sorted_seq)
+    return NULL;
+
+  if(!raptor_sequence_size(seq))
+    return sorted_seq;
+
+  array = rasqal_sequence_as_sorted(seq, rasqal_engine_rowsort_row_compare_arg,
+                                    &rcd);
+  if(!array) {
+    raptor_free_sequence(sorted_seq);
+    return NULL;
+  }
+
+  for(i = 0; array[i]; i++) {
+    rasqal_row* row = rasqal_new_row_from_row((rasqal_row*)array[i]);
+    if(raptor_sequence_push(sorted_seq, row)) {
+      raptor_free_sequence(sorted_seq);
+      sorted_seq = NULL;
+      break;
+    }
+  }
+
+  RASQAL_FREE(void*, array);
+
+  return sorted_seq;
+}
+
+
 /**
  * rasqal_engine_rowsort_calculate_order_values:
  * @query: query object
  * @order_seq: order conditions sequence
  * @row: row
+ * @is_distinct: non-0 if the row is sorted for DISTINCT
  *
  * INTERNAL - Calculate the order condition values for a row
  *
+ * The values are also encoded once into the row order key so that
+ * sorting mostly compares bytes instead of literals.
+ *
  * Return value: non-0 on failure 
  */
 int
 rasqal_engine_rowsort_calculate_order_values(rasqal_query* query,
                                              raptor_sequence* order_seq,
-                                             rasqal_row* row)
+                                             rasqal_row* row,
+                                             int is_distinct)
 {
   int i;
+  int compare_flags;
   
   if(!row->order_size)
     return 1;
@@ -247,6 +352,19 @@ rasqal_engine_rowsort_calculate_order_values(rasqal_query* query,
       rasqal_free_literal(l);
     }
   }
+
+  if(row->order_key)
+    RASQAL_FREE(char*, row->order_key);
+
+  /* a NULL key is not an error; rows are then compared by value */
+  compare_flags = rasqal_engine_rowsort_compare_flags(is_distinct,
+                                                      query->compare_flags);
+  row->order_key = rasqal_literal_array_to_order_key(row->order_values,
+                                                     order_seq,
+                                                     row->order_size,
+                                                     compare_flags,
+                                                     &row->order_key_len,
+                                                     &row->order_key_complete);
   
   return 0;
 }
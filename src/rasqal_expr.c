@@ -580,6 +580,46 @@ rasqal_new_set_expression(rasqal_world* world, rasqal_op op,
 }
 
 
+/**
+ * rasqal_new_exists_expression:
+ * @world: rasqal_world object
+ * @op: #RASQAL_EXPR_EXISTS or #RASQAL_EXPR_NOT_EXISTS
+ * @graph_pattern: graph pattern to test
+ * 
+ * Constructor - create a new SPARQL 1.1 EXISTS / NOT EXISTS expression
+ *
+ * Takes ownership of the @graph_pattern
+ * 
+ * Return value: a new #rasqal_expression object or NULL on failure
+ **/
+rasqal_expression*
+rasqal_new_exists_expression(rasqal_world* world, rasqal_op op,
+                             rasqal_graph_pattern* graph_pattern)
+{
+  rasqal_expression* e = NULL;
+
+  if(!world || !graph_pattern)
+    goto tidy;
+
+  if(op != RASQAL_EXPR_EXISTS && op != RASQAL_EXPR_NOT_EXISTS)
+    goto tidy;
+  
+  e = RASQAL_CALLOC(rasqal_expression*, 1, sizeof(*e));
+  if(e) {
+    e->usage = 1;
+    e->world = world;
+    e->op = op;
+    e->graph_pattern = graph_pattern; graph_pattern = NULL;
+  }
+  
+  tidy:
+  if(graph_pattern)
+    rasqal_free_graph_pattern(graph_pattern);
+
+  return e;
+}
+
+
 /**
  * rasqal_new_group_concat_expression:
  * @world: rasqal_world object
@@ -782,6 +822,11 @@ rasqal_expression_clear(rasqal_expression* e)
       raptor_free_sequence(e->args);
       break;
 
+    case RASQAL_EXPR_EXISTS:
+    case RASQAL_EXPR_NOT_EXISTS:
+      rasqal_free_graph_pattern(e->graph_pattern);
+      break;
+
     case RASQAL_EXPR_UNKNOWN:
     default:
       RASQAL_FATAL2("Unknown operation %u", e->op);
@@ -1001,6 +1046,11 @@ rasqal_expression_visit(rasqal_expression* e,
       }
       break;
 
+    case RASQAL_EXPR_EXISTS:
+    case RASQAL_EXPR_NOT_EXISTS:
+      /* graph pattern expressions are visited with the graph pattern */
+      break;
+
     case RASQAL_EXPR_UNKNOWN:
     default:
       RASQAL_FATAL2("Unknown operation %u", e->op);
@@ -1105,7 +1155,9 @@ static const char* const rasqal_op_labels[RASQAL_EXPR_LAST+1]={
   "strafter",
   "replace",
   "uuid",
-  "struuid"
+  "struuid",
+  "exists",
+  "not exists"
 };
 
 
@@ -1391,6 +1443,15 @@ rasqal_expression_write(rasqal_expression* e, raptor_iostream* iostr)
       raptor_iostream_write_byte(')', iostr);
       break;
 
+    case RASQAL_EXPR_EXISTS:
+    case RASQAL_EXPR_NOT_EXISTS:
+      raptor_iostream_counted_string_write("op ", 3, iostr);
+      rasqal_expression_write_op(e, iostr);
+      raptor_iostream_counted_string_write("(graph pattern[", 15, iostr);
+      raptor_iostream_decimal_write(e->graph_pattern->gp_index, iostr);
+      raptor_iostream_counted_string_write("])", 2, iostr);
+      break;
+
     case RASQAL_EXPR_UNKNOWN:
     default:
       RASQAL_FATAL2("Unknown operation %u", e->op);
@@ -1597,6 +1658,15 @@ rasqal_expression_print(rasqal_expression* e, FILE* fh)
       fputc(')', fh);
       break;
 
+    case RASQAL_EXPR_EXISTS:
+    case RASQAL_EXPR_NOT_EXISTS:
+      fputs("op ", fh);
+      rasqal_expression_print_op(e, fh);
+      fputc('(', fh);
+      rasqal_graph_pattern_print(e->graph_pattern, fh);
+      fputc(')', fh);
+      break;
+
     case RASQAL_EXPR_UNKNOWN:
     default:
       RASQAL_FATAL2("Unknown operation %u", e->op);
@@ -1798,6 +1868,12 @@ rasqal_expression_is_constant(rasqal_expression* e)
       }
       break;
       
+    case RASQAL_EXPR_EXISTS:
+    case RASQAL_EXPR_NOT_EXISTS:
+      /* depends on the data */
+      result = 0;
+      break;
+
     case RASQAL_EXPR_UNKNOWN:
     default:
       RASQAL_FATAL2("Unknown operation %u", e->op);
@@ -2226,6 +2302,17 @@ rasqal_expression_compare(rasqal_expression* e1, rasqal_expression* e2,
       }
       break;
 
+    case RASQAL_EXPR_EXISTS:
+    case RASQAL_EXPR_NOT_EXISTS:
+      if(e1->graph_pattern == e2->graph_pattern)
+        rc = 0;
+      else {
+        rc = e2->graph_pattern->gp_index - e1->graph_pattern->gp_index;
+        if(!rc)
+          rc = 1;
+      }
+      break;
+
     case RASQAL_EXPR_UNKNOWN:
     default:
       RASQAL_FATAL2("Unknown operation %u", e1->op);
@@ -1568,6 +1568,15 @@ rasqal_expression_evaluate2(rasqal_expression* e,
       result = rasqal_expression_evaluate_struuid(e, eval_context, error_p);
       break;
 
+    case RASQAL_EXPR_EXISTS:
+    case RASQAL_EXPR_NOT_EXISTS:
+      /* evaluated by the query engine as a semi-join or anti-join
+       * when the expression is a FILTER conjunct
+       */
+      RASQAL_DEBUG2("Cannot evaluate %s inside an expression\n",
+                    rasqal_expression_op_label(e->op));
+      goto failed;
+
     case RASQAL_EXPR_UNKNOWN:
     default:
       RASQAL_FATAL3("Unknown operation %s (%u)",
@@ -313,11 +313,7 @@ rasqal_literals_sparql11_compatible(rasqal_literal *l1, rasqal_literal *l2)
   raptor_uri* dt2;
   const char *lang1;
   const char *lang2;
-  raptor_uri* xsd_string_uri;
   
-  xsd_string_uri = rasqal_xsd_datatype_type_to_uri(l1->world, 
-                                                   RASQAL_LITERAL_XSD_STRING);
-
   /* Languages */
   lang1 = l1->language;
   lang2 = l2->language;
@@ -326,11 +322,11 @@ rasqal_literals_sparql11_compatible(rasqal_literal *l1, rasqal_literal *l2)
    * purposes 
    */
   dt1 = l1->datatype;
-  if(dt1 && raptor_uri_equals(dt1, xsd_string_uri))
+  if(dt1 && rasqal_literal_get_datatype_type(l1) == RASQAL_LITERAL_XSD_STRING)
     dt1 = NULL;
   
   dt2 = l2->datatype;
-  if(dt2 && raptor_uri_equals(dt2, xsd_string_uri))
+  if(dt2 && rasqal_literal_get_datatype_type(l2) == RASQAL_LITERAL_XSD_STRING)
     dt2 = NULL;
   
   /* If there any datatypes left, the literals are not compatible */
@@ -447,7 +443,6 @@ rasqal_expression_evaluate_encode_for_uri(rasqal_expression *e,
 {
   rasqal_world* world = eval_context->world;
   rasqal_literal* l1;
-  raptor_uri* xsd_string_uri;
   const unsigned char *s;
   unsigned char* new_s = NULL;
   raptor_uri* dt_uri = NULL;
@@ -459,11 +454,8 @@ rasqal_expression_evaluate_encode_for_uri(rasqal_expression *e,
   if((error_p && *error_p) || !l1)
     goto failed;
   
-  xsd_string_uri = rasqal_xsd_datatype_type_to_uri(l1->world, 
-                                                   RASQAL_LITERAL_XSD_STRING);
-
   dt_uri = l1->datatype;
-  if(dt_uri && !raptor_uri_equals(dt_uri, xsd_string_uri))
+  if(dt_uri && rasqal_literal_get_datatype_type(l1) != RASQAL_LITERAL_XSD_STRING)
     /* datatype and not xsd:string */
     goto failed;
 
@@ -596,7 +588,7 @@ rasqal_expression_evaluate_concat(rasqal_expression *e,
 
     if(arg_literal->datatype) {
       /* Datatype */ 
-      if(raptor_uri_equals(arg_literal->datatype, xsd_string_uri)) {
+      if(rasqal_literal_get_datatype_type(arg_literal) == RASQAL_LITERAL_XSD_STRING) {
         if(mode < 0)
           /* mode -1: expect all xsd:string */
           mode = 0;
@@ -42,17 +42,17 @@
 
 
 static void
-rasqal_iostream_write_json_boolean(raptor_iostream* iostr, 
-                                   const char* name, int json_bool)
+rasqal_write_buffer_write_json_boolean(rasqal_write_buffer* wb,
+                                       const char* name, int json_bool)
 {
-  raptor_iostream_write_byte('\"', iostr);
-  raptor_iostream_string_write(name, iostr);
-  raptor_iostream_counted_string_write("\" : ",4, iostr);
+  rasqal_write_buffer_write_byte(wb, '\"');
+  rasqal_write_buffer_write_string(wb, name);
+  rasqal_write_buffer_write_bytes(wb, "\" : ", 4);
 
   if(json_bool)
-    raptor_iostream_counted_string_write("true", 4, iostr);
+    rasqal_write_buffer_write_bytes(wb, "true", 4);
   else
-    raptor_iostream_counted_string_write("false", 5, iostr);
+    rasqal_write_buffer_write_bytes(wb, "false", 5);
 
 }
 
@@ -66,6 +66,9 @@ rasqal_iostream_write_json_boolean(raptor_iostream* iostr,
  * Write a JSON version of the query results format to an
  * iostream in a format - INTERNAL.
  * 
+ * Rows are formatted into a #rasqal_write_buffer and written to
+ * @iostr in large blocks.
+ *
  * If the writing succeeds, the query results will be exhausted.
  * 
  * Return value: non-0 on failure
@@ -78,10 +81,14 @@ rasqal_query_results_write_json1(rasqal_query_results_formatter* formatter,
 {
   rasqal_world* world = rasqal_query_results_get_world(results);
   rasqal_query* query = rasqal_query_results_get_query(results);
+  rasqal_write_buffer* wb;
+  rasqal_row* row;
   int i;
+  int vars_count;
   int row_comma;
   int column_comma = 0;
   rasqal_query_results_type type;
+  int rc;
 
   type = rasqal_query_results_get_type(results);
 
@@ -94,13 +101,17 @@ rasqal_query_results_write_json1(rasqal_query_results_formatter* formatter,
     return 1;
   }
 
-  raptor_iostream_counted_string_write("{\n", 2, iostr);
+  wb = rasqal_new_write_buffer(world->raptor_world_ptr, iostr, 0);
+  if(!wb)
+    return 1;
+
+  rasqal_write_buffer_write_bytes(wb, "{\n", 2);
   
   /* Header */
-  raptor_iostream_counted_string_write("  \"head\": {\n", 12, iostr);
+  rasqal_write_buffer_write_bytes(wb, "  \"head\": {\n", 12);
   
   if(rasqal_query_results_is_bindings(results)) {
-    raptor_iostream_counted_string_write("    \"vars\": [ ", 14, iostr);
+    rasqal_write_buffer_write_bytes(wb, "    \"vars\": [ ", 14);
     for(i = 0; 1; i++) {
       const unsigned char *name;
       
@@ -110,102 +121,102 @@ rasqal_query_results_write_json1(rasqal_query_results_formatter* formatter,
       
       /*     'x', */
       if(i > 0)
-        raptor_iostream_counted_string_write(", ", 2, iostr);
-      raptor_iostream_write_byte('\"', iostr);
-      raptor_iostream_string_write(name, iostr);
-      raptor_iostream_write_byte('\"', iostr);
+        rasqal_write_buffer_write_bytes(wb, ", ", 2);
+      rasqal_write_buffer_write_byte(wb, '\"');
+      rasqal_write_buffer_write_string(wb, name);
+      rasqal_write_buffer_write_byte(wb, '\"');
     }
-    raptor_iostream_counted_string_write(" ]\n", 3, iostr);
+    rasqal_write_buffer_write_bytes(wb, " ]\n", 3);
   }
 
   /* FIXME - could add link inside 'head': */
     
   /*   End Header */
-  raptor_iostream_counted_string_write("  },\n", 5, iostr);
+  rasqal_write_buffer_write_bytes(wb, "  },\n", 5);
 
 
   /* Boolean Results */
   if(rasqal_query_results_is_boolean(results)) {
-    raptor_iostream_counted_string_write("  ", 2, iostr);
-    rasqal_iostream_write_json_boolean(iostr, "boolean", 
-                                       rasqal_query_results_get_boolean(results));
+    rasqal_write_buffer_write_bytes(wb, "  ", 2);
+    rasqal_write_buffer_write_json_boolean(wb, "boolean", 
+                                           rasqal_query_results_get_boolean(results));
     goto results3done;
   }
 
   /* Variable Binding Results */
-  raptor_iostream_counted_string_write("  \"results\": {\n", 15, iostr);
+  rasqal_write_buffer_write_bytes(wb, "  \"results\": {\n", 15);
 
   if(query) {
-    raptor_iostream_counted_string_write("    ", 4, iostr);
-    rasqal_iostream_write_json_boolean(iostr, "ordered", 
-                                       (rasqal_query_get_order_condition(query, 0) != NULL));
-    raptor_iostream_counted_string_write(",\n", 2, iostr);
-
-    raptor_iostream_counted_string_write("    ", 4, iostr);
-    rasqal_iostream_write_json_boolean(iostr, "distinct", 
-                                       rasqal_query_get_distinct(query));
-    raptor_iostream_counted_string_write(",\n", 2, iostr);
+    rasqal_write_buffer_write_bytes(wb, "    ", 4);
+    rasqal_write_buffer_write_json_boolean(wb, "ordered", 
+                                           (rasqal_query_get_order_condition(query, 0) != NULL));
+    rasqal_write_buffer_write_bytes(wb, ",\n", 2);
+
+    rasqal_write_buffer_write_bytes(wb, "    ", 4);
+    rasqal_write_buffer_write_json_boolean(wb, "distinct", 
+                                           rasqal_query_get_distinct(query));
+    rasqal_write_buffer_write_bytes(wb, ",\n", 2);
   }
   
-  raptor_iostream_counted_string_write("    \"bindings\" : [\n", 19, iostr);
+  rasqal_write_buffer_write_bytes(wb, "    \"bindings\" : [\n", 19);
 
+  vars_count = rasqal_query_results_get_bindings_count(results);
   row_comma = 0;
-  while(!rasqal_query_results_finished(results)) {
+  while((row = rasqal_query_results_get_current_row(results))) {
     if(row_comma)
-      raptor_iostream_counted_string_write(",\n", 2, iostr);
+      rasqal_write_buffer_write_bytes(wb, ",\n", 2);
 
     /* Result row */
-    raptor_iostream_counted_string_write("      {\n", 8, iostr);
+    rasqal_write_buffer_write_bytes(wb, "      {\n", 8);
 
     column_comma = 0;
-    for(i = 0; i<rasqal_query_results_get_bindings_count(results); i++) {
+    for(i = 0; i < vars_count; i++) {
       const unsigned char *name = rasqal_query_results_get_binding_name(results, i);
-      rasqal_literal *l = rasqal_query_results_get_binding_value(results, i);
+      rasqal_literal *l = row->values[i];
 
       if(column_comma)
-        raptor_iostream_counted_string_write(",\n", 2, iostr);
+        rasqal_write_buffer_write_bytes(wb, ",\n", 2);
 
       /*       <binding> */
-      raptor_iostream_counted_string_write("        \"", 9, iostr);
-      raptor_iostream_string_write(name, iostr);
-      raptor_iostream_counted_string_write("\" : { ", 6, iostr);
+      rasqal_write_buffer_write_bytes(wb, "        \"", 9);
+      rasqal_write_buffer_write_string(wb, name);
+      rasqal_write_buffer_write_bytes(wb, "\" : { ", 6);
 
       if(!l) {
-        raptor_iostream_string_write("\"type\": \"unbound\", \"value\": null", iostr);
+        rasqal_write_buffer_write_string(wb, "\"type\": \"unbound\", \"value\": null");
       } else {
-        const unsigned char* str;
-        size_t len;
-
         switch(l->type) {
           case RASQAL_LITERAL_URI:
-            raptor_iostream_string_write("\"type\": \"uri\", \"value\": \"", iostr);
-            str = RASQAL_GOOD_CAST(const unsigned char*, raptor_uri_as_counted_string(l->value.uri, &len));
-            raptor_string_ntriples_write(str, len, '"', iostr);
-            raptor_iostream_write_byte('"', iostr);
+            rasqal_write_buffer_write_string(wb, "\"type\": \"uri\", \"value\": \"");
+            rasqal_write_buffer_write_uri(wb, l->value.uri,
+                                          RASQAL_WRITE_ESCAPE_NTRIPLES);
+            rasqal_write_buffer_write_byte(wb, '"');
             break;
 
           case RASQAL_LITERAL_BLANK:
-            raptor_iostream_string_write("\"type\": \"bnode\", \"value\": \"", iostr);
-            raptor_string_ntriples_write(l->string, l->string_len, '"', iostr);
-            raptor_iostream_write_byte('"', iostr);
+            rasqal_write_buffer_write_string(wb, "\"type\": \"bnode\", \"value\": \"");
+            rasqal_write_buffer_write_escaped(wb, l->string, l->string_len,
+                                              RASQAL_WRITE_ESCAPE_NTRIPLES);
+            rasqal_write_buffer_write_byte(wb, '"');
             break;
 
           case RASQAL_LITERAL_STRING:
-            raptor_iostream_string_write("\"type\": \"literal\", \"value\": \"", iostr);
-            raptor_string_ntriples_write(l->string, l->string_len, '"', iostr);
-            raptor_iostream_write_byte('"', iostr);
+            rasqal_write_buffer_write_string(wb, "\"type\": \"literal\", \"value\": \"");
+            rasqal_write_buffer_write_escaped(wb, l->string, l->string_len,
+                                              RASQAL_WRITE_ESCAPE_NTRIPLES);
+            rasqal_write_buffer_write_byte(wb, '"');
 
             if(l->language) {
-              raptor_iostream_string_write(",\n      \"xml:lang\" : \"", iostr);
-              raptor_iostream_string_write(RASQAL_GOOD_CAST(const unsigned char*, l->language), iostr);
-              raptor_iostream_write_byte('"', iostr);
+              rasqal_write_buffer_write_string(wb, ",\n      \"xml:lang\" : \"");
+              rasqal_write_buffer_write_string(wb, l->language);
+              rasqal_write_buffer_write_byte(wb, '"');
             }
 
             if(l->datatype) {
-              raptor_iostream_string_write(",\n      \"datatype\" : \"", iostr);
-              str = RASQAL_GOOD_CAST(const unsigned char*, raptor_uri_as_counted_string(l->datatype, &len));
-              raptor_string_ntriples_write(str, len, '"', iostr);
-              raptor_iostream_write_byte('"', iostr);
+              rasqal_write_buffer_write_string(wb, ",\n      \"datatype\" : \"");
+              rasqal_write_buffer_write_uri(wb, l->datatype,
+                                            RASQAL_WRITE_ESCAPE_NTRIPLES);
+              rasqal_write_buffer_write_byte(wb, '"');
             }
 
             break;
@@ -233,25 +244,28 @@ rasqal_query_results_write_json1(rasqal_query_results_formatter* formatter,
       }
 
       /* End Binding */
-      raptor_iostream_counted_string_write(" }", 2, iostr);
+      rasqal_write_buffer_write_bytes(wb, " }", 2);
       column_comma = 1;
     }
 
     /* End Result Row */
-    raptor_iostream_counted_string_write("\n      }", 8, iostr);
+    rasqal_write_buffer_write_bytes(wb, "\n      }", 8);
     row_comma = 1;
     
     rasqal_query_results_next(results);
   }
 
-  raptor_iostream_counted_string_write("\n    ]\n  }", 10, iostr);
+  rasqal_write_buffer_write_bytes(wb, "\n    ]\n  }", 10);
 
   results3done:
   
   /* end sparql */
-  raptor_iostream_counted_string_write("\n}\n", 3, iostr);
+  rasqal_write_buffer_write_bytes(wb, "\n}\n", 3);
+
+  rc = rasqal_write_buffer_flush(wb);
+  rasqal_free_write_buffer(wb);
 
-  return 0;
+  return rc;
 }
 
 
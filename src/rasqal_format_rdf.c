@@ -759,6 +759,9 @@ static const rasqal_rowsource_handler rasqal_rowsource_rdf_handler={
   /* .set_requirements = */ NULL,
   /* .get_inner_rowsource = */ NULL,
   /* .set_origin = */ NULL,
+  /* .read_batch = */ NULL,
+  /* .get_order = */ NULL,
+  /* .set_outer_variables = */ NULL,
 };
 
 
@@ -73,6 +73,9 @@ static rasqal_rowsource* rasqal_query_results_get_rowsource_sparql_xml(rasqal_qu
  * Write the fourth version of the SPARQL XML query results format to an
  * iostream in a format - INTERNAL.
  * 
+ * Result rows are formatted into a #rasqal_write_buffer and written
+ * to @iostr in large blocks.
+ *
  * If the writing succeeds, the query results will be exhausted.
  * 
  * Return value: non-0 on failure
@@ -92,10 +95,12 @@ rasqal_query_results_write_sparql_xml(rasqal_query_results_formatter* formatter,
   raptor_xml_element *results_element=NULL;
   raptor_xml_element *result_element=NULL;
   raptor_xml_element *element1=NULL;
-  raptor_xml_element *binding_element=NULL;
   raptor_xml_element *variable_element=NULL;
   raptor_qname **attrs=NULL;
+  rasqal_write_buffer* wb = NULL;
+  rasqal_row* row;
   int i;
+  int vars_count;
   rasqal_query_results_type type;
 
   type = rasqal_query_results_get_type(results);
@@ -230,124 +235,72 @@ rasqal_query_results_write_sparql_xml(rasqal_query_results_formatter* formatter,
   raptor_xml_writer_raw_counted(xml_writer, RASQAL_GOOD_CAST(const unsigned char*, "\n"), 1);
 
 
-  /* declare result element for later multiple use */
-  result_element=raptor_new_xml_element_from_namespace_local_name(res_ns,
-                                                                  RASQAL_GOOD_CAST(const unsigned char*, "result"),
-                                                                  NULL, base_uri);
-  if(!result_element)
+  /* Result rows are written as markup through a write buffer straight
+   * to the iostream; the XML writer has closed <results> and sees
+   * nothing until </results>
+   */
+  wb = rasqal_new_write_buffer(world->raptor_world_ptr, iostr, 0);
+  if(!wb)
     goto tidy;
 
-  while(!rasqal_query_results_finished(results)) {
+  vars_count = rasqal_query_results_get_bindings_count(results);
+  while((row = rasqal_query_results_get_current_row(results))) {
     /*     <result> */
-    raptor_xml_writer_raw_counted(xml_writer, RASQAL_GOOD_CAST(const unsigned char*, "    "), 4);
-    raptor_xml_writer_start_element(xml_writer, result_element);
-    raptor_xml_writer_raw_counted(xml_writer, RASQAL_GOOD_CAST(const unsigned char*, "\n"), 1);
+    rasqal_write_buffer_write_bytes(wb, "    <result>\n", 13);
 
-    for(i=0; i<rasqal_query_results_get_bindings_count(results); i++) {
-      const unsigned char *name=rasqal_query_results_get_binding_name(results, i);
-      rasqal_literal *l=rasqal_query_results_get_binding_value(results, i);
+    for(i = 0; i < vars_count; i++) {
+      const unsigned char *name = rasqal_query_results_get_binding_name(results, i);
+      rasqal_literal *l = row->values[i];
 
       /*       <binding> */
-      binding_element=raptor_new_xml_element_from_namespace_local_name(res_ns,
-                                                                       RASQAL_GOOD_CAST(const unsigned char*, "binding"),
-                                                                       NULL, base_uri);
-      if(!binding_element)
-        goto tidy;
-
-      attrs=(raptor_qname **)raptor_alloc_memory(sizeof(raptor_qname*));
-      if(!attrs)
-        goto tidy;
-      attrs[0] = raptor_new_qname_from_namespace_local_name(world->raptor_world_ptr,
-                                                            res_ns,
-                                                            RASQAL_GOOD_CAST(const unsigned char*, "name"),
-                                                            name);
-
-      if(!attrs[0]) {
-        raptor_free_memory((void*)attrs);
-        goto tidy;
-      }
-
-      raptor_xml_element_set_attributes(binding_element, attrs, 1);
-      
-
-      raptor_xml_writer_raw_counted(xml_writer, RASQAL_GOOD_CAST(const unsigned char*, "      "), 6);
-      raptor_xml_writer_start_element(xml_writer, binding_element);
+      rasqal_write_buffer_write_bytes(wb, "      <binding name=\"", 21);
+      rasqal_write_buffer_write_escaped(wb, name,
+                                        strlen(RASQAL_GOOD_CAST(const char*, name)),
+                                        RASQAL_WRITE_ESCAPE_XML_ATTRIBUTE);
+      rasqal_write_buffer_write_bytes(wb, "\">", 2);
 
       if(!l) {
-        element1=raptor_new_xml_element_from_namespace_local_name(res_ns,
-                                                                  RASQAL_GOOD_CAST(const unsigned char*, "unbound"),
-                                                                  NULL, base_uri);
-        if(!element1)
-          goto tidy;
-        raptor_xml_writer_empty_element(xml_writer, element1);
+        rasqal_write_buffer_write_bytes(wb, "<unbound/>", 10);
 
       } else switch(l->type) {
         case RASQAL_LITERAL_URI:
-          element1=raptor_new_xml_element_from_namespace_local_name(res_ns,
-                                                                    RASQAL_GOOD_CAST(const unsigned char*, "uri"),
-                                                                    NULL, base_uri);
-          if(!element1)
-            goto tidy;
-          
-          raptor_xml_writer_start_element(xml_writer, element1);
-          raptor_xml_writer_cdata(xml_writer, RASQAL_GOOD_CAST(const unsigned char*, raptor_uri_as_string(l->value.uri)));
-          raptor_xml_writer_end_element(xml_writer, element1);
-
+          rasqal_write_buffer_write_bytes(wb, "<uri>", 5);
+          rasqal_write_buffer_write_uri(wb, l->value.uri,
+                                        RASQAL_WRITE_ESCAPE_XML_CDATA);
+          rasqal_write_buffer_write_bytes(wb, "</uri>", 6);
           break;
 
         case RASQAL_LITERAL_BLANK:
-          element1=raptor_new_xml_element_from_namespace_local_name(res_ns,
-                                                                    RASQAL_GOOD_CAST(const unsigned char*, "bnode"),
-                                                                    NULL, base_uri);
-          if(!element1)
-            goto tidy;
-          
-          raptor_xml_writer_start_element(xml_writer, element1);
-          raptor_xml_writer_cdata(xml_writer, RASQAL_GOOD_CAST(const unsigned char*, l->string));
-          raptor_xml_writer_end_element(xml_writer, element1);
+          rasqal_write_buffer_write_bytes(wb, "<bnode>", 7);
+          rasqal_write_buffer_write_escaped(wb, l->string,
+                                            strlen(RASQAL_GOOD_CAST(const char*, l->string)),
+                                            RASQAL_WRITE_ESCAPE_XML_CDATA);
+          rasqal_write_buffer_write_bytes(wb, "</bnode>", 8);
           break;
 
         case RASQAL_LITERAL_STRING:
         case RASQAL_LITERAL_UDT:
-          element1=raptor_new_xml_element_from_namespace_local_name(res_ns,
-                                                                    RASQAL_GOOD_CAST(const unsigned char*, "literal"),
-                                                                    NULL, base_uri);
-          if(!element1)
-            goto tidy;
-
-          if(l->language || l->datatype) {
-            attrs=(raptor_qname **)raptor_alloc_memory(sizeof(raptor_qname*));
-            if(!attrs)
-              goto tidy;
-
-            if(l->language)
-              attrs[0]=raptor_new_qname(nstack,
-                                        RASQAL_GOOD_CAST(const unsigned char*, "xml:lang"),
-                                        RASQAL_GOOD_CAST(const unsigned char*, l->language));
-            else
-              attrs[0] = raptor_new_qname_from_namespace_local_name(world->raptor_world_ptr,
-                                                                    res_ns,
-                                                                    RASQAL_GOOD_CAST(const unsigned char*, "datatype"),
-                                                                    RASQAL_GOOD_CAST(const unsigned char*, raptor_uri_as_string(l->datatype)));
-            if(!attrs[0]) {
-              raptor_free_memory((void*)attrs);
-              goto tidy;
-            }
-
-            raptor_xml_element_set_attributes(element1, attrs, 1);
-          }
-
-
-          raptor_xml_writer_start_element(xml_writer, element1);
-
-
-          raptor_xml_writer_cdata_counted(xml_writer,
-                                          RASQAL_GOOD_CAST(const unsigned char*, l->string),
-                                          l->string_len);
-
-          raptor_xml_writer_end_element(xml_writer, element1);
-          
+          if(l->language) {
+            rasqal_write_buffer_write_bytes(wb, "<literal xml:lang=\"", 19);
+            rasqal_write_buffer_write_escaped(wb,
+                                              RASQAL_GOOD_CAST(const unsigned char*, l->language),
+                                              strlen(l->language),
+                                              RASQAL_WRITE_ESCAPE_XML_ATTRIBUTE);
+            rasqal_write_buffer_write_bytes(wb, "\">", 2);
+          } else if(l->datatype) {
+            rasqal_write_buffer_write_bytes(wb, "<literal datatype=\"", 19);
+            rasqal_write_buffer_write_uri(wb, l->datatype,
+                                          RASQAL_WRITE_ESCAPE_XML_ATTRIBUTE);
+            rasqal_write_buffer_write_bytes(wb, "\">", 2);
+          } else
+            rasqal_write_buffer_write_bytes(wb, "<literal>", 9);
+
+          rasqal_write_buffer_write_escaped(wb, l->string, l->string_len,
+                                            RASQAL_WRITE_ESCAPE_XML_CDATA);
+
+          rasqal_write_buffer_write_bytes(wb, "</literal>", 10);
           break;
+
         case RASQAL_LITERAL_PATTERN:
         case RASQAL_LITERAL_QNAME:
         case RASQAL_LITERAL_INTEGER:
@@ -370,26 +323,18 @@ rasqal_query_results_write_sparql_xml(rasqal_query_results_formatter* formatter,
           goto tidy;
         }
 
-      if(element1) {
-        raptor_free_xml_element(element1);
-        element1=NULL;
-      }
-
       /*       </binding> */
-      raptor_xml_writer_end_element(xml_writer, binding_element);
-      raptor_xml_writer_raw_counted(xml_writer, RASQAL_GOOD_CAST(const unsigned char*, "\n"), 1);
-      
-      raptor_free_xml_element(binding_element);
-      binding_element=NULL;
+      rasqal_write_buffer_write_bytes(wb, "</binding>\n", 11);
     }
 
-    raptor_xml_writer_raw_counted(xml_writer, RASQAL_GOOD_CAST(const unsigned char*, "    "), 4);
-    raptor_xml_writer_end_element(xml_writer, result_element);
-    raptor_xml_writer_raw_counted(xml_writer, RASQAL_GOOD_CAST(const unsigned char*, "\n"), 1);
+    rasqal_write_buffer_write_bytes(wb, "    </result>\n", 14);
     
     rasqal_query_results_next(results);
   }
 
+  if(rasqal_write_buffer_flush(wb))
+    goto tidy;
+
   raptor_xml_writer_raw_counted(xml_writer, RASQAL_GOOD_CAST(const unsigned char*, "  "), 2);
   raptor_xml_writer_end_element(xml_writer, results_element);
   raptor_xml_writer_raw_counted(xml_writer, RASQAL_GOOD_CAST(const unsigned char*, "\n"), 1);
@@ -402,12 +347,12 @@ rasqal_query_results_write_sparql_xml(rasqal_query_results_formatter* formatter,
   raptor_xml_writer_raw_counted(xml_writer, RASQAL_GOOD_CAST(const unsigned char*, "\n"), 1);
 
   tidy:
+  if(wb)
+    rasqal_free_write_buffer(wb);
   if(element1)
     raptor_free_xml_element(element1);
   if(variable_element)
     raptor_free_xml_element(variable_element);
-  if(binding_element)
-    raptor_free_xml_element(binding_element);
   if(result_element)
     raptor_free_xml_element(result_element);
   if(results_element)
@@ -1061,6 +1006,9 @@ static const rasqal_rowsource_handler rasqal_rowsource_sparql_xml_handler={
   /* .set_requirements = */ NULL,
   /* .get_inner_rowsource = */ NULL,
   /* .set_origin = */ NULL,
+  /* .read_batch = */ NULL,
+  /* .get_order = */ NULL,
+  /* .set_outer_variables = */ NULL,
 };
 
 
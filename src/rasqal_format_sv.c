@@ -40,13 +40,11 @@
 #endif
 #include <stdarg.h>
 
-#ifndef FILE_READ_BUF_SIZE
-#ifdef BUFSIZ
-#define FILE_READ_BUF_SIZE BUFSIZ
-#else
-#define FILE_READ_BUF_SIZE 1024
-#endif
-#endif
+/* bytes read from the iostream per chunk */
+#define RASQAL_SV_READ_BUFFER_SIZE (256 * 1024)
+
+/* longest field remembered to share its literal with the next row */
+#define RASQAL_SV_COLUMN_CACHE_MAX_WIDTH 1024
 
 #include "rasqal.h"
 #include "rasqal_internal.h"
@@ -55,37 +53,44 @@
 
 #include "sv.h"
 
+/*
+ * rasqal_write_buffer_write_bnodeid:
+ * @wb: write buffer
+ * @bnodeid: blank node ID
+ * @len: length of @bnodeid
+ *
+ * INTERNAL - Write an N-Triples blank node to a write buffer
+ *
+ * IDs matching [A-Za-z][A-Za-z0-9]* are written unchanged by raptor
+ * so they are copied; raptor rewrites any other ID.
+ *
+ * Return value: non-0 on failure
+ */
 static int
-rasqal_iostream_write_csv_string(const unsigned char *string, size_t len,
-                                 raptor_iostream *iostr)
+rasqal_write_buffer_write_bnodeid(rasqal_write_buffer* wb,
+                                  const unsigned char* bnodeid, size_t len)
 {
-  const char delim = '\x22';
-  int quoting_needed = 0;
   size_t i;
 
   for(i = 0; i < len; i++) {
-    char c = RASQAL_GOOD_CAST(char, string[i]);
-    /* Quoting needed for delim (double quote), comma, linefeed or return */
-    if(c == delim   || c == ',' || c == '\r' || c == '\n') {
-      quoting_needed++;
-      break;
-    }
-  }
-  if(!quoting_needed)
-    return raptor_iostream_counted_string_write(string, len, iostr);
+    const unsigned char c = bnodeid[i];
 
-  raptor_iostream_write_byte(delim, iostr);
-  for(i = 0; i < len; i++) {
-    char c = RASQAL_GOOD_CAST(char, string[i]);
-    if(c == delim)
-      raptor_iostream_write_byte(delim, iostr);
-    raptor_iostream_write_byte(c, iostr);
+    if((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'))
+      continue;
+    if(i > 0 && c >= '0' && c <= '9')
+      continue;
+    break;
   }
-  raptor_iostream_write_byte(delim, iostr);
 
-  return 0;
+  if(!len || i < len)
+    return raptor_bnodeid_ntriples_write(bnodeid, len,
+                                         rasqal_write_buffer_get_iostream(wb));
+
+  rasqal_write_buffer_write_bytes(wb, "_:", 2);
+  return rasqal_write_buffer_write_bytes(wb, bnodeid, len);
 }
 
+
 /*
  * rasqal_query_results_write_sv:
  * @iostr: #raptor_iostream to write the query to
@@ -100,6 +105,9 @@ rasqal_iostream_write_csv_string(const unsigned char *string, size_t len,
  *
  * INTERNAL - Write a @sep-separated values version of the query results format to an iostream.
  * 
+ * Rows are formatted into a #rasqal_write_buffer and written to
+ * @iostr in large blocks.
+ *
  * If the writing succeeds, the query results will be exhausted.
  * 
  * Return value: non-0 on failure
@@ -115,10 +123,15 @@ rasqal_query_results_write_sv(raptor_iostream *iostr,
                               const char* eol_str,
                               size_t eol_str_len)
 {
+  rasqal_world* world = rasqal_query_results_get_world(results);
   rasqal_query* query = rasqal_query_results_get_query(results);
+  rasqal_write_buffer* wb;
+  rasqal_write_escape escape;
+  rasqal_row* row;
   int i;
   int vars_count;
   int emit_mkr;
+  int rc;
 
   if(!strcmp(label, (const char*)"mkr"))
     emit_mkr = 1;
@@ -133,9 +146,15 @@ rasqal_query_results_write_sv(raptor_iostream *iostr,
     return 1;
   }
 
+  wb = rasqal_new_write_buffer(world->raptor_world_ptr, iostr, 0);
+  if(!wb)
+    return 1;
+
+  escape = csv_escape ? RASQAL_WRITE_ESCAPE_CSV : RASQAL_WRITE_ESCAPE_NTRIPLES;
+
   if(emit_mkr) {
-    raptor_iostream_counted_string_write("result is relation with format = csv;\n", 38, iostr);
-    raptor_iostream_counted_string_write("begin relation result;\n", 23, iostr);
+    rasqal_write_buffer_write_bytes(wb, "result is relation with format = csv;\n", 38);
+    rasqal_write_buffer_write_bytes(wb, "begin relation result;\n", 23);
   }
   
   /* Header */
@@ -147,80 +166,78 @@ rasqal_query_results_write_sv(raptor_iostream *iostr,
       break;
 
     if(i > 0)
-      raptor_iostream_write_byte(sep, iostr);
+      rasqal_write_buffer_write_byte(wb, sep);
 
     if(variable_prefix)
-      raptor_iostream_write_byte(variable_prefix, iostr);
-    raptor_iostream_string_write(name, iostr);
+      rasqal_write_buffer_write_byte(wb, variable_prefix);
+    rasqal_write_buffer_write_string(wb, name);
   }
   if(emit_mkr)
-    raptor_iostream_counted_string_write(";", 1, iostr);
-  raptor_iostream_counted_string_write(eol_str, eol_str_len, iostr);
+    rasqal_write_buffer_write_byte(wb, ';');
+  rasqal_write_buffer_write_bytes(wb, eol_str, eol_str_len);
 
 
   /* Variable Binding Results */
   vars_count = rasqal_query_results_get_bindings_count(results);
-  while(!rasqal_query_results_finished(results)) {
+  while((row = rasqal_query_results_get_current_row(results))) {
     /* Result row */
     for(i = 0; i < vars_count; i++) {
-      rasqal_literal *l = rasqal_query_results_get_binding_value(results, i);
+      rasqal_literal *l = row->values[i];
 
       if(i > 0)
-        raptor_iostream_write_byte(sep, iostr);
+        rasqal_write_buffer_write_byte(wb, sep);
 
       if(l) {
-        const unsigned char* str;
-        size_t len;
-        
         switch(l->type) {
           case RASQAL_LITERAL_URI:
-            str = RASQAL_GOOD_CAST(const unsigned char*, raptor_uri_as_counted_string(l->value.uri, &len));
             if(csv_escape)
-              rasqal_iostream_write_csv_string(str, len, iostr);
+              rasqal_write_buffer_write_uri(wb, l->value.uri, escape);
             else {
-              raptor_iostream_write_byte('<', iostr);
-              if(str && len > 0)
-                raptor_string_ntriples_write(str, len, '"', iostr);
-              raptor_iostream_write_byte('>', iostr);
+              rasqal_write_buffer_write_byte(wb, '<');
+              rasqal_write_buffer_write_uri(wb, l->value.uri, escape);
+              rasqal_write_buffer_write_byte(wb, '>');
             }
             break;
 
           case RASQAL_LITERAL_BLANK:
-            raptor_bnodeid_ntriples_write(l->string, l->string_len, iostr);
+            rasqal_write_buffer_write_bnodeid(wb, l->string, l->string_len);
             break;
 
           case RASQAL_LITERAL_STRING:
             if(csv_escape) {
-              rasqal_iostream_write_csv_string(l->string, l->string_len, iostr);
+              rasqal_write_buffer_write_escaped(wb, l->string, l->string_len,
+                                                escape);
             } else {
               if(l->datatype && l->valid) {
                 rasqal_literal_type ltype;
-                ltype = rasqal_xsd_datatype_uri_to_type(l->world, l->datatype);
+                ltype = rasqal_literal_get_datatype_type(l);
 
                 if(ltype >= RASQAL_LITERAL_INTEGER &&
                    ltype <= RASQAL_LITERAL_DECIMAL) {
                   /* write integer, float, double and decimal XSD typed
                    * data without quotes, datatype or language 
                    */
-                  raptor_string_ntriples_write(l->string, l->string_len, '\0', iostr);
+                  rasqal_write_buffer_write_escaped(wb, l->string,
+                                                    l->string_len,
+                                                    RASQAL_WRITE_ESCAPE_NTRIPLES_BARE);
                   break;
                 }
               }
 
-              raptor_iostream_write_byte('"', iostr);
-              raptor_string_ntriples_write(l->string, l->string_len, '"', iostr);
-              raptor_iostream_write_byte('"', iostr);
+              rasqal_write_buffer_write_byte(wb, '"');
+              rasqal_write_buffer_write_escaped(wb, l->string, l->string_len,
+                                                escape);
+              rasqal_write_buffer_write_byte(wb, '"');
 
               if(l->language) {
-                raptor_iostream_write_byte('@', iostr);
-                raptor_iostream_string_write(RASQAL_GOOD_CAST(const unsigned char*, l->language), iostr);
+                rasqal_write_buffer_write_byte(wb, '@');
+                rasqal_write_buffer_write_string(wb, l->language);
               }
 
               if(l->datatype) {
-                raptor_iostream_string_write("^^<", iostr);
-                str = RASQAL_GOOD_CAST(const unsigned char*, raptor_uri_as_counted_string(l->datatype, &len));
-                raptor_string_ntriples_write(str, len, '"', iostr);
-                raptor_iostream_write_byte('>', iostr);
+                rasqal_write_buffer_write_bytes(wb, "^^<", 3);
+                rasqal_write_buffer_write_uri(wb, l->datatype, escape);
+                rasqal_write_buffer_write_byte(wb, '>');
               }
             }
 
@@ -254,16 +271,19 @@ rasqal_query_results_write_sv(raptor_iostream *iostr,
 
     /* End Result Row */
     if(emit_mkr)
-      raptor_iostream_counted_string_write(";", 1, iostr);
-    raptor_iostream_counted_string_write(eol_str, eol_str_len, iostr);
+      rasqal_write_buffer_write_byte(wb, ';');
+    rasqal_write_buffer_write_bytes(wb, eol_str, eol_str_len);
     
     rasqal_query_results_next(results);
   }
   if(emit_mkr)
-    raptor_iostream_counted_string_write("end relation result;\n", 21, iostr);
+    rasqal_write_buffer_write_bytes(wb, "end relation result;\n", 21);
 
   /* end sparql */
-  return 0;
+  rc = rasqal_write_buffer_flush(wb);
+  rasqal_free_write_buffer(wb);
+
+  return rc;
 }
 
 
@@ -304,6 +324,21 @@ rasqal_query_results_write_tsv(rasqal_query_results_formatter* formatter,
 
 
 
+/*
+ * Previous value of a column: a repeat of @field shares @literal
+ */
+typedef struct
+{
+  /* copy of the field; @size bytes allocated */
+  char* field;
+  size_t width;
+  size_t size;
+
+  /* literal made from @field or NULL */
+  rasqal_literal* literal;
+} rasqal_rowsource_sv_column;
+
+
 typedef struct 
 {
   rasqal_world* world;
@@ -321,9 +356,13 @@ typedef struct
   int emit_mkr;  /* Non 0 for mKR relation */
   char sep;
   sv* t;
-  char buffer[FILE_READ_BUF_SIZE]; /* iostream read buffer */
+  char* buffer; /* iostream read buffer of RASQAL_SV_READ_BUFFER_SIZE */
   int offset; /* current result row number */
 
+  /* previous row values */
+  rasqal_rowsource_sv_column* columns;
+  size_t columns_count;
+
   /* Output fields */
   raptor_sequence* results_sequence; /* saved result rows */
 
@@ -374,6 +413,47 @@ rasqal_rowsource_sv_header_callback(sv *t, void *user_data,
 }
 
 
+/*
+ * rasqal_rowsource_sv_column_remember:
+ * @column: column
+ * @field: field
+ * @field_len: length of @field
+ * @l: literal made from @field
+ *
+ * INTERNAL - Remember the literal for a field so the next row can share it
+ *
+ * On failure the column is left empty.
+ */
+static void
+rasqal_rowsource_sv_column_remember(rasqal_rowsource_sv_column* column,
+                                    const char* field, size_t field_len,
+                                    rasqal_literal* l)
+{
+  if(column->literal) {
+    rasqal_free_literal(column->literal);
+    column->literal = NULL;
+  }
+
+  if(field_len > RASQAL_SV_COLUMN_CACHE_MAX_WIDTH)
+    return;
+
+  if(column->size < field_len) {
+    if(column->field)
+      RASQAL_FREE(char*, column->field);
+    column->size = 0;
+
+    column->field = RASQAL_MALLOC(char*, field_len);
+    if(!column->field)
+      return;
+    column->size = field_len;
+  }
+
+  memcpy(column->field, field, field_len);
+  column->width = field_len;
+  column->literal = rasqal_new_literal_from_literal(l);
+}
+
+
 static sv_status_t
 rasqal_rowsource_sv_data_callback(sv *t, void *user_data,
                                   char** fields, size_t *widths,
@@ -392,35 +472,53 @@ rasqal_rowsource_sv_data_callback(sv *t, void *user_data,
   RASQAL_DEBUG2("Made new row %d\n", con->offset);
   con->offset++;
 
+  if(!con->columns && count) {
+    con->columns = RASQAL_CALLOC(rasqal_rowsource_sv_column*, count,
+                                 sizeof(*con->columns));
+    /* without it nothing is shared */
+    if(con->columns)
+      con->columns_count = count;
+  }
+
   for(i = 0; i < count; i++) {
     char* field = fields[i];
     size_t field_len = widths[i];
+    rasqal_rowsource_sv_column* column = NULL;
     rasqal_literal* l;
 
+    if(i < con->columns_count)
+      column = &con->columns[i];
+
     if(!field_len) {
       /* missing */
       l = NULL;
-    } else if(con->data_is_turtle) {
-      l = rasqal_new_literal_from_ntriples_counted_string(con->world,
-                                                          RASQAL_GOOD_CAST(unsigned char*,field),
-                                                          field_len);
-      if(!l)
-        goto fail;
+    } else if(column && column->literal && column->width == field_len &&
+              !memcmp(column->field, field, field_len)) {
+      /* same as the previous row */
+      l = rasqal_new_literal_from_literal(column->literal);
     } else {
-      unsigned char* lvalue;
-
-      lvalue = RASQAL_MALLOC(unsigned char*, field_len + 1);
-      if(!lvalue)
-        goto fail;
+      if(con->data_is_turtle) {
+        l = rasqal_new_literal_from_ntriples_counted_string(con->world,
+                                                            RASQAL_GOOD_CAST(unsigned char*,field),
+                                                            field_len);
+        if(!l)
+          goto fail;
+      } else {
+        unsigned char* lvalue;
+
+        lvalue = RASQAL_MALLOC(unsigned char*, field_len + 1);
+        if(!lvalue)
+          goto fail;
 
-      if(!widths[i])
-        *lvalue = '\0';
-      else
         memcpy(lvalue, field, field_len + 1);
 
-      l = rasqal_new_string_literal_node(con->world, lvalue, NULL, NULL);
-      if(!l)
-        goto fail;
+        l = rasqal_new_string_literal_node(con->world, lvalue, NULL, NULL);
+        if(!l)
+          goto fail;
+      }
+
+      if(column)
+        rasqal_rowsource_sv_column_remember(column, field, field_len, l);
     }
 
     rasqal_row_set_value_at(row, RASQAL_GOOD_CAST(int, i), l);
@@ -452,6 +550,10 @@ rasqal_rowsource_sv_init(rasqal_rowsource* rowsource, void *user_data)
 
   con->rowsource = rowsource;
 
+  con->buffer = RASQAL_MALLOC(char*, RASQAL_SV_READ_BUFFER_SIZE);
+  if(!con->buffer)
+    return 1;
+
   con->t = sv_new(con,
                   rasqal_rowsource_sv_header_callback,
                   rasqal_rowsource_sv_data_callback,
@@ -476,6 +578,21 @@ rasqal_rowsource_sv_finish(rasqal_rowsource* rowsource, void *user_data)
   if(con->t)
     sv_free(con->t);
 
+  if(con->buffer)
+    RASQAL_FREE(char*, con->buffer);
+
+  if(con->columns) {
+    size_t i;
+
+    for(i = 0; i < con->columns_count; i++) {
+      if(con->columns[i].field)
+        RASQAL_FREE(char*, con->columns[i].field);
+      if(con->columns[i].literal)
+        rasqal_free_literal(con->columns[i].literal);
+    }
+    RASQAL_FREE(rasqal_rowsource_sv_column*, con->columns);
+  }
+
   if(con->base_uri)
     raptor_free_uri(con->base_uri);
 
@@ -508,7 +625,7 @@ rasqal_rowsource_sv_process(rasqal_rowsource_sv_context* con)
 
     read_len = RASQAL_BAD_CAST(size_t,
                                raptor_iostream_read_bytes(RASQAL_GOOD_CAST(char*, con->buffer), 1,
-                                                          FILE_READ_BUF_SIZE,
+                                                          RASQAL_SV_READ_BUFFER_SIZE,
                                                           con->iostr));
     if(read_len > 0) {
       sv_status_t status;
@@ -522,7 +639,7 @@ rasqal_rowsource_sv_process(rasqal_rowsource_sv_context* con)
       }
     }
 
-    if(read_len < FILE_READ_BUF_SIZE) {
+    if(read_len < RASQAL_SV_READ_BUFFER_SIZE) {
       /* finished */
       break;
     }
@@ -584,6 +701,9 @@ static const rasqal_rowsource_handler rasqal_rowsource_csv_handler={
   /* .set_requirements = */ NULL,
   /* .get_inner_rowsource = */ NULL,
   /* .set_origin = */ NULL,
+  /* .read_batch = */ NULL,
+  /* .get_order = */ NULL,
+  /* .set_outer_variables = */ NULL,
 };
 
 static const rasqal_rowsource_handler rasqal_rowsource_mkr_handler={
@@ -598,6 +718,9 @@ static const rasqal_rowsource_handler rasqal_rowsource_mkr_handler={
   /* .set_requirements = */ NULL,
   /* .get_inner_rowsource = */ NULL,
   /* .set_origin = */ NULL,
+  /* .read_batch = */ NULL,
+  /* .get_order = */ NULL,
+  /* .set_outer_variables = */ NULL,
 };
 
 static const rasqal_rowsource_handler rasqal_rowsource_tsv_handler={
@@ -612,6 +735,9 @@ static const rasqal_rowsource_handler rasqal_rowsource_tsv_handler={
   /* .set_requirements = */ NULL,
   /* .get_inner_rowsource = */ NULL,
   /* .set_origin = */ NULL,
+  /* .read_batch = */ NULL,
+  /* .get_order = */ NULL,
+  /* .set_outer_variables = */ NULL,
 };
 
 
@@ -65,6 +65,8 @@ rasqal_free_formula(rasqal_formula* formula)
     raptor_free_sequence(formula->triples);
   if(formula->value)
     rasqal_free_literal(formula->value);
+  if(formula->path)
+    rasqal_free_path(formula->path);
   RASQAL_FREE(rasqal_formula, formula);
 }
   
@@ -125,7 +125,7 @@ rasqal_new_world(void)
   
   world->warning_level = RASQAL_WARNING_LEVEL_DEFAULT;
 
-  world->genid_counter = 1;
+  world->query_cache_size = RASQAL_QUERY_CACHE_DEFAULT_SIZE;
 
   return world;
 }
@@ -230,6 +230,9 @@ rasqal_free_world(rasqal_world* world)
   if(!world)
     return;
   
+  /* cached queries refer to the factories and URIs freed below */
+  rasqal_world_query_cache_finish(world);
+
   rasqal_finish_result_formats(world);
   rasqal_finish_query_results();
 
@@ -116,6 +116,37 @@ rasqal_new_basic_graph_pattern(rasqal_query* query,
 }
 
 
+/*
+ * rasqal_new_path_graph_pattern:
+ * @query: #rasqal_graph_pattern query object
+ * @triples: triples sequence containing the graph pattern
+ * @column: property path triple in the pattern
+ *
+ * INTERNAL - Create a new graph pattern over one property path triple.
+ * 
+ * Return value: a new #rasqal_graph_pattern object or NULL on failure
+ **/
+rasqal_graph_pattern*
+rasqal_new_path_graph_pattern(rasqal_query* query,
+                              raptor_sequence *triples, int column)
+{
+  rasqal_graph_pattern* gp;
+
+  RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(query, rasqal_query, NULL);
+  RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(triples, raptor_sequence, NULL);
+  
+  gp = rasqal_new_graph_pattern(query, RASQAL_GRAPH_PATTERN_OPERATOR_PATH);
+  if(!gp)
+    return NULL;
+
+  gp->triples = triples;
+  gp->start_column = column;
+  gp->end_column = column;
+
+  return gp;
+}
+
+
 /*
  * rasqal_new_graph_pattern_from_sequence:
  * @query: #rasqal_graph_pattern query object
@@ -445,7 +476,8 @@ static const char* const rasqal_graph_pattern_operator_labels[RASQAL_GRAPH_PATTE
   "Select",
   "Service",
   "Minus",
-  "Values"
+  "Values",
+  "Path"
 };
 
 
@@ -834,6 +866,40 @@ rasqal_graph_pattern_print(rasqal_graph_pattern* gp, FILE* fh)
 }
 
 
+typedef struct {
+  rasqal_query* query;
+  rasqal_graph_pattern_visit_fn fn;
+  void* user_data;
+  int result;
+} rasqal_graph_pattern_exists_visit_state;
+
+
+/*
+ * rasqal_graph_pattern_visit_exists:
+ * @user_data: #rasqal_graph_pattern_exists_visit_state
+ * @e: expression
+ *
+ * INTERNAL - expression visitor to visit EXISTS / NOT EXISTS graph patterns
+ *
+ * Return value: non-0 to truncate the visit
+ */
+static int
+rasqal_graph_pattern_visit_exists(void* user_data, rasqal_expression* e)
+{
+  rasqal_graph_pattern_exists_visit_state* st;
+
+  st = (rasqal_graph_pattern_exists_visit_state*)user_data;
+
+  if(e->op == RASQAL_EXPR_EXISTS || e->op == RASQAL_EXPR_NOT_EXISTS) {
+    st->result = rasqal_graph_pattern_visit(st->query, e->graph_pattern,
+                                            st->fn, st->user_data);
+    return st->result;
+  }
+
+  return 0;
+}
+
+
 /**
  * rasqal_graph_pattern_visit:
  * @query: #rasqal_query to operate on
@@ -883,6 +949,20 @@ rasqal_graph_pattern_visit(rasqal_query *query,
     }
   }
 
+  /* graph patterns inside FILTER EXISTS / NOT EXISTS expressions */
+  if(gp->op == RASQAL_GRAPH_PATTERN_OPERATOR_FILTER && gp->filter_expression) {
+    rasqal_graph_pattern_exists_visit_state st;
+
+    st.query = query;
+    st.fn = fn;
+    st.user_data = user_data;
+    st.result = 0;
+    rasqal_expression_visit(gp->filter_expression,
+                            rasqal_graph_pattern_visit_exists, &st);
+    if(st.result)
+      return st.result;
+  }
+
   return 0;
 }
 
@@ -1058,6 +1138,9 @@ rasqal_new_basic_graph_pattern_from_formula(rasqal_query* query,
   raptor_sequence *formula_triples  = formula->triples;
   int offset = raptor_sequence_size(triples);
   int triple_pattern_size = 0;
+  raptor_sequence *seq;
+  int start_column;
+  int column;
 
   if(formula_triples) {
     /* Move formula triples to end of main triples sequence */
@@ -1071,11 +1154,59 @@ rasqal_new_basic_graph_pattern_from_formula(rasqal_query* query,
 
   rasqal_free_formula(formula);
 
-  gp = rasqal_new_basic_graph_pattern(query, triples, 
-                                      offset, 
-                                      offset + triple_pattern_size - 1);
+  for(column = offset; column < offset + triple_pattern_size; column++) {
+    rasqal_triple* t = (rasqal_triple*)raptor_sequence_get_at(triples, column);
+    if(t->path)
+      break;
+  }
 
-  return gp;
+  if(column == offset + triple_pattern_size) {
+    gp = rasqal_new_basic_graph_pattern(query, triples, 
+                                        offset, 
+                                        offset + triple_pattern_size - 1);
+    return gp;
+  }
+
+  /* Property path triples are split out into their own graph
+   * patterns, keeping the order of the triples in a group
+   */
+  seq = raptor_new_sequence((raptor_data_free_handler)rasqal_free_graph_pattern,
+                            (raptor_data_print_handler)rasqal_graph_pattern_print);
+  if(!seq)
+    return NULL;
+
+  start_column = offset;
+  for(column = offset; column <= offset + triple_pattern_size; column++) {
+    rasqal_triple* t = NULL;
+
+    if(column < offset + triple_pattern_size) {
+      t = (rasqal_triple*)raptor_sequence_get_at(triples, column);
+      if(!t->path)
+        continue;
+    }
+
+    if(column > start_column) {
+      gp = rasqal_new_basic_graph_pattern(query, triples,
+                                          start_column, column - 1);
+      if(!gp || raptor_sequence_push(seq, gp))
+        goto fail;
+    }
+
+    if(t) {
+      gp = rasqal_new_path_graph_pattern(query, triples, column);
+      if(!gp || raptor_sequence_push(seq, gp))
+        goto fail;
+    }
+
+    start_column = column + 1;
+  }
+
+  return rasqal_new_graph_pattern_from_sequence(query, seq,
+                                                RASQAL_GRAPH_PATTERN_OPERATOR_GROUP);
+
+  fail:
+  raptor_free_sequence(seq);
+  return NULL;
 }
 
 
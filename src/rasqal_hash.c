@@ -0,0 +1,115 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_hash.c - Rasqal non-cryptographic hash utilities
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <string.h>
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+
+#define RASQAL_HASH_K1 0x9e3779b97f4a7c15ULL
+#define RASQAL_HASH_K2 0xc2b2ae3d27d4eb4fULL
+
+
+/*
+ * rasqal_hash_mix:
+ * @value: value
+ *
+ * INTERNAL - Scramble a 64 bit value so every input bit affects every output bit
+ *
+ * This is the splitmix64 finalizer.
+ *
+ * Return value: mixed value
+ */
+uint64_t
+rasqal_hash_mix(uint64_t value)
+{
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9ULL;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebULL;
+  value ^= value >> 31;
+  return value;
+}
+
+
+/*
+ * rasqal_hash_combine:
+ * @hash: hash so far
+ * @value: value to add
+ *
+ * INTERNAL - Add a value to a hash in an order dependent way
+ *
+ * Return value: new hash
+ */
+uint64_t
+rasqal_hash_combine(uint64_t hash, uint64_t value)
+{
+  hash ^= value * RASQAL_HASH_K2;
+  hash = (hash << 31) | (hash >> 33);
+  return hash * RASQAL_HASH_K1;
+}
+
+
+/*
+ * rasqal_hash_bytes:
+ * @hash: hash so far (or 0)
+ * @data: bytes
+ * @len: length of @data
+ *
+ * INTERNAL - Add bytes to a hash
+ *
+ * Reads @data a 64 bit word at a time.  The result depends on the
+ * machine byte order so hashes must only be compared within one
+ * process and never stored.
+ *
+ * Return value: new hash
+ */
+uint64_t
+rasqal_hash_bytes(uint64_t hash, const unsigned char* data, size_t len)
+{
+  uint64_t word;
+
+  hash = rasqal_hash_combine(hash, RASQAL_GOOD_CAST(uint64_t, len));
+
+  while(len >= 8) {
+    memcpy(&word, data, 8);
+    hash = rasqal_hash_combine(hash, word);
+    data += 8;
+    len -= 8;
+  }
+
+  if(len) {
+    word = 0;
+    memcpy(&word, data, len);
+    hash = rasqal_hash_combine(hash, word);
+  }
+
+  return hash;
+}
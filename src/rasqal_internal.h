@@ -27,6 +27,7 @@
 #define RASQAL_INTERNAL_H
 
 #if defined(_MSC_VER) && _MSC_VER < 1600
+typedef unsigned __int64 uint64_t;
 typedef unsigned __int32 uint32_t;
 typedef __int16 int16_t;
 #else
@@ -207,11 +208,15 @@ typedef struct rasqal_query_language_factory_s rasqal_query_language_factory;
  * rasqal_projection:
  * @query: rasqal query
  * @wildcard: non-0 if @variables was '*'
- * @distinct: 1 if distinct, 2 if reduced, otherwise neither
+ * @distinct: #RASQAL_PROJECTION_DISTINCT if distinct,
+ *   #RASQAL_PROJECTION_REDUCED if reduced, otherwise neither (0)
  *
  * Query projection (SELECT vars, SELECT *, SELECT DISTINCT/REDUCED ...)
  *
  */
+#define RASQAL_PROJECTION_DISTINCT 1
+#define RASQAL_PROJECTION_REDUCED 2
+
 typedef struct {
   rasqal_query* query;
   
@@ -315,6 +320,7 @@ struct rasqal_graph_pattern_s {
 };
 
 rasqal_graph_pattern* rasqal_new_basic_graph_pattern(rasqal_query* query, raptor_sequence* triples, int start_column, int end_column);
+rasqal_graph_pattern* rasqal_new_path_graph_pattern(rasqal_query* query, raptor_sequence* triples, int column);
 rasqal_graph_pattern* rasqal_new_graph_pattern_from_sequence(rasqal_query* query, raptor_sequence* graph_patterns, rasqal_graph_pattern_operator op);
 rasqal_graph_pattern* rasqal_new_filter_graph_pattern(rasqal_query* query, rasqal_expression* expr);
 rasqal_graph_pattern* rasqal_new_let_graph_pattern(rasqal_query *query, rasqal_variable *var, rasqal_expression *expr);  
@@ -548,6 +554,27 @@ struct rasqal_query_s {
 
   /* Variable projection (or NULL when invalid such as for ASK) */
   rasqal_projection* projection;
+
+  /* INTERNAL query algebra plan built at first execution and reused
+   * by later executions (or NULL) */
+  struct rasqal_algebra_node_s* algebra_node;
+
+  /* query results execution whose state is currently held in the
+   * variable values (or NULL) */
+  rasqal_query_results* active_results;
+
+  /* INTERNAL values set by rasqal_query_set_variable2() by variables
+   * table index (array of size @prebound_values_count) that every
+   * execution starts from */
+  rasqal_literal** prebound_values;
+  int prebound_values_count;
+
+  /* INTERNAL aggregate expressions and their internal variables
+   * extracted from the projection and HAVING by the first algebra
+   * build.  The extraction rewrites those in place so later builds
+   * reuse these.  (or NULL) */
+  raptor_sequence* agg_exprs;
+  raptor_sequence* agg_vars;
 };
 
 
@@ -613,6 +640,13 @@ struct rasqal_row_s {
   int order_size;
   rasqal_literal** order_values;
 
+  /* byte key of order_values from rasqal_literal_array_to_order_key()
+   * (or NULL) and its length; order_key_complete is non-0 if it
+   * orders all the values */
+  unsigned char* order_key;
+  size_t order_key_len;
+  int order_key_complete;
+
   /* Group ID */
   int group_id;
 
@@ -640,7 +674,8 @@ typedef enum {
 
 
 /* rasqal_rowsource_aggregation.c */
-rasqal_rowsource* rasqal_new_aggregation_rowsource(rasqal_world *world, rasqal_query* query, rasqal_rowsource* rowsource, raptor_sequence* exprs_seq, raptor_sequence* vars_seq);
+rasqal_rowsource* rasqal_new_aggregation_rowsource(rasqal_world *world, rasqal_query* query, rasqal_rowsource* rowsource, raptor_sequence* group_exprs_seq, raptor_sequence* exprs_seq, raptor_sequence* vars_seq);
+int rasqal_aggregation_expressions_can_stream(raptor_sequence* exprs_seq);
 
 /* rasqal_rowsource_empty.c */
 rasqal_rowsource* rasqal_new_empty_rowsource(rasqal_world *world, rasqal_query* query);
@@ -661,7 +696,7 @@ rasqal_rowsource* rasqal_new_distinct_rowsource(rasqal_world *world, rasqal_quer
 rasqal_rowsource* rasqal_new_filter_rowsource(rasqal_world *world, rasqal_query *query, rasqal_rowsource* rs, rasqal_expression* expr);
 
 /* rasqal_rowsource_graph.c */
-rasqal_rowsource* rasqal_new_graph_rowsource(rasqal_world *world, rasqal_query *query, rasqal_rowsource* rowsource, rasqal_variable *var);
+rasqal_rowsource* rasqal_new_graph_rowsource(rasqal_world *world, rasqal_query *query, rasqal_rowsource* rowsource, rasqal_variable *var, int bind_from_data);
 
 /* rasqal_rowsource_groupby.c */
 rasqal_rowsource* rasqal_new_groupby_rowsource(rasqal_world *world, rasqal_query* query, rasqal_rowsource* rowsource, raptor_sequence* exprs_seq);
@@ -672,9 +707,24 @@ rasqal_rowsource* rasqal_new_having_rowsource(rasqal_world *world, rasqal_query
 /* rasqal_rowsource_join.c */
 rasqal_rowsource* rasqal_new_join_rowsource(rasqal_world *world, rasqal_query* query, rasqal_rowsource* left, rasqal_rowsource* right, rasqal_join_type join_type, rasqal_expression *expr);
 
+/* rasqal_rowsource_merge_join.c */
+rasqal_rowsource* rasqal_new_merge_join_rowsource(rasqal_world *world, rasqal_query* query, rasqal_rowsource* left, rasqal_rowsource* right, rasqal_variable* key, rasqal_expression *expr);
+
+/* rasqal_rowsource_minus.c */
+rasqal_rowsource* rasqal_new_minus_rowsource(rasqal_world *world, rasqal_query* query, rasqal_rowsource* left, rasqal_rowsource* right);
+
+/* rasqal_rowsource_exists.c */
+rasqal_rowsource* rasqal_new_exists_rowsource(rasqal_world *world, rasqal_query* query, rasqal_triples_source* triples_source, rasqal_rowsource* left, rasqal_rowsource* inner, rasqal_graph_pattern* gp, int negate);
+
+/* rasqal_rowsource_path.c */
+rasqal_rowsource* rasqal_new_path_rowsource(rasqal_world *world, rasqal_query* query, rasqal_triples_source* triples_source, raptor_sequence* triples, int column);
+
 /* rasqal_rowsource_project.c */
 rasqal_rowsource* rasqal_new_project_rowsource(rasqal_world *world, rasqal_query *query, rasqal_rowsource* rowsource, raptor_sequence* projection_variables);
 
+/* rasqal_rowsource_reduced.c */
+rasqal_rowsource* rasqal_new_reduced_rowsource(rasqal_world *world, rasqal_query *query, rasqal_rowsource* rowsource);
+
 /* rasqal_rowsource_rowsequence.c */
 rasqal_rowsource* rasqal_new_rowsequence_rowsource(rasqal_world *world, rasqal_query* query, rasqal_variables_table* vt, raptor_sequence* rows_seq, raptor_sequence* vars_seq);
 
@@ -736,6 +786,53 @@ typedef int (*rasqal_rowsource_ensure_variables_func) (rasqal_rowsource* rowsour
 typedef rasqal_row* (*rasqal_rowsource_read_row_func) (rasqal_rowsource* rowsource, void *user_data);
 
 
+/* default number of rows in a #rasqal_row_batch */
+#define RASQAL_ROW_BATCH_SIZE 1024
+
+/**
+ * rasqal_row_batch:
+ * @rowsource: rowsource the rows are from (not owned)
+ * @size: number of variables (columns)
+ * @capacity: maximum number of rows
+ * @count: number of rows held
+ * @columns: @size column arrays of @capacity values, stored one
+ *   column after another; see RASQAL_ROW_BATCH_VALUE()
+ * @offsets: row offsets
+ * @group_ids: row group IDs
+ *
+ * INTERNAL - A block of rows from a rowsource in a columnar layout
+ *
+ * Used by rasqal_rowsource_read_batch() to move many rows between
+ * rowsources with one call and without a #rasqal_row per row.
+ */
+typedef struct {
+  rasqal_rowsource* rowsource;
+  int size;
+  int capacity;
+  int count;
+  rasqal_literal** columns;
+  int* offsets;
+  int* group_ids;
+} rasqal_row_batch;
+
+/* value of variable at @column in row @row of @batch (may be NULL) */
+#define RASQAL_ROW_BATCH_VALUE(batch, column, row) \
+  ((batch)->columns[(column) * (batch)->capacity + (row)])
+
+/**
+ * rasqal_rowsource_read_batch_func
+ * @user_data: user data
+ * @batch: empty batch to add rows to
+ *
+ * Handler function for adding up to @batch capacity rows to @batch
+ *
+ * Variable values are not left bound to any row.
+ *
+ * Return value: number of rows added, 0 if exhausted or <0 on failure
+ */
+typedef int (*rasqal_rowsource_read_batch_func) (rasqal_rowsource* rowsource, void *user_data, rasqal_row_batch* batch);
+
+
 /**
  * rasqal_rowsource_read_all_rows_func
  * @user_data: user data
@@ -760,6 +857,8 @@ typedef int (*rasqal_rowsource_reset_func) (rasqal_rowsource* rowsource, void *u
 
 /* bit flags */
 #define RASQAL_ROWSOURCE_REQUIRE_RESET (1 << 0)
+/* reset and read again many times, for example once per outer row */
+#define RASQAL_ROWSOURCE_REQUIRE_REPEAT (1 << 1)
 
 /**
  * rasqal_rowsource_set_requirements_func
@@ -797,9 +896,34 @@ typedef rasqal_rowsource* (*rasqal_rowsource_get_inner_rowsource_func) (rasqal_r
 typedef int (*rasqal_rowsource_set_origin_func) (rasqal_rowsource* rowsource, void *user_data, rasqal_literal *origin);
 
 
+/**
+ * rasqal_rowsource_get_order_func
+ * @user_data: user data
+ *
+ * Handler function for getting the variable that rows are returned
+ * in ascending ORDER BY order of
+ *
+ * Return value: variable or NULL if the rows are in no known order
+ */
+typedef rasqal_variable* (*rasqal_rowsource_get_order_func) (rasqal_rowsource* rowsource, void *user_data);
+
+
+/**
+ * rasqal_rowsource_set_outer_variables_func
+ * @user_data: user data
+ * @variables: sequence of #rasqal_variable
+ *
+ * Handler function for setting the variables that an outer join
+ * binds to the values of the current outer row before reading
+ *
+ * Return value: 0 if the outer values will be used, non-0 otherwise
+ */
+typedef int (*rasqal_rowsource_set_outer_variables_func) (rasqal_rowsource* rowsource, void *user_data, raptor_sequence* variables);
+
+
 /**
  * rasqal_rowsource_handler:
- * @version: API version - 1
+ * @version: API version - 1 or 2 when any V2 method is given
  * @name: rowsource name for debugging
  * @init:  initialisation handler - optional, called at most once (V1)
  * @finish: finishing handler - optional, called at most once (V1)
@@ -810,8 +934,15 @@ typedef int (*rasqal_rowsource_set_origin_func) (rasqal_rowsource* rowsource, vo
  * @set_requirements: set requirements flag handler - optional (V1)
  * @get_inner_rowsource: get inner rowsource handler - optional if has no inner rowsources (V1)
  * @set_origin: set origin (GRAPH) handler - optional (V1)
+ * @read_batch: read batch of rows handler - optional (V2)
+ * @get_order: get sort order handler - optional (V2)
+ * @set_outer_variables: set outer join variables handler - optional (V2)
  *
  * Row Source implementation factory handler structure.
+ *
+ * The V2 methods are only used when @version is 2.  Handlers
+ * without @read_batch are read a row at a time by
+ * rasqal_rowsource_read_batch().
  * 
  */
 typedef struct {
@@ -827,6 +958,10 @@ typedef struct {
   rasqal_rowsource_set_requirements_func     set_requirements;
   rasqal_rowsource_get_inner_rowsource_func  get_inner_rowsource;
   rasqal_rowsource_set_origin_func           set_origin;
+  /* API V2 methods */
+  rasqal_rowsource_read_batch_func           read_batch;
+  rasqal_rowsource_get_order_func            get_order;
+  rasqal_rowsource_set_outer_variables_func  set_outer_variables;
 } rasqal_rowsource_handler;
 
 
@@ -857,16 +992,75 @@ typedef struct {
 typedef struct rasqal_results_compare_s rasqal_results_compare;
 
 
+typedef struct rasqal_row_store_s rasqal_row_store;
+
+
+/*
+ * rasqal_data_graph_triples:
+ *
+ * Triples of a #rasqal_data_graph held in memory.  Each triple owns
+ * references to its literals; origin is NULL for a triple in the
+ * data graph itself.
+ */
+struct rasqal_data_graph_triples_s {
+  rasqal_triple* triples;
+  int count;
+  /* allocated size of @triples */
+  int size;
+};
+
+
+/**
+ * rasqal_write_escape:
+ * @RASQAL_WRITE_ESCAPE_NONE: write bytes as-is
+ * @RASQAL_WRITE_ESCAPE_NTRIPLES: N-Triples string escapes with a '"' delimiter
+ * @RASQAL_WRITE_ESCAPE_NTRIPLES_BARE: N-Triples string escapes with no delimiter
+ * @RASQAL_WRITE_ESCAPE_CSV: CSV field quoting
+ * @RASQAL_WRITE_ESCAPE_XML_CDATA: XML 1.0 element content escapes
+ * @RASQAL_WRITE_ESCAPE_XML_ATTRIBUTE: XML 1.0 '"'-quoted attribute value escapes
+ * @RASQAL_WRITE_ESCAPE_LAST: internal
+ *
+ * Escaping applied by a #rasqal_write_buffer
+ */
+typedef enum {
+  RASQAL_WRITE_ESCAPE_NONE,
+  RASQAL_WRITE_ESCAPE_NTRIPLES,
+  RASQAL_WRITE_ESCAPE_NTRIPLES_BARE,
+  RASQAL_WRITE_ESCAPE_CSV,
+  RASQAL_WRITE_ESCAPE_XML_CDATA,
+  RASQAL_WRITE_ESCAPE_XML_ATTRIBUTE,
+  RASQAL_WRITE_ESCAPE_LAST = RASQAL_WRITE_ESCAPE_XML_ATTRIBUTE
+} rasqal_write_escape;
+
+typedef struct rasqal_write_buffer_s rasqal_write_buffer;
+
+/* default bytes a #rasqal_write_buffer collects before writing */
+#define RASQAL_WRITE_BUFFER_SIZE (64 * 1024)
+
+/* default bytes of rows a #rasqal_row_store holds in memory */
+#define RASQAL_ROW_STORE_MEMORY_LIMIT (8 * 1024 * 1024)
+
 /* 
  * Rowsource Internal flags
  *
  * RASQAL_ROWSOURCE_FLAGS_SAVE_ROWS: need to save all rows in
- * @rows_sequence for reset operation
+ * @row_store for reset operation
  *
  * RASQAL_ROWSOURCE_FLAGS_SAVED_ROWS: have saved rows ready for reply
+ *
+ * RASQAL_ROWSOURCE_FLAGS_CORRELATED: rows depend on values bound
+ * outside the rowsource so must be read again after a reset
  */
 #define RASQAL_ROWSOURCE_FLAGS_SAVE_ROWS  0x01
 #define RASQAL_ROWSOURCE_FLAGS_SAVED_ROWS 0x02
+#define RASQAL_ROWSOURCE_FLAGS_CORRELATED 0x04
+
+/*
+ * Smallest estimated cost, in rowsources, of a subtree that is
+ * uncorrelated and repeatedly reset for it to be materialized into a
+ * #rasqal_row_store rather than executed again.
+ */
+#define RASQAL_ROWSOURCE_MATERIALIZE_COST 2
 
 /**
  * rasqal_rowsource:
@@ -883,6 +1077,7 @@ typedef struct rasqal_results_compare_s rasqal_results_compare;
  * @size: number of variables in @variables_sequence
  * @rows_sequence: stored sequence of rows for use by rasqal_rowsource_read_row() (or NULL)
  * @offset: size of @rows_sequence
+ * @row_store: rows saved for replay after a reset (or NULL)
  * @generate_group: non-0 to generate a group (ID 0) around all the returned rows, if there is no grouping returned.
  * @usage: reference count
  *
@@ -916,6 +1111,10 @@ typedef struct rasqal_results_compare_s rasqal_results_compare;
  * The @rows_sequence and @offset variables are used by the
  * rasqal_rowsource_read_row() function when operating over a handler
  * that will only return a full sequence: handler->read_all_rows is NULL.
+ *
+ * The @row_store holds the rows saved by a rowsource that is replayed
+ * after a reset instead of being executed again; see
+ * rasqal_rowsource_set_requirements().
  */
 struct rasqal_rowsource_s
 {
@@ -945,6 +1144,8 @@ struct rasqal_rowsource_s
 
   int offset;
 
+  rasqal_row_store* row_store;
+
   unsigned int generate_group : 1;
 
   int usage;
@@ -959,6 +1160,8 @@ void rasqal_free_rowsource(rasqal_rowsource *rowsource);
 rasqal_row* rasqal_rowsource_read_row(rasqal_rowsource *rowsource);
 int rasqal_rowsource_get_rows_count(rasqal_rowsource *rowsource);
 raptor_sequence* rasqal_rowsource_read_all_rows(rasqal_rowsource *rowsource);
+int rasqal_rowsource_read_batch(rasqal_rowsource *rowsource, rasqal_row_batch* batch);
+int rasqal_rowsource_has_read_batch(rasqal_rowsource *rowsource);
 int rasqal_rowsource_get_size(rasqal_rowsource *rowsource);
 int rasqal_rowsource_add_variable(rasqal_rowsource *rowsource, rasqal_variable* v);
 rasqal_variable* rasqal_rowsource_get_variable_by_offset(rasqal_rowsource *rowsource, int offset);
@@ -968,11 +1171,14 @@ void rasqal_rowsource_print_row_sequence(rasqal_rowsource* rowsource,raptor_sequ
 int rasqal_rowsource_reset(rasqal_rowsource* rowsource);
 int rasqal_rowsource_set_requirements(rasqal_rowsource* rowsource, unsigned int requirement);
 rasqal_rowsource* rasqal_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource, int offset);
+rasqal_variable* rasqal_rowsource_get_order(rasqal_rowsource* rowsource);
+int rasqal_rowsource_set_outer_variables(rasqal_rowsource* rowsource, raptor_sequence* variables);
 int rasqal_rowsource_write(rasqal_rowsource *rowsource,  raptor_iostream *iostr);
 void rasqal_rowsource_print(rasqal_rowsource* rs, FILE* fh);
 int rasqal_rowsource_ensure_variables(rasqal_rowsource *rowsource);
 int rasqal_rowsource_set_origin(rasqal_rowsource* rowsource, rasqal_literal *literal);
 int rasqal_rowsource_request_grouping(rasqal_rowsource* rowsource);
+int rasqal_rowsource_set_correlated(rasqal_rowsource* rowsource);
 void rasqal_rowsource_remove_all_variables(rasqal_rowsource *rowsource);
 
 typedef struct rasqal_query_results_format_factory_s rasqal_query_results_format_factory;
@@ -1040,10 +1246,65 @@ struct rasqal_query_results_formatter_s {
 rasqal_rowsource* rasqal_query_results_formatter_get_read_rowsource(rasqal_world *world, raptor_iostream *iostr, rasqal_query_results_formatter* formatter, rasqal_variables_table* vars_table, raptor_uri *base_uri, unsigned int flags);
 
 
+/*
+ * rasqal_path_operator:
+ * @RASQAL_PATH_OPERATOR_LINK: a single predicate IRI
+ * @RASQAL_PATH_OPERATOR_INVERSE: ^path
+ * @RASQAL_PATH_OPERATOR_SEQUENCE: path1 / path2
+ * @RASQAL_PATH_OPERATOR_ALTERNATIVE: path1 | path2
+ * @RASQAL_PATH_OPERATOR_ZERO_OR_ONE: path?
+ * @RASQAL_PATH_OPERATOR_ZERO_OR_MORE: path*
+ * @RASQAL_PATH_OPERATOR_ONE_OR_MORE: path+
+ *
+ * INTERNAL - SPARQL 1.1 property path operators
+ */
+typedef enum {
+  RASQAL_PATH_OPERATOR_LINK,
+  RASQAL_PATH_OPERATOR_INVERSE,
+  RASQAL_PATH_OPERATOR_SEQUENCE,
+  RASQAL_PATH_OPERATOR_ALTERNATIVE,
+  RASQAL_PATH_OPERATOR_ZERO_OR_ONE,
+  RASQAL_PATH_OPERATOR_ZERO_OR_MORE,
+  RASQAL_PATH_OPERATOR_ONE_OR_MORE,
+
+  RASQAL_PATH_OPERATOR_LAST = RASQAL_PATH_OPERATOR_ONE_OR_MORE
+} rasqal_path_operator;
+
+
+/*
+ * Property path
+ *
+ * LINK paths have @iri; unary operators use @path1; SEQUENCE and
+ * ALTERNATIVE use @path1 and @path2.
+ */
+struct rasqal_path_s {
+  int usage;
+
+  rasqal_path_operator op;
+
+  rasqal_literal* iri;
+
+  struct rasqal_path_s* path1;
+  struct rasqal_path_s* path2;
+};
+typedef struct rasqal_path_s rasqal_path;
+
+/* rasqal_path.c */
+rasqal_path* rasqal_new_link_path(rasqal_literal* iri);
+rasqal_path* rasqal_new_path(rasqal_path_operator op, rasqal_path* path1, rasqal_path* path2);
+rasqal_path* rasqal_new_path_from_path(rasqal_path* path);
+void rasqal_free_path(rasqal_path* path);
+int rasqal_path_is_link(rasqal_path* path);
+int rasqal_path_write(rasqal_path* path, raptor_iostream* iostr);
+int rasqal_path_print(rasqal_path* path, FILE* fh);
+
+
 typedef struct {
   rasqal_world *world;
   raptor_sequence *triples;
   rasqal_literal *value;
+  /* property path of a Verb that is not a single IRI (or NULL) */
+  rasqal_path *path;
 } rasqal_formula;
 
 
@@ -1052,6 +1313,11 @@ int rasqal_xsd_datetime_check(const char* string);
 int rasqal_xsd_date_check(const char* string);
 
 
+/* rasqal_data_graph.c */
+int rasqal_data_graph_add_graph_names(rasqal_data_graph* dg, raptor_sequence* names);
+int rasqal_data_graph_has_graph_name(rasqal_data_graph* dg, raptor_uri* uri);
+
+
 /* rasqal_dataset.c */
 typedef struct rasqal_dataset_s rasqal_dataset;
 typedef struct rasqal_dataset_term_iterator_s rasqal_dataset_term_iterator;
@@ -1171,6 +1437,11 @@ int rasqal_graph_pattern_variable_bound_below(rasqal_graph_pattern *gp, rasqal_v
 int rasqal_double_approximately_compare(double a, double b);
 int rasqal_double_approximately_equal(double a, double b);
 
+/* rasqal_hash.c */
+uint64_t rasqal_hash_mix(uint64_t value);
+uint64_t rasqal_hash_combine(uint64_t hash, uint64_t value);
+uint64_t rasqal_hash_bytes(uint64_t hash, const unsigned char* data, size_t len);
+
 /* rasqal_expr.c */
 rasqal_literal* rasqal_new_string_literal_node(rasqal_world*, const unsigned char *string, const char *language, raptor_uri *datatype);
 int rasqal_literal_as_boolean(rasqal_literal* literal, int* error_p);
@@ -1178,6 +1449,7 @@ int rasqal_literal_as_integer(rasqal_literal* l, int* error_p);
 double rasqal_literal_as_double(rasqal_literal* l, int* error_p);
 raptor_uri* rasqal_literal_as_uri(rasqal_literal* l);
 int rasqal_literal_string_to_native(rasqal_literal *l, int flags);
+rasqal_literal_type rasqal_literal_get_datatype_type(rasqal_literal* l);
 int rasqal_literal_has_qname(rasqal_literal* l);
 int rasqal_literal_expand_qname(void* user_data, rasqal_literal* l);
 int rasqal_literal_is_constant(rasqal_literal* l);
@@ -1258,6 +1530,7 @@ time_t rasqal_timegm(struct tm *tm);
 
 /* rasqal_raptor.c */
 int rasqal_raptor_init(rasqal_world*);
+int rasqal_raptor_is_triples_source_factory(rasqal_triples_source_factory* factory);
 
 #ifdef RAPTOR_TRIPLES_SOURCE_REDLAND
 /* rasqal_redland.c */
@@ -1312,6 +1585,10 @@ int rasqal_literal_write_turtle(rasqal_literal* l, raptor_iostream* iostr);
 int rasqal_literal_array_equals(rasqal_literal** values_a, rasqal_literal** values_b, int size);
 int rasqal_literal_array_compare(rasqal_literal** values_a, rasqal_literal** values_b, raptor_sequence* exprs_seq, int size, int compare_flags);
 int rasqal_literal_array_compare_by_order(rasqal_literal** values_a, rasqal_literal** values_b, int* order, int size, int compare_flags);
+uint64_t rasqal_literal_hash_rdf_term(rasqal_literal* l);
+uint64_t rasqal_literal_hash_value(rasqal_literal* l);
+uint64_t rasqal_literal_hash_flags(rasqal_literal* l, int flags);
+unsigned char* rasqal_literal_array_to_order_key(rasqal_literal** values, raptor_sequence* exprs_seq, int size, int compare_flags, size_t* len_p, int* complete_p);
 rasqal_map* rasqal_new_literal_sequence_sort_map(int is_distinct, int compare_flags);
 int rasqal_literal_sequence_sort_map_add_literal_sequence(rasqal_map* map, raptor_sequence* literals_sequence);
 raptor_sequence* rasqal_new_literal_sequence_of_sequence_from_data(rasqal_world* world, const char* const row_data[], int width);
@@ -1347,6 +1624,12 @@ int rasqal_query_reset_select_query(rasqal_query* query);
 rasqal_projection* rasqal_query_get_projection(rasqal_query* query);
 int rasqal_query_set_projection(rasqal_query* query, rasqal_projection* projection);
 int rasqal_query_set_modifier(rasqal_query* query, rasqal_solution_modifier* modifier);
+void rasqal_query_reset_algebra(rasqal_query* query);
+void rasqal_query_reset_variable_values(rasqal_query* query);
+
+/* rasqal_query_cache.c */
+#define RASQAL_QUERY_CACHE_DEFAULT_SIZE 64
+void rasqal_world_query_cache_finish(rasqal_world* world);
 
 /* rasqal_query_results.c */
 int rasqal_init_query_results(void);
@@ -1362,6 +1645,7 @@ rasqal_world* rasqal_query_results_get_world(rasqal_query_results* query_results
 typedef int (*raptor_data_compare_arg_handler)(const void *data1, const void *data2, void *user_data);
 #endif
 int rasqal_query_results_sort(rasqal_query_results* query_result);
+int rasqal_query_results_ensure_stored(rasqal_query_results* query_results);
 int rasqal_query_results_set_boolean(rasqal_query_results* query_results, int value);
 
 /* rasqal_query_write.c */
@@ -1410,11 +1694,34 @@ raptor_sequence* rasqal_row_sequence_copy(raptor_sequence *seq);
 void rasqal_row_set_rowsource(rasqal_row* row, rasqal_rowsource* rowsource);
 void rasqal_row_set_weak_rowsource(rasqal_row* row, rasqal_rowsource* rowsource);
 rasqal_variable* rasqal_row_get_variable_by_offset(rasqal_row* row, int offset);
+uint64_t rasqal_row_hash(rasqal_row* row, int flags);
+uint64_t rasqal_row_hash_by_offsets(rasqal_row* row, const int* offsets, int count, int flags);
+
+/* rasqal_row_batch.c */
+rasqal_row_batch* rasqal_new_row_batch(rasqal_rowsource* rowsource, int capacity);
+void rasqal_free_row_batch(rasqal_row_batch* batch);
+void rasqal_row_batch_clear(rasqal_row_batch* batch);
+int rasqal_row_batch_add_row(rasqal_row_batch* batch, rasqal_row* row);
+int rasqal_row_batch_new_row(rasqal_row_batch* batch);
+void rasqal_row_batch_merge_values(rasqal_row_batch* batch, int index, rasqal_row_batch* src, int src_index, int* map);
+rasqal_row* rasqal_row_batch_get_row(rasqal_row_batch* batch, int index);
+int rasqal_row_batch_bind_row(rasqal_row_batch* batch, int index);
+void rasqal_row_batch_remove_rows(rasqal_row_batch* batch, const char* keep);
+
+/* rasqal_row_store.c */
+rasqal_row_store* rasqal_new_row_store(rasqal_world* world, size_t memory_limit);
+void rasqal_free_row_store(rasqal_row_store* store);
+int rasqal_row_store_add_row(rasqal_row_store* store, rasqal_row* row);
+int rasqal_row_store_rewind(rasqal_row_store* store);
+rasqal_row* rasqal_row_store_read_row(rasqal_row_store* store, rasqal_rowsource* rowsource);
+int rasqal_row_store_get_count(rasqal_row_store* store);
+int rasqal_row_store_is_spilled(rasqal_row_store* store);
 
 /* rasqal_row_compatible.c */
 rasqal_row_compatible* rasqal_new_row_compatible(rasqal_variables_table* vt, rasqal_rowsource *first_rowsource, rasqal_rowsource *second_rowsource);
 void rasqal_free_row_compatible(rasqal_row_compatible* map);
 int rasqal_row_compatible_check(rasqal_row_compatible* map, rasqal_row *first_row, rasqal_row *second_row);
+int rasqal_row_compatible_check_batch(rasqal_row_compatible* map, rasqal_row_batch* first_batch, int first_index, rasqal_row_batch* second_batch, int second_index);
 void rasqal_print_row_compatible(FILE *handle, rasqal_row_compatible* map);
 
 /* rasqal_triples_source.c */
@@ -1499,11 +1806,17 @@ struct rasqal_world_s {
   struct timeval now;
   /* set when now is a cached value */
   unsigned int now_set : 1;
+  /* query results execution that @now belongs to (or NULL) */
+  rasqal_query_results* now_results;
 
   rasqal_warning_level warning_level;
 
-  /* generated counter - increments at every generation */
-  int genid_counter;
+  /* cache of prepared queries: sequence of entries in least to most
+   * recently used order (or NULL) */
+  raptor_sequence* query_cache;
+
+  /* maximum number of entries in @query_cache */
+  int query_cache_size;
 };
 
 
@@ -1534,8 +1847,9 @@ typedef enum {
   RASQAL_ALGEBRA_OPERATOR_HAVING   = 17,
   RASQAL_ALGEBRA_OPERATOR_VALUES   = 18,
   RASQAL_ALGEBRA_OPERATOR_SERVICE  = 19,
+  RASQAL_ALGEBRA_OPERATOR_PATH     = 20,
 
-  RASQAL_ALGEBRA_OPERATOR_LAST = RASQAL_ALGEBRA_OPERATOR_SERVICE
+  RASQAL_ALGEBRA_OPERATOR_LAST = RASQAL_ALGEBRA_OPERATOR_PATH
 } rasqal_algebra_node_operator;
 
 
@@ -1557,12 +1871,15 @@ struct rasqal_algebra_node_s {
   /* operator for this algebra_node's contents */
   rasqal_algebra_node_operator op;
 
-  /* type BGP (otherwise NULL and start_column and end_column are -1) */
+  /* types BGP, PATH (otherwise NULL and start_column and end_column are -1)
+   * type PATH: the one property path triple at start_column = end_column
+   */
   raptor_sequence* triples;
   int start_column;
   int end_column;
   
   /* types JOIN, DIFF, LEFTJOIN, UNION, ORDERBY: node1 and node2 ALWAYS present
+   * (DIFF is the SPARQL 1.1 MINUS of node1 and node2)
    * types FILTER, TOLIST: node1 ALWAYS present, node2 ALWAYS NULL
    * type PROJECT, GRAPH, GROUPBY, AGGREGATION, HAVING: node1 always present
    * (otherwise NULL)
@@ -1666,9 +1983,11 @@ typedef struct
 
 rasqal_algebra_node* rasqal_new_assignment_algebra_node(rasqal_query* query, rasqal_variable *var, rasqal_expression *expr);
 rasqal_algebra_node* rasqal_new_distinct_algebra_node(rasqal_query* query, rasqal_algebra_node* node1);
+rasqal_algebra_node* rasqal_new_reduced_algebra_node(rasqal_query* query, rasqal_algebra_node* node1);
 rasqal_algebra_node* rasqal_new_filter_algebra_node(rasqal_query* query, rasqal_expression* expr, rasqal_algebra_node* node);
 rasqal_algebra_node* rasqal_new_empty_algebra_node(rasqal_query* query);
 rasqal_algebra_node* rasqal_new_triples_algebra_node(rasqal_query* query, raptor_sequence* triples, int start_column, int end_column);
+rasqal_algebra_node* rasqal_new_path_algebra_node(rasqal_query* query, raptor_sequence* triples, int column);
 rasqal_algebra_node* rasqal_new_2op_algebra_node(rasqal_query* query, rasqal_algebra_node_operator op, rasqal_algebra_node* node1, rasqal_algebra_node* node2);
 rasqal_algebra_node* rasqal_new_leftjoin_algebra_node(rasqal_query* query, rasqal_algebra_node* node1, rasqal_algebra_node* node2, rasqal_expression* expr);
 rasqal_algebra_node* rasqal_new_join_algebra_node(rasqal_query* query, rasqal_algebra_node* node1, rasqal_algebra_node* node2, rasqal_expression* expr);
@@ -1690,6 +2009,7 @@ int rasqal_algebra_algebra_node_write(rasqal_algebra_node *node, raptor_iostream
 int rasqal_algebra_node_print(rasqal_algebra_node* node, FILE* fh);
 int rasqal_algebra_node_visit(rasqal_query *query, rasqal_algebra_node* node, rasqal_algebra_node_visit_fn fn, void *user_data);
 rasqal_algebra_node* rasqal_algebra_query_to_algebra(rasqal_query* query);
+rasqal_algebra_node* rasqal_algebra_exists_graph_pattern_to_algebra(rasqal_query* query, rasqal_graph_pattern* gp);
 rasqal_algebra_node* rasqal_algebra_query_add_group_by(rasqal_query* query, rasqal_algebra_node* node, rasqal_solution_modifier* modifier);
 rasqal_algebra_node* rasqal_algebra_query_add_orderby(rasqal_query* query, rasqal_algebra_node* node, rasqal_projection* projection, rasqal_solution_modifier* modifier);
 rasqal_algebra_node* rasqal_algebra_query_add_slice(rasqal_query* query, rasqal_algebra_node* node, rasqal_solution_modifier* modifier);
@@ -1699,6 +2019,7 @@ rasqal_algebra_node* rasqal_algebra_query_add_construct_projection(rasqal_query*
 rasqal_algebra_node* rasqal_algebra_query_add_distinct(rasqal_query* query, rasqal_algebra_node* node, rasqal_projection* projection);
 rasqal_algebra_node* rasqal_algebra_query_add_having(rasqal_query* query, rasqal_algebra_node* node, rasqal_solution_modifier* modifier);
 int rasqal_algebra_node_is_empty(rasqal_algebra_node* node);
+int rasqal_algebra_node_is_correlated(rasqal_algebra_node* root, rasqal_algebra_node* node);
 
 rasqal_algebra_aggregate* rasqal_algebra_query_prepare_aggregates(rasqal_query* query, rasqal_algebra_node* node, rasqal_projection* projection, rasqal_solution_modifier* modifier);
 void rasqal_free_algebra_aggregate(rasqal_algebra_aggregate* ae);
@@ -1800,7 +2121,8 @@ const char* rasqal_engine_error_as_string(rasqal_engine_error error);
 rasqal_map* rasqal_engine_new_rowsort_map(int is_distinct, int compare_flags, raptor_sequence* order_conditions_sequence);
 int rasqal_engine_rowsort_map_add_row(rasqal_map* map, rasqal_row* row);
 raptor_sequence* rasqal_engine_rowsort_map_to_sequence(rasqal_map* map, raptor_sequence* seq);
-int rasqal_engine_rowsort_calculate_order_values(rasqal_query* query, raptor_sequence* order_seq, rasqal_row* row);
+raptor_sequence* rasqal_engine_rowsort_sort_sequence(raptor_sequence* seq, int compare_flags, raptor_sequence* order_conditions_sequence);
+int rasqal_engine_rowsort_calculate_order_values(rasqal_query* query, raptor_sequence* order_seq, rasqal_row* row, int is_distinct);
 
 
 /* rasqal_engine_algebra.c */
@@ -1810,6 +2132,15 @@ extern const rasqal_query_execution_factory rasqal_query_engine_algebra;
 
 /* rasqal_iostream.c */
 raptor_iostream* rasqal_new_iostream_from_stringbuffer(raptor_world *raptor_world_ptr, raptor_stringbuffer* sb);
+rasqal_write_buffer* rasqal_new_write_buffer(raptor_world* raptor_world_ptr, raptor_iostream* iostr, size_t size);
+void rasqal_free_write_buffer(rasqal_write_buffer* wb);
+int rasqal_write_buffer_flush(rasqal_write_buffer* wb);
+int rasqal_write_buffer_write_bytes(rasqal_write_buffer* wb, const void* data, size_t len);
+int rasqal_write_buffer_write_byte(rasqal_write_buffer* wb, const int byte);
+int rasqal_write_buffer_write_string(rasqal_write_buffer* wb, const void* string);
+int rasqal_write_buffer_write_escaped(rasqal_write_buffer* wb, const unsigned char* string, size_t len, rasqal_write_escape escape);
+int rasqal_write_buffer_write_uri(rasqal_write_buffer* wb, raptor_uri* uri, rasqal_write_escape escape);
+raptor_iostream* rasqal_write_buffer_get_iostream(rasqal_write_buffer* wb);
 
 /* rasqal_service.c */
 rasqal_rowsource* rasqal_service_execute_as_rowsource(rasqal_service* svc, rasqal_variables_table* vars_table);
@@ -1851,6 +2182,8 @@ rasqal_results_compare* rasqal_new_results_compare(rasqal_world* world, rasqal_q
 void rasqal_free_results_compare(rasqal_results_compare* rrc);
 void rasqal_results_compare_set_log_handler(rasqal_results_compare* rrc, void* log_user_data, raptor_log_handler log_handler);
 int rasqal_results_compare_compare(rasqal_results_compare* rrc);
+void rasqal_results_compare_set_unordered(rasqal_results_compare* rrc, int unordered);
+void rasqal_results_compare_set_max_differences(rasqal_results_compare* rrc, int max_differences);
 rasqal_variable* rasqal_results_compare_get_variable_by_offset(rasqal_results_compare* rrc, int idx);
 int rasqal_results_compare_get_variable_offset_for_result(rasqal_results_compare* rrc, int var_idx, int qr_index);
 int rasqal_results_compare_variables_equal(rasqal_results_compare* rrc);
@@ -1904,9 +2237,7 @@ int rasqal_random_irand(rasqal_random *random_object);
 double rasqal_random_drand(rasqal_random *random_object);
 
 /* rasqal_sort.c */
-#if RAPTOR_VERSION < 20015
 void** rasqal_sequence_as_sorted(raptor_sequence* seq,  raptor_data_compare_arg_handler compare, void* user_data);
-#endif
 int* rasqal_variables_table_get_order(rasqal_variables_table* vt);
 
 /*
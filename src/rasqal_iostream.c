@@ -160,3 +160,494 @@ rasqal_new_iostream_from_stringbuffer(raptor_world *raptor_world_ptr,
 
   return raptor_new_iostream_from_handler(raptor_world_ptr, con, handler);
 }
+
+
+
+/* number of entries in the escaped URI cache; a power of 2 */
+#define RASQAL_WRITE_BUFFER_URI_CACHE_SIZE 256
+
+typedef struct {
+  /* URI reference held while it is cached */
+  raptor_uri* uri;
+
+  rasqal_write_escape escape;
+
+  /* escaped form of @uri allocated by rasqal_alloc_memory() */
+  unsigned char* string;
+  size_t length;
+} rasqal_write_buffer_uri_entry;
+
+
+/*
+ * rasqal_write_buffer:
+ *
+ * INTERNAL - Collects many small writes into a large local buffer
+ * and passes it to the iostream in single writes.
+ */
+struct rasqal_write_buffer_s {
+  raptor_world* raptor_world_ptr;
+
+  /* iostream to write to (shared) */
+  raptor_iostream* iostr;
+
+  unsigned char* buffer;
+  size_t size;
+  size_t length;
+
+  /* non-0 once a write to @iostr failed */
+  int failed;
+
+  /* direct-mapped cache of escaped URIs indexed by URI pointer;
+   * allocated on first use
+   */
+  rasqal_write_buffer_uri_entry* uri_cache;
+};
+
+
+/*
+ * rasqal_new_write_buffer:
+ * @raptor_world_ptr: raptor world
+ * @iostr: iostream to write to
+ * @size: buffer size in bytes or 0 for %RASQAL_WRITE_BUFFER_SIZE
+ *
+ * INTERNAL - Create a new write buffer in front of an iostream
+ *
+ * The iostream @iostr is shared and must outlive the buffer.
+ *
+ * Return value: new buffer or NULL on failure
+ */
+rasqal_write_buffer*
+rasqal_new_write_buffer(raptor_world* raptor_world_ptr,
+                        raptor_iostream* iostr, size_t size)
+{
+  rasqal_write_buffer* wb;
+
+  if(!iostr)
+    return NULL;
+
+  if(!size)
+    size = RASQAL_WRITE_BUFFER_SIZE;
+
+  wb = RASQAL_CALLOC(rasqal_write_buffer*, 1, sizeof(*wb));
+  if(!wb)
+    return NULL;
+
+  wb->buffer = RASQAL_MALLOC(unsigned char*, size);
+  if(!wb->buffer) {
+    RASQAL_FREE(rasqal_write_buffer, wb);
+    return NULL;
+  }
+
+  wb->raptor_world_ptr = raptor_world_ptr;
+  wb->iostr = iostr;
+  wb->size = size;
+
+  return wb;
+}
+
+
+/*
+ * rasqal_free_write_buffer:
+ * @wb: write buffer
+ *
+ * INTERNAL - Flush and destroy a write buffer
+ *
+ * Call rasqal_write_buffer_flush() first to see if the final write failed.
+ */
+void
+rasqal_free_write_buffer(rasqal_write_buffer* wb)
+{
+  int i;
+
+  if(!wb)
+    return;
+
+  rasqal_write_buffer_flush(wb);
+
+  if(wb->uri_cache) {
+    for(i = 0; i < RASQAL_WRITE_BUFFER_URI_CACHE_SIZE; i++) {
+      rasqal_write_buffer_uri_entry* entry = &wb->uri_cache[i];
+
+      if(entry->uri)
+        raptor_free_uri(entry->uri);
+      if(entry->string)
+        rasqal_free_memory(entry->string);
+    }
+    RASQAL_FREE(rasqal_write_buffer_uri_entry*, wb->uri_cache);
+  }
+
+  RASQAL_FREE(unsigned char*, wb->buffer);
+  RASQAL_FREE(rasqal_write_buffer, wb);
+}
+
+
+/*
+ * rasqal_write_buffer_flush:
+ * @wb: write buffer
+ *
+ * INTERNAL - Write any buffered bytes to the iostream
+ *
+ * Return value: non-0 if this or any earlier write failed
+ */
+int
+rasqal_write_buffer_flush(rasqal_write_buffer* wb)
+{
+  if(wb->length) {
+    if(!wb->failed &&
+       raptor_iostream_counted_string_write(wb->buffer, wb->length, wb->iostr))
+      wb->failed = 1;
+    wb->length = 0;
+  }
+
+  return wb->failed;
+}
+
+
+/*
+ * rasqal_write_buffer_get_iostream:
+ * @wb: write buffer
+ *
+ * INTERNAL - Flush a write buffer and get the iostream behind it
+ *
+ * For writes that must go through a raptor iostream function.
+ *
+ * Return value: iostream
+ */
+raptor_iostream*
+rasqal_write_buffer_get_iostream(rasqal_write_buffer* wb)
+{
+  rasqal_write_buffer_flush(wb);
+
+  return wb->iostr;
+}
+
+
+/*
+ * rasqal_write_buffer_write_bytes:
+ * @wb: write buffer
+ * @data: bytes
+ * @len: length of @data
+ *
+ * INTERNAL - Write bytes to a write buffer
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_write_buffer_write_bytes(rasqal_write_buffer* wb,
+                                const void* data, size_t len)
+{
+  if(wb->length + len > wb->size) {
+    if(rasqal_write_buffer_flush(wb))
+      return 1;
+
+    /* too large to be worth buffering */
+    if(len >= wb->size) {
+      if(raptor_iostream_counted_string_write(data, len, wb->iostr))
+        wb->failed = 1;
+      return wb->failed;
+    }
+  }
+
+  memcpy(wb->buffer + wb->length, data, len);
+  wb->length += len;
+
+  return 0;
+}
+
+
+/*
+ * rasqal_write_buffer_write_byte:
+ * @wb: write buffer
+ * @byte: byte
+ *
+ * INTERNAL - Write a byte to a write buffer
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_write_buffer_write_byte(rasqal_write_buffer* wb, const int byte)
+{
+  if(wb->length == wb->size && rasqal_write_buffer_flush(wb))
+    return 1;
+
+  wb->buffer[wb->length++] = RASQAL_GOOD_CAST(unsigned char, byte);
+
+  return 0;
+}
+
+
+/*
+ * rasqal_write_buffer_write_string:
+ * @wb: write buffer
+ * @string: NUL terminated string
+ *
+ * INTERNAL - Write a string to a write buffer
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_write_buffer_write_string(rasqal_write_buffer* wb, const void* string)
+{
+  return rasqal_write_buffer_write_bytes(wb, string,
+                                         strlen(RASQAL_GOOD_CAST(const char*, string)));
+}
+
+
+/*
+ * rasqal_write_buffer_is_plain:
+ * @string: string
+ * @len: length of @string
+ * @escape: escaping
+ *
+ * INTERNAL - Check if a string is written unchanged by an escaping
+ *
+ * Only printable ASCII can be plain; anything else is left to the
+ * slower escaping code.
+ *
+ * Return value: non-0 if @string needs no escapes
+ */
+static int
+rasqal_write_buffer_is_plain(const unsigned char* string, size_t len,
+                             rasqal_write_escape escape)
+{
+  size_t i;
+
+  if(escape == RASQAL_WRITE_ESCAPE_NONE)
+    return 1;
+
+  for(i = 0; i < len; i++) {
+    const unsigned char c = string[i];
+
+    if(c < 0x20 || c >= 0x7f)
+      return 0;
+
+    switch(escape) {
+      case RASQAL_WRITE_ESCAPE_NTRIPLES:
+        if(c == '\\' || c == '"')
+          return 0;
+        break;
+
+      case RASQAL_WRITE_ESCAPE_NTRIPLES_BARE:
+        if(c == '\\')
+          return 0;
+        break;
+
+      case RASQAL_WRITE_ESCAPE_CSV:
+        if(c == '"' || c == ',')
+          return 0;
+        break;
+
+      case RASQAL_WRITE_ESCAPE_XML_ATTRIBUTE:
+        if(c == '"')
+          return 0;
+        /* FALLTHROUGH */
+      case RASQAL_WRITE_ESCAPE_XML_CDATA:
+        if(c == '&' || c == '<' || c == '>')
+          return 0;
+        break;
+
+      case RASQAL_WRITE_ESCAPE_NONE:
+      default:
+        break;
+    }
+  }
+
+  return 1;
+}
+
+
+/* Write a CSV field, double-quoted only if it contains a double
+ * quote, comma, linefeed or return
+ */
+static int
+rasqal_write_buffer_write_csv(rasqal_write_buffer* wb,
+                              const unsigned char* string, size_t len)
+{
+  const unsigned char delim = '\x22';
+  size_t i;
+
+  for(i = 0; i < len; i++) {
+    const unsigned char c = string[i];
+    if(c == delim || c == ',' || c == '\r' || c == '\n')
+      break;
+  }
+  if(i == len)
+    return rasqal_write_buffer_write_bytes(wb, string, len);
+
+  rasqal_write_buffer_write_byte(wb, delim);
+  for(i = 0; i < len; i++) {
+    if(string[i] == delim)
+      rasqal_write_buffer_write_byte(wb, delim);
+    rasqal_write_buffer_write_byte(wb, string[i]);
+  }
+
+  return rasqal_write_buffer_write_byte(wb, delim);
+}
+
+
+/*
+ * rasqal_write_buffer_write_escaped:
+ * @wb: write buffer
+ * @string: UTF-8 string
+ * @len: length of @string
+ * @escape: escaping to apply
+ *
+ * INTERNAL - Write a string to a write buffer with escapes
+ *
+ * Plain ASCII strings are copied into the buffer.  Other N-Triples
+ * and XML strings are escaped by raptor after flushing the buffer so
+ * the output is identical to writing them with raptor directly.  As
+ * with raptor, invalid UTF-8 does not fail the write.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_write_buffer_write_escaped(rasqal_write_buffer* wb,
+                                  const unsigned char* string, size_t len,
+                                  rasqal_write_escape escape)
+{
+  if(!len)
+    return 0;
+
+  if(rasqal_write_buffer_is_plain(string, len, escape))
+    return rasqal_write_buffer_write_bytes(wb, string, len);
+
+  if(escape == RASQAL_WRITE_ESCAPE_CSV)
+    return rasqal_write_buffer_write_csv(wb, string, len);
+
+  if(rasqal_write_buffer_flush(wb))
+    return 1;
+
+  switch(escape) {
+    case RASQAL_WRITE_ESCAPE_NTRIPLES:
+      raptor_string_ntriples_write(string, len, '"', wb->iostr);
+      break;
+
+    case RASQAL_WRITE_ESCAPE_NTRIPLES_BARE:
+      raptor_string_ntriples_write(string, len, '\0', wb->iostr);
+      break;
+
+    case RASQAL_WRITE_ESCAPE_XML_CDATA:
+      raptor_xml_escape_string_write(string, len, '\0', wb->iostr);
+      break;
+
+    case RASQAL_WRITE_ESCAPE_XML_ATTRIBUTE:
+      raptor_xml_escape_string_write(string, len, '"', wb->iostr);
+      break;
+
+    case RASQAL_WRITE_ESCAPE_CSV:
+    case RASQAL_WRITE_ESCAPE_NONE:
+    default:
+      break;
+  }
+
+  return 0;
+}
+
+
+/* Set cache @entry to the escaped form of @uri.  Returns non-0 on failure */
+static int
+rasqal_write_buffer_cache_uri(rasqal_write_buffer* wb,
+                              rasqal_write_buffer_uri_entry* entry,
+                              raptor_uri* uri, rasqal_write_escape escape)
+{
+  const unsigned char* str;
+  size_t len;
+  void* escaped = NULL;
+  size_t escaped_len = 0;
+
+  str = raptor_uri_as_counted_string(uri, &len);
+
+  if(rasqal_write_buffer_is_plain(str, len, escape)) {
+    escaped = rasqal_alloc_memory(len + 1);
+    if(!escaped)
+      return 1;
+    memcpy(escaped, str, len + 1);
+    escaped_len = len;
+  } else {
+    raptor_iostream* string_iostr;
+    rasqal_write_buffer* string_wb;
+
+    string_iostr = raptor_new_iostream_to_string(wb->raptor_world_ptr,
+                                                 &escaped, &escaped_len,
+                                                 rasqal_alloc_memory);
+    if(!string_iostr)
+      return 1;
+
+    string_wb = rasqal_new_write_buffer(wb->raptor_world_ptr, string_iostr,
+                                        len + 1);
+    if(string_wb) {
+      rasqal_write_buffer_write_escaped(string_wb, str, len, escape);
+      rasqal_free_write_buffer(string_wb);
+    }
+    /* sets escaped */
+    raptor_free_iostream(string_iostr);
+
+    if(!string_wb || !escaped) {
+      if(escaped)
+        rasqal_free_memory(escaped);
+      return 1;
+    }
+  }
+
+  if(entry->uri)
+    raptor_free_uri(entry->uri);
+  if(entry->string)
+    rasqal_free_memory(entry->string);
+
+  entry->uri = raptor_uri_copy(uri);
+  entry->escape = escape;
+  entry->string = RASQAL_GOOD_CAST(unsigned char*, escaped);
+  entry->length = escaped_len;
+
+  return 0;
+}
+
+
+/*
+ * rasqal_write_buffer_write_uri:
+ * @wb: write buffer
+ * @uri: URI
+ * @escape: escaping to apply
+ *
+ * INTERNAL - Write a URI string to a write buffer with escapes
+ *
+ * The escaped form is cached by URI pointer so a URI repeated across
+ * rows is escaped once and then copied.  Raptor shares one object per
+ * URI string so repeats are the same pointer; a reference is held to
+ * each cached URI so its pointer is not reused.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_write_buffer_write_uri(rasqal_write_buffer* wb, raptor_uri* uri,
+                              rasqal_write_escape escape)
+{
+  rasqal_write_buffer_uri_entry* entry;
+  uint64_t hash;
+  const unsigned char* str;
+  size_t len;
+
+  if(!wb->uri_cache) {
+    wb->uri_cache = RASQAL_CALLOC(rasqal_write_buffer_uri_entry*,
+                                  RASQAL_WRITE_BUFFER_URI_CACHE_SIZE,
+                                  sizeof(*wb->uri_cache));
+    if(!wb->uri_cache)
+      goto uncached;
+  }
+
+  hash = rasqal_hash_combine(rasqal_hash_mix(RASQAL_GOOD_CAST(uint64_t, RASQAL_GOOD_CAST(size_t, uri))),
+                             RASQAL_GOOD_CAST(uint64_t, escape));
+  entry = &wb->uri_cache[hash & (RASQAL_WRITE_BUFFER_URI_CACHE_SIZE - 1)];
+
+  if(entry->uri != uri || entry->escape != escape) {
+    if(rasqal_write_buffer_cache_uri(wb, entry, uri, escape))
+      goto uncached;
+  }
+
+  return rasqal_write_buffer_write_bytes(wb, entry->string, entry->length);
+
+  uncached:
+  str = raptor_uri_as_counted_string(uri, &len);
+  return rasqal_write_buffer_write_escaped(wb, str, len, escape);
+}
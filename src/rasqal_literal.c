@@ -47,7 +47,7 @@
 #include <stddef.h>
 #endif
 #include <stdarg.h>
-/* for isnan() */
+/* for isnan() and isinf() */
 #ifdef HAVE_MATH_H
 #include <math.h>
 #endif
@@ -75,6 +75,33 @@ static rasqal_literal_type rasqal_literal_promote_numerics(rasqal_literal* l1, r
 static int rasqal_literal_set_typed_value(rasqal_literal* l, rasqal_literal_type type, const unsigned char* string, int canonicalize);
 
 
+/*
+ * rasqal_literal_private:
+ * @literal: public literal fields; must be first
+ * @hash_cached: RASQAL_LITERAL_HASH_CACHED_ bits of the hashes below
+ * @hash_rdf_term: cached rasqal_literal_hash_rdf_term() value
+ * @hash_value: cached rasqal_literal_hash_value() value
+ * @datatype_type: @datatype resolved to a type code or
+ *   RASQAL_LITERAL_UNKNOWN if not resolved yet
+ *
+ * INTERNAL - Literal with fields private to the library
+ *
+ * Every literal is allocated with this size so that these fields are
+ * not part of the public #rasqal_literal structure and its ABI.
+ */
+typedef struct {
+  rasqal_literal literal;
+
+  unsigned int hash_cached;
+  uint64_t hash_rdf_term;
+  uint64_t hash_value;
+
+  rasqal_literal_type datatype_type;
+} rasqal_literal_private;
+
+#define RASQAL_LITERAL_PRIVATE(l) ((rasqal_literal_private*)(l))
+
+
 const unsigned char* rasqal_xsd_boolean_true = (const unsigned char*)"true";
 const unsigned char* rasqal_xsd_boolean_false = (const unsigned char*)"false";
 
@@ -101,7 +128,7 @@ rasqal_new_integer_literal(rasqal_world* world, rasqal_literal_type type,
 
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(world, rasqal_world, NULL);
 
-  l  = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(*l));
+  l  = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(rasqal_literal_private));
   if(l) {
     l->valid = 1;
     l->usage = 1;
@@ -197,7 +224,7 @@ rasqal_new_typed_literal(rasqal_world* world, rasqal_literal_type type,
 
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(world, rasqal_world, NULL);
 
-  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(*l));
+  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(rasqal_literal_private));
   if(!l)
     return NULL;
 
@@ -242,7 +269,7 @@ rasqal_new_floating_literal(rasqal_world *world,
   if(type != RASQAL_LITERAL_FLOAT && type != RASQAL_LITERAL_DOUBLE)
     return NULL;
 
-  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(*l));
+  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(rasqal_literal_private));
   if(l) {
     size_t slen = 0;
     l->valid = 1;
@@ -322,7 +349,7 @@ rasqal_new_uri_literal(rasqal_world* world, raptor_uri *uri)
 
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(world, rasqal_world, NULL);
 
-  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(*l));
+  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(rasqal_literal_private));
   if(l) {
     l->valid = 1;
     l->usage = 1;
@@ -361,7 +388,7 @@ rasqal_new_pattern_literal(rasqal_world* world,
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(world, rasqal_world, NULL);
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(pattern, char*, NULL);
 
-  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(*l));
+  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(rasqal_literal_private));
   if(l) {
     l->valid = 1;
     l->usage = 1;
@@ -419,7 +446,7 @@ rasqal_new_decimal_literal_from_decimal(rasqal_world* world,
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(world, rasqal_world, NULL);
   /* string and decimal NULLness are checked below */
 
-  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(*l));
+  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(rasqal_literal_private));
   if(!l)
     return NULL;
   
@@ -539,7 +566,7 @@ rasqal_new_datetime_literal_from_datetime(rasqal_world* world,
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(world, rasqal_world, NULL);
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(dt, rasqal_xsd_datetime, NULL);
 
-  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(*l));
+  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(rasqal_literal_private));
   if(!l)
     goto failed;
   
@@ -598,6 +625,10 @@ rasqal_literal_set_typed_value(rasqal_literal* l, rasqal_literal_type type,
 
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(l, rasqal_literal, 1);
 
+  /* the type or lexical form may change so forget any cached hashes */
+  if(l->type != type || string || canonicalize)
+    RASQAL_LITERAL_PRIVATE(l)->hash_cached = 0;
+
 retype:
   l->valid = rasqal_xsd_datatype_check(type, string ? string : l->string,
                                        0 /* no flags set */);
@@ -632,6 +663,7 @@ retype:
     if(l->datatype)
       raptor_free_uri(l->datatype);
     l->datatype = raptor_uri_copy(dt_uri);
+    RASQAL_LITERAL_PRIVATE(l)->datatype_type = l->type;
 
     l->parent_type = rasqal_xsd_datatype_parent_type(type);
   }
@@ -825,7 +857,7 @@ rasqal_literal_string_to_native(rasqal_literal *l, int flags)
   if(!l->datatype)
     return 0;
   
-  native_type = rasqal_xsd_datatype_uri_to_type(l->world, l->datatype);
+  native_type = rasqal_literal_get_datatype_type(l);
   /* plain literal - nothing to do */
   if(native_type == RASQAL_LITERAL_STRING)
     return 0;
@@ -837,7 +869,7 @@ rasqal_literal_string_to_native(rasqal_literal *l, int flags)
   }
 
   /* If a user defined type - update the literal */
-  if(native_type == RASQAL_LITERAL_UNKNOWN) {
+  if(native_type == RASQAL_LITERAL_UDT) {
     l->type = RASQAL_LITERAL_UDT;
     return 0;
   }
@@ -891,7 +923,7 @@ rasqal_new_string_literal_common(rasqal_world* world,
   int native_type_promotion = (flags & 1);
   int canonicalize = (flags & 2) >> 1;
 
-  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(*l));
+  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(rasqal_literal_private));
   if(l) {
     rasqal_literal_type datatype_type = RASQAL_LITERAL_STRING;
 
@@ -926,8 +958,9 @@ rasqal_new_string_literal_common(rasqal_world* world,
     l->datatype = datatype;
     l->flags = datatype_qname;
 
+    /* resolve the datatype once; later comparisons use the code */
     if(datatype)
-      datatype_type = rasqal_xsd_datatype_uri_to_type(world, datatype);
+      datatype_type = rasqal_literal_get_datatype_type(l);
     l->parent_type = rasqal_xsd_datatype_parent_type(datatype_type);
     
     if(native_type_promotion &&
@@ -1035,7 +1068,7 @@ rasqal_new_simple_literal(rasqal_world* world,
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(world, rasqal_world, NULL);
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(string, char*, NULL);
 
-  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(*l));
+  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(rasqal_literal_private));
   if(l) {
     l->valid = 1;
     l->usage = 1;
@@ -1067,7 +1100,7 @@ rasqal_new_boolean_literal(rasqal_world* world, int value)
 
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(world, rasqal_world, NULL);
 
-  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(*l));
+  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(rasqal_literal_private));
   if(l) {
     l->valid = 1;
     l->usage = 1;
@@ -1106,7 +1139,7 @@ rasqal_new_variable_literal(rasqal_world* world, rasqal_variable *variable)
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(world, rasqal_world, NULL);
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(variable, rasqal_variable, NULL);
 
-  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(*l));
+  l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(rasqal_literal_private));
   if(l) {
     l->valid = 1;
     l->usage = 1;
@@ -2196,6 +2229,72 @@ rasqal_new_literal_from_promotion(rasqal_literal* lit,
 }  
 
 
+/*
+ * rasqal_literal_get_datatype_type:
+ * @l: #rasqal_literal literal
+ *
+ * INTERNAL - Get the type code of a literal's datatype URI
+ *
+ * The datatype URI is resolved once and the code stored in the
+ * literal so comparing and writing literals do not need to look up
+ * the URI again.
+ *
+ * Return value: #RASQAL_LITERAL_STRING if there is no datatype,
+ * #RASQAL_LITERAL_UDT if it is not a known XSD datatype or else the
+ * XSD datatype type
+ */
+rasqal_literal_type
+rasqal_literal_get_datatype_type(rasqal_literal* l)
+{
+  rasqal_literal_private* pl = RASQAL_LITERAL_PRIVATE(l);
+
+  if(pl->datatype_type == RASQAL_LITERAL_UNKNOWN) {
+    rasqal_literal_type type = RASQAL_LITERAL_STRING;
+
+    if(l->datatype) {
+      type = rasqal_xsd_datatype_uri_to_type(l->world, l->datatype);
+      if(type == RASQAL_LITERAL_UNKNOWN)
+        type = RASQAL_LITERAL_UDT;
+    }
+    pl->datatype_type = type;
+  }
+
+  return pl->datatype_type;
+}
+
+
+/*
+ * rasqal_literal_datatypes_equal:
+ * @dt1: first datatype URI
+ * @type1: type code of @dt1 from rasqal_literal_get_datatype_type()
+ * @dt2: second datatype URI
+ * @type2: type code of @dt2
+ *
+ * INTERNAL - Compare datatype URIs using their type codes
+ *
+ * Each XSD type code stands for exactly one URI except the codes for
+ * user defined types and types derived from xsd:integer, which need
+ * the URIs comparing.
+ *
+ * Return value: non-0 if equal
+ */
+static int
+rasqal_literal_datatypes_equal(raptor_uri* dt1, rasqal_literal_type type1,
+                               raptor_uri* dt2, rasqal_literal_type type2)
+{
+  if(dt1 == dt2)
+    return 1;
+
+  if(type1 != type2)
+    return 0;
+
+  if(type1 != RASQAL_LITERAL_UDT && type1 != RASQAL_LITERAL_INTEGER_SUBTYPE)
+    return 1;
+
+  return raptor_uri_equals(dt1, dt2);
+}
+
+
 /*
  * rasqal_literal_string_languages_compare
  * @l1: #rasqal_literal first literal
@@ -2241,7 +2340,11 @@ rasqal_literal_string_datatypes_compare(rasqal_literal* l1, rasqal_literal* l2)
 
   if(l1->datatype && l2->datatype) {
     /* both have a datatype */
-    rc = raptor_uri_compare(l1->datatype, l2->datatype);
+    if(!rasqal_literal_datatypes_equal(l1->datatype,
+                                       rasqal_literal_get_datatype_type(l1),
+                                       l2->datatype,
+                                       rasqal_literal_get_datatype_type(l2)))
+      rc = raptor_uri_compare(l1->datatype, l2->datatype);
   } else if(l1->datatype || l2->datatype)
     /* only one has a datatype; the datatype-less one is earlier */
     rc = (!l1->datatype ? -1 : 1);
@@ -2684,7 +2787,10 @@ rasqal_literal_string_equals_flags(rasqal_literal* l1, rasqal_literal* l2,
       goto done;
     }
     /* if different - type error */
-    if(!raptor_uri_equals(dt1, dt2)) {
+    if(!rasqal_literal_datatypes_equal(dt1,
+                                       free_dt1 ? RASQAL_LITERAL_XSD_STRING : rasqal_literal_get_datatype_type(l1),
+                                       dt2,
+                                       free_dt2 ? RASQAL_LITERAL_XSD_STRING : rasqal_literal_get_datatype_type(l2))) {
       if(error_p)
         *error_p = 1;
       result = 0;
@@ -2968,6 +3074,284 @@ rasqal_literal_equals_flags(rasqal_literal* l1, rasqal_literal* l2,
 }
 
 
+/* hash of an unbound (NULL) value */
+#define RASQAL_LITERAL_HASH_NULL 0x2545f4914f6cdd1dULL
+
+/* bits of rasqal_literal_private hash_cached field */
+#define RASQAL_LITERAL_HASH_CACHED_RDF_TERM (1 << 0)
+#define RASQAL_LITERAL_HASH_CACHED_VALUE    (1 << 1)
+
+
+static uint64_t
+rasqal_literal_hash_tag(uint64_t hash, char tag)
+{
+  return rasqal_hash_combine(hash, RASQAL_GOOD_CAST(uint64_t, RASQAL_GOOD_CAST(unsigned char, tag)));
+}
+
+
+static uint64_t
+rasqal_literal_hash_uri(uint64_t hash, raptor_uri* uri)
+{
+  const unsigned char* str;
+  size_t len;
+
+  str = raptor_uri_as_counted_string(uri, &len);
+  return rasqal_hash_bytes(hash, str, len);
+}
+
+
+/* Language tags compare case-insensitively so hash them lowercased */
+static uint64_t
+rasqal_literal_hash_language(uint64_t hash, const char* language)
+{
+  unsigned char buffer[64];
+  size_t len = 0;
+
+  hash = rasqal_literal_hash_tag(hash, '@');
+  while(*language) {
+    buffer[len++] = RASQAL_GOOD_CAST(unsigned char, tolower(RASQAL_GOOD_CAST(unsigned char, *language++)));
+    if(len == sizeof(buffer)) {
+      hash = rasqal_hash_bytes(hash, buffer, len);
+      len = 0;
+    }
+  }
+  return rasqal_hash_bytes(hash, buffer, len);
+}
+
+
+/* Only literals that cannot change later may cache their hashes */
+static int
+rasqal_literal_hash_cacheable(rasqal_literal* l)
+{
+  return !l->flags && l->type != RASQAL_LITERAL_VARIABLE;
+}
+
+
+/**
+ * rasqal_literal_hash_rdf_term:
+ * @l: literal or NULL
+ *
+ * INTERNAL - Hash a literal consistently with RDF term equality
+ *
+ * Literals equal by rasqal_literal_equals_flags() with
+ * #RASQAL_COMPARE_RDF have the same hash: URIs hash their URI string,
+ * blank nodes their label and all literal values their lexical form,
+ * language (ignoring case) and datatype URI.
+ *
+ * Hashes are not stable across processes or machines.
+ *
+ * Return value: hash
+ */
+uint64_t
+rasqal_literal_hash_rdf_term(rasqal_literal* l)
+{
+  uint64_t hash = 0;
+
+  if(!l)
+    return RASQAL_LITERAL_HASH_NULL;
+
+  if(RASQAL_LITERAL_PRIVATE(l)->hash_cached & RASQAL_LITERAL_HASH_CACHED_RDF_TERM)
+    return RASQAL_LITERAL_PRIVATE(l)->hash_rdf_term;
+
+  switch(rasqal_literal_get_rdf_term_type(l)) {
+    case RASQAL_LITERAL_URI:
+      hash = rasqal_literal_hash_tag(hash, 'U');
+      if(l->value.uri)
+        hash = rasqal_literal_hash_uri(hash, l->value.uri);
+      break;
+
+    case RASQAL_LITERAL_BLANK:
+      hash = rasqal_literal_hash_tag(hash, 'B');
+      hash = rasqal_hash_bytes(hash, l->string, l->string_len);
+      break;
+
+    case RASQAL_LITERAL_STRING:
+      hash = rasqal_literal_hash_tag(hash, 'L');
+      hash = rasqal_hash_bytes(hash, l->string, l->string_len);
+      if(l->language)
+        hash = rasqal_literal_hash_language(hash, l->language);
+      if(l->datatype) {
+        hash = rasqal_literal_hash_tag(hash, '^');
+        hash = rasqal_literal_hash_uri(hash, l->datatype);
+      }
+      break;
+
+    case RASQAL_LITERAL_UNKNOWN:
+    case RASQAL_LITERAL_XSD_STRING:
+    case RASQAL_LITERAL_BOOLEAN:
+    case RASQAL_LITERAL_INTEGER:
+    case RASQAL_LITERAL_FLOAT:
+    case RASQAL_LITERAL_DOUBLE:
+    case RASQAL_LITERAL_DECIMAL:
+    case RASQAL_LITERAL_DATETIME:
+    case RASQAL_LITERAL_UDT:
+    case RASQAL_LITERAL_PATTERN:
+    case RASQAL_LITERAL_QNAME:
+    case RASQAL_LITERAL_VARIABLE:
+    case RASQAL_LITERAL_INTEGER_SUBTYPE:
+    case RASQAL_LITERAL_DATE:
+    default:
+      /* Not an RDF term so never RDF term equal to anything */
+      hash = rasqal_literal_hash_tag(hash, 'X');
+      break;
+  }
+
+  hash = rasqal_hash_mix(hash);
+
+  if(rasqal_literal_hash_cacheable(l)) {
+    RASQAL_LITERAL_PRIVATE(l)->hash_rdf_term = hash;
+    RASQAL_LITERAL_PRIVATE(l)->hash_cached |= RASQAL_LITERAL_HASH_CACHED_RDF_TERM;
+  }
+
+  return hash;
+}
+
+
+/**
+ * rasqal_literal_hash_value:
+ * @l: literal or NULL
+ *
+ * INTERNAL - Hash a literal consistently with value equality
+ *
+ * Literals equal by rasqal_literal_equals_flags() with
+ * #RASQAL_COMPARE_XQUERY have the same hash.  Numeric and boolean
+ * values of every type are hashed as their canonical double value so
+ * that numeric promotion is respected, plain and xsd:string literals
+ * hash the same and dates and dateTimes hash their point on the
+ * timeline.
+ *
+ * Doubles that are only approximately equal and dateTimes that are
+ * incomparable (only one has a timezone) may hash differently.
+ *
+ * Hashes are not stable across processes or machines.
+ *
+ * Return value: hash
+ */
+uint64_t
+rasqal_literal_hash_value(rasqal_literal* l)
+{
+  uint64_t hash = 0;
+  double d;
+  int error = 0;
+
+  if(!l)
+    return RASQAL_LITERAL_HASH_NULL;
+
+  if(l->type == RASQAL_LITERAL_VARIABLE)
+    return rasqal_literal_hash_value(l->value.variable->value);
+
+  if(RASQAL_LITERAL_PRIVATE(l)->hash_cached & RASQAL_LITERAL_HASH_CACHED_VALUE)
+    return RASQAL_LITERAL_PRIVATE(l)->hash_value;
+
+  /* Ensure the value is native as for value comparison */
+  rasqal_literal_string_to_native(l, 0);
+
+  switch(l->type) {
+    case RASQAL_LITERAL_URI:
+      hash = rasqal_literal_hash_tag(hash, 'U');
+      if(l->value.uri)
+        hash = rasqal_literal_hash_uri(hash, l->value.uri);
+      break;
+
+    case RASQAL_LITERAL_BLANK:
+      hash = rasqal_literal_hash_tag(hash, 'B');
+      hash = rasqal_hash_bytes(hash, l->string, l->string_len);
+      break;
+
+    case RASQAL_LITERAL_STRING:
+    case RASQAL_LITERAL_XSD_STRING:
+      hash = rasqal_literal_hash_tag(hash, 'S');
+      hash = rasqal_hash_bytes(hash, l->string, l->string_len);
+      if(l->language)
+        hash = rasqal_literal_hash_language(hash, l->language);
+      break;
+
+    case RASQAL_LITERAL_UDT:
+      hash = rasqal_literal_hash_tag(hash, 'L');
+      hash = rasqal_hash_bytes(hash, l->string, l->string_len);
+      if(l->datatype) {
+        hash = rasqal_literal_hash_tag(hash, '^');
+        hash = rasqal_literal_hash_uri(hash, l->datatype);
+      }
+      break;
+
+    case RASQAL_LITERAL_BOOLEAN:
+    case RASQAL_LITERAL_INTEGER:
+    case RASQAL_LITERAL_INTEGER_SUBTYPE:
+    case RASQAL_LITERAL_FLOAT:
+    case RASQAL_LITERAL_DOUBLE:
+    case RASQAL_LITERAL_DECIMAL:
+      d = rasqal_literal_as_double(l, &error);
+      hash = rasqal_literal_hash_tag(hash, 'N');
+      if(isnan(d)) {
+        /* all NaNs */
+        hash = rasqal_literal_hash_tag(hash, 'n');
+      } else {
+        uint64_t bits;
+
+        /* -0.0 == 0.0 */
+        if(!(d < 0.0) && !(d > 0.0))
+          d = 0.0;
+        memcpy(&bits, &d, sizeof(bits));
+        hash = rasqal_hash_combine(hash, bits);
+      }
+      break;
+
+    case RASQAL_LITERAL_DATETIME:
+      hash = rasqal_literal_hash_tag(hash, 'T');
+      hash = rasqal_hash_combine(hash, RASQAL_GOOD_CAST(uint64_t, l->value.datetime->time_on_timeline));
+      hash = rasqal_hash_combine(hash, RASQAL_GOOD_CAST(uint64_t, l->value.datetime->microseconds));
+      break;
+
+    case RASQAL_LITERAL_DATE:
+      hash = rasqal_literal_hash_tag(hash, 'T');
+      hash = rasqal_hash_combine(hash, RASQAL_GOOD_CAST(uint64_t, l->value.date->time_on_timeline));
+      hash = rasqal_hash_combine(hash, 0);
+      break;
+
+    case RASQAL_LITERAL_UNKNOWN:
+    case RASQAL_LITERAL_PATTERN:
+    case RASQAL_LITERAL_QNAME:
+    case RASQAL_LITERAL_VARIABLE:
+    default:
+      hash = rasqal_literal_hash_tag(hash, 'X');
+      hash = rasqal_hash_combine(hash, RASQAL_GOOD_CAST(uint64_t, l->type));
+      break;
+  }
+
+  hash = rasqal_hash_mix(hash);
+
+  if(rasqal_literal_hash_cacheable(l)) {
+    RASQAL_LITERAL_PRIVATE(l)->hash_value = hash;
+    RASQAL_LITERAL_PRIVATE(l)->hash_cached |= RASQAL_LITERAL_HASH_CACHED_VALUE;
+  }
+
+  return hash;
+}
+
+
+/**
+ * rasqal_literal_hash_flags:
+ * @l: literal or NULL
+ * @flags: comparison flags as for rasqal_literal_equals_flags()
+ *
+ * INTERNAL - Hash a literal consistently with rasqal_literal_equals_flags()
+ *
+ * If @flags contains #RASQAL_COMPARE_RDF the RDF term hash is
+ * returned, otherwise the value hash.
+ *
+ * Return value: hash
+ */
+uint64_t
+rasqal_literal_hash_flags(rasqal_literal* l, int flags)
+{
+  if(flags & RASQAL_COMPARE_RDF)
+    return rasqal_literal_hash_rdf_term(l);
+
+  return rasqal_literal_hash_value(l);
+}
+
+
 /*
  * rasqal_literal_expand_qname:
  * @user_data: #rasqal_query cast as void for use with raptor_sequence_foreach
@@ -3013,6 +3397,7 @@ rasqal_literal_expand_qname(void *user_data, rasqal_literal *l)
       if(!uri)
         return 1;
       l->datatype = uri;
+      RASQAL_LITERAL_PRIVATE(l)->datatype_type = RASQAL_LITERAL_UNKNOWN;
       RASQAL_FREE(char*, l->flags);
       l->flags = NULL;
 
@@ -3091,7 +3476,7 @@ rasqal_literal_as_node(rasqal_literal* l)
     case RASQAL_LITERAL_DATETIME:
     case RASQAL_LITERAL_UDT:
     case RASQAL_LITERAL_INTEGER_SUBTYPE:
-      new_l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(*new_l));
+      new_l = RASQAL_CALLOC(rasqal_literal*, 1, sizeof(rasqal_literal_private));
       if(new_l) {
         new_l->valid = 1;
         new_l->usage = 1;
@@ -4490,6 +4875,349 @@ rasqal_literal_array_compare_by_order(rasqal_literal** values_a,
 }
 
 
+/*
+ * Order key encoding used by rasqal_literal_array_to_order_key()
+ *
+ * Each value is a class byte then a payload.  Unbound values are
+ * RASQAL_ORDER_KEY_NULL and end the key since
+ * rasqal_literal_array_compare() stops comparing at the first NULL.
+ * Literals have a family byte before the payload; the order of
+ * families is not defined by SPARQL so they are ordered by family.
+ * Booleans are in the numeric family as 0 and 1 since
+ * rasqal_literal_compare() promotes them to integers.
+ */
+#define RASQAL_ORDER_KEY_NULL    0x00
+#define RASQAL_ORDER_KEY_BLANK   0x01
+#define RASQAL_ORDER_KEY_URI     0x02
+#define RASQAL_ORDER_KEY_LITERAL 0x03
+
+#define RASQAL_ORDER_KEY_NUMERIC    0x01
+#define RASQAL_ORDER_KEY_DATETIME   0x02
+#define RASQAL_ORDER_KEY_DATE       0x03
+#define RASQAL_ORDER_KEY_STRING     0x04
+#define RASQAL_ORDER_KEY_XSD_STRING 0x05
+#define RASQAL_ORDER_KEY_OTHER      0x06
+
+/* bytes in an encoded double: sign class, 2 exponent, 7 mantissa */
+#define RASQAL_ORDER_KEY_DOUBLE_SIZE 10
+
+typedef struct {
+  unsigned char* buffer;
+  size_t size;
+  size_t capacity;
+} rasqal_order_key;
+
+
+static int
+rasqal_order_key_append(rasqal_order_key* key, const unsigned char* data,
+                        size_t len)
+{
+  if(key->size + len > key->capacity) {
+    size_t capacity = key->capacity ? key->capacity : 64;
+    unsigned char* buffer;
+
+    while(key->size + len > capacity)
+      capacity <<= 1;
+
+    buffer = RASQAL_MALLOC(unsigned char*, capacity);
+    if(!buffer)
+      return 1;
+
+    if(key->buffer) {
+      memcpy(buffer, key->buffer, key->size);
+      RASQAL_FREE(char*, key->buffer);
+    }
+    key->buffer = buffer;
+    key->capacity = capacity;
+  }
+
+  memcpy(key->buffer + key->size, data, len);
+  key->size += len;
+
+  return 0;
+}
+
+
+static int
+rasqal_order_key_append_byte(rasqal_order_key* key, unsigned char b)
+{
+  return rasqal_order_key_append(key, &b, 1);
+}
+
+
+/* append a NUL terminated string including the NUL which is never
+ * inside it, so no encoded string is a prefix of another */
+static int
+rasqal_order_key_append_string(rasqal_order_key* key, const unsigned char* str)
+{
+  return rasqal_order_key_append(key, str,
+                                 strlen(RASQAL_GOOD_CAST(const char*, str)) + 1);
+}
+
+
+/*
+ * rasqal_order_key_append_double:
+ * @key: order key
+ * @d: finite or infinite value (not NaN)
+ *
+ * INTERNAL - Append a double so that byte order is numeric order
+ *
+ * The mantissa is written 8 bits at a time which holds all 53 bits.
+ * Negative values have their exponent and mantissa bytes inverted.
+ * Positive and negative zero are the same.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_order_key_append_double(rasqal_order_key* key, double d)
+{
+  unsigned char bytes[RASQAL_ORDER_KEY_DOUBLE_SIZE];
+  int negative = (d < 0.0);
+  double m;
+  int exponent;
+  unsigned int biased;
+  int i;
+
+  memset(bytes, 0, sizeof(bytes));
+
+  if(!negative && !(d > 0.0))
+    bytes[0] = 2;
+  else if(isinf(d))
+    bytes[0] = negative ? 0 : 4;
+  else {
+    bytes[0] = negative ? 1 : 3;
+
+    m = frexp(negative ? -d : d, &exponent);
+    biased = RASQAL_GOOD_CAST(unsigned int, exponent + 0x8000);
+    bytes[1] = RASQAL_GOOD_CAST(unsigned char, (biased >> 8) & 0xff);
+    bytes[2] = RASQAL_GOOD_CAST(unsigned char, biased & 0xff);
+    for(i = 3; i < RASQAL_ORDER_KEY_DOUBLE_SIZE; i++) {
+      int b;
+
+      m *= 256.0;
+      b = RASQAL_GOOD_CAST(int, m);
+      bytes[i] = RASQAL_GOOD_CAST(unsigned char, b);
+      m -= b;
+    }
+
+    if(negative) {
+      for(i = 1; i < RASQAL_ORDER_KEY_DOUBLE_SIZE; i++)
+        bytes[i] = RASQAL_GOOD_CAST(unsigned char, ~bytes[i]);
+    }
+  }
+
+  return rasqal_order_key_append(key, bytes, sizeof(bytes));
+}
+
+
+/*
+ * rasqal_order_key_append_literal:
+ * @key: order key
+ * @l: literal value
+ * @compare_flags: #RASQAL_COMPARE_XQUERY or #RASQAL_COMPARE_RDF
+ * @exact_p: pointer to set to 0 if the encoding does not fully order @l
+ *
+ * INTERNAL - Append one literal in the order of rasqal_literal_compare()
+ *
+ * Values that only partly fit a byte order, such as decimals or
+ * literals with a language, write the part that does and clear
+ * *@exact_p so the caller ends the key there.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_order_key_append_literal(rasqal_order_key* key, rasqal_literal* l,
+                                int compare_flags, int* exact_p)
+{
+  rasqal_literal_type type;
+  int error = 0;
+  double d;
+
+  type = rasqal_literal_get_rdf_term_type(l);
+  if(type == RASQAL_LITERAL_UNKNOWN) {
+    *exact_p = 0;
+    return 0;
+  }
+
+  if(type == RASQAL_LITERAL_BLANK) {
+    if(rasqal_order_key_append_byte(key, RASQAL_ORDER_KEY_BLANK))
+      return 1;
+    return rasqal_order_key_append_string(key, l->string);
+  }
+
+  if(type == RASQAL_LITERAL_URI) {
+    if(rasqal_order_key_append_byte(key, RASQAL_ORDER_KEY_URI))
+      return 1;
+    return rasqal_order_key_append_string(key, raptor_uri_as_string(l->value.uri));
+  }
+
+  if(rasqal_order_key_append_byte(key, RASQAL_ORDER_KEY_LITERAL))
+    return 1;
+
+  if(compare_flags & RASQAL_COMPARE_RDF) {
+    /* all literals compare by lexical form, language then datatype */
+    if(rasqal_order_key_append_string(key, l->string))
+      return 1;
+    if(l->language || l->datatype)
+      *exact_p = 0;
+    return 0;
+  }
+
+  switch(l->type) {
+    case RASQAL_LITERAL_BOOLEAN:
+    case RASQAL_LITERAL_INTEGER:
+    case RASQAL_LITERAL_INTEGER_SUBTYPE:
+    case RASQAL_LITERAL_FLOAT:
+    case RASQAL_LITERAL_DOUBLE:
+    case RASQAL_LITERAL_DECIMAL:
+      if(rasqal_order_key_append_byte(key, RASQAL_ORDER_KEY_NUMERIC))
+        return 1;
+
+      d = rasqal_literal_as_double(l, &error);
+      if(error || isnan(d)) {
+        *exact_p = 0;
+        return 0;
+      }
+      if(rasqal_order_key_append_double(key, d))
+        return 1;
+
+      /* decimals and integer subtypes may not be a unique double */
+      if(l->type == RASQAL_LITERAL_DECIMAL ||
+         l->type == RASQAL_LITERAL_INTEGER_SUBTYPE)
+        *exact_p = 0;
+      return 0;
+
+    case RASQAL_LITERAL_STRING:
+      if(rasqal_order_key_append_byte(key, RASQAL_ORDER_KEY_STRING) ||
+         rasqal_order_key_append_string(key, l->string))
+        return 1;
+      if(l->language || l->datatype)
+        *exact_p = 0;
+      return 0;
+
+    case RASQAL_LITERAL_XSD_STRING:
+      if(rasqal_order_key_append_byte(key, RASQAL_ORDER_KEY_XSD_STRING))
+        return 1;
+      return rasqal_order_key_append_string(key, l->string);
+
+    case RASQAL_LITERAL_DATETIME:
+      *exact_p = 0;
+      return rasqal_order_key_append_byte(key, RASQAL_ORDER_KEY_DATETIME);
+
+    case RASQAL_LITERAL_DATE:
+      *exact_p = 0;
+      return rasqal_order_key_append_byte(key, RASQAL_ORDER_KEY_DATE);
+
+    case RASQAL_LITERAL_UNKNOWN:
+    case RASQAL_LITERAL_BLANK:
+    case RASQAL_LITERAL_URI:
+    case RASQAL_LITERAL_UDT:
+    case RASQAL_LITERAL_PATTERN:
+    case RASQAL_LITERAL_QNAME:
+    case RASQAL_LITERAL_VARIABLE:
+    default:
+      *exact_p = 0;
+      return rasqal_order_key_append_byte(key, RASQAL_ORDER_KEY_OTHER);
+  }
+}
+
+
+/*
+ * rasqal_literal_array_to_order_key:
+ * @values: array of literals
+ * @exprs_seq: array of order condition expressions (or NULL)
+ * @size: size of arrays
+ * @compare_flags: comparison flags as for rasqal_literal_array_compare()
+ * @len_p: pointer to store the key length
+ * @complete_p: pointer to store non-0 if the key orders all of @values
+ *
+ * INTERNAL - Encode an array of literals as a byte key in ORDER BY order
+ *
+ * Comparing two keys with memcmp() over the shorter length gives the
+ * same order as rasqal_literal_array_compare() with @exprs_seq when
+ * the bytes differ.  When they do not and either key is not complete
+ * the literals must be compared with rasqal_literal_array_compare().
+ * Equal complete keys compare equal.
+ *
+ * Ordering follows SPARQL: unbound before blank nodes before IRIs
+ * before literals, numbers by value across numeric types and
+ * descending order conditions with the bytes of that value inverted.
+ * Unbound values sort first in either direction.
+ *
+ * Return value: new key or NULL if @compare_flags have no key or on failure
+ */
+unsigned char*
+rasqal_literal_array_to_order_key(rasqal_literal** values,
+                                  raptor_sequence* exprs_seq,
+                                  int size,
+                                  int compare_flags,
+                                  size_t* len_p,
+                                  int* complete_p)
+{
+  rasqal_order_key key;
+  int exact = 1;
+  int i;
+
+  if((compare_flags & RASQAL_COMPARE_NOCASE) ||
+     !(compare_flags & (RASQAL_COMPARE_XQUERY | RASQAL_COMPARE_RDF)))
+    return NULL;
+
+  key.buffer = NULL;
+  key.size = 0;
+  key.capacity = 0;
+
+  for(i = 0; i < size && exact; i++) {
+    rasqal_expression* e = NULL;
+    rasqal_literal* l = values[i];
+    size_t start = key.size;
+
+    if(exprs_seq)
+      e = (rasqal_expression*)raptor_sequence_get_at(exprs_seq, i);
+
+    if(!l) {
+      if(rasqal_order_key_append_byte(&key, RASQAL_ORDER_KEY_NULL))
+        goto fail;
+      /* No values after a NULL are compared */
+      break;
+    }
+
+    l = rasqal_literal_value(l);
+    if(!l) {
+      exact = 0;
+      break;
+    }
+
+    if(rasqal_order_key_append_literal(&key, l, compare_flags, &exact))
+      goto fail;
+
+    if(e && e->op == RASQAL_EXPR_ORDER_COND_DESC) {
+      size_t j;
+
+      for(j = start; j < key.size; j++)
+        key.buffer[j] = RASQAL_GOOD_CAST(unsigned char, ~key.buffer[j]);
+    }
+  }
+
+  if(!key.buffer) {
+    /* no bytes: an empty key */
+    key.buffer = RASQAL_MALLOC(unsigned char*, 1);
+    if(!key.buffer)
+      return NULL;
+  }
+
+  *len_p = key.size;
+  *complete_p = exact;
+
+  return key.buffer;
+
+  fail:
+  if(key.buffer)
+    RASQAL_FREE(char*, key.buffer);
+
+  return NULL;
+}
+
+
 /**
  * rasqal_literal_array_equals:
  * @values_a: first array of literals
@@ -4985,6 +5713,295 @@ static const struct {
 };
 
 
+static rasqal_literal*
+rasqal_literal_test_string(rasqal_world* world, rasqal_literal_type type,
+                           const char* str)
+{
+  size_t len = strlen(str);
+  unsigned char* copy;
+
+  copy = RASQAL_MALLOC(unsigned char*, len + 1);
+  if(!copy)
+    return NULL;
+  memcpy(copy, str, len + 1);
+
+  if(type == RASQAL_LITERAL_STRING)
+    return rasqal_new_string_literal(world, copy, NULL, NULL, NULL);
+  return rasqal_new_simple_literal(world, type, copy);
+}
+
+
+#define ORDER_KEY_COUNT 11
+
+/* Check order keys of values listed in ascending ORDER BY order */
+static int
+rasqal_literal_test_order_keys(rasqal_world* world, const char* program)
+{
+  rasqal_literal* lits[ORDER_KEY_COUNT];
+  unsigned char* keys[ORDER_KEY_COUNT];
+  size_t lens[ORDER_KEY_COUNT];
+  int completes[ORDER_KEY_COUNT];
+  rasqal_literal* one_double = NULL;
+  rasqal_literal* booleans[2] = { NULL, NULL };
+  unsigned char* key = NULL;
+  size_t len = 0;
+  int complete = 0;
+  raptor_sequence* desc_seq = NULL;
+  rasqal_expression* e;
+  int failures = 0;
+  int i;
+
+  memset(keys, 0, sizeof(keys));
+
+  lits[0] = NULL;
+  lits[1] = rasqal_literal_test_string(world, RASQAL_LITERAL_BLANK, "b1");
+  lits[2] = rasqal_literal_test_string(world, RASQAL_LITERAL_BLANK, "b2");
+  lits[3] = rasqal_new_uri_literal(world,
+                                   raptor_new_uri(world->raptor_world_ptr,
+                                                  RASQAL_GOOD_CAST(const unsigned char*, "http://example.org/a")));
+  lits[4] = rasqal_new_uri_literal(world,
+                                   raptor_new_uri(world->raptor_world_ptr,
+                                                  RASQAL_GOOD_CAST(const unsigned char*, "http://example.org/ab")));
+  lits[5] = rasqal_new_integer_literal(world, RASQAL_LITERAL_INTEGER, -5);
+  lits[6] = rasqal_new_double_literal(world, -0.25);
+  lits[7] = rasqal_new_integer_literal(world, RASQAL_LITERAL_INTEGER, 1);
+  lits[8] = rasqal_new_double_literal(world, 2.5);
+  lits[9] = rasqal_new_integer_literal(world, RASQAL_LITERAL_INTEGER, 10);
+  lits[10] = rasqal_literal_test_string(world, RASQAL_LITERAL_STRING, "abc");
+
+  for(i = 1; i < ORDER_KEY_COUNT; i++) {
+    if(!lits[i]) {
+      fprintf(DEBUG_FH, "%s: failed to create order key literal %d\n",
+              program, i);
+      failures++;
+      goto tidy;
+    }
+  }
+
+  for(i = 0; i < ORDER_KEY_COUNT; i++) {
+    keys[i] = rasqal_literal_array_to_order_key(&lits[i], NULL, 1,
+                                                RASQAL_COMPARE_XQUERY,
+                                                &lens[i], &completes[i]);
+    if(!keys[i] || !completes[i]) {
+      fprintf(DEBUG_FH, "%s: order key %d missing or not complete\n",
+              program, i);
+      failures++;
+      goto tidy;
+    }
+  }
+
+  for(i = 1; i < ORDER_KEY_COUNT; i++) {
+    size_t min_len = (lens[i - 1] < lens[i]) ? lens[i - 1] : lens[i];
+
+    if(memcmp(keys[i - 1], keys[i], min_len) >= 0) {
+      fprintf(DEBUG_FH, "%s: order key %d does not sort before key %d\n",
+              program, i - 1, i);
+      failures++;
+    }
+  }
+
+  /* Numbers of different types with the same value have the same key */
+  one_double = rasqal_new_double_literal(world, 1.0);
+  key = rasqal_literal_array_to_order_key(&one_double, NULL, 1,
+                                          RASQAL_COMPARE_XQUERY,
+                                          &len, &complete);
+  if(!key || len != lens[7] || memcmp(key, keys[7], len)) {
+    fprintf(DEBUG_FH, "%s: order key of 1.0 differs from 1\n", program);
+    failures++;
+  }
+  if(key)
+    RASQAL_FREE(char*, key);
+
+  /* Booleans order as the integers 0 and 1 among numbers */
+  booleans[0] = rasqal_new_boolean_literal(world, 0);
+  booleans[1] = rasqal_new_boolean_literal(world, 1);
+  if(!booleans[0] || !booleans[1]) {
+    fprintf(DEBUG_FH, "%s: failed to create boolean literals\n", program);
+    failures++;
+    goto tidy;
+  }
+
+  key = rasqal_literal_array_to_order_key(&booleans[0], NULL, 1,
+                                          RASQAL_COMPARE_XQUERY,
+                                          &len, &complete);
+  if(!key || len != lens[6] || len != lens[7] ||
+     memcmp(keys[6], key, len) >= 0 || memcmp(key, keys[7], len) >= 0) {
+    fprintf(DEBUG_FH, "%s: order key of false is not between -0.25 and 1\n",
+            program);
+    failures++;
+  }
+  if(key)
+    RASQAL_FREE(char*, key);
+
+  key = rasqal_literal_array_to_order_key(&booleans[1], NULL, 1,
+                                          RASQAL_COMPARE_XQUERY,
+                                          &len, &complete);
+  if(!key || len != lens[7] || memcmp(key, keys[7], len)) {
+    fprintf(DEBUG_FH, "%s: order key of true differs from 1\n", program);
+    failures++;
+  }
+  if(key)
+    RASQAL_FREE(char*, key);
+
+  /* Descending order inverts values but unbound stays first */
+  desc_seq = raptor_new_sequence((raptor_data_free_handler)rasqal_free_expression,
+                                 (raptor_data_print_handler)rasqal_expression_print);
+  e = rasqal_new_1op_expression(world, RASQAL_EXPR_ORDER_COND_DESC,
+                                rasqal_new_literal_expression(world,
+                                                              rasqal_new_literal_from_literal(lits[7])));
+  if(!desc_seq || !e || raptor_sequence_push(desc_seq, e)) {
+    fprintf(DEBUG_FH, "%s: failed to create DESC order condition\n", program);
+    failures++;
+    goto tidy;
+  }
+
+  for(i = 0; i < ORDER_KEY_COUNT; i++) {
+    RASQAL_FREE(char*, keys[i]);
+    keys[i] = rasqal_literal_array_to_order_key(&lits[i], desc_seq, 1,
+                                                RASQAL_COMPARE_XQUERY,
+                                                &lens[i], &completes[i]);
+    if(!keys[i]) {
+      fprintf(DEBUG_FH, "%s: DESC order key %d missing\n", program, i);
+      failures++;
+      goto tidy;
+    }
+  }
+
+  for(i = 2; i < ORDER_KEY_COUNT; i++) {
+    size_t min_len = (lens[i - 1] < lens[i]) ? lens[i - 1] : lens[i];
+
+    if(memcmp(keys[i - 1], keys[i], min_len) <= 0) {
+      fprintf(DEBUG_FH, "%s: DESC order key %d does not sort after key %d\n",
+              program, i - 1, i);
+      failures++;
+    }
+  }
+  if(memcmp(keys[0], keys[ORDER_KEY_COUNT - 1], lens[0]) >= 0) {
+    fprintf(DEBUG_FH, "%s: DESC order key of unbound is not first\n",
+            program);
+    failures++;
+  }
+
+  tidy:
+  if(desc_seq)
+    raptor_free_sequence(desc_seq);
+  if(one_double)
+    rasqal_free_literal(one_double);
+  for(i = 0; i < 2; i++) {
+    if(booleans[i])
+      rasqal_free_literal(booleans[i]);
+  }
+  for(i = 0; i < ORDER_KEY_COUNT; i++) {
+    if(lits[i])
+      rasqal_free_literal(lits[i]);
+    if(keys[i])
+      RASQAL_FREE(char*, keys[i]);
+  }
+
+  return failures;
+}
+
+
+#define HASH_COUNT 13
+
+/* Check hashes agree with equality for both RDF term and value equality */
+static int
+rasqal_literal_test_hashes(rasqal_world* world, const char* program)
+{
+  rasqal_literal* lits[HASH_COUNT];
+  /* offsets of literals that must have the same value hash */
+  static const int value_equal[][2] = {
+    {0, 1}, {0, 2}, {0, 3}, {5, 6}, {11, 12}
+  };
+  int failures = 0;
+  int i;
+  int j;
+
+  lits[0] = rasqal_new_integer_literal(world, RASQAL_LITERAL_INTEGER, 1);
+  lits[1] = rasqal_new_double_literal(world, 1.0);
+  lits[2] = rasqal_new_typed_literal(world, RASQAL_LITERAL_DECIMAL,
+                                     RASQAL_GOOD_CAST(const unsigned char*, "1.0"));
+  lits[3] = rasqal_new_boolean_literal(world, 1);
+  lits[4] = rasqal_new_integer_literal(world, RASQAL_LITERAL_INTEGER, 2);
+  lits[5] = rasqal_literal_test_string(world, RASQAL_LITERAL_STRING, "abc");
+  lits[6] = rasqal_new_typed_literal(world, RASQAL_LITERAL_XSD_STRING,
+                                     RASQAL_GOOD_CAST(const unsigned char*, "abc"));
+  lits[7] = rasqal_literal_test_string(world, RASQAL_LITERAL_STRING, "abc");
+  lits[8] = rasqal_new_uri_literal(world,
+                                   raptor_new_uri(world->raptor_world_ptr,
+                                                  RASQAL_GOOD_CAST(const unsigned char*, "http://example.org/a")));
+  lits[9] = rasqal_new_uri_literal(world,
+                                   raptor_new_uri(world->raptor_world_ptr,
+                                                  RASQAL_GOOD_CAST(const unsigned char*, "http://example.org/a")));
+  lits[10] = rasqal_literal_test_string(world, RASQAL_LITERAL_BLANK, "b1");
+  lits[11] = rasqal_new_double_literal(world, -0.0);
+  lits[12] = rasqal_new_integer_literal(world, RASQAL_LITERAL_INTEGER, 0);
+
+  for(i = 0; i < HASH_COUNT; i++) {
+    if(!lits[i]) {
+      fprintf(DEBUG_FH, "%s: failed to create hash literal %d\n", program, i);
+      failures++;
+      goto tidy;
+    }
+  }
+
+  for(i = 0; i < HASH_COUNT; i++) {
+    for(j = 0; j < HASH_COUNT; j++) {
+      int error = 0;
+
+      if(rasqal_literal_equals_flags(lits[i], lits[j], RASQAL_COMPARE_RDF,
+                                     &error) && !error &&
+         rasqal_literal_hash_rdf_term(lits[i]) != rasqal_literal_hash_rdf_term(lits[j])) {
+        fprintf(DEBUG_FH, "%s: RDF term equal literals %d and %d hash differently\n",
+                program, i, j);
+        failures++;
+      }
+
+      error = 0;
+      if(rasqal_literal_equals_flags(lits[i], lits[j], RASQAL_COMPARE_XQUERY,
+                                     &error) && !error &&
+         rasqal_literal_hash_value(lits[i]) != rasqal_literal_hash_value(lits[j])) {
+        fprintf(DEBUG_FH, "%s: value equal literals %d and %d hash differently\n",
+                program, i, j);
+        failures++;
+      }
+    }
+  }
+
+  for(i = 0; i < RASQAL_GOOD_CAST(int, sizeof(value_equal) / sizeof(value_equal[0])); i++) {
+    rasqal_literal* l1 = lits[value_equal[i][0]];
+    rasqal_literal* l2 = lits[value_equal[i][1]];
+
+    if(rasqal_literal_hash_value(l1) != rasqal_literal_hash_value(l2)) {
+      fprintf(DEBUG_FH, "%s: value hash of literals %d and %d differ\n",
+              program, value_equal[i][0], value_equal[i][1]);
+      failures++;
+    }
+  }
+
+  if(rasqal_literal_hash_rdf_term(lits[5]) != rasqal_literal_hash_rdf_term(lits[7]) ||
+     rasqal_literal_hash_rdf_term(lits[8]) != rasqal_literal_hash_rdf_term(lits[9])) {
+    fprintf(DEBUG_FH, "%s: RDF term hash of same terms differ\n", program);
+    failures++;
+  }
+
+  if(rasqal_literal_hash_value(lits[0]) == rasqal_literal_hash_value(lits[4]) ||
+     rasqal_literal_hash_value(lits[0]) == rasqal_literal_hash_value(NULL)) {
+    fprintf(DEBUG_FH, "%s: value hash of different values are the same\n",
+            program);
+    failures++;
+  }
+
+  tidy:
+  for(i = 0; i < HASH_COUNT; i++) {
+    if(lits[i])
+      rasqal_free_literal(lits[i]);
+  }
+
+  return failures;
+}
+
+
 int
 main(int argc, char *argv[]) 
 {
@@ -5067,6 +6084,11 @@ main(int argc, char *argv[])
     }
   }
   
+  fprintf(stderr, "%s: Testing literal order keys\n", program);
+  failures += rasqal_literal_test_order_keys(world, program);
+
+  fprintf(stderr, "%s: Testing literal hashes\n", program);
+  failures += rasqal_literal_test_hashes(world, program);
 
   tidy:
   rasqal_free_world(world);
@@ -821,6 +821,178 @@ rasqal_new_term_from_counted_string(rasqal_world* world,
 #endif
 
 
+/* Return non-0 if @string is a plain absolute IRI that needs no
+ * N-Triples unescaping or other checks
+ */
+static int
+rasqal_ntriples_is_simple_iri(const unsigned char* string, size_t length)
+{
+  static const char rdf_ordinal_prefix[] = "http://www.w3.org/1999/02/22-rdf-syntax-ns#_";
+  size_t i;
+  int seen_scheme = 0;
+
+  if(!length || !isalpha(RASQAL_GOOD_CAST(int, string[0])))
+    return 0;
+
+  for(i = 0; i < length; i++) {
+    const unsigned char c = string[i];
+
+    if(c <= 0x20 || c >= 0x7f)
+      return 0;
+
+    switch(c) {
+      case '<': case '>': case '"': case '{': case '}':
+      case '|': case '^': case '`': case '\\':
+        return 0;
+
+      case ':':
+        seen_scheme = 1;
+        break;
+
+      default:
+        /* scheme = alpha *( alpha | digit | "+" | "-" | "." ) */
+        if(!seen_scheme && !isalnum(RASQAL_GOOD_CAST(int, c)) &&
+           c != '+' && c != '-' && c != '.')
+          return 0;
+        break;
+    }
+  }
+
+  /* rdf:_n properties get their ordinal checked */
+  if(length >= sizeof(rdf_ordinal_prefix) - 1 &&
+     !memcmp(string, rdf_ordinal_prefix, sizeof(rdf_ordinal_prefix) - 1))
+    return 0;
+
+  return seen_scheme;
+}
+
+
+/*
+ * rasqal_new_literal_from_ntriples_simple:
+ * @world: rasqal world
+ * @string: N-Triples format string (UTF-8)
+ * @length: length of @string
+ *
+ * INTERNAL - create a new literal from a common form of N-Triples term
+ *
+ * Handles IRIs and blank nodes in plain ASCII and ASCII literals
+ * without escapes, optionally with a language or datatype.  These are
+ * most terms in query results and are made directly into a literal
+ * without building and copying a #raptor_term.
+ *
+ * Return value: new literal or NULL if @string is not a simple term or on failure
+ */
+static rasqal_literal*
+rasqal_new_literal_from_ntriples_simple(rasqal_world* world,
+                                        const unsigned char* string,
+                                        size_t length)
+{
+  unsigned char* new_str;
+  char* language = NULL;
+  raptor_uri* uri = NULL;
+  size_t i;
+  size_t len;
+
+  if(length < 2)
+    return NULL;
+
+  if(string[0] == '<') {
+    if(string[length - 1] != '>' ||
+       !rasqal_ntriples_is_simple_iri(string + 1, length - 2))
+      return NULL;
+
+    uri = raptor_new_uri_from_counted_string(world->raptor_world_ptr,
+                                             string + 1, length - 2);
+    if(!uri)
+      return NULL;
+
+    return rasqal_new_uri_literal(world, uri);
+  }
+
+  if(string[0] == '_') {
+    if(length < 3 || string[1] != ':')
+      return NULL;
+
+    for(i = 2; i < length; i++) {
+      if(!isalnum(RASQAL_GOOD_CAST(int, string[i])))
+        return NULL;
+    }
+
+    len = length - 2;
+    new_str = RASQAL_MALLOC(unsigned char*, len + 1);
+    if(!new_str)
+      return NULL;
+    memcpy(new_str, string + 2, len);
+    new_str[len] = '\0';
+
+    return rasqal_new_simple_literal(world, RASQAL_LITERAL_BLANK, new_str);
+  }
+
+  if(string[0] != '"')
+    return NULL;
+
+  for(i = 1; i < length; i++) {
+    const unsigned char c = string[i];
+
+    if(c == '"')
+      break;
+    if(c < 0x20 || c >= 0x7f || c == '\\')
+      return NULL;
+  }
+  if(i == length)
+    return NULL;
+
+  /* string is string[1 .. i-1]; after the close quote at i can be
+   * nothing, @language or ^^<datatype>
+   */
+  len = i - 1;
+  i++;
+
+  if(i < length) {
+    const unsigned char* rest = string + i;
+    size_t rest_len = length - i;
+
+    if(rest[0] == '@') {
+      size_t j;
+
+      if(rest_len < 2 || !isalpha(RASQAL_GOOD_CAST(int, rest[1])))
+        return NULL;
+      for(j = 2; j < rest_len; j++) {
+        if(!isalnum(RASQAL_GOOD_CAST(int, rest[j])) && rest[j] != '-')
+          return NULL;
+      }
+
+      language = RASQAL_MALLOC(char*, rest_len);
+      if(!language)
+        return NULL;
+      memcpy(language, rest + 1, rest_len - 1);
+      language[rest_len - 1] = '\0';
+    } else if(rest_len > 4 && rest[0] == '^' && rest[1] == '^' &&
+              rest[2] == '<' && rest[rest_len - 1] == '>' &&
+              rasqal_ntriples_is_simple_iri(rest + 3, rest_len - 4)) {
+      uri = raptor_new_uri_from_counted_string(world->raptor_world_ptr,
+                                               rest + 3, rest_len - 4);
+      if(!uri)
+        return NULL;
+    } else
+      return NULL;
+  }
+
+  new_str = RASQAL_MALLOC(unsigned char*, len + 1);
+  if(!new_str) {
+    if(language)
+      RASQAL_FREE(char*, language);
+    if(uri)
+      raptor_free_uri(uri);
+    return NULL;
+  }
+  memcpy(new_str, string + 1, len);
+  new_str[len] = '\0';
+
+  return rasqal_new_string_literal(world, new_str, language, uri, NULL);
+}
+
+
 /*
  * rasqal_new_literal_from_ntriples_counted_string:
  * @world: rasqal world
@@ -839,6 +1011,12 @@ rasqal_new_literal_from_ntriples_counted_string(rasqal_world* world,
   raptor_term* term;
   rasqal_literal* l;
 
+  if(length) {
+    l = rasqal_new_literal_from_ntriples_simple(world, string, length);
+    if(l)
+      return l;
+  }
+
 #if RAPTOR_VERSION >= 20012
   term = raptor_new_term_from_counted_string(world->raptor_world_ptr,
                                              string, length);
@@ -0,0 +1,257 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_path.c - Rasqal SPARQL 1.1 property path class
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+
+/*
+ * rasqal_new_link_path:
+ * @iri: predicate IRI literal
+ *
+ * INTERNAL - Constructor - create a new property path for one predicate
+ *
+ * Takes ownership of @iri
+ *
+ * Return value: new #rasqal_path or NULL on failure
+ */
+rasqal_path*
+rasqal_new_link_path(rasqal_literal* iri)
+{
+  rasqal_path* path;
+
+  if(!iri)
+    return NULL;
+
+  path = RASQAL_CALLOC(rasqal_path*, 1, sizeof(*path));
+  if(!path) {
+    rasqal_free_literal(iri);
+    return NULL;
+  }
+
+  path->usage = 1;
+  path->op = RASQAL_PATH_OPERATOR_LINK;
+  path->iri = iri;
+
+  return path;
+}
+
+
+/*
+ * rasqal_new_path:
+ * @op: path operator other than #RASQAL_PATH_OPERATOR_LINK
+ * @path1: first argument path
+ * @path2: second argument path for SEQUENCE and ALTERNATIVE (or NULL)
+ *
+ * INTERNAL - Constructor - create a new property path from argument paths
+ *
+ * Takes ownership of @path1 and @path2
+ *
+ * Return value: new #rasqal_path or NULL on failure
+ */
+rasqal_path*
+rasqal_new_path(rasqal_path_operator op, rasqal_path* path1,
+                rasqal_path* path2)
+{
+  rasqal_path* path = NULL;
+  int binary;
+
+  binary = (op == RASQAL_PATH_OPERATOR_SEQUENCE ||
+            op == RASQAL_PATH_OPERATOR_ALTERNATIVE);
+
+  if(op == RASQAL_PATH_OPERATOR_LINK || !path1 || (binary && !path2))
+    goto tidy;
+
+  path = RASQAL_CALLOC(rasqal_path*, 1, sizeof(*path));
+  if(path) {
+    path->usage = 1;
+    path->op = op;
+    path->path1 = path1; path1 = NULL;
+    if(binary) {
+      path->path2 = path2; path2 = NULL;
+    }
+  }
+
+  tidy:
+  if(path1)
+    rasqal_free_path(path1);
+  if(path2)
+    rasqal_free_path(path2);
+
+  return path;
+}
+
+
+/*
+ * rasqal_new_path_from_path:
+ * @path: #rasqal_path to copy
+ *
+ * INTERNAL - Copy Constructor - create a new #rasqal_path from an existing one
+ *
+ * This adds a new reference to the path, it does not do a deep copy
+ *
+ * Return value: a new #rasqal_path or NULL on failure
+ */
+rasqal_path*
+rasqal_new_path_from_path(rasqal_path* path)
+{
+  if(!path)
+    return NULL;
+
+  path->usage++;
+  return path;
+}
+
+
+/*
+ * rasqal_free_path:
+ * @path: #rasqal_path object
+ *
+ * INTERNAL - Destructor - destroy a #rasqal_path object.
+ */
+void
+rasqal_free_path(rasqal_path* path)
+{
+  if(!path)
+    return;
+
+  if(--path->usage)
+    return;
+
+  if(path->iri)
+    rasqal_free_literal(path->iri);
+  if(path->path1)
+    rasqal_free_path(path->path1);
+  if(path->path2)
+    rasqal_free_path(path->path2);
+
+  RASQAL_FREE(rasqal_path, path);
+}
+
+
+/*
+ * rasqal_path_is_link:
+ * @path: #rasqal_path object
+ *
+ * INTERNAL - Test if a path is a single predicate IRI
+ *
+ * Return value: non-0 if the path is a plain triple pattern predicate
+ */
+int
+rasqal_path_is_link(rasqal_path* path)
+{
+  return path && path->op == RASQAL_PATH_OPERATOR_LINK;
+}
+
+
+static const char* const rasqal_path_operator_labels[RASQAL_PATH_OPERATOR_LAST + 1] = {
+  "link",
+  "inverse",
+  "sequence",
+  "alternative",
+  "zeroOrOne",
+  "zeroOrMore",
+  "oneOrMore"
+};
+
+
+/*
+ * rasqal_path_write:
+ * @path: #rasqal_path object
+ * @iostr: The #raptor_iostream handle to write to.
+ *
+ * INTERNAL - Write a property path to an iostream in a debug format.
+ *
+ * The print debug format may change in any release.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_path_write(rasqal_path* path, raptor_iostream* iostr)
+{
+  if(!path || !iostr)
+    return 1;
+
+  if(path->op == RASQAL_PATH_OPERATOR_LINK) {
+    rasqal_literal_write(path->iri, iostr);
+    return 0;
+  }
+
+  raptor_iostream_string_write(rasqal_path_operator_labels[path->op], iostr);
+  raptor_iostream_write_byte('(', iostr);
+  rasqal_path_write(path->path1, iostr);
+  if(path->path2) {
+    raptor_iostream_counted_string_write(", ", 2, iostr);
+    rasqal_path_write(path->path2, iostr);
+  }
+  raptor_iostream_write_byte(')', iostr);
+
+  return 0;
+}
+
+
+/*
+ * rasqal_path_print:
+ * @path: #rasqal_path object
+ * @fh: The FILE* handle to print to.
+ *
+ * INTERNAL - Print a property path in a debug format.
+ *
+ * The print debug format may change in any release.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_path_print(rasqal_path* path, FILE* fh)
+{
+  if(!path || !fh)
+    return 1;
+
+  if(path->op == RASQAL_PATH_OPERATOR_LINK) {
+    rasqal_literal_print(path->iri, fh);
+    return 0;
+  }
+
+  fputs(rasqal_path_operator_labels[path->op], fh);
+  fputc('(', fh);
+  rasqal_path_print(path->path1, fh);
+  if(path->path2) {
+    fputs(", ", fh);
+    rasqal_path_print(path->path2, fh);
+  }
+  fputc(')', fh);
+
+  return 0;
+}
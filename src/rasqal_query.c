@@ -245,6 +245,25 @@ rasqal_free_query(rasqal_query* query)
   if(query->projection)
     rasqal_free_projection(query->projection);
   
+  if(query->algebra_node)
+    rasqal_free_algebra_node(query->algebra_node);
+
+  if(query->agg_exprs)
+    raptor_free_sequence(query->agg_exprs);
+
+  if(query->prebound_values) {
+    int i;
+
+    for(i = 0; i < query->prebound_values_count; i++) {
+      if(query->prebound_values[i])
+        rasqal_free_literal(query->prebound_values[i]);
+    }
+    RASQAL_FREE(rasqal_literal**, query->prebound_values);
+  }
+
+  if(query->agg_vars)
+    raptor_free_sequence(query->agg_vars);
+
   RASQAL_FREE(rasqal_query, query);
 }
 
@@ -457,6 +476,8 @@ rasqal_query_set_distinct(rasqal_query* query, int distinct_mode)
       return;
   }
   query->projection->distinct = distinct_mode;
+
+  rasqal_query_reset_algebra(query);
 }
 
 
@@ -534,6 +555,8 @@ rasqal_query_set_limit(rasqal_query* query, int limit)
 
   if(query->modifier)
     query->modifier->limit = limit;
+
+  rasqal_query_reset_algebra(query);
 }
 
 
@@ -577,6 +600,8 @@ rasqal_query_set_offset(rasqal_query* query, int offset)
 
   if(query->modifier)
     query->modifier->offset = offset;
+
+  rasqal_query_reset_algebra(query);
 }
 
 
@@ -597,6 +622,10 @@ rasqal_query_add_data_graph(rasqal_query* query, rasqal_data_graph* data_graph)
 
   if(raptor_sequence_push(query->data_graphs, (void*)data_graph))
     return 1;
+
+  /* GRAPH <uri> evaluation depends on the named graphs in the dataset */
+  rasqal_query_reset_algebra(query);
+
   return 0;
 }
 
@@ -625,6 +654,8 @@ rasqal_query_add_data_graphs(rasqal_query* query,
   rc = raptor_sequence_join(query->data_graphs, data_graphs);
   raptor_free_sequence(data_graphs);
 
+  rasqal_query_reset_algebra(query);
+
   return rc;
 }
 
@@ -674,6 +705,9 @@ rasqal_query_get_data_graph(rasqal_query* query, int idx)
  *
  * Test if the query dataset contains a named graph
  *
+ * The named graphs are the named data graphs and the graphs of any
+ * quads in data graphs made by rasqal_new_data_graph_from_triples().
+ *
  * Return value: non-0 if the dataset contains a named graph
  */
 int
@@ -688,7 +722,7 @@ rasqal_query_dataset_contains_named_graph(rasqal_query* query,
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(graph_uri, raptor_uri, 1);
 
   for(idx = 0; (dg = rasqal_query_get_data_graph(query, idx)); idx++) {
-    if(dg->name_uri && raptor_uri_equals(dg->name_uri, graph_uri)) {
+    if(rasqal_data_graph_has_graph_name(dg, graph_uri)) {
       /* graph_uri is a graph name in the dataset */
       found = 1;
       break;
@@ -897,11 +931,48 @@ rasqal_query_set_variable2(rasqal_query* query,
                            const unsigned char *name,
                            rasqal_literal* value)
 {
+  rasqal_variable* v;
+  int size;
+  int i;
+
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(query, rasqal_query, 1);
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(name, char*, 1);
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(value, rasqal_literal, 1);
 
-  return rasqal_variables_table_set(query->vars_table, type, name, value);
+  v = rasqal_variables_table_get_by_name(query->vars_table, type, name);
+  if(!v)
+    return 1;
+
+  /* remember the value so each execution starts with it */
+  size = rasqal_variables_table_get_total_variables_count(query->vars_table);
+  if(query->prebound_values_count < size) {
+    rasqal_literal** values;
+
+    values = RASQAL_CALLOC(rasqal_literal**, RASQAL_GOOD_CAST(size_t, size),
+                           sizeof(rasqal_literal*));
+    if(!values)
+      return 1;
+
+    if(query->prebound_values) {
+      memcpy(values, query->prebound_values,
+             RASQAL_GOOD_CAST(size_t, query->prebound_values_count) * sizeof(rasqal_literal*));
+      RASQAL_FREE(rasqal_literal**, query->prebound_values);
+    }
+    query->prebound_values = values;
+    query->prebound_values_count = size;
+  }
+
+  for(i = 0; i < size; i++) {
+    if(rasqal_variables_table_get(query->vars_table, i) == v) {
+      if(query->prebound_values[i])
+        rasqal_free_literal(query->prebound_values[i]);
+      query->prebound_values[i] = rasqal_new_literal_from_literal(value);
+      break;
+    }
+  }
+
+  rasqal_variable_set_value(v, value);
+  return 0;
 }
 
 
@@ -1387,6 +1458,16 @@ rasqal_query_execute_with_engine(rasqal_query* query,
  *
  * Excute a query - run and return results.
  *
+ * A query may be executed again while results of an earlier
+ * execution are still being read.  Each #rasqal_query_results keeps
+ * its own variable bindings and NOW() time so their rows can be read
+ * in any interleaved order.
+ *
+ * Thread safety: a #rasqal_world and every object made from it,
+ * including queries and query results, must only be used from one
+ * thread at a time.  Separate worlds may be used from different
+ * threads at the same time.
+ *
  * return value: a #rasqal_query_results structure or NULL on failure.
  **/
 rasqal_query_results*
@@ -2205,6 +2286,58 @@ rasqal_query_get_bindings_row(rasqal_query* query, int idx)
 }
 
 
+/**
+ * rasqal_query_set_bindings_rows:
+ * @query: #rasqal_query query object
+ * @rows: sequence of #rasqal_row (or NULL for no rows)
+ *
+ * Replace the rows of the query VALUES (BINDINGS) block
+ *
+ * Each row must have one value (or NULL for UNDEF) for each variable
+ * in rasqal_query_get_bindings_variables_sequence().  The @rows
+ * sequence becomes owned by the query.
+ *
+ * The query algebra built by a previous execution shares the VALUES
+ * block so the next rasqal_query_execute() uses the new rows without
+ * preparing the query again.  This allows a query template with a
+ * VALUES block to be prepared once and executed with different
+ * parameter values.  Each execution takes its own references to the
+ * rows when it starts, so results that are still being read keep
+ * the rows they were executed with.
+ *
+ * Return value: non-0 on failure such as there being no VALUES block or a row of the wrong size
+ **/
+int
+rasqal_query_set_bindings_rows(rasqal_query* query, raptor_sequence* rows)
+{
+  int size;
+  int i;
+  rasqal_row* row;
+
+  RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(query, rasqal_query, 1);
+
+  if(!query->bindings || !query->bindings->variables)
+    goto fail;
+
+  size = raptor_sequence_size(query->bindings->variables);
+  for(i = 0; rows && (row = (rasqal_row*)raptor_sequence_get_at(rows, i)); i++) {
+    if(row->size != size)
+      goto fail;
+  }
+
+  if(query->bindings->rows)
+    raptor_free_sequence(query->bindings->rows);
+  query->bindings->rows = rows;
+
+  return 0;
+
+  fail:
+  if(rows)
+    raptor_free_sequence(rows);
+  return 1;
+}
+
+
 /*
  * rasqal_query_variable_bound_in_triple:
  * @query: #rasqal_query query object
@@ -2405,3 +2538,54 @@ rasqal_query_set_modifier(rasqal_query* query,
   
   return 0;
 }
+
+
+/*
+ * rasqal_query_reset_variable_values:
+ * @query: #rasqal_query
+ *
+ * INTERNAL - Set the query variables to the values an execution starts with
+ *
+ * These are the values given with rasqal_query_set_variable2() or
+ * else no value.
+ **/
+void
+rasqal_query_reset_variable_values(rasqal_query* query)
+{
+  int size;
+  int i;
+
+  size = rasqal_variables_table_get_total_variables_count(query->vars_table);
+  for(i = 0; i < size; i++) {
+    rasqal_variable* v;
+    rasqal_literal* value = NULL;
+
+    v = rasqal_variables_table_get(query->vars_table, i);
+    if(!v)
+      continue;
+
+    if(i < query->prebound_values_count && query->prebound_values[i])
+      value = rasqal_new_literal_from_literal(query->prebound_values[i]);
+
+    rasqal_variable_set_value(v, value);
+  }
+}
+
+
+/*
+ * rasqal_query_reset_algebra:
+ * @query: #rasqal_query
+ *
+ * INTERNAL - Discard the query algebra saved by a previous execution
+ *
+ * Used when a query part that the algebra was built from is changed
+ * so that the next execution builds it again.
+ **/
+void
+rasqal_query_reset_algebra(rasqal_query* query)
+{
+  if(query->algebra_node) {
+    rasqal_free_algebra_node(query->algebra_node);
+    query->algebra_node = NULL;
+  }
+}
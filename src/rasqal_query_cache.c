@@ -0,0 +1,658 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_query_cache.c - Rasqal world cache of prepared queries
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+
+/*
+ * rasqal_query_cache_entry:
+ * @key: normalized query text with language name and base URI prefix
+ * @key_len: length of @key
+ * @hash: hash of @key for quick rejection
+ * @query: prepared query (one reference owned by the cache)
+ * @limit: limit after preparing
+ * @offset: offset after preparing
+ * @distinct: distinct mode after preparing
+ * @explain: explain flag after preparing
+ * @store_results: store results flag after preparing
+ * @data_graphs_count: number of data graphs (FROM) after preparing
+ * @bindings_rows: VALUES rows after preparing (or NULL)
+ * @prebound_values: values set by rasqal_query_set_variable2() after
+ *   preparing by variables table index (or NULL)
+ * @prebound_values_count: size of @prebound_values
+ * @features: query features after preparing
+ *
+ * INTERNAL - one prepared query held in the world query cache
+ *
+ * The state a caller can change on the query is saved after
+ * preparing so it can be put back before the query is given to the
+ * next caller.
+ */
+typedef struct {
+  unsigned char* key;
+  size_t key_len;
+  unsigned long hash;
+  rasqal_query* query;
+
+  int limit;
+  int offset;
+  int distinct;
+  int explain;
+  int store_results;
+  int data_graphs_count;
+  raptor_sequence* bindings_rows;
+  rasqal_literal** prebound_values;
+  int prebound_values_count;
+  int features[RASQAL_FEATURE_LAST + 1];
+} rasqal_query_cache_entry;
+
+
+static void
+rasqal_free_query_cache_entry(rasqal_query_cache_entry* entry)
+{
+  if(!entry)
+    return;
+
+  if(entry->key)
+    RASQAL_FREE(char*, entry->key);
+
+  if(entry->query)
+    rasqal_free_query(entry->query);
+
+  if(entry->bindings_rows)
+    raptor_free_sequence(entry->bindings_rows);
+
+  if(entry->prebound_values) {
+    int i;
+
+    for(i = 0; i < entry->prebound_values_count; i++) {
+      if(entry->prebound_values[i])
+        rasqal_free_literal(entry->prebound_values[i]);
+    }
+    RASQAL_FREE(rasqal_literal**, entry->prebound_values);
+  }
+
+  RASQAL_FREE(rasqal_query_cache_entry, entry);
+}
+
+
+/* Copy a sequence of #rasqal_row as new row references */
+static raptor_sequence*
+rasqal_query_cache_copy_rows(raptor_sequence* rows)
+{
+  raptor_sequence* new_rows;
+  rasqal_row* row;
+  int i;
+
+  new_rows = raptor_new_sequence((raptor_data_free_handler)rasqal_free_row,
+                                 (raptor_data_print_handler)rasqal_row_print);
+  if(!new_rows)
+    return NULL;
+
+  for(i = 0; (row = (rasqal_row*)raptor_sequence_get_at(rows, i)); i++) {
+    if(raptor_sequence_push(new_rows, rasqal_new_row_from_row(row))) {
+      raptor_free_sequence(new_rows);
+      return NULL;
+    }
+  }
+
+  return new_rows;
+}
+
+
+/*
+ * rasqal_query_cache_save_state:
+ * @entry: cache entry
+ *
+ * INTERNAL - Save the state of a newly prepared query that callers can change
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_query_cache_save_state(rasqal_query_cache_entry* entry)
+{
+  rasqal_query* query = entry->query;
+
+  entry->limit = rasqal_query_get_limit(query);
+  entry->offset = rasqal_query_get_offset(query);
+  entry->distinct = rasqal_query_get_distinct(query);
+  entry->explain = rasqal_query_get_explain(query);
+  entry->store_results = query->store_results;
+  entry->data_graphs_count = query->data_graphs ?
+    raptor_sequence_size(query->data_graphs) : 0;
+  memcpy(entry->features, query->features, sizeof(entry->features));
+
+  if(query->bindings && query->bindings->rows) {
+    entry->bindings_rows = rasqal_query_cache_copy_rows(query->bindings->rows);
+    if(!entry->bindings_rows)
+      return 1;
+  }
+
+  if(query->prebound_values) {
+    int i;
+
+    entry->prebound_values = RASQAL_CALLOC(rasqal_literal**,
+                                           RASQAL_GOOD_CAST(size_t, query->prebound_values_count),
+                                           sizeof(rasqal_literal*));
+    if(!entry->prebound_values)
+      return 1;
+    entry->prebound_values_count = query->prebound_values_count;
+
+    for(i = 0; i < query->prebound_values_count; i++)
+      entry->prebound_values[i] = rasqal_new_literal_from_literal(query->prebound_values[i]);
+  }
+
+  return 0;
+}
+
+
+/*
+ * rasqal_query_cache_restore_state:
+ * @entry: cache entry
+ *
+ * INTERNAL - Undo changes made by the previous caller of a cached query
+ *
+ * Only parts that differ are set again so that the query algebra
+ * saved by earlier executions is kept when nothing changed.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_query_cache_restore_state(rasqal_query_cache_entry* entry)
+{
+  rasqal_query* query = entry->query;
+
+  if(rasqal_query_get_limit(query) != entry->limit)
+    rasqal_query_set_limit(query, entry->limit);
+  if(rasqal_query_get_offset(query) != entry->offset)
+    rasqal_query_set_offset(query, entry->offset);
+  if(rasqal_query_get_distinct(query) != entry->distinct)
+    rasqal_query_set_distinct(query, entry->distinct);
+  rasqal_query_set_explain(query, entry->explain);
+  query->store_results = entry->store_results;
+  memcpy(query->features, entry->features, sizeof(entry->features));
+  query->user_data = NULL;
+
+  if(query->data_graphs &&
+     raptor_sequence_size(query->data_graphs) > entry->data_graphs_count) {
+    while(raptor_sequence_size(query->data_graphs) > entry->data_graphs_count) {
+      rasqal_data_graph* dg;
+
+      dg = (rasqal_data_graph*)raptor_sequence_pop(query->data_graphs);
+      rasqal_free_data_graph(dg);
+    }
+    rasqal_query_reset_algebra(query);
+  }
+
+  if(query->bindings) {
+    raptor_sequence* rows = query->bindings->rows;
+    int size = entry->bindings_rows ? raptor_sequence_size(entry->bindings_rows) : 0;
+    int same = ((rows ? raptor_sequence_size(rows) : 0) == size);
+    int i;
+
+    for(i = 0; same && i < size; i++) {
+      if(raptor_sequence_get_at(rows, i) !=
+         raptor_sequence_get_at(entry->bindings_rows, i))
+        same = 0;
+    }
+
+    if(!same) {
+      rows = NULL;
+      if(entry->bindings_rows) {
+        rows = rasqal_query_cache_copy_rows(entry->bindings_rows);
+        if(!rows)
+          return 1;
+      }
+      if(rasqal_query_set_bindings_rows(query, rows))
+        return 1;
+    }
+  }
+
+  /* the pre-bound values array only grows so it is at least as big
+   * as the saved one */
+  if(query->prebound_values) {
+    int changed = 0;
+    int i;
+
+    for(i = 0; i < query->prebound_values_count; i++) {
+      rasqal_literal* value = NULL;
+
+      if(i < entry->prebound_values_count)
+        value = entry->prebound_values[i];
+
+      if(query->prebound_values[i] != value) {
+        if(query->prebound_values[i])
+          rasqal_free_literal(query->prebound_values[i]);
+        query->prebound_values[i] = rasqal_new_literal_from_literal(value);
+        changed = 1;
+      }
+    }
+
+    if(changed)
+      rasqal_query_reset_variable_values(query);
+  }
+
+  return 0;
+}
+
+
+/*
+ * rasqal_query_cache_copy_normalized:
+ * @dest: destination buffer (or NULL to only count)
+ * @src: query string
+ *
+ * INTERNAL - Copy a query string collapsing insignificant whitespace
+ *
+ * Runs of whitespace and '#' comments outside string literals and
+ * IRIs are turned into a single space and leading and trailing
+ * whitespace is removed.  Text inside quoted strings, IRIs and
+ * backslash escapes is copied unchanged so that two different
+ * queries never normalize to the same text.
+ *
+ * Return value: length of normalized string
+ */
+static size_t
+rasqal_query_cache_copy_normalized(unsigned char* dest,
+                                   const unsigned char* src)
+{
+  const unsigned char* p = src;
+  size_t len = 0;
+  int pending_space = 0;
+
+#define RQC_IS_SPACE(c) ((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\n')
+#define RQC_EMIT(c) do { if(dest) dest[len] = (c); len++; } while(0)
+
+  while(*p) {
+    unsigned char c = *p;
+
+    if(RQC_IS_SPACE(c)) {
+      pending_space = 1;
+      p++;
+      continue;
+    }
+
+    if(c == '#') {
+      /* comment to end of line */
+      while(*p && *p != '\n' && *p != '\r')
+        p++;
+      pending_space = 1;
+      continue;
+    }
+
+    if(pending_space && len > 0)
+      RQC_EMIT(' ');
+    pending_space = 0;
+
+    if(c == '\\') {
+      RQC_EMIT(c);
+      p++;
+      if(*p)
+        RQC_EMIT(*p++);
+      continue;
+    }
+
+    if(c == '"' || c == '\'') {
+      /* string literal, possibly long ('''...''' or """...""") */
+      int long_string = (p[1] == c && p[2] == c);
+      int quotes = long_string ? 3 : 1;
+      int i;
+
+      for(i = 0; i < quotes; i++)
+        RQC_EMIT(*p++);
+
+      while(*p) {
+        if(*p == '\\') {
+          RQC_EMIT(*p++);
+          if(*p)
+            RQC_EMIT(*p++);
+          continue;
+        }
+        if(*p == c && (!long_string || (p[1] == c && p[2] == c))) {
+          for(i = 0; i < quotes; i++)
+            RQC_EMIT(*p++);
+          break;
+        }
+        RQC_EMIT(*p++);
+      }
+      continue;
+    }
+
+    if(c == '<') {
+      /* IRIREF cannot contain whitespace, quotes or '<' so anything
+       * else is the less-than operator
+       */
+      const unsigned char* q = p + 1;
+      while(*q && *q != '>' && *q != '<' && *q != '"' && *q != '\'' &&
+            !RQC_IS_SPACE(*q))
+        q++;
+
+      if(*q == '>') {
+        while(p <= q)
+          RQC_EMIT(*p++);
+        continue;
+      }
+    }
+
+    RQC_EMIT(c);
+    p++;
+  }
+
+#undef RQC_EMIT
+#undef RQC_IS_SPACE
+
+  return len;
+}
+
+
+/*
+ * rasqal_query_cache_make_key:
+ * @name: query language name (or NULL)
+ * @uri: query language URI (or NULL)
+ * @query_string: query string
+ * @base_uri: base URI (or NULL)
+ * @len_p: pointer to store key length
+ *
+ * INTERNAL - Make a query cache key
+ *
+ * The key is the language name or URI, the base URI and the
+ * normalized query string separated by newlines.
+ *
+ * Return value: new key string or NULL on failure
+ */
+static unsigned char*
+rasqal_query_cache_make_key(const char* name, const unsigned char* uri,
+                            const unsigned char* query_string,
+                            raptor_uri* base_uri, size_t* len_p)
+{
+  const unsigned char* lang;
+  const unsigned char* base = NULL;
+  size_t lang_len;
+  size_t base_len = 0;
+  size_t query_len;
+  unsigned char* key;
+  unsigned char* p;
+
+  lang = name ? RASQAL_GOOD_CAST(const unsigned char*, name) : uri;
+  lang_len = lang ? strlen(RASQAL_GOOD_CAST(const char*, lang)) : 0;
+
+  if(base_uri)
+    base = raptor_uri_as_counted_string(base_uri, &base_len);
+
+  query_len = rasqal_query_cache_copy_normalized(NULL, query_string);
+
+  key = RASQAL_MALLOC(unsigned char*, lang_len + base_len + query_len + 3);
+  if(!key)
+    return NULL;
+
+  p = key;
+  if(lang_len) {
+    memcpy(p, lang, lang_len);
+    p += lang_len;
+  }
+  *p++ = '\n';
+  if(base_len) {
+    memcpy(p, base, base_len);
+    p += base_len;
+  }
+  *p++ = '\n';
+  p += rasqal_query_cache_copy_normalized(p, query_string);
+  *p = '\0';
+
+  *len_p = RASQAL_GOOD_CAST(size_t, p - key);
+
+  return key;
+}
+
+
+/* djb2 string hash */
+static unsigned long
+rasqal_query_cache_hash(const unsigned char* key, size_t len)
+{
+  unsigned long hash = 5381;
+
+  while(len--)
+    hash = ((hash << 5) + hash) + *key++;
+
+  return hash;
+}
+
+
+/*
+ * rasqal_query_cache_trim:
+ * @world: world object
+ * @size: maximum number of entries to keep
+ *
+ * INTERNAL - Remove least recently used entries beyond @size
+ */
+static void
+rasqal_query_cache_trim(rasqal_world* world, int size)
+{
+  if(!world->query_cache)
+    return;
+
+  while(raptor_sequence_size(world->query_cache) > size) {
+    rasqal_query_cache_entry* entry;
+
+    /* least recently used entry is at the start */
+    entry = (rasqal_query_cache_entry*)raptor_sequence_unshift(world->query_cache);
+    rasqal_free_query_cache_entry(entry);
+  }
+}
+
+
+/**
+ * rasqal_world_set_query_cache_size:
+ * @world: rasqal_world object
+ * @size: maximum number of prepared queries to keep (0 to disable)
+ *
+ * Set the size of the world cache of prepared queries.
+ *
+ * The cache is used by rasqal_world_get_prepared_query() and holds
+ * up to @size prepared queries, discarding the least recently used
+ * query when full.  Reducing the size discards entries immediately.
+ * The default size is 64.
+ *
+ * Return value: non-0 on failure
+ **/
+int
+rasqal_world_set_query_cache_size(rasqal_world* world, int size)
+{
+  RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(world, rasqal_world, 1);
+
+  if(size < 0)
+    return 1;
+
+  world->query_cache_size = size;
+  rasqal_query_cache_trim(world, size);
+
+  return 0;
+}
+
+
+/**
+ * rasqal_world_get_prepared_query:
+ * @world: rasqal_world object
+ * @name: the query language name (or NULL)
+ * @uri: #raptor_uri language uri (or NULL)
+ * @query_string: the query string
+ * @base_uri: base URI of query string (optional)
+ *
+ * Get a prepared query from the world query cache, preparing it on a miss.
+ *
+ * Queries are looked up by the query language, base URI and the
+ * query text with insignificant whitespace and comments removed.
+ * On a cache miss a new query is made with rasqal_new_query() and
+ * prepared with rasqal_query_prepare() and, if that succeeds, added
+ * to the cache.  The query algebra is built on the first execution
+ * and reused by all later executions of the same query object.
+ *
+ * The returned query belongs to the caller until it is released
+ * with rasqal_free_query(); a cached query is only returned when no
+ * other caller holds it, otherwise a new uncached query is prepared.
+ * Before a cached query is returned, the limit, offset, distinct
+ * mode, explain flag, features, user data, added data graphs and
+ * VALUES rows are put back to how they were after preparing so
+ * nothing set by an earlier caller is seen.
+ * Per-execution parameter values can be supplied through a VALUES
+ * block in the query text and replaced before each execution with
+ * rasqal_query_set_bindings_rows() without re-preparing the query.
+ *
+ * Return value: a prepared #rasqal_query or NULL on failure
+ **/
+rasqal_query*
+rasqal_world_get_prepared_query(rasqal_world* world,
+                                const char* name, const unsigned char* uri,
+                                const unsigned char* query_string,
+                                raptor_uri* base_uri)
+{
+  unsigned char* key;
+  size_t key_len = 0;
+  unsigned long hash;
+  rasqal_query* query = NULL;
+  rasqal_query_cache_entry* entry = NULL;
+  int i;
+
+  RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(world, rasqal_world, NULL);
+  RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(query_string, char*, NULL);
+
+  key = rasqal_query_cache_make_key(name, uri, query_string, base_uri,
+                                    &key_len);
+  if(!key)
+    return NULL;
+
+  hash = rasqal_query_cache_hash(key, key_len);
+
+  if(world->query_cache) {
+    for(i = 0;
+        (entry = (rasqal_query_cache_entry*)raptor_sequence_get_at(world->query_cache, i));
+        i++) {
+      if(entry->hash != hash || entry->key_len != key_len ||
+         memcmp(entry->key, key, key_len))
+        continue;
+
+      /* move to most recently used position at the end */
+      raptor_sequence_delete_at(world->query_cache, i);
+      if(raptor_sequence_push(world->query_cache, entry)) {
+        RASQAL_FREE(char*, key);
+        return NULL;
+      }
+
+      if(entry->query->usage > 1) {
+        /* held by another caller: prepare a separate query below */
+        RASQAL_DEBUG2("query cache entry %d is in use\n", i);
+        break;
+      }
+
+      RASQAL_DEBUG2("query cache hit for entry %d\n", i);
+      RASQAL_FREE(char*, key);
+
+      if(rasqal_query_cache_restore_state(entry))
+        return NULL;
+
+      entry->query->usage++;
+      return entry->query;
+    }
+  }
+
+  query = rasqal_new_query(world, name, uri);
+  if(!query)
+    goto fail;
+
+  if(rasqal_query_prepare(query, query_string, base_uri))
+    goto fail;
+
+  if(world->query_cache_size <= 0 || entry) {
+    /* caching disabled or the cached query is in use */
+    RASQAL_FREE(char*, key);
+    return query;
+  }
+
+  if(!world->query_cache) {
+    world->query_cache = raptor_new_sequence((raptor_data_free_handler)rasqal_free_query_cache_entry, NULL);
+    if(!world->query_cache)
+      goto fail;
+  }
+
+  rasqal_query_cache_trim(world, world->query_cache_size - 1);
+
+  entry = RASQAL_CALLOC(rasqal_query_cache_entry*, 1, sizeof(*entry));
+  if(!entry)
+    goto fail;
+
+  entry->key = key;
+  entry->key_len = key_len;
+  entry->hash = hash;
+  entry->query = query;
+  key = NULL;
+
+  if(rasqal_query_cache_save_state(entry)) {
+    /* entry owns query now */
+    query = NULL;
+    rasqal_free_query_cache_entry(entry);
+    goto fail;
+  }
+
+  /* sequence owns entry and the query reference in it */
+  if(raptor_sequence_push(world->query_cache, entry))
+    return NULL;
+
+  query->usage++;
+  return query;
+
+  fail:
+  if(key)
+    RASQAL_FREE(char*, key);
+  if(query)
+    rasqal_free_query(query);
+
+  return NULL;
+}
+
+
+/*
+ * rasqal_world_query_cache_finish:
+ * @world: rasqal_world object
+ *
+ * INTERNAL - Free all cached prepared queries
+ */
+void
+rasqal_world_query_cache_finish(rasqal_world* world)
+{
+  if(world->query_cache) {
+    raptor_free_sequence(world->query_cache);
+    world->query_cache = NULL;
+  }
+}
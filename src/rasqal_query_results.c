@@ -159,6 +159,15 @@ struct rasqal_query_results_s {
 
   /* non-0 if @vars_table has been initialized from first row */
   int vars_table_init;
+
+  /* execution state saved while another execution is active:
+   * query variable values (array of size @saved_values_count) and
+   * the NOW() time of this execution
+   */
+  rasqal_literal** saved_values;
+  int saved_values_count;
+  struct timeval saved_now;
+  int saved_now_set;
 };
     
 
@@ -344,6 +353,114 @@ rasqal_new_query_results_from_string(rasqal_world* world,
 }
 
 
+/*
+ * rasqal_query_results_save_state:
+ * @query_results: query results
+ *
+ * INTERNAL - Save the execution state held in the query variables
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_query_results_save_state(rasqal_query_results* query_results)
+{
+  rasqal_query* query = query_results->query;
+  int size;
+  int i;
+
+  size = rasqal_variables_table_get_total_variables_count(query->vars_table);
+
+  if(query_results->saved_values && query_results->saved_values_count < size) {
+    RASQAL_FREE(rasqal_literal**, query_results->saved_values);
+    query_results->saved_values = NULL;
+  }
+
+  if(!query_results->saved_values) {
+    query_results->saved_values = RASQAL_CALLOC(rasqal_literal**,
+                                                RASQAL_GOOD_CAST(size_t, size ? size : 1),
+                                                sizeof(rasqal_literal*));
+    if(!query_results->saved_values)
+      return 1;
+  }
+
+  query_results->saved_values_count = size;
+
+  for(i = 0; i < size; i++) {
+    rasqal_variable* v;
+
+    v = rasqal_variables_table_get(query->vars_table, i);
+    query_results->saved_values[i] = (v && v->value) ?
+      rasqal_new_literal_from_literal(v->value) : NULL;
+  }
+
+  return 0;
+}
+
+
+/*
+ * rasqal_query_results_activate:
+ * @query_results: query results
+ *
+ * INTERNAL - Make this execution the one using the query variables and NOW()
+ *
+ * Executions keep their variable bindings in the shared query
+ * variables and the NOW() time in the world.  When the query or the
+ * world was last used by another execution, save its state there
+ * and restore this one so that interleaved executions of the same
+ * or different queries do not see each other's bindings.  An
+ * execution with no saved state starts from the pre-bound values.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_query_results_activate(rasqal_query_results* query_results)
+{
+  rasqal_query* query = query_results->query;
+  rasqal_world* world = query_results->world;
+  rasqal_query_results* active;
+  int i;
+
+  if(!query)
+    return 0;
+
+  active = query->active_results;
+  if(active != query_results) {
+    if(active && rasqal_query_results_save_state(active))
+      return 1;
+
+    if(query_results->saved_values) {
+      for(i = 0; i < query_results->saved_values_count; i++) {
+        rasqal_variable* v;
+
+        v = rasqal_variables_table_get(query->vars_table, i);
+        if(v)
+          rasqal_variable_set_value(v, query_results->saved_values[i]);
+        else if(query_results->saved_values[i])
+          rasqal_free_literal(query_results->saved_values[i]);
+        query_results->saved_values[i] = NULL;
+      }
+    } else
+      rasqal_query_reset_variable_values(query);
+
+    query->active_results = query_results;
+  }
+
+  active = world->now_results;
+  if(active != query_results) {
+    if(active) {
+      active->saved_now = world->now;
+      active->saved_now_set = world->now_set;
+    }
+
+    world->now = query_results->saved_now;
+    world->now_set = query_results->saved_now_set ? 1 : 0;
+    world->now_results = query_results;
+  }
+
+  return 0;
+}
+
+
 /**
  * rasqal_query_results_execute_with_engine:
  * @query_results: the #rasqal_query_results object
@@ -376,10 +493,14 @@ rasqal_query_results_execute_with_engine(rasqal_query_results* query_results,
   /* set executed flag early to enable cleanup on error */
   query_results->executed = 1;
 
-  /* ensure stored results are present if ordering or distincting are being done */
+  if(rasqal_query_results_activate(query_results))
+    return 1;
+
+  /* ensure stored results are present if ordering or distincting
+   * are being done; REDUCED streams through its recent rows cache */
   query_results->store_results = (store_results ||
                                   rasqal_query_get_order_conditions_sequence(query) ||
-                                  rasqal_query_get_distinct(query));
+                                  rasqal_query_get_distinct(query) == RASQAL_PROJECTION_DISTINCT);
   
   ex_data_size = query_results->execution_factory->execution_data_size;
   if(ex_data_size > 0) {
@@ -462,8 +583,25 @@ rasqal_free_query_results(rasqal_query_results* query_results)
   if(query_results->vars_table)
     rasqal_free_variables_table(query_results->vars_table);
 
-  if(query)
+  if(query_results->saved_values) {
+    int i;
+
+    for(i = 0; i < query_results->saved_values_count; i++) {
+      if(query_results->saved_values[i])
+        rasqal_free_literal(query_results->saved_values[i]);
+    }
+    RASQAL_FREE(rasqal_literal**, query_results->saved_values);
+  }
+
+  if(query_results->world->now_results == query_results)
+    query_results->world->now_results = NULL;
+
+  if(query) {
+    if(query->active_results == query_results)
+      query->active_results = NULL;
+
     rasqal_query_remove_query_result(query, query_results);
+  }
 
   RASQAL_FREE(rasqal_query_results, query_results);
 }
@@ -765,6 +903,11 @@ rasqal_query_results_ensure_have_row_internal(rasqal_query_results* query_result
             query_results->execution_factory->get_row) {
     rasqal_engine_error execution_error = RASQAL_ENGINE_OK;
 
+    if(rasqal_query_results_activate(query_results)) {
+      query_results->failed = 1;
+      return 1;
+    }
+
     /* handle limit/offset for incremental get_row() */
     while(1) {
       int check;
@@ -1661,6 +1804,9 @@ rasqal_query_results_execute_and_store_results(rasqal_query_results* query_resul
 
   if(query_results->execution_factory->get_all_rows) {
     rasqal_engine_error execution_error = RASQAL_ENGINE_OK;
+
+    if(rasqal_query_results_activate(query_results))
+      return 1;
     
     seq = query_results->execution_factory->get_all_rows(query_results->execution_data, &execution_error);
     if(execution_error == RASQAL_ENGINE_FAILED)
@@ -1678,6 +1824,30 @@ rasqal_query_results_execute_and_store_results(rasqal_query_results* query_resul
 }
 
 
+/*
+ * rasqal_query_results_ensure_stored:
+ * @query_results: query results object
+ *
+ * INTERNAL - Store all rows of executed query results if not already stored
+ *
+ * Fails if rows have already been read one at a time since those
+ * cannot be stored any more.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_query_results_ensure_stored(rasqal_query_results* query_results)
+{
+  if(query_results->results_sequence || !query_results->execution_factory)
+    return 0;
+
+  if(query_results->result_count > 0 || query_results->row)
+    return 1;
+
+  return rasqal_query_results_execute_and_store_results(query_results);
+}
+
+
 /*
  * rasqal_query_results_update_query_bindings:
  * @query_results: query results to read from
@@ -1888,22 +2058,22 @@ rasqal_query_results_sort(rasqal_query_results* query_results)
   if(query_results->results_sequence) {
     int size = raptor_sequence_size(query_results->results_sequence);
     if(size > 1) {
-#if RAPTOR_VERSION < 20015
       raptor_sequence *seq;
       void** array;
       size_t i;
 
-      seq = raptor_new_sequence((raptor_data_free_handler)rasqal_free_row, (raptor_data_print_handler)rasqal_row_print);
-      if(!seq) {
+      /* stable sort so rows that compare equal keep their order */
+      array = rasqal_sequence_as_sorted(query_results->results_sequence,
+                                        rasqal_query_results_sort_compare_row,
+                                        &rqr);
+      if(!array) {
         RASQAL_FREE(int*, rqr.order);
         return 1;
       }
 
-      array = rasqal_sequence_as_sorted(seq,
-                                        rasqal_query_results_sort_compare_row,
-                                        &rqr);
-      if(!array) {
-        raptor_free_sequence(seq);
+      seq = raptor_new_sequence((raptor_data_free_handler)rasqal_free_row, (raptor_data_print_handler)rasqal_row_print);
+      if(!seq) {
+        RASQAL_FREE(void*, array);
         RASQAL_FREE(int*, rqr.order);
         return 1;
       }
@@ -1915,11 +2085,6 @@ rasqal_query_results_sort(rasqal_query_results* query_results)
       raptor_free_sequence(query_results->results_sequence);
       query_results->results_sequence = seq;
       RASQAL_FREE(void*, array);
-#else
-      raptor_sequence_sort_r(query_results->results_sequence,
-                             rasqal_query_results_sort_compare_row,
-                             &rqr);
-#endif
     }
   }
   
@@ -48,11 +48,102 @@
          FROM <%s> \
          WHERE \
          { $person $x foaf:Person }"
+#define AGG_QUERY_FORMAT "PREFIX foaf: <http://xmlns.com/foaf/0.1/> \
+         SELECT (COUNT($person) AS $count) \
+         FROM <%s> \
+         WHERE \
+         { $person $x foaf:Person }"
+#define ALL_QUERY_FORMAT "SELECT $s $p $o \
+         FROM <%s> \
+         WHERE \
+         { $s $p $o }"
+/* the UNION uses $o bound by the left triple pattern */
+#define UNION_QUERY_FORMAT "SELECT $o $x \
+         FROM <%s> \
+         WHERE \
+         { $s $p $o . { $o $q $x } UNION { $x $r $o } }"
+#define VALUES_QUERY_FORMAT "SELECT $v \
+         FROM <%s> \
+         WHERE \
+         { } \
+         VALUES $v { 1 2 }"
 #else
 #define NO_QUERY_LANGUAGE
 #endif
 
 #define EXPECTED_RESULTS_COUNT 1
+#define EXPECTED_TRIPLES_COUNT 3
+
+
+#ifndef NO_QUERY_LANGUAGE
+/* Execute an aggregate query returning the integer value of the
+ * single result or -1 on failure
+ */
+static int
+query_test_count(rasqal_query* query)
+{
+  rasqal_query_results *results;
+  rasqal_literal *value;
+  int count = -1;
+
+  results = rasqal_query_execute(query);
+  if(!results)
+    return -1;
+
+  if(!rasqal_query_results_finished(results)) {
+    value = rasqal_query_results_get_binding_value(results, 0);
+    if(value && value->type == RASQAL_LITERAL_INTEGER)
+      count = value->value.integer;
+  }
+
+  rasqal_free_query_results(results);
+
+  return count;
+}
+
+
+/* Read the remaining rows of a query result returning how many */
+static int
+query_test_read_rows(rasqal_query_results* results)
+{
+  int count = 0;
+
+  while(!rasqal_query_results_finished(results)) {
+    count++;
+    rasqal_query_results_next(results);
+  }
+
+  return count;
+}
+
+
+/* Make a sequence of one row with one integer value */
+static raptor_sequence*
+query_test_new_integer_rows(rasqal_world* world, int integer)
+{
+  raptor_sequence* rows;
+  rasqal_row* row;
+  rasqal_literal* value;
+
+  rows = raptor_new_sequence((raptor_data_free_handler)rasqal_free_row,
+                             (raptor_data_print_handler)rasqal_row_print);
+  if(!rows)
+    return NULL;
+
+  row = rasqal_new_row_for_size(world, 1);
+  value = rasqal_new_integer_literal(world, RASQAL_LITERAL_INTEGER, integer);
+  if(!row || !value || rasqal_row_set_value_at(row, 0, value) ||
+     raptor_sequence_push(rows, row)) {
+    if(value)
+      rasqal_free_literal(value);
+    raptor_free_sequence(rows);
+    return NULL;
+  }
+  rasqal_free_literal(value);
+
+  return rows;
+}
+#endif
 
 
 #ifdef NO_QUERY_LANGUAGE
@@ -75,6 +166,20 @@ main(int argc, char **argv) {
   const char *query_language_name=QUERY_LANGUAGE;
   const char *query_format=QUERY_FORMAT;
   unsigned char *query_string;
+  unsigned char *query_string2;
+  rasqal_query *query2;
+  unsigned char *agg_query_string;
+  const char *agg_query_format = AGG_QUERY_FORMAT;
+  unsigned char *all_query_string;
+  const char *all_query_format = ALL_QUERY_FORMAT;
+  unsigned char *union_query_string;
+  const char *union_query_format = UNION_QUERY_FORMAT;
+  unsigned char *values_query_string;
+  const char *values_query_format = VALUES_QUERY_FORMAT;
+  raptor_sequence *rows;
+  raptor_uri *none_uri;
+  rasqal_literal *none_value;
+  rasqal_query_results *results2;
   int count;
   rasqal_world *world;
   const char *data_file;
@@ -100,6 +205,30 @@ main(int argc, char **argv) {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wformat-nonliteral"
   sprintf(RASQAL_GOOD_CAST(char*, query_string), query_format, data_string);
+#pragma GCC diagnostic pop
+  agg_query_string = RASQAL_MALLOC(unsigned char*, strlen(RASQAL_GOOD_CAST(const char*, data_string)) + strlen(agg_query_format) + 1);
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+  sprintf(RASQAL_GOOD_CAST(char*, agg_query_string), agg_query_format,
+          data_string);
+#pragma GCC diagnostic pop
+  all_query_string = RASQAL_MALLOC(unsigned char*, strlen(RASQAL_GOOD_CAST(const char*, data_string)) + strlen(all_query_format) + 1);
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+  sprintf(RASQAL_GOOD_CAST(char*, all_query_string), all_query_format,
+          data_string);
+#pragma GCC diagnostic pop
+  union_query_string = RASQAL_MALLOC(unsigned char*, strlen(RASQAL_GOOD_CAST(const char*, data_string)) + strlen(union_query_format) + 1);
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+  sprintf(RASQAL_GOOD_CAST(char*, union_query_string), union_query_format,
+          data_string);
+#pragma GCC diagnostic pop
+  values_query_string = RASQAL_MALLOC(unsigned char*, strlen(RASQAL_GOOD_CAST(const char*, data_string)) + strlen(values_query_format) + 1);
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+  sprintf(RASQAL_GOOD_CAST(char*, values_query_string), values_query_format,
+          data_string);
 #pragma GCC diagnostic pop
   raptor_free_memory(data_string);
   
@@ -121,8 +250,6 @@ main(int argc, char **argv) {
     return(1);
   }
 
-  RASQAL_FREE(char*, query_string);
-
   printf("%s: executing query #1\n", program);
   results=rasqal_query_execute(query);
   if(!results) {
@@ -201,6 +328,240 @@ main(int argc, char **argv) {
 
   rasqal_free_query(query);
 
+  printf("%s: getting cached prepared query\n", program);
+  query = rasqal_world_get_prepared_query(world, query_language_name, NULL,
+                                          query_string, base_uri);
+  if(!query) {
+    fprintf(stderr, "%s: getting cached prepared query FAILED\n", program);
+    return(1);
+  }
+  rasqal_free_query(query);
+
+  /* same query text with different spacing must share the entry */
+  query_string2 = RASQAL_MALLOC(unsigned char*, strlen(RASQAL_GOOD_CAST(const char*, query_string)) + 3);
+  sprintf(RASQAL_GOOD_CAST(char*, query_string2), "\n %s\t",
+          RASQAL_GOOD_CAST(const char*, query_string));
+  query2 = rasqal_world_get_prepared_query(world, query_language_name, NULL,
+                                           query_string2, base_uri);
+  RASQAL_FREE(char*, query_string2);
+  if(query2 != query) {
+    fprintf(stderr, "%s: cached prepared query lookup returned %p, expected %p\n",
+            program, RASQAL_GOOD_CAST(void*, query2),
+            RASQAL_GOOD_CAST(void*, query));
+    return(1);
+  }
+
+  printf("%s: executing cached query\n", program);
+  results = rasqal_query_execute(query2);
+  if(!results) {
+    fprintf(stderr, "%s: cached query execution FAILED\n", program);
+    return(1);
+  }
+  rasqal_free_query_results(results);
+
+  /* a cached query held by one caller is not given to another */
+  query = rasqal_world_get_prepared_query(world, query_language_name, NULL,
+                                          query_string, base_uri);
+  if(!query || query == query2) {
+    fprintf(stderr, "%s: cached prepared query in use was returned again\n",
+            program);
+    return(1);
+  }
+  rasqal_free_query(query);
+
+  /* changes made by one caller are undone for the next */
+  rasqal_query_set_limit(query2, 0);
+  rasqal_free_query(query2);
+
+  query = rasqal_world_get_prepared_query(world, query_language_name, NULL,
+                                          query_string, base_uri);
+  if(query != query2 || rasqal_query_get_limit(query) >= 0) {
+    fprintf(stderr, "%s: cached prepared query kept the previous caller limit\n",
+            program);
+    return(1);
+  }
+
+  /* so are variables bound by one caller */
+  none_uri = raptor_new_uri(world->raptor_world_ptr,
+                            RASQAL_GOOD_CAST(const unsigned char*, "http://example.org/none"));
+  none_value = rasqal_new_uri_literal(world, none_uri);
+  if(!none_value ||
+     rasqal_query_set_variable2(query, RASQAL_VARIABLE_TYPE_NORMAL,
+                                RASQAL_GOOD_CAST(const unsigned char*, "x"),
+                                none_value)) {
+    fprintf(stderr, "%s: binding cached query variable FAILED\n", program);
+    return(1);
+  }
+  rasqal_free_literal(none_value);
+
+  results = rasqal_query_execute(query);
+  count = results ? query_test_read_rows(results) : -1;
+  if(results)
+    rasqal_free_query_results(results);
+  if(count != 0) {
+    fprintf(stderr, "%s: cached query with a bound variable returned %d results, expected 0\n",
+            program, count);
+    return(1);
+  }
+  rasqal_free_query(query);
+
+  query = rasqal_world_get_prepared_query(world, query_language_name, NULL,
+                                          query_string, base_uri);
+  if(query != query2) {
+    fprintf(stderr, "%s: getting cached prepared query FAILED\n", program);
+    return(1);
+  }
+
+  results = rasqal_query_execute(query);
+  count = results ? query_test_read_rows(results) : -1;
+  if(results)
+    rasqal_free_query_results(results);
+  if(count != EXPECTED_RESULTS_COUNT) {
+    fprintf(stderr, "%s: cached prepared query kept the previous caller variable, returned %d results, expected %d\n",
+            program, count, EXPECTED_RESULTS_COUNT);
+    return(1);
+  }
+  rasqal_free_query(query);
+
+  /* an aggregate query keeps its aggregation when the algebra is
+   * built again after a change
+   */
+  printf("%s: preparing aggregate query\n", program);
+  query = rasqal_new_query(world, query_language_name, NULL);
+  if(!query || rasqal_query_prepare(query, agg_query_string, base_uri)) {
+    fprintf(stderr, "%s: aggregate query prepare FAILED\n", program);
+    return(1);
+  }
+
+  count = query_test_count(query);
+  if(count != EXPECTED_RESULTS_COUNT) {
+    fprintf(stderr, "%s: aggregate query execution 1 returned count %d, expected %d\n",
+            program, count, EXPECTED_RESULTS_COUNT);
+    return(1);
+  }
+
+  rasqal_query_set_limit(query, 10);
+
+  count = query_test_count(query);
+  if(count != EXPECTED_RESULTS_COUNT) {
+    fprintf(stderr, "%s: aggregate query execution 2 returned count %d, expected %d\n",
+            program, count, EXPECTED_RESULTS_COUNT);
+    return(1);
+  }
+
+  rasqal_free_query(query);
+
+  /* interleaved executions of one query keep their own bindings */
+  printf("%s: interleaving two executions\n", program);
+  query = rasqal_new_query(world, query_language_name, NULL);
+  if(!query || rasqal_query_prepare(query, all_query_string, base_uri)) {
+    fprintf(stderr, "%s: triples query prepare FAILED\n", program);
+    return(1);
+  }
+
+  results = rasqal_query_execute(query);
+  if(!results || rasqal_query_results_finished(results)) {
+    fprintf(stderr, "%s: interleaved query execution 1 FAILED\n", program);
+    return(1);
+  }
+  /* leave the first execution part way with its variables bound */
+  rasqal_query_results_next(results);
+
+  results2 = rasqal_query_execute(query);
+  if(!results2) {
+    fprintf(stderr, "%s: interleaved query execution 2 FAILED\n", program);
+    return(1);
+  }
+  count = query_test_read_rows(results2);
+  if(count != EXPECTED_TRIPLES_COUNT) {
+    fprintf(stderr, "%s: interleaved query execution 2 returned %d results, expected %d\n",
+            program, count, EXPECTED_TRIPLES_COUNT);
+    return(1);
+  }
+
+  count = 1 + query_test_read_rows(results);
+  if(count != EXPECTED_TRIPLES_COUNT) {
+    fprintf(stderr, "%s: interleaved query execution 1 returned %d results, expected %d\n",
+            program, count, EXPECTED_TRIPLES_COUNT);
+    return(1);
+  }
+
+  rasqal_free_query_results(results2);
+  rasqal_free_query_results(results);
+  rasqal_free_query(query);
+
+  /* a correlated right side of a join is executed for every left row */
+  printf("%s: executing correlated union query\n", program);
+  query = rasqal_new_query(world, query_language_name, NULL);
+  if(!query || rasqal_query_prepare(query, union_query_string, base_uri)) {
+    fprintf(stderr, "%s: union query prepare FAILED\n", program);
+    return(1);
+  }
+
+  results = rasqal_query_execute(query);
+  if(!results) {
+    fprintf(stderr, "%s: union query execution FAILED\n", program);
+    return(1);
+  }
+  count = query_test_read_rows(results);
+  if(count != EXPECTED_TRIPLES_COUNT) {
+    fprintf(stderr, "%s: union query execution returned %d results, expected %d\n",
+            program, count, EXPECTED_TRIPLES_COUNT);
+    return(1);
+  }
+
+  rasqal_free_query_results(results);
+  rasqal_free_query(query);
+
+  /* new VALUES rows are used by the next execution but not by one
+   * that is still being read
+   */
+  printf("%s: replacing VALUES rows during an execution\n", program);
+  query = rasqal_new_query(world, query_language_name, NULL);
+  if(!query || rasqal_query_prepare(query, values_query_string, base_uri)) {
+    fprintf(stderr, "%s: VALUES query prepare FAILED\n", program);
+    return(1);
+  }
+
+  results = rasqal_query_execute(query);
+  if(!results || rasqal_query_results_finished(results)) {
+    fprintf(stderr, "%s: VALUES query execution 1 FAILED\n", program);
+    return(1);
+  }
+  rasqal_query_results_next(results);
+
+  rows = query_test_new_integer_rows(world, 3);
+  if(!rows || rasqal_query_set_bindings_rows(query, rows)) {
+    fprintf(stderr, "%s: setting VALUES rows FAILED\n", program);
+    return(1);
+  }
+
+  count = 1 + query_test_read_rows(results);
+  rasqal_free_query_results(results);
+  if(count != 2) {
+    fprintf(stderr, "%s: VALUES query execution 1 returned %d results, expected 2\n",
+            program, count);
+    return(1);
+  }
+
+  results = rasqal_query_execute(query);
+  count = results ? query_test_read_rows(results) : -1;
+  if(results)
+    rasqal_free_query_results(results);
+  if(count != 1) {
+    fprintf(stderr, "%s: VALUES query execution 2 returned %d results, expected 1\n",
+            program, count);
+    return(1);
+  }
+
+  rasqal_free_query(query);
+
+  RASQAL_FREE(char*, values_query_string);
+  RASQAL_FREE(char*, union_query_string);
+  RASQAL_FREE(char*, all_query_string);
+  RASQAL_FREE(char*, agg_query_string);
+  RASQAL_FREE(char*, query_string);
+
   raptor_free_uri(base_uri);
 
   rasqal_free_world(world);
@@ -58,6 +58,33 @@ static int rasqal_query_select_build_variables_use_map(rasqal_query* query, unsi
 static int rasqal_query_select_build_variables_use_map_binds(rasqal_query* query, unsigned short *use_map, int width, rasqal_graph_pattern* gp, unsigned short* vars_scope);
 static int rasqal_query_union_build_variables_use_map_binds(rasqal_query* query, unsigned short *use_map, int width, rasqal_graph_pattern* gp, unsigned short* vars_scope);
 static int rasqal_query_values_build_variables_use_map_binds(rasqal_query* query, unsigned short *use_map, int width, rasqal_graph_pattern* gp, unsigned short* vars_scope);
+static int rasqal_query_minus_build_variables_use_map_binds(rasqal_query* query, unsigned short *use_map, int width, rasqal_graph_pattern* gp, unsigned short* vars_scope);
+static int rasqal_query_exists_build_variables_use_map_binds(rasqal_query* query, unsigned short *use_map, int width, rasqal_graph_pattern* gp, unsigned short* vars_scope);
+
+
+/*
+ * rasqal_query_expand_path_qnames:
+ * @rq: query
+ * @path: property path
+ *
+ * INTERNAL - Expand qnames in the IRIs of a property path
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_query_expand_path_qnames(rasqal_query* rq, rasqal_path* path)
+{
+  if(path->iri && rasqal_literal_expand_qname(rq, path->iri))
+    return 1;
+
+  if(path->path1 && rasqal_query_expand_path_qnames(rq, path->path1))
+    return 1;
+
+  if(path->path2 && rasqal_query_expand_path_qnames(rq, path->path2))
+    return 1;
+
+  return 0;
+}
 
 
 int
@@ -72,8 +99,9 @@ rasqal_query_expand_triple_qnames(rasqal_query* rq)
   for(i = 0; i< raptor_sequence_size(rq->triples); i++) {
     rasqal_triple* t = (rasqal_triple*)raptor_sequence_get_at(rq->triples, i);
     if(rasqal_literal_expand_qname(rq, t->subject) ||
-       rasqal_literal_expand_qname(rq, t->predicate) ||
-       rasqal_literal_expand_qname(rq, t->object))
+       (t->predicate && rasqal_literal_expand_qname(rq, t->predicate)) ||
+       rasqal_literal_expand_qname(rq, t->object) ||
+       (t->path && rasqal_query_expand_path_qnames(rq, t->path)))
       return 1;
   }
 
@@ -93,7 +121,7 @@ rasqal_sequence_has_qname(raptor_sequence *seq)
   for(i = 0; i< raptor_sequence_size(seq); i++) {
     rasqal_triple* t = (rasqal_triple*)raptor_sequence_get_at(seq, i);
     if(rasqal_literal_has_qname(t->subject) ||
-       rasqal_literal_has_qname(t->predicate) ||
+       (t->predicate && rasqal_literal_has_qname(t->predicate)) ||
        rasqal_literal_has_qname(t->object))
       return 1;
   }
@@ -228,7 +256,7 @@ rasqal_query_build_anonymous_variables(rasqal_query* rq)
        rasqal_query_convert_blank_node_to_anonymous_variable(rq, t->subject))
       goto done;
 
-    if(t->predicate->type == RASQAL_LITERAL_BLANK &&
+    if(t->predicate && t->predicate->type == RASQAL_LITERAL_BLANK &&
        rasqal_query_convert_blank_node_to_anonymous_variable(rq, t->predicate))
       goto done;
 
@@ -1523,7 +1551,7 @@ rasqal_query_triples_build_variables_use_map_row(raptor_sequence *triples,
       use_map_row[v->offset] |= RASQAL_VAR_USE_MENTIONED_HERE;
     }
     
-    if((v = rasqal_literal_as_variable(t->predicate))) {
+    if(t->predicate && (v = rasqal_literal_as_variable(t->predicate))) {
       use_map_row[v->offset] |= RASQAL_VAR_USE_MENTIONED_HERE;
     }
 
@@ -1600,6 +1628,7 @@ rasqal_query_graph_pattern_build_variables_use_map(rasqal_query* query,
   offset = (gp->gp_index + RASQAL_VAR_USE_MAP_OFFSET_LAST + 1) * width;
   switch(gp->op) {
     case RASQAL_GRAPH_PATTERN_OPERATOR_BASIC:
+    case RASQAL_GRAPH_PATTERN_OPERATOR_PATH:
       /* BGP (part 1) - everything is a mention */
       rasqal_query_triples_build_variables_use_map_row(query->triples, 
                                                        &use_map[offset],
@@ -1784,7 +1813,7 @@ rasqal_query_triples_build_variables_use_map_binds(rasqal_query* query,
         triple_row[v->offset] |= RASQAL_TRIPLES_USE_SUBJECT;
     }
     
-    if((v = rasqal_literal_as_variable(t->predicate))) {
+    if(t->predicate && (v = rasqal_literal_as_variable(t->predicate))) {
       if(!vars_scope[v->offset]) {
         /* v needs binding in this triple as PREDICATE */
         triple_row[v->offset] |= RASQAL_TRIPLES_BOUND_PREDICATE;
@@ -1817,7 +1846,7 @@ rasqal_query_triples_build_variables_use_map_binds(rasqal_query* query,
       rasqal_graph_pattern_promote_variable_mention_to_bind(gp, v, vars_scope);
     }
     
-    if((v = rasqal_literal_as_variable(t->predicate)) &&
+    if(t->predicate && (v = rasqal_literal_as_variable(t->predicate)) &&
        triple_row[v->offset] & RASQAL_TRIPLES_BOUND_PREDICATE) {
       rasqal_graph_pattern_promote_variable_mention_to_bind(gp, v, vars_scope);
     }
@@ -1905,6 +1934,7 @@ rasqal_query_graph_pattern_build_variables_use_map_binds(rasqal_query* query,
 
   switch(gp->op) {
     case RASQAL_GRAPH_PATTERN_OPERATOR_BASIC: 
+    case RASQAL_GRAPH_PATTERN_OPERATOR_PATH:
       rc = rasqal_query_triples_build_variables_use_map_binds(query,
                                                               use_map,
                                                               width,
@@ -1946,8 +1976,14 @@ rasqal_query_graph_pattern_build_variables_use_map_binds(rasqal_query* query,
                                                              vars_scope);
       break;
 
-    case RASQAL_GRAPH_PATTERN_OPERATOR_SERVICE:
     case RASQAL_GRAPH_PATTERN_OPERATOR_MINUS:
+      rc = rasqal_query_minus_build_variables_use_map_binds(query,
+                                                            use_map,
+                                                            width,
+                                                            gp, vars_scope);
+      break;
+
+    case RASQAL_GRAPH_PATTERN_OPERATOR_SERVICE:
     case RASQAL_GRAPH_PATTERN_OPERATOR_UNKNOWN:
       break;
   }
@@ -1958,8 +1994,9 @@ rasqal_query_graph_pattern_build_variables_use_map_binds(rasqal_query* query,
   rasqal_query_dump_vars_scope(query, width, vars_scope);
 #endif
 
-  /* Bind sub-graph patterns but not sub-SELECT gp twice */
-  if(gp->op != RASQAL_GRAPH_PATTERN_OPERATOR_SELECT && gp->graph_patterns) {
+  /* Bind sub-graph patterns but not sub-SELECT or MINUS gp twice */
+  if(gp->op != RASQAL_GRAPH_PATTERN_OPERATOR_SELECT &&
+     gp->op != RASQAL_GRAPH_PATTERN_OPERATOR_MINUS && gp->graph_patterns) {
     int gp_size = raptor_sequence_size(gp->graph_patterns);
     int i;
     
@@ -1984,6 +2021,11 @@ rasqal_query_graph_pattern_build_variables_use_map_binds(rasqal_query* query,
     }
   }
 
+  /* FILTER EXISTS patterns see every variable bound in the group */
+  if(gp->op == RASQAL_GRAPH_PATTERN_OPERATOR_GROUP)
+    rc = rasqal_query_exists_build_variables_use_map_binds(query, use_map,
+                                                           width, gp,
+                                                           vars_scope);
 
   done:
   return rc;
@@ -2757,6 +2799,162 @@ rasqal_query_union_build_variables_use_map_binds(rasqal_query* query,
 }
 
 
+/**
+ * rasqal_query_minus_build_variables_use_map_binds:
+ * @use_map: 2D array of (num. variables x num. GPs) to READ and WRITE
+ * @width: width of array (num. variables)
+ * @gp: graph pattern to use
+ * @vars_scope: variables bound in current scope
+ *
+ * INTERNAL - Mark variables bound in a MINUS sub-graph pattern
+ *
+ * The MINUS pattern is evaluated independently of the outer pattern
+ * so it starts with an empty scope and binds nothing in the outer
+ * scope.
+ * 
+ **/
+static int
+rasqal_query_minus_build_variables_use_map_binds(rasqal_query* query,
+                                                 unsigned short *use_map,
+                                                 int width,
+                                                 rasqal_graph_pattern* gp,
+                                                 unsigned short* vars_scope)
+{
+  unsigned short* inner_vars_scope;
+  raptor_sequence* seq;
+  int gp_size;
+  int i;
+  int rc = 0;
+
+  inner_vars_scope = RASQAL_CALLOC(unsigned short*, RASQAL_GOOD_CAST(size_t, width),
+                                   sizeof(unsigned short));
+  if(!inner_vars_scope)
+    return 1;
+
+  seq = gp->graph_patterns;
+  gp_size = raptor_sequence_size(seq);
+  for(i = 0; i < gp_size; i++) {
+    rasqal_graph_pattern *sgp;
+
+    sgp = (rasqal_graph_pattern*)raptor_sequence_get_at(seq, i);
+
+    rc = rasqal_query_graph_pattern_build_variables_use_map_binds(query,
+                                                                  use_map,
+                                                                  width,
+                                                                  sgp,
+                                                                  inner_vars_scope);
+    if(rc)
+      break;
+  }
+
+  RASQAL_FREE(intarray, inner_vars_scope);
+
+  return rc;
+}
+
+
+typedef struct {
+  rasqal_query* query;
+  unsigned short* use_map;
+  int width;
+  unsigned short* vars_scope;
+  unsigned short* inner_vars_scope;
+  int rc;
+} rasqal_query_exists_binds_state;
+
+
+static int
+rasqal_query_exists_build_variables_use_map_binds_visit(void* user_data,
+                                                        rasqal_expression* e)
+{
+  rasqal_query_exists_binds_state* st;
+  size_t len;
+
+  st = (rasqal_query_exists_binds_state*)user_data;
+  if(e->op != RASQAL_EXPR_EXISTS && e->op != RASQAL_EXPR_NOT_EXISTS)
+    return 0;
+
+  len = RASQAL_GOOD_CAST(size_t, st->width) * sizeof(unsigned short);
+  memcpy(st->inner_vars_scope, st->vars_scope, len);
+
+  st->rc = rasqal_query_graph_pattern_build_variables_use_map_binds(st->query,
+                                                                    st->use_map,
+                                                                    st->width,
+                                                                    e->graph_pattern,
+                                                                    st->inner_vars_scope);
+  return st->rc;
+}
+
+
+/**
+ * rasqal_query_exists_build_variables_use_map_binds:
+ * @use_map: 2D array of (num. variables x num. GPs) to READ and WRITE
+ * @width: width of array (num. variables)
+ * @gp: GROUP graph pattern to use
+ * @vars_scope: variables bound in the group and outer scope
+ *
+ * INTERNAL - Mark variables bound in FILTER EXISTS / NOT EXISTS patterns
+ *
+ * Each EXISTS pattern starts with a copy of the group scope so that
+ * variables bound in the group are uses (substituted from the
+ * current row) and all other variables are bound by the pattern.
+ * Nothing is added to the group scope.
+ * 
+ **/
+static int
+rasqal_query_exists_build_variables_use_map_binds(rasqal_query* query,
+                                                  unsigned short *use_map,
+                                                  int width,
+                                                  rasqal_graph_pattern* gp,
+                                                  unsigned short* vars_scope)
+{
+  rasqal_query_exists_binds_state st;
+  raptor_sequence* seq;
+  int gp_size;
+  int i;
+
+  seq = gp->graph_patterns;
+  if(!seq)
+    return 0;
+
+  st.query = query;
+  st.use_map = use_map;
+  st.width = width;
+  st.vars_scope = vars_scope;
+  st.inner_vars_scope = NULL;
+  st.rc = 0;
+
+  gp_size = raptor_sequence_size(seq);
+  for(i = 0; i < gp_size; i++) {
+    rasqal_graph_pattern *sgp;
+
+    sgp = (rasqal_graph_pattern*)raptor_sequence_get_at(seq, i);
+    if(sgp->op != RASQAL_GRAPH_PATTERN_OPERATOR_FILTER ||
+       !sgp->filter_expression)
+      continue;
+
+    if(!st.inner_vars_scope) {
+      st.inner_vars_scope = RASQAL_CALLOC(unsigned short*,
+                                          RASQAL_GOOD_CAST(size_t, width),
+                                          sizeof(unsigned short));
+      if(!st.inner_vars_scope)
+        return 1;
+    }
+
+    rasqal_expression_visit(sgp->filter_expression,
+                            rasqal_query_exists_build_variables_use_map_binds_visit,
+                            &st);
+    if(st.rc)
+      break;
+  }
+
+  if(st.inner_vars_scope)
+    RASQAL_FREE(intarray, st.inner_vars_scope);
+
+  return st.rc;
+}
+
+
 /**
  * rasqal_query_values_build_variables_use_map_binds:
  * @use_map: 2D array of (num. variables x num. GPs) to READ and WRITE
@@ -50,6 +50,7 @@ typedef struct
 } sparql_writer_context;
 
 static void rasqal_query_write_sparql_expression(sparql_writer_context *wc, raptor_iostream* iostr, rasqal_expression* e);
+static void rasqal_query_write_sparql_graph_pattern(sparql_writer_context *wc, raptor_iostream* iostr, rasqal_graph_pattern *gp, int gp_index, unsigned int indent);
 
 
 static void
@@ -184,13 +185,62 @@ rasqal_query_write_sparql_literal(sparql_writer_context *wc,
 }
 
 
+static void
+rasqal_query_write_sparql_path(sparql_writer_context *wc,
+                               raptor_iostream* iostr, rasqal_path* path)
+{
+  rasqal_path* arg;
+  int i;
+
+  if(path->op == RASQAL_PATH_OPERATOR_LINK) {
+    if(path->iri->type == RASQAL_LITERAL_URI &&
+       raptor_uri_equals(path->iri->value.uri, wc->type_uri))
+      raptor_iostream_write_byte('a', iostr);
+    else
+      rasqal_query_write_sparql_literal(wc, iostr, path->iri);
+    return;
+  }
+
+  if(path->op == RASQAL_PATH_OPERATOR_INVERSE)
+    raptor_iostream_write_byte('^', iostr);
+
+  /* bracket every argument that is not a single IRI */
+  for(i = 0; i < 2; i++) {
+    arg = i ? path->path2 : path->path1;
+    if(!arg)
+      break;
+
+    if(i)
+      raptor_iostream_write_byte(path->op == RASQAL_PATH_OPERATOR_SEQUENCE ? '/' : '|',
+                                 iostr);
+
+    if(rasqal_path_is_link(arg))
+      rasqal_query_write_sparql_path(wc, iostr, arg);
+    else {
+      raptor_iostream_write_byte('(', iostr);
+      rasqal_query_write_sparql_path(wc, iostr, arg);
+      raptor_iostream_write_byte(')', iostr);
+    }
+  }
+
+  if(path->op == RASQAL_PATH_OPERATOR_ZERO_OR_ONE)
+    raptor_iostream_write_byte('?', iostr);
+  else if(path->op == RASQAL_PATH_OPERATOR_ZERO_OR_MORE)
+    raptor_iostream_write_byte('*', iostr);
+  else if(path->op == RASQAL_PATH_OPERATOR_ONE_OR_MORE)
+    raptor_iostream_write_byte('+', iostr);
+}
+
+
 static void
 rasqal_query_write_sparql_triple(sparql_writer_context *wc,
                                  raptor_iostream* iostr, rasqal_triple* triple)
 {
   rasqal_query_write_sparql_literal(wc, iostr, triple->subject);
   raptor_iostream_write_byte(' ', iostr);
-  if(triple->predicate->type == RASQAL_LITERAL_URI &&
+  if(triple->path)
+    rasqal_query_write_sparql_path(wc, iostr, triple->path);
+  else if(triple->predicate->type == RASQAL_LITERAL_URI &&
      raptor_uri_equals(triple->predicate->value.uri, wc->type_uri))
     raptor_iostream_write_byte('a', iostr);
   else
@@ -309,7 +359,9 @@ static const char* const rasqal_sparql_op_labels[RASQAL_EXPR_LAST+1] = {
   "STRAFTER",
   "REPLACE",
   "UUID",
-  "STRUUID"
+  "STRUUID",
+  "EXISTS",
+  "NOT EXISTS"
 };
 
 
@@ -545,6 +597,14 @@ rasqal_query_write_sparql_expression(sparql_writer_context *wc,
       raptor_iostream_counted_string_write(" )", 2, iostr);
       break;
 
+    case RASQAL_EXPR_EXISTS:
+    case RASQAL_EXPR_NOT_EXISTS:
+      rasqal_query_write_sparql_expression_op(wc, iostr, e);
+      raptor_iostream_write_byte(' ', iostr);
+      rasqal_query_write_sparql_graph_pattern(wc, iostr, e->graph_pattern,
+                                              0, 0);
+      break;
+
     case RASQAL_EXPR_UNKNOWN:
     case RASQAL_EXPR_STR_MATCH:
     case RASQAL_EXPR_STR_NMATCH:
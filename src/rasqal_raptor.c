@@ -41,18 +41,36 @@
 #include "rasqal_internal.h"
 
 
-struct rasqal_raptor_triple_s {
-  struct rasqal_raptor_triple_s *next;
-  rasqal_triple *triple;
-};
+/* triples per storage chunk: 1 << RASQAL_RAPTOR_CHUNK_SHIFT */
+#define RASQAL_RAPTOR_CHUNK_SHIFT 12
+#define RASQAL_RAPTOR_CHUNK_SIZE (1 << RASQAL_RAPTOR_CHUNK_SHIFT)
+
+
+/* number of entries in the term literal cache; a power of 2 */
+#define RASQAL_RAPTOR_TERM_CACHE_SIZE 1024
+
+typedef struct {
+  /* term reference */
+  raptor_term* term;
+
+  /* literal made from @term */
+  rasqal_literal* literal;
+} rasqal_raptor_term_cache_entry;
 
-typedef struct rasqal_raptor_triple_s rasqal_raptor_triple;
 
 typedef struct {
   rasqal_world* world;
 
-  rasqal_raptor_triple *head;
-  rasqal_raptor_triple *tail;
+  /* triples stored by value in chunks of RASQAL_RAPTOR_CHUNK_SIZE so
+   * there is no allocation per triple and scans read memory in order.
+   * The subject, predicate and object literals are owned; the origin
+   * is one of the shared @source_literals.
+   */
+  rasqal_triple** chunks;
+  /* allocated size of @chunks */
+  int chunks_size;
+  /* number of triples stored */
+  int triples_count;
 
   /* index used while reading triples into the two arrays below.
    * This is used to connect a triple to the URI literal of the source
@@ -68,10 +86,38 @@ typedef struct {
   /* array of URI literals (allocated here) */
   rasqal_literal **source_literals;
 
+  /* arrays of the offset of the first triple and one past the last
+   * triple read from each source (allocated here).  The triples of
+   * one source are contiguous in the chunks above so a triple pattern
+   * with a graph only walks the triples of the sources that can match
+   * it.
+   */
+  int* source_starts;
+  int* source_ends;
+
+  /* array of flags set for each source whose triples each own their
+   * origin rather than sharing the source literal (allocated here).
+   * Only set for data graphs held in memory that contain quads.
+   */
+  char* source_quads;
+
   /* genid base for mapping user bnodes */
   unsigned char* mapped_id_base;
   /* length of above string */
   size_t mapped_id_base_len;
+
+  /* parser of the current source */
+  raptor_parser* parser;
+
+  /* non-0 if a statement could not be stored */
+  int failed;
+
+  /* direct-mapped cache of the literals for recently seen terms of
+   * the current source, allocated while parsing.  Statements in
+   * line-based dumps repeat the same subject and predicate terms so
+   * most terms share an existing literal.
+   */
+  rasqal_raptor_term_cache_entry* term_cache;
 } rasqal_raptor_triples_source_user_data;
 
 
@@ -95,32 +141,379 @@ raptor_statement_as_rasqal_triple(rasqal_world* world,
 }
 
 
+/* Make a blank node literal for @id prefixed with the source genid base */
+static rasqal_literal*
+rasqal_raptor_new_blank_literal(rasqal_raptor_triples_source_user_data* rtsc,
+                                const unsigned char* id, size_t id_len)
+{
+  unsigned char *mapped_id;
+
+  mapped_id = RASQAL_MALLOC(unsigned char*,
+                            rtsc->mapped_id_base_len + 1 + id_len + 1);
+  if(!mapped_id)
+    return NULL;
+
+  memcpy(mapped_id, rtsc->mapped_id_base, rtsc->mapped_id_base_len);
+  mapped_id[rtsc->mapped_id_base_len] = '_';
+  memcpy(mapped_id + rtsc->mapped_id_base_len + 1, id, id_len);
+  mapped_id[rtsc->mapped_id_base_len + 1 + id_len] = '\0';
+
+  return rasqal_new_simple_literal(rtsc->world, RASQAL_LITERAL_BLANK,
+                                   mapped_id);
+}
+
+
+/*
+ * rasqal_raptor_new_term_literal:
+ * @rtsc: triples source user data
+ * @term: raptor term
+ *
+ * INTERNAL - Make a literal from a parsed term mapping blank node IDs
+ *
+ * Blank node IDs are prefixed with the genid base of the data graph
+ * being parsed so that blank nodes in different graphs never share
+ * an ID.
+ *
+ * Return value: new literal or NULL on failure
+ */
+static rasqal_literal*
+rasqal_raptor_new_term_literal(rasqal_raptor_triples_source_user_data* rtsc,
+                               raptor_term* term)
+{
+  if(term->type != RAPTOR_TERM_TYPE_BLANK || !rtsc->mapped_id_base)
+    return rasqal_new_literal_from_term(rtsc->world, term);
+
+  return rasqal_raptor_new_blank_literal(rtsc, term->value.blank.string,
+                                         term->value.blank.string_len);
+}
+
+
+/*
+ * rasqal_raptor_new_literal:
+ * @rtsc: triples source user data
+ * @l: literal
+ *
+ * INTERNAL - Get a literal for a data graph held in memory mapping blank node IDs
+ *
+ * The same as rasqal_raptor_new_term_literal() for literals.
+ *
+ * Return value: new literal reference or NULL on failure
+ */
+static rasqal_literal*
+rasqal_raptor_new_literal(rasqal_raptor_triples_source_user_data* rtsc,
+                          rasqal_literal* l)
+{
+  if(l->type != RASQAL_LITERAL_BLANK || !rtsc->mapped_id_base)
+    return rasqal_new_literal_from_literal(l);
+
+  return rasqal_raptor_new_blank_literal(rtsc, l->string, l->string_len);
+}
+
+
+/*
+ * rasqal_raptor_term_hash:
+ * @term: raptor term
+ *
+ * INTERNAL - Get a hash of a term for the term literal cache
+ *
+ * URIs are shared by raptor so a URI hashes by pointer.
+ *
+ * Return value: hash
+ */
+static uint64_t
+rasqal_raptor_term_hash(raptor_term* term)
+{
+  uint64_t hash = RASQAL_GOOD_CAST(uint64_t, term->type);
+
+  switch(term->type) {
+    case RAPTOR_TERM_TYPE_URI:
+      hash = rasqal_hash_combine(hash, RASQAL_GOOD_CAST(uint64_t, RASQAL_GOOD_CAST(size_t, term->value.uri)));
+      break;
+
+    case RAPTOR_TERM_TYPE_BLANK:
+      hash = rasqal_hash_bytes(hash, term->value.blank.string,
+                               term->value.blank.string_len);
+      break;
+
+    case RAPTOR_TERM_TYPE_LITERAL:
+      hash = rasqal_hash_bytes(hash, term->value.literal.string,
+                               term->value.literal.string_len);
+      hash = rasqal_hash_combine(hash, RASQAL_GOOD_CAST(uint64_t, RASQAL_GOOD_CAST(size_t, term->value.literal.datatype)));
+      if(term->value.literal.language)
+        hash = rasqal_hash_bytes(hash, term->value.literal.language,
+                                 term->value.literal.language_len);
+      break;
+
+    case RAPTOR_TERM_TYPE_UNKNOWN:
+    default:
+      break;
+  }
+
+  return rasqal_hash_mix(hash);
+}
+
+
+/* Empty the term literal cache */
+static void
+rasqal_raptor_term_cache_clear(rasqal_raptor_triples_source_user_data* rtsc)
+{
+  int i;
+
+  if(!rtsc->term_cache)
+    return;
+
+  for(i = 0; i < RASQAL_RAPTOR_TERM_CACHE_SIZE; i++) {
+    rasqal_raptor_term_cache_entry* entry = &rtsc->term_cache[i];
+
+    if(entry->term)
+      raptor_free_term(entry->term);
+    if(entry->literal)
+      rasqal_free_literal(entry->literal);
+  }
+
+  RASQAL_FREE(rasqal_raptor_term_cache_entry*, rtsc->term_cache);
+  rtsc->term_cache = NULL;
+}
+
+
+/*
+ * rasqal_raptor_term_literal:
+ * @rtsc: triples source user data
+ * @term: raptor term
+ *
+ * INTERNAL - Get a literal for a parsed term, sharing a recent one if possible
+ *
+ * Return value: new literal reference or NULL on failure
+ */
+static rasqal_literal*
+rasqal_raptor_term_literal(rasqal_raptor_triples_source_user_data* rtsc,
+                           raptor_term* term)
+{
+  rasqal_raptor_term_cache_entry* entry;
+  rasqal_literal* l;
+
+  if(!rtsc->term_cache) {
+    rtsc->term_cache = RASQAL_CALLOC(rasqal_raptor_term_cache_entry*,
+                                     RASQAL_RAPTOR_TERM_CACHE_SIZE,
+                                     sizeof(*rtsc->term_cache));
+    if(!rtsc->term_cache)
+      return rasqal_raptor_new_term_literal(rtsc, term);
+  }
+
+  entry = &rtsc->term_cache[rasqal_raptor_term_hash(term) & (RASQAL_RAPTOR_TERM_CACHE_SIZE - 1)];
+
+  if(entry->term && raptor_term_equals(entry->term, term))
+    return rasqal_new_literal_from_literal(entry->literal);
+
+  l = rasqal_raptor_new_term_literal(rtsc, term);
+  if(!l)
+    return NULL;
+
+  if(entry->term)
+    raptor_free_term(entry->term);
+  if(entry->literal)
+    rasqal_free_literal(entry->literal);
+
+  entry->term = raptor_term_copy(term);
+  entry->literal = rasqal_new_literal_from_literal(l);
+
+  return l;
+}
+
+
+/*
+ * rasqal_raptor_get_triple:
+ * @rtsc: triples source user data
+ * @offset: triple offset
+ *
+ * INTERNAL - Get a stored triple by offset
+ *
+ * Return value: shared triple
+ */
+static rasqal_triple*
+rasqal_raptor_get_triple(rasqal_raptor_triples_source_user_data* rtsc,
+                         int offset)
+{
+  return &rtsc->chunks[offset >> RASQAL_RAPTOR_CHUNK_SHIFT][offset & (RASQAL_RAPTOR_CHUNK_SIZE - 1)];
+}
+
+
+/*
+ * rasqal_raptor_add_triple:
+ * @rtsc: triples source user data
+ * @s: subject literal
+ * @p: predicate literal
+ * @o: object literal
+ * @origin: shared origin literal or NULL
+ *
+ * INTERNAL - Store a triple after the last one
+ *
+ * Takes ownership of @s, @p and @o even on failure.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_raptor_add_triple(rasqal_raptor_triples_source_user_data* rtsc,
+                         rasqal_literal* s, rasqal_literal* p,
+                         rasqal_literal* o, rasqal_literal* origin)
+{
+  int chunk = rtsc->triples_count >> RASQAL_RAPTOR_CHUNK_SHIFT;
+  rasqal_triple* t;
+
+  if(!(rtsc->triples_count & (RASQAL_RAPTOR_CHUNK_SIZE - 1))) {
+    /* first triple of a new chunk */
+    if(chunk == rtsc->chunks_size) {
+      int new_size = rtsc->chunks_size ? rtsc->chunks_size * 2 : 16;
+      rasqal_triple** new_chunks;
+
+      new_chunks = RASQAL_CALLOC(rasqal_triple**,
+                                 RASQAL_GOOD_CAST(size_t, new_size),
+                                 sizeof(rasqal_triple*));
+      if(!new_chunks)
+        goto fail;
+
+      if(rtsc->chunks) {
+        memcpy(new_chunks, rtsc->chunks,
+               RASQAL_GOOD_CAST(size_t, rtsc->chunks_size) * sizeof(rasqal_triple*));
+        RASQAL_FREE(rasqal_triple**, rtsc->chunks);
+      }
+      rtsc->chunks = new_chunks;
+      rtsc->chunks_size = new_size;
+    }
+
+    rtsc->chunks[chunk] = RASQAL_CALLOC(rasqal_triple*,
+                                        RASQAL_RAPTOR_CHUNK_SIZE,
+                                        sizeof(rasqal_triple));
+    if(!rtsc->chunks[chunk])
+      goto fail;
+  }
+
+  t = rasqal_raptor_get_triple(rtsc, rtsc->triples_count);
+  t->subject = s;
+  t->predicate = p;
+  t->object = o;
+  t->origin = origin;
+
+  rtsc->triples_count++;
+
+  return 0;
+
+  fail:
+  rasqal_free_literal(s);
+  rasqal_free_literal(p);
+  rasqal_free_literal(o);
+
+  return 1;
+}
+
+
 static void
 rasqal_raptor_statement_handler(void *user_data,
                                 raptor_statement *statement)
 {
   rasqal_raptor_triples_source_user_data* rtsc;
-  rasqal_raptor_triple *triple;
+  rasqal_literal *s, *p, *o;
   
   rtsc = (rasqal_raptor_triples_source_user_data*)user_data;
 
-  triple = RASQAL_MALLOC(rasqal_raptor_triple*, sizeof(rasqal_raptor_triple));
-  triple->next = NULL;
-  triple->triple = raptor_statement_as_rasqal_triple(rtsc->world,
-                                                     statement);
+  if(rtsc->failed)
+    return;
+
+  s = rasqal_raptor_term_literal(rtsc, statement->subject);
+  p = rasqal_raptor_term_literal(rtsc, statement->predicate);
+  o = rasqal_raptor_term_literal(rtsc, statement->object);
+  if(!s || !p || !o) {
+    if(s)
+      rasqal_free_literal(s);
+    if(p)
+      rasqal_free_literal(p);
+    if(o)
+      rasqal_free_literal(o);
+    goto fail;
+  }
 
   /* this origin URI literal is shared amongst the triples and
    * freed only in rasqal_raptor_free_triples_source
    */
-  rasqal_triple_set_origin(triple->triple, 
-                           rtsc->source_literals[rtsc->source_index]);
+  if(rasqal_raptor_add_triple(rtsc, s, p, o,
+                              rtsc->source_literals[rtsc->source_index]))
+    goto fail;
 
-  if(rtsc->tail)
-    rtsc->tail->next = triple;
-  else
-    rtsc->head = triple;
+  return;
+
+  fail:
+  rtsc->failed = 1;
+  if(rtsc->parser)
+    raptor_parser_parse_abort(rtsc->parser);
+}
+
+
+/*
+ * rasqal_raptor_add_data_graph_triples:
+ * @rtsc: triples source user data
+ * @dg: data graph held in memory
+ *
+ * INTERNAL - Store the triples of a data graph held in memory as the current source
+ *
+ * If any triple is a quad the source is marked so every triple of it
+ * owns its origin and is matched on it.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_raptor_add_data_graph_triples(rasqal_raptor_triples_source_user_data* rtsc,
+                                     rasqal_data_graph* dg)
+{
+  struct rasqal_data_graph_triples_s* dgt = dg->triples;
+  rasqal_literal* source_literal = rtsc->source_literals[rtsc->source_index];
+  int quads = 0;
+  int i;
+
+  for(i = 0; i < dgt->count; i++) {
+    if(dgt->triples[i].origin) {
+      quads = 1;
+      break;
+    }
+  }
+  rtsc->source_quads[rtsc->source_index] = RASQAL_GOOD_CAST(char, quads);
+
+  for(i = 0; i < dgt->count; i++) {
+    rasqal_triple* t = &dgt->triples[i];
+    rasqal_literal *s, *p, *o;
+    rasqal_literal* origin = source_literal;
+
+    if(quads) {
+      origin = t->origin ? t->origin : source_literal;
+      if(origin) {
+        origin = rasqal_raptor_new_literal(rtsc, origin);
+        if(!origin)
+          return 1;
+      }
+    }
+
+    s = rasqal_raptor_new_literal(rtsc, t->subject);
+    p = rasqal_raptor_new_literal(rtsc, t->predicate);
+    o = rasqal_raptor_new_literal(rtsc, t->object);
+    if(!s || !p || !o) {
+      if(s)
+        rasqal_free_literal(s);
+      if(p)
+        rasqal_free_literal(p);
+      if(o)
+        rasqal_free_literal(o);
+      if(quads && origin)
+        rasqal_free_literal(origin);
+      return 1;
+    }
+
+    if(rasqal_raptor_add_triple(rtsc, s, p, o, origin)) {
+      if(quads && origin)
+        rasqal_free_literal(origin);
+      return 1;
+    }
+  }
 
-  rtsc->tail = triple;
+  return 0;
 }
 
 
@@ -134,10 +527,6 @@ rasqal_raptor_get_genid(rasqal_world* world, const unsigned char* base,
 
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(world, rasqal_world, NULL);
 
-  /* This is read-only and thread safe */
-  if(counter < 0)
-    counter= world->genid_counter++;
-
   length = strlen(RASQAL_GOOD_CAST(const char*, base)) + 2;  /* base + (int) + "\0" */
   tmpcounter = counter;
   while(tmpcounter /= 10)
@@ -152,33 +541,6 @@ rasqal_raptor_get_genid(rasqal_world* world, const unsigned char* base,
 }
 
 
-static unsigned char*
-rasqal_raptor_generate_id_handler(void *user_data,
-                                  unsigned char *user_bnodeid) 
-{
-  rasqal_raptor_triples_source_user_data* rtsc;
-
-  rtsc = (rasqal_raptor_triples_source_user_data*)user_data;
-
-  if(user_bnodeid) {
-    unsigned char *mapped_id;
-    size_t user_bnodeid_len = strlen(RASQAL_GOOD_CAST(const char*, user_bnodeid));
-    
-    mapped_id = RASQAL_MALLOC(unsigned char*, 
-                              rtsc->mapped_id_base_len + 1 + user_bnodeid_len + 1);
-    memcpy(mapped_id, rtsc->mapped_id_base, rtsc->mapped_id_base_len);
-    mapped_id[rtsc->mapped_id_base_len] = '_';
-    memcpy(mapped_id + rtsc->mapped_id_base_len + 1,
-           user_bnodeid, user_bnodeid_len + 1);
-
-    raptor_free_memory(user_bnodeid);
-    return mapped_id;
-  }
-  
-  return rasqal_raptor_get_genid(rtsc->world, RASQAL_GOOD_CAST(const unsigned char*, "genid"), -1);
-}
-
-
 static int
 rasqal_raptor_support_feature(void *user_data,
                               rasqal_triples_source_feature feature)
@@ -234,6 +596,24 @@ rasqal_raptor_init_triples_source_common(rasqal_world* world,
                                           sizeof(rasqal_literal*));
     if(!rtsc->source_literals)
       return 1;
+
+    rtsc->source_starts = RASQAL_CALLOC(int*,
+                                        RASQAL_GOOD_CAST(size_t, rtsc->sources_count),
+                                        sizeof(int));
+    if(!rtsc->source_starts)
+      return 1;
+
+    rtsc->source_ends = RASQAL_CALLOC(int*,
+                                      RASQAL_GOOD_CAST(size_t, rtsc->sources_count),
+                                      sizeof(int));
+    if(!rtsc->source_ends)
+      return 1;
+
+    rtsc->source_quads = RASQAL_CALLOC(char*,
+                                       RASQAL_GOOD_CAST(size_t, rtsc->sources_count),
+                                       sizeof(char));
+    if(!rtsc->source_quads)
+      return 1;
   } else {
     /* No sources so the work is done */
     return 0;
@@ -253,6 +633,8 @@ rasqal_raptor_init_triples_source_common(rasqal_world* world,
     iostr = dg->iostr;
 
     rtsc->source_index = i;
+    rtsc->source_starts[i] = rtsc->triples_count;
+    rtsc->source_ends[i] = rtsc->triples_count;
     if(uri)
       rtsc->source_uri = raptor_uri_copy(uri);
 
@@ -270,54 +652,65 @@ rasqal_raptor_init_triples_source_common(rasqal_world* world,
                                                    i);
     rtsc->mapped_id_base_len = strlen(RASQAL_GOOD_CAST(const char*, rtsc->mapped_id_base));
 
-    parser_name = dg->format_name;
-    if(parser_name) {
-      if(!raptor_world_is_parser_name(world->raptor_world_ptr, parser_name)) {
-        if(rdf_query)
-          handler1(rdf_query, /* locator */ NULL,
-                   "Invalid data graph parser name ignored");
-        else
-          handler2(world, /* locator */ NULL,
-                   "Invalid data graph parser name ignored");
-        parser_name = NULL;
+    if(dg->triples) {
+      /* held in memory: nothing to parse */
+      rc = rasqal_raptor_add_data_graph_triples(rtsc, dg);
+    } else {
+      parser_name = dg->format_name;
+      if(parser_name) {
+        if(!raptor_world_is_parser_name(world->raptor_world_ptr, parser_name)) {
+          if(rdf_query)
+            handler1(rdf_query, /* locator */ NULL,
+                     "Invalid data graph parser name ignored");
+          else
+            handler2(world, /* locator */ NULL,
+                     "Invalid data graph parser name ignored");
+          parser_name = NULL;
+        }
       }
-    }
-    if(!parser_name)
-      parser_name = "guess";
+      if(!parser_name)
+        parser_name = "guess";
     
-    parser = raptor_new_parser(world->raptor_world_ptr, parser_name);
-    raptor_parser_set_statement_handler(parser, rtsc, rasqal_raptor_statement_handler);
-    raptor_world_set_generate_bnodeid_handler(world->raptor_world_ptr,
-                                              rtsc,
-                                              rasqal_raptor_generate_id_handler);
+      parser = raptor_new_parser(world->raptor_world_ptr, parser_name);
+      raptor_parser_set_statement_handler(parser, rtsc, rasqal_raptor_statement_handler);
+      rtsc->parser = parser;
 
 #ifdef RAPTOR_FEATURE_NO_NET
-    if(flags & 1)
-      raptor_set_feature(parser, RAPTOR_FEATURE_NO_NET,
-                         rdf_query->features[RASQAL_FEATURE_NO_NET]);
+      if(flags & 1)
+        raptor_set_feature(parser, RAPTOR_FEATURE_NO_NET,
+                           rdf_query->features[RASQAL_FEATURE_NO_NET]);
 #endif
 
-    if(iostr) {
-      rc = raptor_parser_parse_iostream(parser, iostr, dg->base_uri);
-    } else {
-      rc = raptor_parser_parse_uri(parser, uri, name_uri);
-    }
+      if(iostr) {
+        rc = raptor_parser_parse_iostream(parser, iostr, dg->base_uri);
+      } else {
+        rc = raptor_parser_parse_uri(parser, uri, name_uri);
+      }
     
-    raptor_free_parser(parser);
+      raptor_free_parser(parser);
+      rtsc->parser = NULL;
+    }
+
+    rtsc->source_ends[i] = rtsc->triples_count;
+
+    /* blank node literals depend on the source */
+    rasqal_raptor_term_cache_clear(rtsc);
+
+    if(rtsc->failed)
+      rc = 1;
 
-    raptor_free_uri(rtsc->source_uri);
+    if(rtsc->source_uri) {
+      raptor_free_uri(rtsc->source_uri);
+      rtsc->source_uri = NULL;
+    }
 
     if(free_name_uri)
       raptor_free_uri(name_uri);
 
-    /* Reset raptor genid handler to default */
-    /* FIXME: this should be per-parser not raptor-wide */
-    raptor_world_set_generate_bnodeid_handler(world->raptor_world_ptr,
-                                              NULL, NULL);
-
     /* This is freed in rasqal_raptor_free_triples_source() */
     /* rasqal_free_literal(rtsc->source_literal); */
     RASQAL_FREE(char*, rtsc->mapped_id_base);
+    rtsc->mapped_id_base = NULL;
 
     if(rc)
       break;
@@ -468,22 +861,124 @@ rasqal_raptor_triple_match(rasqal_world* world,
 }
 
 
+/*
+ * rasqal_raptor_source_matches:
+ * @rtsc: triples source user data
+ * @source: source index
+ * @match: triple pattern with wildcards
+ * @parts: parts of the triple to match
+ *
+ * INTERNAL - Test if any triple of a source can match on the graph
+ *
+ * Uses the same graph rules as rasqal_raptor_triple_match() so that
+ * sources skipped here hold no triples it would accept.
+ *
+ * Return value: non-0 if the triples of @source need matching
+ */
+static int
+rasqal_raptor_source_matches(rasqal_raptor_triples_source_user_data* rtsc,
+                             int source,
+                             rasqal_triple *match,
+                             unsigned int parts)
+{
+  rasqal_literal* origin = rtsc->source_literals[source];
+
+  if(rtsc->source_starts[source] == rtsc->source_ends[source])
+    return 0;
+
+  if(rtsc->source_quads[source])
+    /* each triple has its own origin */
+    return 1;
+
+  if(!(parts & RASQAL_TRIPLE_ORIGIN))
+    /* Not binding a graph: only triples with no GRAPH match */
+    return !origin;
+
+  if(!origin)
+    return 0;
+
+  if(match->origin && match->origin->type == RASQAL_LITERAL_URI)
+    return raptor_uri_equals(origin->value.uri, match->origin->value.uri);
+
+  return 1;
+}
+
+
+/*
+ * rasqal_raptor_source_first_triple:
+ * @rtsc: triples source user data
+ * @source: pointer to source index to start from; updated
+ * @match: triple pattern with wildcards
+ * @parts: parts of the triple to match
+ *
+ * INTERNAL - Get the first triple of the next source that can match
+ *
+ * Return value: triple offset or <0 when no source is left
+ */
+static int
+rasqal_raptor_source_first_triple(rasqal_raptor_triples_source_user_data* rtsc,
+                                  int* source,
+                                  rasqal_triple *match,
+                                  unsigned int parts)
+{
+  for(; *source < rtsc->sources_count; (*source)++) {
+    if(rasqal_raptor_source_matches(rtsc, *source, match, parts))
+      return rtsc->source_starts[*source];
+  }
+
+  return -1;
+}
+
+
+/*
+ * rasqal_raptor_source_next_triple:
+ * @rtsc: triples source user data
+ * @source: pointer to source index of @offset; updated
+ * @offset: current triple offset
+ * @match: triple pattern with wildcards
+ * @parts: parts of the triple to match
+ *
+ * INTERNAL - Get the triple after @offset skipping sources that cannot match
+ *
+ * Return value: triple offset or <0 at the end
+ */
+static int
+rasqal_raptor_source_next_triple(rasqal_raptor_triples_source_user_data* rtsc,
+                                 int* source,
+                                 int offset,
+                                 rasqal_triple *match,
+                                 unsigned int parts)
+{
+  if(++offset < rtsc->source_ends[*source])
+    return offset;
+
+  (*source)++;
+  return rasqal_raptor_source_first_triple(rtsc, source, match, parts);
+}
+
+
 /* non-0 if present */
 static int
 rasqal_raptor_triple_present(rasqal_triples_source *rts, void *user_data, 
                              rasqal_triple *t) 
 {
   rasqal_raptor_triples_source_user_data* rtsc;
-  rasqal_raptor_triple *triple;
+  int offset;
   unsigned int parts = RASQAL_TRIPLE_SPO;
+  int source = 0;
   
   rtsc = (rasqal_raptor_triples_source_user_data*)user_data;
 
   if(t->origin)
     parts = (rasqal_triple_parts)(parts | RASQAL_TRIPLE_GRAPH);
 
-  for(triple = rtsc->head; triple; triple = triple->next) {
-    if(rasqal_raptor_triple_match(rtsc->world, triple->triple, t, parts))
+  for(offset = rasqal_raptor_source_first_triple(rtsc, &source, t, parts);
+      offset >= 0;
+      offset = rasqal_raptor_source_next_triple(rtsc, &source, offset, t,
+                                                parts)) {
+    if(rasqal_raptor_triple_match(rtsc->world,
+                                  rasqal_raptor_get_triple(rtsc, offset),
+                                  t, parts))
       return 1;
   }
 
@@ -496,17 +991,41 @@ static void
 rasqal_raptor_free_triples_source(void *user_data)
 {
   rasqal_raptor_triples_source_user_data* rtsc;
-  rasqal_raptor_triple *cur;
   int i;
 
   rtsc = (rasqal_raptor_triples_source_user_data*)user_data;
-  cur = rtsc->head;
-  while(cur) {
-    rasqal_raptor_triple *next = cur->next;
-    rasqal_triple_set_origin(cur->triple, NULL); /* shared URI literal */
-    rasqal_free_triple(cur->triple);
-    RASQAL_FREE(rasqal_raptor_triple, cur);
-    cur = next;
+  rasqal_raptor_term_cache_clear(rtsc);
+
+  for(i = 0; i < rtsc->triples_count; i++) {
+    rasqal_triple* t = rasqal_raptor_get_triple(rtsc, i);
+
+    /* origin is a shared source literal except in quads sources */
+    rasqal_free_literal(t->subject);
+    rasqal_free_literal(t->predicate);
+    rasqal_free_literal(t->object);
+  }
+
+  for(i = 0; i < rtsc->sources_count; i++) {
+    int offset;
+
+    if(!rtsc->source_quads || !rtsc->source_quads[i])
+      continue;
+
+    for(offset = rtsc->source_starts[i]; offset < rtsc->source_ends[i];
+        offset++) {
+      rasqal_triple* t = rasqal_raptor_get_triple(rtsc, offset);
+
+      if(t->origin)
+        rasqal_free_literal(t->origin);
+    }
+  }
+
+  if(rtsc->chunks) {
+    for(i = 0; i < rtsc->chunks_size; i++) {
+      if(rtsc->chunks[i])
+        RASQAL_FREE(rasqal_triple*, rtsc->chunks[i]);
+    }
+    RASQAL_FREE(rasqal_triple**, rtsc->chunks);
   }
 
   for(i = 0; i < rtsc->sources_count; i++) {
@@ -515,6 +1034,12 @@ rasqal_raptor_free_triples_source(void *user_data)
   }
   if(rtsc->source_literals)
     RASQAL_FREE(raptor_literal_ptr, rtsc->source_literals);
+  if(rtsc->source_starts)
+    RASQAL_FREE(int*, rtsc->source_starts);
+  if(rtsc->source_ends)
+    RASQAL_FREE(int*, rtsc->source_ends);
+  if(rtsc->source_quads)
+    RASQAL_FREE(char*, rtsc->source_quads);
 }
 
 
@@ -535,8 +1060,30 @@ rasqal_raptor_register_triples_source_factory(rasqal_triples_source_factory *fac
 }
 
 
+/*
+ * rasqal_raptor_is_triples_source_factory:
+ * @factory: triples source factory
+ *
+ * INTERNAL - Test if a triples source factory is the built-in one
+ *
+ * Only the built-in triples source reads data graphs held in memory.
+ *
+ * Return value: non-0 if @factory was registered by rasqal_raptor_init()
+ */
+int
+rasqal_raptor_is_triples_source_factory(rasqal_triples_source_factory* factory)
+{
+  return factory->init_triples_source2 == rasqal_raptor_init_triples_source2;
+}
+
+
 typedef struct {
-  rasqal_raptor_triple *cur;
+  /* current triple or NULL at the end */
+  rasqal_triple *cur;
+  /* offset of cur */
+  int offset;
+  /* source index of cur */
+  int source;
   rasqal_raptor_triples_source_user_data* source_context;
   rasqal_triple match;
 
@@ -547,6 +1094,39 @@ typedef struct {
 } rasqal_raptor_triples_match_context;
 
 
+/*
+ * rasqal_raptor_match_from:
+ * @world: rasqal world
+ * @rtmc: triples match context
+ * @offset: triple offset to start from or <0 at the end
+ *
+ * INTERNAL - Move a triples match to the first matching triple from @offset
+ *
+ * Sets the current triple to NULL if no triple matches.
+ */
+static void
+rasqal_raptor_match_from(rasqal_world* world,
+                         rasqal_raptor_triples_match_context* rtmc,
+                         int offset)
+{
+  rasqal_raptor_triples_source_user_data* rtsc = rtmc->source_context;
+
+  rtmc->cur = NULL;
+
+  for(; offset >= 0;
+      offset = rasqal_raptor_source_next_triple(rtsc, &rtmc->source, offset,
+                                                &rtmc->match, rtmc->parts)) {
+    rasqal_triple* t = rasqal_raptor_get_triple(rtsc, offset);
+
+    if(rasqal_raptor_triple_match(world, t, &rtmc->match, rtmc->parts)) {
+      rtmc->cur = t;
+      rtmc->offset = offset;
+      break;
+    }
+  }
+}
+
+
 static rasqal_triple_parts
 rasqal_raptor_bind_match(struct rasqal_triples_match_s* rtm,
                          void *user_data,
@@ -562,7 +1142,7 @@ rasqal_raptor_bind_match(struct rasqal_triples_match_s* rtm,
 #ifdef RASQAL_DEBUG
   if(rtmc->cur) {
     RASQAL_DEBUG1("  matched statement ");
-    rasqal_triple_print(rtmc->cur->triple, stderr);
+    rasqal_triple_print(rtmc->cur, stderr);
     fputc('\n', stderr);
   } else
     RASQAL_FATAL1("  matched NO statement - BUG\n");
@@ -571,7 +1151,7 @@ rasqal_raptor_bind_match(struct rasqal_triples_match_s* rtm,
   /* set variable values from the fields of statement */
 
   if(bindings[0] && (parts & RASQAL_TRIPLE_SUBJECT)) {
-    rasqal_literal *l = rtmc->cur->triple->subject;
+    rasqal_literal *l = rtmc->cur->subject;
     RASQAL_DEBUG1("binding subject to variable\n");
     rasqal_variable_set_value(bindings[0], rasqal_new_literal_from_literal(l));
     result = RASQAL_TRIPLE_SUBJECT;
@@ -579,8 +1159,8 @@ rasqal_raptor_bind_match(struct rasqal_triples_match_s* rtm,
 
   if(bindings[1] && (parts & RASQAL_TRIPLE_PREDICATE)) {
     if(bindings[0] == bindings[1]) {
-      if(!rasqal_literal_equals_flags(rtmc->cur->triple->subject,
-                                      rtmc->cur->triple->predicate,
+      if(!rasqal_literal_equals_flags(rtmc->cur->subject,
+                                      rtmc->cur->predicate,
                                       RASQAL_COMPARE_RDF, &error))
         return (rasqal_triple_parts)0;
       if(error)
@@ -588,7 +1168,7 @@ rasqal_raptor_bind_match(struct rasqal_triples_match_s* rtm,
       
       RASQAL_DEBUG1("subject and predicate values match\n");
     } else {
-      rasqal_literal *l = rtmc->cur->triple->predicate;
+      rasqal_literal *l = rtmc->cur->predicate;
       RASQAL_DEBUG1("binding predicate to variable\n");
       rasqal_variable_set_value(bindings[1], rasqal_new_literal_from_literal(l));
       result = (rasqal_triple_parts)(result | RASQAL_TRIPLE_PREDICATE);
@@ -599,8 +1179,8 @@ rasqal_raptor_bind_match(struct rasqal_triples_match_s* rtm,
     int bind = 1;
     
     if(bindings[0] == bindings[2]) {
-      if(!rasqal_literal_equals_flags(rtmc->cur->triple->subject,
-                                      rtmc->cur->triple->object,
+      if(!rasqal_literal_equals_flags(rtmc->cur->subject,
+                                      rtmc->cur->object,
                                       RASQAL_COMPARE_RDF, &error))
         return (rasqal_triple_parts)0;
       if(error)
@@ -612,8 +1192,8 @@ rasqal_raptor_bind_match(struct rasqal_triples_match_s* rtm,
     if(bindings[1] == bindings[2] &&
        !(bindings[0] == bindings[1]) /* don't do this check if ?x ?x ?x */
        ) {
-      if(!rasqal_literal_equals_flags(rtmc->cur->triple->predicate,
-                                      rtmc->cur->triple->object,
+      if(!rasqal_literal_equals_flags(rtmc->cur->predicate,
+                                      rtmc->cur->object,
                                       RASQAL_COMPARE_RDF, &error))
         return (rasqal_triple_parts)0;
       if(error)
@@ -624,7 +1204,7 @@ rasqal_raptor_bind_match(struct rasqal_triples_match_s* rtm,
     }
     
     if(bind) {
-      rasqal_literal *l = rtmc->cur->triple->object;
+      rasqal_literal *l = rtmc->cur->object;
       RASQAL_DEBUG1("binding object to variable\n");
       rasqal_variable_set_value(bindings[2], rasqal_new_literal_from_literal(l));
       result = (rasqal_triple_parts)(result | RASQAL_TRIPLE_OBJECT);
@@ -633,7 +1213,7 @@ rasqal_raptor_bind_match(struct rasqal_triples_match_s* rtm,
 
   if(bindings[3] && (parts & RASQAL_TRIPLE_ORIGIN)) {
     rasqal_literal *l;
-    l = rasqal_new_literal_from_literal(rtmc->cur->triple->origin);
+    l = rasqal_new_literal_from_literal(rtmc->cur->origin);
     RASQAL_DEBUG1("binding origin to variable\n");
     rasqal_variable_set_value(bindings[3], l);
     result = (rasqal_triple_parts)(result | RASQAL_TRIPLE_ORIGIN);
@@ -653,41 +1233,43 @@ rasqal_raptor_next_match(struct rasqal_triples_match_s* rtm, void *user_data)
 
 #if 0
   if(rtmc->bind_parts & RASQAL_TRIPLE_SUBJECT) {
-    rasqal_variable* v = rasqal_literal_as_variable(rtmc->cur->triple->subject);
+    rasqal_variable* v = rasqal_literal_as_variable(rtmc->cur->subject);
     if(v)
       rasqal_variable_set_value(v, NULL);
   }
   if(rtmc->bind_parts & RASQAL_TRIPLE_PREDICATE) {
-    rasqal_variable* v = rasqal_literal_as_variable(rtmc->cur->triple->predicate);
+    rasqal_variable* v = rasqal_literal_as_variable(rtmc->cur->predicate);
     if(v)
       rasqal_variable_set_value(v, NULL);
   }
   if(rtmc->bind_parts & RASQAL_TRIPLE_OBJECT) {
-    rasqal_variable* v = rasqal_literal_as_variable(rtmc->cur->triple->object);
+    rasqal_variable* v = rasqal_literal_as_variable(rtmc->cur->object);
     if(v)
       rasqal_variable_set_value(v, NULL);
   }
   if(rtmc->bind_parts & RASQAL_TRIPLE_ORIGIN) {
-    rasqal_variable* v = rasqal_literal_as_variable(rtmc->cur->triple->origin);
+    rasqal_variable* v = rasqal_literal_as_variable(rtmc->cur->origin);
     if(v)
       rasqal_variable_set_value(v, NULL);
   }
 #endif
 
-  while(rtmc->cur) {
-    rtmc->cur = rtmc->cur->next;
+  if(!rtmc->cur)
+    return;
+
+  rasqal_raptor_match_from(rtm->world, rtmc,
+                           rasqal_raptor_source_next_triple(rtmc->source_context,
+                                                            &rtmc->source,
+                                                            rtmc->offset,
+                                                            &rtmc->match,
+                                                            rtmc->parts));
 #ifdef RASQAL_DEBUG
-    if(!rtmc->cur) {
-      RASQAL_DEBUG1("triple match ended when matching ");
-      rasqal_triple_print(&rtmc->match, stderr);
-      fputc('\n', stderr);
-    }
-#endif
-    if(rtmc->cur &&
-       rasqal_raptor_triple_match(rtm->world, rtmc->cur->triple, &rtmc->match,
-                                  rtmc->parts))
-      break;
+  if(!rtmc->cur) {
+    RASQAL_DEBUG1("triple match ended when matching ");
+    rasqal_triple_print(&rtmc->match, stderr);
+    fputc('\n', stderr);
   }
+#endif
 }
 
 static int
@@ -748,7 +1330,6 @@ rasqal_raptor_init_triples_match(rasqal_triples_match* rtm,
   rtm->user_data = rtmc;
 
   rtmc->source_context = rtsc;
-  rtmc->cur = rtsc->head;
   
   /* Parts we bind */
   rtmc->bind_parts = m->parts;
@@ -808,12 +1389,13 @@ rasqal_raptor_init_triples_match(rasqal_triples_match* rtm,
   }
   
 
-  while(rtmc->cur) {
-    if(rasqal_raptor_triple_match(rtm->world, rtmc->cur->triple, &rtmc->match,
-                                  rtmc->parts))
-      break;
-    rtmc->cur = rtmc->cur->next;
-  }
+  /* only walk the sources that can match the graph */
+  rtmc->source = 0;
+  rasqal_raptor_match_from(rtm->world, rtmc,
+                           rasqal_raptor_source_first_triple(rtsc,
+                                                             &rtmc->source,
+                                                             &rtmc->match,
+                                                             rtmc->parts));
   
   return 0;
 }
@@ -49,6 +49,8 @@
  * @second_count: number of variables in second query result
  * @variables_count: number of variables in @vt and @defined_in_map
  * @variables_in_both_count: number of shared variables in both query results
+ * @unordered: non-0 to compare rows as multisets rather than by position
+ * @max_differences: maximum number of row differences to report or 0 for all
  *
  * Lookup data constructed for comparing two query results to enable
  * quick mapping between values.
@@ -72,9 +74,53 @@ struct rasqal_results_compare_s {
   unsigned int second_count;
   unsigned int variables_count;
   unsigned int variables_in_both_count;
+
+  int unordered;
+  int max_differences;
 };
 
 
+/*
+ * rasqal_results_compare_side:
+ * @rows: stored rows of one query result
+ * @rows_count: number of rows in @rows
+ * @cell_hash: term hash of each cell (@rows_count * width); 0 for blanks
+ * @cell_blank: blank node id of each cell or -1 if not a blank node
+ * @row_hash: hash of each row using the current blank node signatures
+ * @blanks_count: number of distinct blank node labels
+ * @blank_sig: current signature of each blank node
+ * @blank_new_sig: signatures being computed by the next refinement round
+ *
+ * INTERNAL - Canonicalized form of one query result used by the
+ * unordered comparison.
+ */
+typedef struct {
+  rasqal_row** rows;
+  int rows_count;
+  uint64_t* cell_hash;
+  int* cell_blank;
+  uint64_t* row_hash;
+  int blanks_count;
+  uint64_t* blank_sig;
+  uint64_t* blank_new_sig;
+} rasqal_results_compare_side;
+
+
+/*
+ * rasqal_results_compare_entry:
+ * @hash: row hash
+ * @row: offset of representative row in the first result or -1 if unused
+ * @count: number of first result rows not yet matched by the second
+ *
+ * INTERNAL - Row multiset hash table entry
+ */
+typedef struct {
+  uint64_t hash;
+  int row;
+  int count;
+} rasqal_results_compare_entry;
+
+
 
 rasqal_results_compare*
 rasqal_new_results_compare(rasqal_world* world,
@@ -107,6 +153,9 @@ rasqal_new_results_compare(rasqal_world* world,
   rrc->message.locator = NULL;
   rrc->message.text = NULL;
 
+  rrc->unordered = 0;
+  rrc->max_differences = 0;
+
   rrc->first_count = RASQAL_GOOD_CAST(unsigned int, rasqal_variables_table_get_total_variables_count(first_vt));
   rrc->second_count = RASQAL_GOOD_CAST(unsigned int, rasqal_variables_table_get_total_variables_count(second_vt));
   rrc->variables_count = 0;
@@ -199,6 +248,46 @@ rasqal_results_compare_set_log_handler(rasqal_results_compare* rrc,
 }
 
 
+/**
+ * rasqal_results_compare_set_unordered:
+ * @rrc: results compare object
+ * @unordered: non-0 to compare results as multisets of rows
+ *
+ * Set whether query results comparer ignores row order
+ *
+ * When set, rasqal_results_compare_compare() matches rows by hashing
+ * canonicalized rows so the order of rows in either result does not
+ * matter but the number of times each row appears does.  Blank nodes
+ * are matched by structure rather than by label.
+ *
+ */
+void
+rasqal_results_compare_set_unordered(rasqal_results_compare* rrc,
+                                     int unordered)
+{
+  rrc->unordered = unordered;
+}
+
+
+/**
+ * rasqal_results_compare_set_max_differences:
+ * @rrc: results compare object
+ * @max_differences: maximum number of differences to report or 0 for all
+ *
+ * Set the number of differences query results comparer reports
+ *
+ * The comparison still runs to the end so the result is unaffected;
+ * only the number of log messages is limited.
+ *
+ */
+void
+rasqal_results_compare_set_max_differences(rasqal_results_compare* rrc,
+                                           int max_differences)
+{
+  rrc->max_differences = max_differences;
+}
+
+
 /**
  * rasqal_results_compare_variables_equal:
  * @rrc: results compare object
@@ -307,6 +396,548 @@ rasqal_print_results_compare(FILE *handle, rasqal_results_compare* rrc)
 }
 
 
+/* initial signature of every blank node */
+#define RRC_HASH_BLANK 0x9e3779b97f4a7c15ULL
+
+
+static void
+rasqal_results_compare_side_clear(rasqal_results_compare_side* side)
+{
+  int i;
+
+  if(side->rows) {
+    for(i = 0; i < side->rows_count; i++)
+      rasqal_free_row(side->rows[i]);
+    RASQAL_FREE(rasqal_row**, side->rows);
+  }
+  if(side->cell_hash)
+    RASQAL_FREE(uint64_t*, side->cell_hash);
+  if(side->cell_blank)
+    RASQAL_FREE(int*, side->cell_blank);
+  if(side->row_hash)
+    RASQAL_FREE(uint64_t*, side->row_hash);
+  if(side->blank_sig)
+    RASQAL_FREE(uint64_t*, side->blank_sig);
+  if(side->blank_new_sig)
+    RASQAL_FREE(uint64_t*, side->blank_new_sig);
+}
+
+
+/*
+ * rasqal_results_compare_side_init:
+ * @rrc: results compare object
+ * @side: side to fill
+ * @qr_index: results index 0 (first) or 1 (second)
+ *
+ * INTERNAL - Read all rows of a query result and hash their cells
+ *
+ * Cells are stored in the order of the shared variables table so
+ * rows of both results line up.  Blank nodes are numbered by label,
+ * their labels are otherwise ignored.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_results_compare_side_init(rasqal_results_compare* rrc,
+                                 rasqal_results_compare_side* side,
+                                 int qr_index)
+{
+  rasqal_query_results* qr = qr_index ? rrc->second_qr : rrc->first_qr;
+  unsigned int width = rrc->variables_count;
+  int rows_size = 16;
+  const unsigned char** labels = NULL;
+  int* table = NULL;
+  size_t table_size;
+  size_t cells;
+  size_t blank_cells = 0;
+  size_t ci;
+  int i;
+  int rc = 1;
+
+  if(rasqal_query_results_ensure_stored(qr))
+    goto tidy;
+
+  side->rows = RASQAL_MALLOC(rasqal_row**, RASQAL_GOOD_CAST(size_t, rows_size) * sizeof(rasqal_row*));
+  if(!side->rows)
+    goto tidy;
+
+  while(1) {
+    rasqal_row* row;
+
+    row = rasqal_query_results_get_row_by_offset(qr, side->rows_count);
+    if(!row)
+      break;
+
+    if(side->rows_count == rows_size) {
+      rasqal_row** new_rows;
+
+      new_rows = RASQAL_MALLOC(rasqal_row**,
+                               RASQAL_GOOD_CAST(size_t, rows_size << 1) * sizeof(rasqal_row*));
+      if(!new_rows) {
+        rasqal_free_row(row);
+        goto tidy;
+      }
+      memcpy(new_rows, side->rows,
+             RASQAL_GOOD_CAST(size_t, rows_size) * sizeof(rasqal_row*));
+      RASQAL_FREE(rasqal_row**, side->rows);
+      side->rows = new_rows;
+      rows_size <<= 1;
+    }
+    side->rows[side->rows_count++] = row;
+  }
+
+  cells = RASQAL_GOOD_CAST(size_t, side->rows_count) * width;
+  /* allocate at least one cell so empty results need no special case */
+  side->cell_hash = RASQAL_MALLOC(uint64_t*, (cells + 1) * sizeof(uint64_t));
+  side->cell_blank = RASQAL_MALLOC(int*, (cells + 1) * sizeof(int));
+  side->row_hash = RASQAL_MALLOC(uint64_t*, RASQAL_GOOD_CAST(size_t, side->rows_count + 1) * sizeof(uint64_t));
+  if(!side->cell_hash || !side->cell_blank || !side->row_hash)
+    goto tidy;
+
+  for(i = 0, ci = 0; i < side->rows_count; i++) {
+    rasqal_row* row = side->rows[i];
+    unsigned int j;
+
+    for(j = 0; j < width; j++, ci++) {
+      int ix = rrc->defined_in_map[qr_index + (RASQAL_GOOD_CAST(int, j) << 1)];
+      rasqal_literal* l = NULL;
+
+      if(ix >= 0 && ix < row->size)
+        l = row->values[ix];
+
+      side->cell_blank[ci] = -1;
+      if(l && l->type == RASQAL_LITERAL_BLANK) {
+        side->cell_hash[ci] = 0;
+        side->cell_blank[ci] = 0;
+        blank_cells++;
+      } else
+        side->cell_hash[ci] = rasqal_literal_hash_rdf_term(l);
+    }
+  }
+
+  /* Number the blank node labels with an open addressing table */
+  for(table_size = 16; table_size < (blank_cells << 1); table_size <<= 1)
+    ;
+  table = RASQAL_MALLOC(int*, table_size * sizeof(int));
+  labels = RASQAL_MALLOC(const unsigned char**, (blank_cells + 1) * sizeof(unsigned char*));
+  if(!table || !labels)
+    goto tidy;
+  for(ci = 0; ci < table_size; ci++)
+    table[ci] = -1;
+
+  for(i = 0, ci = 0; i < side->rows_count; i++) {
+    rasqal_row* row = side->rows[i];
+    unsigned int j;
+
+    for(j = 0; j < width; j++, ci++) {
+      int ix;
+      rasqal_literal* l;
+      size_t slot;
+
+      if(side->cell_blank[ci] < 0)
+        continue;
+
+      ix = rrc->defined_in_map[qr_index + (RASQAL_GOOD_CAST(int, j) << 1)];
+      l = row->values[ix];
+      slot = RASQAL_GOOD_CAST(size_t,
+               rasqal_hash_mix(rasqal_hash_bytes(0, l->string, l->string_len)));
+      slot &= table_size - 1;
+      while(table[slot] >= 0 &&
+            strcmp(RASQAL_GOOD_CAST(const char*, labels[table[slot]]),
+                   RASQAL_GOOD_CAST(const char*, l->string)))
+        slot = (slot + 1) & (table_size - 1);
+
+      if(table[slot] < 0) {
+        labels[side->blanks_count] = l->string;
+        table[slot] = side->blanks_count++;
+      }
+      side->cell_blank[ci] = table[slot];
+    }
+  }
+
+  side->blank_sig = RASQAL_MALLOC(uint64_t*, RASQAL_GOOD_CAST(size_t, side->blanks_count + 1) * sizeof(uint64_t));
+  side->blank_new_sig = RASQAL_MALLOC(uint64_t*, RASQAL_GOOD_CAST(size_t, side->blanks_count + 1) * sizeof(uint64_t));
+  if(!side->blank_sig || !side->blank_new_sig)
+    goto tidy;
+
+  for(i = 0; i < side->blanks_count; i++)
+    side->blank_sig[i] = RRC_HASH_BLANK;
+
+  rc = 0;
+
+  tidy:
+  if(table)
+    RASQAL_FREE(int*, table);
+  if(labels)
+    RASQAL_FREE(const unsigned char**, labels);
+
+  return rc;
+}
+
+
+/*
+ * rasqal_results_compare_side_hash_rows:
+ * @side: side
+ * @width: number of cells per row
+ *
+ * INTERNAL - Hash every row using the current blank node signatures
+ */
+static void
+rasqal_results_compare_side_hash_rows(rasqal_results_compare_side* side,
+                                      unsigned int width)
+{
+  size_t ci = 0;
+  int i;
+
+  for(i = 0; i < side->rows_count; i++) {
+    uint64_t hash = 0;
+    unsigned int j;
+
+    for(j = 0; j < width; j++, ci++) {
+      uint64_t cell;
+
+      if(side->cell_blank[ci] >= 0)
+        cell = side->blank_sig[side->cell_blank[ci]];
+      else
+        cell = side->cell_hash[ci];
+      hash = rasqal_hash_combine(hash, cell);
+    }
+    side->row_hash[i] = rasqal_hash_mix(hash);
+  }
+}
+
+
+static int
+rasqal_results_compare_uint64_compare(const void* a, const void* b)
+{
+  uint64_t ua = *(const uint64_t*)a;
+  uint64_t ub = *(const uint64_t*)b;
+
+  return (ua > ub) - (ua < ub);
+}
+
+
+/*
+ * rasqal_results_compare_side_refine:
+ * @side: side
+ * @width: number of cells per row
+ *
+ * INTERNAL - Run one round of blank node signature refinement
+ *
+ * Each blank node's new signature combines its old signature with
+ * the hashes of every row it appears in and the column it appears
+ * in.  The combination is a sum so it does not depend on row order.
+ * Row hashes must be up to date with the current signatures.
+ *
+ * Return value: number of distinct blank node signatures after the round
+ */
+static int
+rasqal_results_compare_side_refine(rasqal_results_compare_side* side,
+                                   unsigned int width)
+{
+  size_t ci = 0;
+  int i;
+  int distinct = 0;
+
+  for(i = 0; i < side->blanks_count; i++)
+    side->blank_new_sig[i] = rasqal_hash_mix(side->blank_sig[i]);
+
+  for(i = 0; i < side->rows_count; i++) {
+    unsigned int j;
+
+    for(j = 0; j < width; j++, ci++) {
+      int b = side->cell_blank[ci];
+
+      if(b >= 0)
+        side->blank_new_sig[b] +=
+          rasqal_hash_mix(side->row_hash[i] ^ ((uint64_t)(j + 1) * RRC_HASH_BLANK));
+    }
+  }
+
+  memcpy(side->blank_sig, side->blank_new_sig,
+         RASQAL_GOOD_CAST(size_t, side->blanks_count) * sizeof(uint64_t));
+
+  /* count distinct signatures; blank_new_sig is scratch space now */
+  qsort(side->blank_new_sig, RASQAL_GOOD_CAST(size_t, side->blanks_count),
+        sizeof(uint64_t), rasqal_results_compare_uint64_compare);
+  for(i = 0; i < side->blanks_count; i++) {
+    if(!i || side->blank_new_sig[i] != side->blank_new_sig[i - 1])
+      distinct++;
+  }
+
+  return distinct;
+}
+
+
+/*
+ * rasqal_results_compare_rows_equal:
+ * @rrc: results compare object
+ * @side1: side of first row
+ * @row1: offset of first row in @side1
+ * @qr_index1: results index @side1 was read from
+ * @side2: side of second row
+ * @row2: offset of second row in @side2
+ * @qr_index2: results index @side2 was read from
+ *
+ * INTERNAL - Check two rows with equal hashes really are equal
+ *
+ * Return value: non-0 if equal
+ */
+static int
+rasqal_results_compare_rows_equal(rasqal_results_compare* rrc,
+                                  rasqal_results_compare_side* side1,
+                                  int row1,
+                                  int qr_index1,
+                                  rasqal_results_compare_side* side2,
+                                  int row2,
+                                  int qr_index2)
+{
+  unsigned int width = rrc->variables_count;
+  size_t ci1 = RASQAL_GOOD_CAST(size_t, row1) * width;
+  size_t ci2 = RASQAL_GOOD_CAST(size_t, row2) * width;
+  unsigned int j;
+
+  for(j = 0; j < width; j++, ci1++, ci2++) {
+    int b1 = side1->cell_blank[ci1];
+    int b2 = side2->cell_blank[ci2];
+    int ix1;
+    int ix2;
+    rasqal_literal* l1 = NULL;
+    rasqal_literal* l2 = NULL;
+    int error = 0;
+
+    if(b1 >= 0 || b2 >= 0) {
+      if(b1 < 0 || b2 < 0 || side1->blank_sig[b1] != side2->blank_sig[b2])
+        return 0;
+      continue;
+    }
+
+    if(side1->cell_hash[ci1] != side2->cell_hash[ci2])
+      return 0;
+
+    ix1 = rrc->defined_in_map[qr_index1 + (RASQAL_GOOD_CAST(int, j) << 1)];
+    ix2 = rrc->defined_in_map[qr_index2 + (RASQAL_GOOD_CAST(int, j) << 1)];
+    if(ix1 >= 0 && ix1 < side1->rows[row1]->size)
+      l1 = side1->rows[row1]->values[ix1];
+    if(ix2 >= 0 && ix2 < side2->rows[row2]->size)
+      l2 = side2->rows[row2]->values[ix2];
+
+    if(!rasqal_literal_equals_flags(l1, l2, RASQAL_COMPARE_RDF, &error) ||
+       error)
+      return 0;
+  }
+
+  return 1;
+}
+
+
+/*
+ * rasqal_results_compare_report_row:
+ * @rrc: results compare object
+ * @row: row
+ * @qr_index: results index 0 (first) or 1 (second) @row is from
+ * @count: number of unmatched copies of @row
+ *
+ * INTERNAL - Log a row that appears in only one of the results
+ */
+static void
+rasqal_results_compare_report_row(rasqal_results_compare* rrc,
+                                  rasqal_row* row, int qr_index, int count)
+{
+  raptor_world* raptor_world_ptr;
+  void *string;
+  size_t length;
+  raptor_iostream* string_iostr;
+  unsigned int j;
+
+  raptor_world_ptr = rasqal_world_get_raptor(rrc->world);
+
+  string_iostr = raptor_new_iostream_to_string(raptor_world_ptr,
+                                               &string, &length,
+                                               (raptor_data_malloc_handler)malloc);
+  if(!string_iostr)
+    return;
+
+  raptor_iostream_counted_string_write("Row ", 4, string_iostr);
+  raptor_iostream_decimal_write(row->offset + 1, string_iostr);
+  raptor_iostream_counted_string_write(" only in ", 9, string_iostr);
+  raptor_iostream_string_write(qr_index ? rrc->second_qr_label : rrc->first_qr_label,
+                               string_iostr);
+  if(count > 1) {
+    raptor_iostream_counted_string_write(" (", 2, string_iostr);
+    raptor_iostream_decimal_write(count, string_iostr);
+    raptor_iostream_counted_string_write(" times)", 7, string_iostr);
+  }
+  raptor_iostream_counted_string_write(": [", 3, string_iostr);
+  for(j = 0; j < rrc->variables_count; j++) {
+    rasqal_variable* v;
+    int ix;
+    rasqal_literal* l = NULL;
+
+    v = rasqal_results_compare_get_variable_by_offset(rrc, RASQAL_GOOD_CAST(int, j));
+    ix = rrc->defined_in_map[qr_index + (RASQAL_GOOD_CAST(int, j) << 1)];
+    if(ix >= 0 && ix < row->size)
+      l = row->values[ix];
+
+    if(j > 0)
+      raptor_iostream_counted_string_write(", ", 2, string_iostr);
+    raptor_iostream_string_write(v->name, string_iostr);
+    raptor_iostream_write_byte('=', string_iostr);
+    rasqal_literal_write(l, string_iostr);
+  }
+  raptor_iostream_write_byte(']', string_iostr);
+
+  /* this allocates and copies result into 'string' */
+  raptor_free_iostream(string_iostr);
+
+  rrc->message.level = RAPTOR_LOG_LEVEL_ERROR;
+  rrc->message.text = (const char*)string;
+  if(rrc->log_handler)
+    rrc->log_handler(rrc->log_user_data, &rrc->message);
+
+  free(string);
+}
+
+
+/*
+ * rasqal_results_compare_compare_unordered:
+ * @rrc: results compare object
+ *
+ * INTERNAL - Compare two query results as multisets of rows
+ *
+ * Rows are canonicalized to the shared variable order and hashed.
+ * Blank nodes are given structural signatures by repeatedly hashing
+ * each blank node with the rows it appears in (colour refinement as
+ * used for graph isomorphism) until the number of distinct signatures
+ * stops growing, so relabelled blank nodes match.  As with any colour
+ * refinement, some highly regular blank node structures cannot be
+ * told apart.
+ *
+ * The rows of the first result are then counted in a hash table and
+ * the rows of the second result are matched against it, so the
+ * comparison is linear in the number of rows.
+ *
+ * Return value: number of rows that did not match or <0 on failure
+ */
+static int
+rasqal_results_compare_compare_unordered(rasqal_results_compare* rrc)
+{
+  rasqal_results_compare_side side1;
+  rasqal_results_compare_side side2;
+  rasqal_results_compare_entry* table = NULL;
+  size_t table_size;
+  unsigned int width = rrc->variables_count;
+  int distinct1 = 1;
+  int distinct2 = 1;
+  int rounds;
+  int reported = 0;
+  int differences = 0;
+  int i;
+  size_t ti;
+
+  memset(&side1, '\0', sizeof(side1));
+  memset(&side2, '\0', sizeof(side2));
+
+  if(rasqal_results_compare_side_init(rrc, &side1, 0) ||
+     rasqal_results_compare_side_init(rrc, &side2, 1)) {
+    differences = -1;
+    goto tidy;
+  }
+
+  /* Refine both sides in lock step so their signatures stay comparable */
+  rasqal_results_compare_side_hash_rows(&side1, width);
+  rasqal_results_compare_side_hash_rows(&side2, width);
+  /* Partitions only get finer so this ends within blanks_count rounds */
+  rounds = 1 + (side1.blanks_count > side2.blanks_count ?
+                side1.blanks_count : side2.blanks_count);
+  while((side1.blanks_count || side2.blanks_count) && rounds--) {
+    int new_distinct1 = rasqal_results_compare_side_refine(&side1, width);
+    int new_distinct2 = rasqal_results_compare_side_refine(&side2, width);
+
+    rasqal_results_compare_side_hash_rows(&side1, width);
+    rasqal_results_compare_side_hash_rows(&side2, width);
+
+    if(new_distinct1 == distinct1 && new_distinct2 == distinct2)
+      break;
+    distinct1 = new_distinct1;
+    distinct2 = new_distinct2;
+  }
+
+  for(table_size = 16;
+      table_size < (RASQAL_GOOD_CAST(size_t, side1.rows_count) << 1);
+      table_size <<= 1)
+    ;
+  table = RASQAL_MALLOC(rasqal_results_compare_entry*,
+                        table_size * sizeof(*table));
+  if(!table) {
+    differences = -1;
+    goto tidy;
+  }
+  for(ti = 0; ti < table_size; ti++)
+    table[ti].row = -1;
+
+  for(i = 0; i < side1.rows_count; i++) {
+    uint64_t hash = side1.row_hash[i];
+
+    ti = RASQAL_GOOD_CAST(size_t, hash) & (table_size - 1);
+    while(table[ti].row >= 0 &&
+          (table[ti].hash != hash ||
+           !rasqal_results_compare_rows_equal(rrc, &side1, table[ti].row, 0,
+                                              &side1, i, 0)))
+      ti = (ti + 1) & (table_size - 1);
+
+    if(table[ti].row < 0) {
+      table[ti].hash = hash;
+      table[ti].row = i;
+      table[ti].count = 0;
+    }
+    table[ti].count++;
+  }
+
+  for(i = 0; i < side2.rows_count; i++) {
+    uint64_t hash = side2.row_hash[i];
+
+    ti = RASQAL_GOOD_CAST(size_t, hash) & (table_size - 1);
+    while(table[ti].row >= 0 &&
+          (table[ti].hash != hash ||
+           !rasqal_results_compare_rows_equal(rrc, &side1, table[ti].row, 0,
+                                              &side2, i, 1)))
+      ti = (ti + 1) & (table_size - 1);
+
+    if(table[ti].row >= 0 && table[ti].count > 0) {
+      table[ti].count--;
+      continue;
+    }
+
+    differences++;
+    if(!rrc->max_differences || reported < rrc->max_differences) {
+      rasqal_results_compare_report_row(rrc, side2.rows[i], 1, 1);
+      reported++;
+    }
+  }
+
+  for(ti = 0; ti < table_size; ti++) {
+    if(table[ti].row < 0 || !table[ti].count)
+      continue;
+
+    differences += table[ti].count;
+    if(!rrc->max_differences || reported < rrc->max_differences) {
+      rasqal_results_compare_report_row(rrc, side1.rows[table[ti].row], 0,
+                                        table[ti].count);
+      reported++;
+    }
+  }
+
+  tidy:
+  if(table)
+    RASQAL_FREE(rasqal_results_compare_entry*, table);
+  rasqal_results_compare_side_clear(&side1);
+  rasqal_results_compare_side_clear(&side2);
+
+  return differences;
+}
+
+
 /**
  * rasqal_results_compare_compare:
  * @cqr: query results object
@@ -360,12 +991,23 @@ rasqal_results_compare_compare(rasqal_results_compare* rrc)
     }
   }
 
-  /* set results to be stored? */
+  if(rrc->unordered) {
+    int rc = rasqal_results_compare_compare_unordered(rrc);
 
-  /* sort rows by something ?  As long as the sort is the same it
-   * probably does not matter what the method is. */
+    if(rc < 0) {
+      rrc->message.level = RAPTOR_LOG_LEVEL_ERROR;
+      rrc->message.text = "Failed to read results for comparing";
+      if(rrc->log_handler)
+        rrc->log_handler(rrc->log_user_data, &rrc->message);
+      differences++;
+    } else
+      row_differences_count = rc;
+
+    differences += row_differences_count;
+    goto values_done;
+  }
 
-  /* what to do about blank nodes? */
+  /* Blank nodes are only matched structurally in unordered mode */
 
   /* for each row */
   for(rowi = 0; 1; rowi++) {
@@ -412,6 +1054,11 @@ rasqal_results_compare_compare(rasqal_results_compare* rrc)
         size_t length;
         raptor_iostream* string_iostr;
 
+        differences++;
+        this_row_different = 1;
+        if(rrc->max_differences && differences > rrc->max_differences)
+          continue;
+
         raptor_world_ptr = rasqal_world_get_raptor(rrc->world);
 
         string_iostr = raptor_new_iostream_to_string(raptor_world_ptr,
@@ -453,9 +1100,6 @@ rasqal_results_compare_compare(rasqal_results_compare* rrc)
           rrc->log_handler(rrc->log_user_data, &rrc->message);
 
         free(string);
-
-        differences++;
-        this_row_different = 1;
       }
     } /* end for each var */
 
@@ -471,6 +1115,7 @@ rasqal_results_compare_compare(rasqal_results_compare* rrc)
     rasqal_query_results_next(rrc->second_qr);
   } /* end for each row */
 
+  values_done:
   if(row_differences_count) {
     rrc->message.level = RAPTOR_LOG_LEVEL_ERROR;
     rrc->message.text = "Results have different values";
@@ -514,6 +1159,121 @@ const struct {
 };
 
 
+#define NCOMPARE_TESTS 11
+
+/* maximum number of row differences reported by the compare tests */
+#define COMPARE_MAX_DIFFERENCES 2
+
+const struct {
+  const char* first_qr_string;
+  const char* second_qr_string;
+  int expected_equality;
+  /* rows reported or -1 to only check COMPARE_MAX_DIFFERENCES */
+  int expected_reported;
+} compare_data[NCOMPARE_TESTS] = {
+  /* same rows in a different order */
+  {
+    "x\ty\n\"a\"\t<http://example.org/1>\n\"b\"\t<http://example.org/2>\n",
+    "y\tx\n<http://example.org/2>\t\"b\"\n<http://example.org/1>\t\"a\"\n",
+    1, 0
+  },
+  /* row multiplicity matters */
+  {
+    "x\n\"a\"\n\"a\"\n\"b\"\n",
+    "x\n\"a\"\n\"b\"\n\"b\"\n",
+    0, 2
+  },
+  /* row multiplicity matters when one side has fewer rows */
+  {
+    "x\n\"a\"\n\"a\"\n\"b\"\n",
+    "x\n\"a\"\n\"b\"\n",
+    0, 1
+  },
+  /* different value */
+  {
+    "x\n\"a\"\n",
+    "x\n\"c\"\n",
+    0, 2
+  },
+  /* more differences than are reported */
+  {
+    "x\n\"a\"\n\"b\"\n\"c\"\n",
+    "x\n\"d\"\n\"e\"\n\"f\"\n",
+    0, COMPARE_MAX_DIFFERENCES
+  },
+  /* relabelled blank nodes in a different order */
+  {
+    "x\ty\n_:a\t_:b\n_:b\t_:a\n_:c\t\"c\"\n",
+    "x\ty\n_:z\t\"c\"\n_:p\t_:q\n_:q\t_:p\n",
+    1, 0
+  },
+  /* relabelled blank node shared across rows */
+  {
+    "x\ty\n_:a\t\"1\"\n_:a\t\"2\"\n",
+    "x\ty\n_:z\t\"2\"\n_:z\t\"1\"\n",
+    1, 0
+  },
+  /* shared blank nodes versus distinct blank nodes */
+  {
+    "x\ty\n_:a\t_:b\n_:b\t_:a\n",
+    "x\ty\n_:c\t_:d\n_:e\t_:f\n",
+    0, -1
+  },
+  /* blank node shared across rows versus one per row */
+  {
+    "x\ty\n_:a\t\"1\"\n_:a\t\"2\"\n",
+    "x\ty\n_:b\t\"1\"\n_:c\t\"2\"\n",
+    0, -1
+  },
+  /* blank node shared within a row versus distinct blank nodes */
+  {
+    "x\ty\n_:a\t_:a\n",
+    "x\ty\n_:b\t_:c\n",
+    0, -1
+  },
+  /* blank nodes distinguished only through another row */
+  {
+    "x\ty\n_:a\t\"1\"\n_:b\t\"2\"\n_:a\t\"3\"\n",
+    "x\ty\n_:a\t\"1\"\n_:b\t\"2\"\n_:b\t\"3\"\n",
+    0, -1
+  }
+};
+
+
+/* Count the row difference reports */
+static void
+compare_test_log_handler(void *user_data, raptor_log_message *message)
+{
+  int* reported = (int*)user_data;
+
+  if(!strncmp(message->text, "Row ", 4))
+    (*reported)++;
+}
+
+
+#ifdef RASQAL_QUERY_SPARQL
+/* executed query results are read lazily, not stored */
+static const char* const executed_query_string =
+  "SELECT ?x ?y WHERE { VALUES (?x ?y) { (\"a\" \"1\") (\"b\" \"2\") (\"a\" \"3\") } }";
+
+#define NEXECUTED_TESTS 2
+
+const struct {
+  const char* qr_string;
+  int expected_equality;
+} executed_data[NEXECUTED_TESTS] = {
+  {
+    "y\tx\n\"3\"\t\"a\"\n\"2\"\t\"b\"\n\"1\"\t\"a\"\n",
+    1
+  },
+  {
+    "y\tx\n\"3\"\t\"a\"\n\"2\"\t\"b\"\n",
+    0
+  }
+};
+#endif
+
+
 #if defined(RASQAL_DEBUG) && RASQAL_DEBUG > 1
 static void
 print_bindings_results_simple(rasqal_query_results *results, FILE* output)
@@ -615,6 +1375,117 @@ main(int argc, char *argv[])
       rasqal_free_results_compare(rrc);
   }
 
+  for(i = 0; i < NCOMPARE_TESTS; i++) {
+    raptor_uri* base_uri = raptor_new_uri(raptor_world_ptr,
+                                          (const unsigned char*)"http://example.org/");
+    rasqal_query_results *first_qr;
+    rasqal_query_results *second_qr;
+    int expected_equality = compare_data[i].expected_equality;
+    int expected_reported = compare_data[i].expected_reported;
+    rasqal_results_compare* rrc = NULL;
+    int equal;
+    int reported = 0;
+
+    first_qr = rasqal_new_query_results_from_string(world, type, base_uri,
+                                                    compare_data[i].first_qr_string,
+                                                    0);
+    second_qr = rasqal_new_query_results_from_string(world, type, base_uri,
+                                                     compare_data[i].second_qr_string,
+                                                     0);
+    raptor_free_uri(base_uri);
+
+    if(first_qr && second_qr)
+      rrc = rasqal_new_results_compare(world, first_qr, "first",
+                                       second_qr, "second");
+    if(!rrc) {
+      fprintf(stderr, "%s: failed to create results compare %d\n",
+              program, i);
+      failures++;
+    } else {
+      rasqal_results_compare_set_unordered(rrc, 1);
+      rasqal_results_compare_set_max_differences(rrc, COMPARE_MAX_DIFFERENCES);
+      rasqal_results_compare_set_log_handler(rrc, &reported,
+                                             compare_test_log_handler);
+
+      equal = rasqal_results_compare_compare(rrc);
+      RASQAL_DEBUG4("%s: unordered compare test %d returned %d\n", program, i, equal);
+      if(equal != expected_equality) {
+        fprintf(stderr,
+                "%s: FAILED unordered compare test %d returned %d  expected %d\n",
+                program, i, equal, expected_equality);
+        failures++;
+      }
+
+      if(reported > COMPARE_MAX_DIFFERENCES ||
+         (expected_reported >= 0 && reported != expected_reported)) {
+        fprintf(stderr,
+                "%s: FAILED unordered compare test %d reported %d rows  expected %d\n",
+                program, i, reported, expected_reported);
+        failures++;
+      }
+    }
+
+    if(first_qr)
+      rasqal_free_query_results(first_qr);
+    if(second_qr)
+      rasqal_free_query_results(second_qr);
+    if(rrc)
+      rasqal_free_results_compare(rrc);
+  }
+
+#ifdef RASQAL_QUERY_SPARQL
+  for(i = 0; i < NEXECUTED_TESTS; i++) {
+    raptor_uri* base_uri = raptor_new_uri(raptor_world_ptr,
+                                          (const unsigned char*)"http://example.org/");
+    rasqal_query* query;
+    rasqal_query_results *first_qr = NULL;
+    rasqal_query_results *second_qr;
+    int expected_equality = executed_data[i].expected_equality;
+    rasqal_results_compare* rrc = NULL;
+    int equal;
+
+    query = rasqal_new_query(world, "sparql", NULL);
+    if(query &&
+       !rasqal_query_prepare(query,
+                             (const unsigned char*)executed_query_string,
+                             base_uri))
+      first_qr = rasqal_query_execute(query);
+    second_qr = rasqal_new_query_results_from_string(world, type, base_uri,
+                                                     executed_data[i].qr_string,
+                                                     0);
+    raptor_free_uri(base_uri);
+
+    if(first_qr && second_qr)
+      rrc = rasqal_new_results_compare(world, first_qr, "executed",
+                                       second_qr, "expected");
+    if(!rrc) {
+      fprintf(stderr, "%s: failed to create executed results compare %d\n",
+              program, i);
+      failures++;
+    } else {
+      rasqal_results_compare_set_unordered(rrc, 1);
+
+      equal = rasqal_results_compare_compare(rrc);
+      RASQAL_DEBUG4("%s: executed compare test %d returned %d\n", program, i, equal);
+      if(equal != expected_equality) {
+        fprintf(stderr,
+                "%s: FAILED executed compare test %d returned %d  expected %d\n",
+                program, i, equal, expected_equality);
+        failures++;
+      }
+    }
+
+    if(rrc)
+      rasqal_free_results_compare(rrc);
+    if(first_qr)
+      rasqal_free_query_results(first_qr);
+    if(second_qr)
+      rasqal_free_query_results(second_qr);
+    if(query)
+      rasqal_free_query(query);
+  }
+#endif
+
   if(world)
     rasqal_free_world(world);
 
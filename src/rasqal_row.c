@@ -175,6 +175,8 @@ rasqal_free_row(rasqal_row* row)
     }
     RASQAL_FREE(array, row->order_values);
   }
+  if(row->order_key)
+    RASQAL_FREE(char*, row->order_key);
 
   if(row->rowsource)
     rasqal_free_rowsource(row->rowsource);
@@ -720,3 +722,64 @@ rasqal_row_get_variable_by_offset(rasqal_row* row, int offset)
 
   return rasqal_rowsource_get_variable_by_offset(row->rowsource, offset);
 }
+
+
+/**
+ * rasqal_row_hash:
+ * @row: row
+ * @flags: comparison flags as for rasqal_literal_equals_flags()
+ *
+ * INTERNAL - Hash all values of a row
+ *
+ * Rows whose values are pairwise equal by
+ * rasqal_literal_equals_flags() with @flags have the same hash.
+ * Unbound values are hashed too so their positions matter.
+ *
+ * Return value: hash
+ */
+uint64_t
+rasqal_row_hash(rasqal_row* row, int flags)
+{
+  uint64_t hash = 0;
+  int i;
+
+  for(i = 0; i < row->size; i++)
+    hash = rasqal_hash_combine(hash,
+                               rasqal_literal_hash_flags(row->values[i], flags));
+
+  return rasqal_hash_mix(hash);
+}
+
+
+/**
+ * rasqal_row_hash_by_offsets:
+ * @row: row
+ * @offsets: array of value offsets into @row
+ * @count: number of offsets in @offsets
+ * @flags: comparison flags as for rasqal_literal_equals_flags()
+ *
+ * INTERNAL - Hash a subset of row values such as join or group keys
+ *
+ * Offsets outside the row are hashed as unbound values.
+ *
+ * Return value: hash
+ */
+uint64_t
+rasqal_row_hash_by_offsets(rasqal_row* row, const int* offsets, int count,
+                           int flags)
+{
+  uint64_t hash = 0;
+  int i;
+
+  for(i = 0; i < count; i++) {
+    int offset = offsets[i];
+    rasqal_literal* l = NULL;
+
+    if(offset >= 0 && offset < row->size)
+      l = row->values[offset];
+
+    hash = rasqal_hash_combine(hash, rasqal_literal_hash_flags(l, flags));
+  }
+
+  return rasqal_hash_mix(hash);
+}
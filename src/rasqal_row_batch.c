@@ -0,0 +1,495 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_row_batch.c - Rasqal Query Result Row Batch
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+
+#ifndef STANDALONE
+
+/**
+ * rasqal_new_row_batch:
+ * @rowsource: rowsource the rows will be read from
+ * @capacity: maximum number of rows
+ *
+ * INTERNAL - Create a new empty batch of rows for a rowsource
+ *
+ * The batch has one column per rowsource variable so the rowsource
+ * variables are ensured here.  The batch does not hold a reference
+ * to @rowsource which must outlive it.
+ *
+ * Return value: new batch or NULL on failure
+ */
+rasqal_row_batch*
+rasqal_new_row_batch(rasqal_rowsource* rowsource, int capacity)
+{
+  rasqal_row_batch* batch;
+
+  if(!rowsource || capacity < 1)
+    return NULL;
+
+  if(rasqal_rowsource_ensure_variables(rowsource))
+    return NULL;
+
+  batch = RASQAL_CALLOC(rasqal_row_batch*, 1, sizeof(*batch));
+  if(!batch)
+    return NULL;
+
+  batch->rowsource = rowsource;
+  batch->size = rasqal_rowsource_get_size(rowsource);
+  batch->capacity = capacity;
+  batch->count = 0;
+
+  if(batch->size > 0) {
+    batch->columns = RASQAL_CALLOC(rasqal_literal**,
+                                   RASQAL_GOOD_CAST(size_t, batch->size) * RASQAL_GOOD_CAST(size_t, capacity),
+                                   sizeof(rasqal_literal*));
+    if(!batch->columns)
+      goto fail;
+  }
+
+  batch->offsets = RASQAL_CALLOC(int*, RASQAL_GOOD_CAST(size_t, capacity),
+                                 sizeof(int));
+  batch->group_ids = RASQAL_CALLOC(int*, RASQAL_GOOD_CAST(size_t, capacity),
+                                   sizeof(int));
+  if(!batch->offsets || !batch->group_ids)
+    goto fail;
+
+  return batch;
+
+  fail:
+  rasqal_free_row_batch(batch);
+  return NULL;
+}
+
+
+/**
+ * rasqal_free_row_batch:
+ * @batch: batch
+ *
+ * INTERNAL - Destructor - free a batch of rows and all the values in it
+ */
+void
+rasqal_free_row_batch(rasqal_row_batch* batch)
+{
+  if(!batch)
+    return;
+
+  if(batch->columns) {
+    rasqal_row_batch_clear(batch);
+    RASQAL_FREE(rasqal_literal**, batch->columns);
+  }
+  if(batch->offsets)
+    RASQAL_FREE(int*, batch->offsets);
+  if(batch->group_ids)
+    RASQAL_FREE(int*, batch->group_ids);
+
+  RASQAL_FREE(rasqal_row_batch, batch);
+}
+
+
+/**
+ * rasqal_row_batch_clear:
+ * @batch: batch
+ *
+ * INTERNAL - Remove all rows from a batch
+ */
+void
+rasqal_row_batch_clear(rasqal_row_batch* batch)
+{
+  int c;
+  int r;
+
+  for(c = 0; c < batch->size; c++) {
+    for(r = 0; r < batch->count; r++) {
+      rasqal_literal** value_p = &RASQAL_ROW_BATCH_VALUE(batch, c, r);
+
+      if(*value_p) {
+        rasqal_free_literal(*value_p);
+        *value_p = NULL;
+      }
+    }
+  }
+
+  batch->count = 0;
+}
+
+
+/**
+ * rasqal_row_batch_new_row:
+ * @batch: batch
+ *
+ * INTERNAL - Add an empty row to a batch
+ *
+ * Return value: index of the new row or <0 if the batch is full
+ */
+int
+rasqal_row_batch_new_row(rasqal_row_batch* batch)
+{
+  int index;
+
+  if(batch->count >= batch->capacity)
+    return -1;
+
+  index = batch->count++;
+  batch->offsets[index] = 0;
+  batch->group_ids[index] = -1;
+
+  return index;
+}
+
+
+/**
+ * rasqal_row_batch_add_row:
+ * @batch: batch
+ * @row: row to add
+ *
+ * INTERNAL - Add the values of a row to a batch
+ *
+ * The row is not consumed.
+ *
+ * Return value: non-0 on failure or if the batch is full
+ */
+int
+rasqal_row_batch_add_row(rasqal_row_batch* batch, rasqal_row* row)
+{
+  int index;
+  int size;
+  int i;
+
+  index = rasqal_row_batch_new_row(batch);
+  if(index < 0)
+    return 1;
+
+  size = (row->size < batch->size) ? row->size : batch->size;
+  for(i = 0; i < size; i++) {
+    if(row->values[i])
+      RASQAL_ROW_BATCH_VALUE(batch, i, index) = rasqal_new_literal_from_literal(row->values[i]);
+  }
+
+  batch->offsets[index] = row->offset;
+  batch->group_ids[index] = row->group_id;
+
+  return 0;
+}
+
+
+/**
+ * rasqal_row_batch_merge_values:
+ * @batch: batch
+ * @index: row in @batch to set values in
+ * @src: batch to copy values from
+ * @src_index: row in @src
+ * @map: array mapping @src columns to @batch columns (<0 to skip) or NULL if the columns are the same
+ *
+ * INTERNAL - Set the unset values of a batch row from a row of another batch
+ */
+void
+rasqal_row_batch_merge_values(rasqal_row_batch* batch, int index,
+                              rasqal_row_batch* src, int src_index, int* map)
+{
+  int i;
+
+  for(i = 0; i < src->size; i++) {
+    rasqal_literal* l = RASQAL_ROW_BATCH_VALUE(src, i, src_index);
+    int dest_i = map ? map[i] : i;
+
+    if(!l || dest_i < 0 || dest_i >= batch->size)
+      continue;
+
+    if(!RASQAL_ROW_BATCH_VALUE(batch, dest_i, index))
+      RASQAL_ROW_BATCH_VALUE(batch, dest_i, index) = rasqal_new_literal_from_literal(l);
+  }
+}
+
+
+/**
+ * rasqal_row_batch_get_row:
+ * @batch: batch
+ * @index: row in @batch
+ *
+ * INTERNAL - Make a row from a batch row
+ *
+ * Return value: new row for the batch rowsource or NULL on failure
+ */
+rasqal_row*
+rasqal_row_batch_get_row(rasqal_row_batch* batch, int index)
+{
+  rasqal_row* row;
+  int i;
+
+  if(index < 0 || index >= batch->count)
+    return NULL;
+
+  row = rasqal_new_row(batch->rowsource);
+  if(!row)
+    return NULL;
+
+  for(i = 0; i < batch->size && i < row->size; i++) {
+    rasqal_literal* l = RASQAL_ROW_BATCH_VALUE(batch, i, index);
+    if(l)
+      row->values[i] = rasqal_new_literal_from_literal(l);
+  }
+
+  row->offset = batch->offsets[index];
+  row->group_id = batch->group_ids[index];
+
+  return row;
+}
+
+
+/**
+ * rasqal_row_batch_bind_row:
+ * @batch: batch
+ * @index: row in @batch
+ *
+ * INTERNAL - Bind the batch rowsource variables to the values of a batch row
+ *
+ * This is rasqal_row_bind_variables() for a row held in a batch.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_row_batch_bind_row(rasqal_row_batch* batch, int index)
+{
+  int i;
+
+  for(i = 0; i < batch->size; i++) {
+    rasqal_variable* v;
+
+    v = rasqal_rowsource_get_variable_by_offset(batch->rowsource, i);
+    if(v) {
+      rasqal_literal *value = RASQAL_ROW_BATCH_VALUE(batch, i, index);
+      if(value) {
+        value = rasqal_new_literal_from_literal(value);
+        if(!value)
+          return 1;
+      }
+
+      /* it is OK to bind to NULL */
+      rasqal_variable_set_value(v, value);
+    }
+  }
+
+  return 0;
+}
+
+
+/**
+ * rasqal_row_batch_remove_rows:
+ * @batch: batch
+ * @keep: array of @batch count flags; non-0 to keep the row
+ *
+ * INTERNAL - Remove rows from a batch keeping the order of the rest
+ */
+void
+rasqal_row_batch_remove_rows(rasqal_row_batch* batch, const char* keep)
+{
+  int c;
+  int r;
+  int count = 0;
+
+  for(r = 0; r < batch->count; r++) {
+    if(!keep[r]) {
+      for(c = 0; c < batch->size; c++) {
+        rasqal_literal** value_p = &RASQAL_ROW_BATCH_VALUE(batch, c, r);
+        if(*value_p) {
+          rasqal_free_literal(*value_p);
+          *value_p = NULL;
+        }
+      }
+      continue;
+    }
+
+    if(r != count) {
+      for(c = 0; c < batch->size; c++) {
+        RASQAL_ROW_BATCH_VALUE(batch, c, count) = RASQAL_ROW_BATCH_VALUE(batch, c, r);
+        RASQAL_ROW_BATCH_VALUE(batch, c, r) = NULL;
+      }
+      batch->offsets[count] = batch->offsets[r];
+      batch->group_ids[count] = batch->group_ids[r];
+    }
+    count++;
+  }
+
+  batch->count = count;
+}
+
+
+#endif /* not STANDALONE */
+
+
+
+#ifdef STANDALONE
+
+/* one more prototype */
+int main(int argc, char *argv[]);
+
+
+const char* const batch_data_2x5_rows[] =
+{
+  /* 2 variable names and 5 rows */
+  "a",   NULL, "b",   NULL,
+  /* row 1 data */
+  "foo", NULL, "red", NULL,
+  /* row 2 data */
+  "baz", NULL, "blue", NULL,
+  /* row 3 data */
+  "bob", NULL, "green", NULL,
+  /* row 4 data */
+  "sue", NULL, NULL, NULL,
+  /* row 5 data */
+  "jim", NULL, "red", NULL,
+  /* end of data */
+  NULL, NULL, NULL, NULL
+};
+
+#define EXPECTED_ROWS_COUNT 5
+
+/* batches of 2 rows: 2, 2, 1 then 0 at the end */
+#define TEST_BATCH_SIZE 2
+
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  rasqal_world* world = NULL;
+  rasqal_query* query = NULL;
+  rasqal_rowsource *rowsource = NULL;
+  rasqal_row_batch* batch = NULL;
+  raptor_sequence* seq = NULL;
+  raptor_sequence* vars_seq = NULL;
+  rasqal_variables_table* vt;
+  char keep[TEST_BATCH_SIZE];
+  int failures = 0;
+  int total = 0;
+  int kept = 0;
+  int count;
+  int i;
+
+  world = rasqal_new_world(); rasqal_world_open(world);
+
+  query = rasqal_new_query(world, "sparql", NULL);
+
+  vt = query->vars_table;
+
+  seq = rasqal_new_row_sequence(world, vt, batch_data_2x5_rows, 2, &vars_seq);
+  if(!seq) {
+    fprintf(stderr, "%s: failed to create sequence\n", program);
+    failures++;
+    goto tidy;
+  }
+
+  rowsource = rasqal_new_rowsequence_rowsource(world, query, vt, seq, vars_seq);
+  if(!rowsource) {
+    fprintf(stderr, "%s: failed to create rowsequence rowsource\n", program);
+    failures++;
+    goto tidy;
+  }
+  /* vars_seq and seq are now owned by rowsource */
+  vars_seq = seq = NULL;
+
+  batch = rasqal_new_row_batch(rowsource, TEST_BATCH_SIZE);
+  if(!batch) {
+    fprintf(stderr, "%s: failed to create batch\n", program);
+    failures++;
+    goto tidy;
+  }
+
+  while((count = rasqal_rowsource_read_batch(rowsource, batch)) > 0) {
+    if(count > TEST_BATCH_SIZE || count != batch->count) {
+      fprintf(stderr, "%s: read_batch returned %d rows for batch of %d holding %d\n",
+              program, count, TEST_BATCH_SIZE, batch->count);
+      failures++;
+      goto tidy;
+    }
+    total += count;
+
+    /* keep rows with b bound */
+    for(i = 0; i < batch->count; i++)
+      keep[i] = (RASQAL_ROW_BATCH_VALUE(batch, 1, i) != NULL);
+    rasqal_row_batch_remove_rows(batch, keep);
+    kept += batch->count;
+
+    for(i = 0; i < batch->count; i++) {
+      rasqal_row* row = rasqal_row_batch_get_row(batch, i);
+      if(!row || !row->values[0] || !row->values[1]) {
+        fprintf(stderr, "%s: batch row #%d has missing values\n", program, i);
+        failures++;
+        if(row)
+          rasqal_free_row(row);
+        goto tidy;
+      }
+      rasqal_free_row(row);
+    }
+  }
+
+  if(count < 0) {
+    fprintf(stderr, "%s: read_batch failed\n", program);
+    failures++;
+    goto tidy;
+  }
+
+  if(total != EXPECTED_ROWS_COUNT) {
+    fprintf(stderr, "%s: read %d rows in batches, expected %d\n", program,
+            total, EXPECTED_ROWS_COUNT);
+    failures++;
+    goto tidy;
+  }
+
+  if(kept != EXPECTED_ROWS_COUNT - 1) {
+    fprintf(stderr, "%s: kept %d rows, expected %d\n", program,
+            kept, EXPECTED_ROWS_COUNT - 1);
+    failures++;
+    goto tidy;
+  }
+
+  tidy:
+  if(batch)
+    rasqal_free_row_batch(batch);
+  if(seq)
+    raptor_free_sequence(seq);
+  if(rowsource)
+    rasqal_free_rowsource(rowsource);
+  if(query)
+    rasqal_free_query(query);
+  if(world)
+    rasqal_free_world(world);
+
+  return failures;
+}
+
+#endif /* STANDALONE */
@@ -94,11 +94,13 @@ rasqal_free_row_compatible(rasqal_row_compatible* map)
 }
 
 
-/**
- * rasqal_row_compatible_check:
+/*
+ * rasqal_row_compatible_check_values:
  * @map: row compatible map object
- * @first_row: first row
- * @second_row: second row
+ * @first_values: values of first row
+ * @first_stride: distance between first row values in @first_values
+ * @second_values: values of second row
+ * @second_stride: distance between second row values in @second_values
  *
  * Test if two rows have SPARQL Algebra "Compatible Mappings"
  * 
@@ -111,10 +113,16 @@ rasqal_free_row_compatible(rasqal_row_compatible* map)
  *    the values for both rows must either
  *      a) be the same defined value
  *      b) both be undefined
+ *
+ * The values are strided so that rows held in a #rasqal_row_batch
+ * can be checked in place.
  */
-int
-rasqal_row_compatible_check(rasqal_row_compatible* map,
-                            rasqal_row *first_row, rasqal_row *second_row)
+static int
+rasqal_row_compatible_check_values(rasqal_row_compatible* map,
+                                   rasqal_literal** first_values,
+                                   int first_stride,
+                                   rasqal_literal** second_values,
+                                   int second_stride)
 {
   int i;
   int count = map->variables_count;
@@ -136,10 +144,10 @@ rasqal_row_compatible_check(rasqal_row_compatible* map,
     int offset2 = map->defined_in_map[1 + (i<<1)];
 
     if(offset1 >= 0)
-      first_value = first_row->values[offset1];
+      first_value = first_values[offset1 * first_stride];
 
     if(offset2 >= 0)
-      second_value = second_row->values[offset2];
+      second_value = second_values[offset2 * second_stride];
 
 #if defined(RASQAL_DEBUG) && RASQAL_DEBUG > 1
     RASQAL_DEBUG5("row variable #%d - %s has first row offset #%d  second row offset #%d\n", i, name, offset1, offset2);
@@ -174,6 +182,63 @@ rasqal_row_compatible_check(rasqal_row_compatible* map,
 }
 
 
+/**
+ * rasqal_row_compatible_check:
+ * @map: row compatible map object
+ * @first_row: first row
+ * @second_row: second row
+ *
+ * Test if two rows have SPARQL Algebra "Compatible Mappings"
+ *
+ * See rasqal_row_compatible_check_values() for the definition.
+ *
+ * Return value: non-0 if compatible
+ */
+int
+rasqal_row_compatible_check(rasqal_row_compatible* map,
+                            rasqal_row *first_row, rasqal_row *second_row)
+{
+  return rasqal_row_compatible_check_values(map, first_row->values, 1,
+                                            second_row->values, 1);
+}
+
+
+/**
+ * rasqal_row_compatible_check_batch:
+ * @map: row compatible map object
+ * @first_batch: batch holding the first row
+ * @first_index: first row in @first_batch
+ * @second_batch: batch holding the second row
+ * @second_index: second row in @second_batch
+ *
+ * INTERNAL - Test if two batch rows have SPARQL Algebra "Compatible Mappings"
+ *
+ * Return value: non-0 if compatible
+ */
+int
+rasqal_row_compatible_check_batch(rasqal_row_compatible* map,
+                                  rasqal_row_batch* first_batch,
+                                  int first_index,
+                                  rasqal_row_batch* second_batch,
+                                  int second_index)
+{
+  rasqal_literal** first_values = NULL;
+  rasqal_literal** second_values = NULL;
+
+  /* a batch row is every capacity-th value from its first column */
+  if(first_batch->columns)
+    first_values = &first_batch->columns[first_index];
+  if(second_batch->columns)
+    second_values = &second_batch->columns[second_index];
+
+  return rasqal_row_compatible_check_values(map,
+                                            first_values,
+                                            first_batch->capacity,
+                                            second_values,
+                                            second_batch->capacity);
+}
+
+
 void
 rasqal_print_row_compatible(FILE *handle, rasqal_row_compatible* map)
 {
@@ -0,0 +1,823 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_row_store.c - Rasqal Query Result Row Store
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+
+#ifndef STANDALONE
+
+/*
+ * Rows are encoded one after another as a record length followed by
+ * the row offset, group ID, size and order size then one term per
+ * value and order value.  A term is a tag byte followed by counted
+ * strings: the URI string, the blank node ID or the lexical form,
+ * language and datatype URI of a literal.  Integers are in native
+ * byte order since the encoding never leaves the process.
+ */
+#define RASQAL_ROW_STORE_TERM_NULL    0
+#define RASQAL_ROW_STORE_TERM_URI     1
+#define RASQAL_ROW_STORE_TERM_BLANK   2
+#define RASQAL_ROW_STORE_TERM_LITERAL 3
+
+struct rasqal_row_store_s {
+  rasqal_world* world;
+
+  /* encoded rows held in memory; once spilled only the current row */
+  unsigned char* buffer;
+  size_t buffer_size;
+  size_t buffer_capacity;
+
+  /* maximum size of @buffer before the rows are spilled */
+  size_t memory_limit;
+
+  /* temporary file holding all the rows after spilling or NULL */
+  FILE* spill;
+
+  /* position of the next row to read from @buffer */
+  size_t read_offset;
+
+  /* non-0 after rasqal_row_store_rewind() when no more rows may be added */
+  int reading;
+
+  /* number of rows added */
+  int count;
+};
+
+
+/**
+ * rasqal_new_row_store:
+ * @world: world object
+ * @memory_limit: bytes of encoded rows to hold in memory or 0 for the default
+ *
+ * INTERNAL - Create a new empty store for rows that are read back in order
+ *
+ * Rows are added with rasqal_row_store_add_row() then after
+ * rasqal_row_store_rewind() read back with rasqal_row_store_read_row()
+ * as many times as needed.  The rows are held in a compact encoding
+ * and once they take more than @memory_limit bytes, all of them are
+ * moved to a temporary file.
+ *
+ * Return value: new row store or NULL on failure
+ */
+rasqal_row_store*
+rasqal_new_row_store(rasqal_world* world, size_t memory_limit)
+{
+  rasqal_row_store* store;
+
+  if(!world)
+    return NULL;
+
+  store = RASQAL_CALLOC(rasqal_row_store*, 1, sizeof(*store));
+  if(!store)
+    return NULL;
+
+  store->world = world;
+  store->memory_limit = memory_limit ? memory_limit :
+    RASQAL_ROW_STORE_MEMORY_LIMIT;
+
+  return store;
+}
+
+
+/**
+ * rasqal_free_row_store:
+ * @store: row store
+ *
+ * INTERNAL - Destructor - free a row store and remove any temporary file
+ */
+void
+rasqal_free_row_store(rasqal_row_store* store)
+{
+  if(!store)
+    return;
+
+  if(store->buffer)
+    RASQAL_FREE(char*, store->buffer);
+
+  if(store->spill)
+    fclose(store->spill);
+
+  RASQAL_FREE(rasqal_row_store, store);
+}
+
+
+static int
+rasqal_row_store_reserve(rasqal_row_store* store, size_t len)
+{
+  unsigned char* new_buffer;
+  size_t new_capacity;
+
+  if(store->buffer_size + len <= store->buffer_capacity)
+    return 0;
+
+  new_capacity = store->buffer_capacity ? store->buffer_capacity : 256;
+  while(new_capacity < store->buffer_size + len)
+    new_capacity <<= 1;
+
+  new_buffer = RASQAL_MALLOC(unsigned char*, new_capacity);
+  if(!new_buffer)
+    return 1;
+
+  if(store->buffer) {
+    memcpy(new_buffer, store->buffer, store->buffer_size);
+    RASQAL_FREE(char*, store->buffer);
+  }
+
+  store->buffer = new_buffer;
+  store->buffer_capacity = new_capacity;
+
+  return 0;
+}
+
+
+static int
+rasqal_row_store_put(rasqal_row_store* store, const void* data, size_t len)
+{
+  if(rasqal_row_store_reserve(store, len))
+    return 1;
+
+  memcpy(store->buffer + store->buffer_size, data, len);
+  store->buffer_size += len;
+
+  return 0;
+}
+
+
+static int
+rasqal_row_store_put_int(rasqal_row_store* store, int value)
+{
+  return rasqal_row_store_put(store, &value, sizeof(value));
+}
+
+
+static int
+rasqal_row_store_put_string(rasqal_row_store* store,
+                            const unsigned char* string, size_t len)
+{
+  /* length 0 is no string so an empty string is stored as length 1 */
+  int counted_len = string ? RASQAL_GOOD_CAST(int, len) + 1 : 0;
+
+  if(rasqal_row_store_put_int(store, counted_len))
+    return 1;
+
+  return string ? rasqal_row_store_put(store, string, len) : 0;
+}
+
+
+/*
+ * rasqal_row_store_put_term:
+ * @store: row store
+ * @l: literal value or NULL
+ *
+ * INTERNAL - Encode a row value
+ *
+ * Only RDF terms can be stored.
+ *
+ * Return value: non-0 on failure or if @l cannot be stored
+ */
+static int
+rasqal_row_store_put_term(rasqal_row_store* store, rasqal_literal* l)
+{
+  const unsigned char* string;
+  unsigned char tag;
+  size_t len;
+  raptor_uri* dt_uri;
+
+  if(!l) {
+    tag = RASQAL_ROW_STORE_TERM_NULL;
+    return rasqal_row_store_put(store, &tag, 1);
+  }
+
+  switch(l->type) {
+    case RASQAL_LITERAL_URI:
+      tag = RASQAL_ROW_STORE_TERM_URI;
+      string = raptor_uri_as_counted_string(l->value.uri, &len);
+      return rasqal_row_store_put(store, &tag, 1) ||
+             rasqal_row_store_put_string(store, string, len);
+
+    case RASQAL_LITERAL_BLANK:
+      tag = RASQAL_ROW_STORE_TERM_BLANK;
+      return rasqal_row_store_put(store, &tag, 1) ||
+             rasqal_row_store_put_string(store, l->string, l->string_len);
+
+    case RASQAL_LITERAL_STRING:
+    case RASQAL_LITERAL_XSD_STRING:
+    case RASQAL_LITERAL_BOOLEAN:
+    case RASQAL_LITERAL_INTEGER:
+    case RASQAL_LITERAL_FLOAT:
+    case RASQAL_LITERAL_DOUBLE:
+    case RASQAL_LITERAL_DECIMAL:
+    case RASQAL_LITERAL_DATE:
+    case RASQAL_LITERAL_DATETIME:
+    case RASQAL_LITERAL_UDT:
+    case RASQAL_LITERAL_INTEGER_SUBTYPE:
+      tag = RASQAL_ROW_STORE_TERM_LITERAL;
+      string = RASQAL_GOOD_CAST(const unsigned char*,
+                                rasqal_literal_as_counted_string(l, &len, 0,
+                                                                 NULL));
+      if(!string)
+        return 1;
+
+      dt_uri = l->datatype;
+      if(!dt_uri && l->type != RASQAL_LITERAL_STRING)
+        dt_uri = rasqal_xsd_datatype_type_to_uri(store->world, l->type);
+
+      if(rasqal_row_store_put(store, &tag, 1) ||
+         rasqal_row_store_put_string(store, string, len))
+        return 1;
+
+      if(rasqal_row_store_put_string(store,
+                                     RASQAL_GOOD_CAST(const unsigned char*, l->language),
+                                     l->language ? strlen(l->language) : 0))
+        return 1;
+
+      if(dt_uri) {
+        string = raptor_uri_as_counted_string(dt_uri, &len);
+        return rasqal_row_store_put_string(store, string, len);
+      }
+      return rasqal_row_store_put_string(store, NULL, 0);
+
+    case RASQAL_LITERAL_UNKNOWN:
+    case RASQAL_LITERAL_PATTERN:
+    case RASQAL_LITERAL_QNAME:
+    case RASQAL_LITERAL_VARIABLE:
+    default:
+      return 1;
+  }
+}
+
+
+/*
+ * rasqal_row_store_spill:
+ * @store: row store
+ *
+ * INTERNAL - Write the rows in memory to the temporary file and empty the buffer
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_row_store_spill(rasqal_row_store* store)
+{
+  if(!store->spill) {
+    store->spill = tmpfile();
+    if(!store->spill)
+      return 1;
+
+    RASQAL_DEBUG3("row store %p spilling %d rows to a temporary file\n",
+                  store, store->count);
+  }
+
+  if(store->buffer_size &&
+     fwrite(store->buffer, 1, store->buffer_size, store->spill) != store->buffer_size)
+    return 1;
+
+  store->buffer_size = 0;
+
+  return 0;
+}
+
+
+/**
+ * rasqal_row_store_add_row:
+ * @store: row store
+ * @row: row
+ *
+ * INTERNAL - Add a copy of a row to the end of a row store
+ *
+ * The row values must be RDF terms or unset.  Rows cannot be added
+ * once the store has been rewound for reading.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_row_store_add_row(rasqal_row_store* store, rasqal_row* row)
+{
+  size_t start = store->buffer_size;
+  int record_len;
+  int i;
+
+  if(store->reading)
+    return 1;
+
+  /* record length is filled in when known */
+  if(rasqal_row_store_put_int(store, 0) ||
+     rasqal_row_store_put_int(store, row->offset) ||
+     rasqal_row_store_put_int(store, row->group_id) ||
+     rasqal_row_store_put_int(store, row->size) ||
+     rasqal_row_store_put_int(store, row->order_size > 0 ? row->order_size : 0))
+    goto fail;
+
+  for(i = 0; i < row->size; i++) {
+    if(rasqal_row_store_put_term(store, row->values[i]))
+      goto fail;
+  }
+
+  for(i = 0; i < row->order_size; i++) {
+    if(rasqal_row_store_put_term(store, row->order_values[i]))
+      goto fail;
+  }
+
+  record_len = RASQAL_GOOD_CAST(int, store->buffer_size - start - sizeof(int));
+  memcpy(store->buffer + start, &record_len, sizeof(record_len));
+
+  store->count++;
+
+  if(store->spill || store->buffer_size > store->memory_limit)
+    return rasqal_row_store_spill(store);
+
+  return 0;
+
+  fail:
+  store->buffer_size = start;
+  return 1;
+}
+
+
+/**
+ * rasqal_row_store_rewind:
+ * @store: row store
+ *
+ * INTERNAL - Start reading the rows from the first one
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_row_store_rewind(rasqal_row_store* store)
+{
+  store->reading = 1;
+  store->read_offset = 0;
+
+  if(store->spill) {
+    store->buffer_size = 0;
+    if(fseek(store->spill, 0L, SEEK_SET))
+      return 1;
+  }
+
+  return 0;
+}
+
+
+static int
+rasqal_row_store_get(const unsigned char** p, const unsigned char* end,
+                     void* data, size_t len)
+{
+  if(RASQAL_GOOD_CAST(size_t, end - *p) < len)
+    return 1;
+
+  memcpy(data, *p, len);
+  *p += len;
+
+  return 0;
+}
+
+
+/*
+ * rasqal_row_store_get_string:
+ * @p: pointer to encoded data position
+ * @end: end of encoded data
+ * @string_p: pointer to store new NUL-terminated string or NULL
+ * @len_p: pointer to store string length
+ *
+ * INTERNAL - Decode a counted string into a new string
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_row_store_get_string(const unsigned char** p, const unsigned char* end,
+                            unsigned char** string_p, size_t* len_p)
+{
+  int counted_len;
+  size_t len;
+  unsigned char* string;
+
+  *string_p = NULL;
+  *len_p = 0;
+
+  if(rasqal_row_store_get(p, end, &counted_len, sizeof(counted_len)) ||
+     counted_len < 0)
+    return 1;
+
+  if(!counted_len)
+    return 0;
+
+  len = RASQAL_GOOD_CAST(size_t, counted_len - 1);
+  if(RASQAL_GOOD_CAST(size_t, end - *p) < len)
+    return 1;
+
+  string = RASQAL_MALLOC(unsigned char*, len + 1);
+  if(!string)
+    return 1;
+
+  memcpy(string, *p, len);
+  string[len] = '\0';
+  *p += len;
+
+  *string_p = string;
+  *len_p = len;
+
+  return 0;
+}
+
+
+/*
+ * rasqal_row_store_get_term:
+ * @store: row store
+ * @p: pointer to encoded data position
+ * @end: end of encoded data
+ * @l_p: pointer to store new literal or NULL
+ *
+ * INTERNAL - Decode a row value
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_row_store_get_term(rasqal_row_store* store,
+                          const unsigned char** p, const unsigned char* end,
+                          rasqal_literal** l_p)
+{
+  raptor_world* raptor_world_ptr = store->world->raptor_world_ptr;
+  unsigned char tag;
+  unsigned char* string = NULL;
+  unsigned char* language = NULL;
+  unsigned char* dt_string = NULL;
+  raptor_uri* uri;
+  size_t len;
+  size_t dt_len;
+
+  *l_p = NULL;
+
+  if(rasqal_row_store_get(p, end, &tag, 1))
+    return 1;
+
+  switch(tag) {
+    case RASQAL_ROW_STORE_TERM_NULL:
+      return 0;
+
+    case RASQAL_ROW_STORE_TERM_URI:
+      if(rasqal_row_store_get_string(p, end, &string, &len) || !string)
+        goto fail;
+      uri = raptor_new_uri_from_counted_string(raptor_world_ptr, string, len);
+      RASQAL_FREE(char*, string);
+      if(!uri)
+        return 1;
+      *l_p = rasqal_new_uri_literal(store->world, uri);
+      break;
+
+    case RASQAL_ROW_STORE_TERM_BLANK:
+      if(rasqal_row_store_get_string(p, end, &string, &len) || !string)
+        goto fail;
+      *l_p = rasqal_new_simple_literal(store->world, RASQAL_LITERAL_BLANK,
+                                       string);
+      break;
+
+    case RASQAL_ROW_STORE_TERM_LITERAL:
+      if(rasqal_row_store_get_string(p, end, &string, &len) || !string ||
+         rasqal_row_store_get_string(p, end, &language, &len) ||
+         rasqal_row_store_get_string(p, end, &dt_string, &dt_len))
+        goto fail;
+
+      uri = NULL;
+      if(dt_string) {
+        uri = raptor_new_uri_from_counted_string(raptor_world_ptr, dt_string,
+                                                 dt_len);
+        RASQAL_FREE(char*, dt_string);
+        dt_string = NULL;
+        if(!uri)
+          goto fail;
+      }
+
+      /* string, language and uri become owned by the literal */
+      *l_p = rasqal_new_string_literal(store->world, string,
+                                       RASQAL_GOOD_CAST(const char*, language),
+                                       uri, NULL);
+      break;
+
+    default:
+      return 1;
+  }
+
+  return *l_p ? 0 : 1;
+
+  fail:
+  if(string)
+    RASQAL_FREE(char*, string);
+  if(language)
+    RASQAL_FREE(char*, language);
+  if(dt_string)
+    RASQAL_FREE(char*, dt_string);
+  return 1;
+}
+
+
+/**
+ * rasqal_row_store_read_row:
+ * @store: row store
+ * @rowsource: rowsource to set in the row
+ *
+ * INTERNAL - Read the next row from a row store
+ *
+ * Return value: new row or NULL at the end of the rows or on failure
+ */
+rasqal_row*
+rasqal_row_store_read_row(rasqal_row_store* store, rasqal_rowsource* rowsource)
+{
+  const unsigned char* p;
+  const unsigned char* end;
+  rasqal_row* row = NULL;
+  int record_len;
+  int offset;
+  int group_id;
+  int size;
+  int order_size;
+  int i;
+
+  if(!store->reading)
+    return NULL;
+
+  if(store->spill) {
+    /* read the next record into the otherwise unused buffer */
+    if(fread(&record_len, sizeof(record_len), 1, store->spill) != 1 ||
+       record_len < 0)
+      return NULL;
+
+    store->buffer_size = 0;
+    if(rasqal_row_store_reserve(store, RASQAL_GOOD_CAST(size_t, record_len)))
+      return NULL;
+
+    if(fread(store->buffer, 1, RASQAL_GOOD_CAST(size_t, record_len),
+             store->spill) != RASQAL_GOOD_CAST(size_t, record_len))
+      return NULL;
+
+    p = store->buffer;
+  } else {
+    if(store->read_offset >= store->buffer_size)
+      return NULL;
+
+    memcpy(&record_len, store->buffer + store->read_offset, sizeof(record_len));
+    p = store->buffer + store->read_offset + sizeof(record_len);
+    store->read_offset += sizeof(record_len) + RASQAL_GOOD_CAST(size_t, record_len);
+  }
+  end = p + record_len;
+
+  if(rasqal_row_store_get(&p, end, &offset, sizeof(offset)) ||
+     rasqal_row_store_get(&p, end, &group_id, sizeof(group_id)) ||
+     rasqal_row_store_get(&p, end, &size, sizeof(size)) ||
+     rasqal_row_store_get(&p, end, &order_size, sizeof(order_size)))
+    return NULL;
+
+  row = rasqal_new_row_for_size(store->world, size);
+  if(!row)
+    return NULL;
+
+  if(rowsource)
+    rasqal_row_set_rowsource(row, rowsource);
+  row->offset = offset;
+  row->group_id = group_id;
+
+  for(i = 0; i < size; i++) {
+    if(rasqal_row_store_get_term(store, &p, end, &row->values[i]))
+      goto fail;
+  }
+
+  if(order_size > 0) {
+    if(rasqal_row_set_order_size(row, order_size))
+      goto fail;
+
+    for(i = 0; i < order_size; i++) {
+      if(rasqal_row_store_get_term(store, &p, end, &row->order_values[i]))
+        goto fail;
+    }
+  }
+
+  return row;
+
+  fail:
+  rasqal_free_row(row);
+  return NULL;
+}
+
+
+/**
+ * rasqal_row_store_get_count:
+ * @store: row store
+ *
+ * INTERNAL - Get the number of rows added to a row store
+ *
+ * Return value: number of rows
+ */
+int
+rasqal_row_store_get_count(rasqal_row_store* store)
+{
+  return store->count;
+}
+
+
+/**
+ * rasqal_row_store_is_spilled:
+ * @store: row store
+ *
+ * INTERNAL - Test if a row store has moved its rows to a temporary file
+ *
+ * Return value: non-0 if the rows are in a temporary file
+ */
+int
+rasqal_row_store_is_spilled(rasqal_row_store* store)
+{
+  return store->spill != NULL;
+}
+
+
+#endif /* not STANDALONE */
+
+
+
+#ifdef STANDALONE
+
+/* one more prototype */
+int main(int argc, char *argv[]);
+
+
+const char* const store_data_2x4_rows[] =
+{
+  /* 2 variable names and 4 rows */
+  "a",   NULL, "b",   NULL,
+  /* row 1 data */
+  "foo", NULL, NULL, "http://example.org/red",
+  /* row 2 data */
+  "baz", NULL, NULL, "http://example.org/blue",
+  /* row 3 data */
+  NULL,  NULL, NULL, "http://example.org/green",
+  /* row 4 data */
+  "sue", NULL, NULL, NULL,
+  /* end of data */
+  NULL, NULL, NULL, NULL
+};
+
+#define EXPECTED_ROWS_COUNT 4
+
+/* small enough that the second row is spilled */
+#define TEST_SPILL_MEMORY_LIMIT 64
+
+
+static int
+check_store(const char* program, rasqal_world* world, raptor_sequence* seq,
+            size_t memory_limit, int expect_spilled)
+{
+  rasqal_row_store* store;
+  int failures = 0;
+  int pass;
+  int i;
+
+  store = rasqal_new_row_store(world, memory_limit);
+  if(!store) {
+    fprintf(stderr, "%s: failed to create row store\n", program);
+    return 1;
+  }
+
+  for(i = 0; i < raptor_sequence_size(seq); i++) {
+    rasqal_row* row = (rasqal_row*)raptor_sequence_get_at(seq, i);
+    if(rasqal_row_store_add_row(store, row)) {
+      fprintf(stderr, "%s: failed to add row #%d\n", program, i);
+      failures++;
+      goto tidy;
+    }
+  }
+
+  if(rasqal_row_store_get_count(store) != EXPECTED_ROWS_COUNT) {
+    fprintf(stderr, "%s: row store has %d rows, expected %d\n", program,
+            rasqal_row_store_get_count(store), EXPECTED_ROWS_COUNT);
+    failures++;
+    goto tidy;
+  }
+
+  if(!rasqal_row_store_is_spilled(store) != !expect_spilled) {
+    fprintf(stderr, "%s: row store with limit %d is %sspilled\n", program,
+            RASQAL_GOOD_CAST(int, memory_limit),
+            rasqal_row_store_is_spilled(store) ? "" : "not ");
+    failures++;
+    goto tidy;
+  }
+
+  /* read the rows back twice as after a reset */
+  for(pass = 0; pass < 2; pass++) {
+    rasqal_row* row;
+
+    if(rasqal_row_store_rewind(store)) {
+      fprintf(stderr, "%s: failed to rewind row store\n", program);
+      failures++;
+      goto tidy;
+    }
+
+    for(i = 0; (row = rasqal_row_store_read_row(store, NULL)); i++) {
+      rasqal_row* expected = (rasqal_row*)raptor_sequence_get_at(seq, i);
+      int j;
+
+      if(!expected || row->size != expected->size) {
+        fprintf(stderr, "%s: pass %d read unexpected row #%d\n", program,
+                pass, i);
+        failures++;
+        rasqal_free_row(row);
+        goto tidy;
+      }
+
+      for(j = 0; j < row->size; j++) {
+        rasqal_literal* l = row->values[j];
+        rasqal_literal* el = expected->values[j];
+
+        if(!l != !el ||
+           (l && !rasqal_literal_equals_flags(l, el, RASQAL_COMPARE_RDF, NULL))) {
+          fprintf(stderr, "%s: pass %d row #%d value #%d differs\n", program,
+                  pass, i, j);
+          failures++;
+        }
+      }
+      rasqal_free_row(row);
+    }
+
+    if(i != EXPECTED_ROWS_COUNT) {
+      fprintf(stderr, "%s: pass %d read %d rows, expected %d\n", program,
+              pass, i, EXPECTED_ROWS_COUNT);
+      failures++;
+      goto tidy;
+    }
+  }
+
+  tidy:
+  rasqal_free_row_store(store);
+
+  return failures;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  rasqal_world* world = NULL;
+  rasqal_query* query = NULL;
+  raptor_sequence* seq = NULL;
+  raptor_sequence* vars_seq = NULL;
+  int failures = 0;
+
+  world = rasqal_new_world(); rasqal_world_open(world);
+
+  query = rasqal_new_query(world, "sparql", NULL);
+
+  seq = rasqal_new_row_sequence(world, query->vars_table, store_data_2x4_rows,
+                                2, &vars_seq);
+  if(!seq) {
+    fprintf(stderr, "%s: failed to create sequence\n", program);
+    failures++;
+    goto tidy;
+  }
+
+  failures += check_store(program, world, seq, 0, 0);
+  failures += check_store(program, world, seq, TEST_SPILL_MEMORY_LIMIT, 1);
+
+  tidy:
+  if(seq)
+    raptor_free_sequence(seq);
+  if(vars_seq)
+    raptor_free_sequence(vars_seq);
+  if(query)
+    rasqal_free_query(query);
+  if(world)
+    rasqal_free_world(world);
+
+  return failures;
+}
+
+#endif /* STANDALONE */
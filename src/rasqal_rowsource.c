@@ -71,7 +71,7 @@ rasqal_new_rowsource_from_handler(rasqal_world* world,
   if(!world || !handler)
     return NULL;
 
-  if(handler->version < 1 || handler->version > 1)
+  if(handler->version < 1 || handler->version > 2)
     return NULL;
 
   rowsource = RASQAL_CALLOC(rasqal_rowsource*, 1, sizeof(*rowsource));
@@ -161,6 +161,9 @@ rasqal_free_rowsource(rasqal_rowsource *rowsource)
   if(rowsource->rows_sequence)
     raptor_free_sequence(rowsource->rows_sequence);
 
+  if(rowsource->row_store)
+    rasqal_free_row_store(rowsource->row_store);
+
   RASQAL_FREE(rasqal_rowsource, rowsource);
 }
 
@@ -232,6 +235,36 @@ rasqal_rowsource_ensure_variables(rasqal_rowsource *rowsource)
 }
 
 
+/*
+ * rasqal_rowsource_save_row:
+ * @rowsource: rasqal rowsource
+ * @row: row
+ *
+ * INTERNAL - Save a copy of a row for replay after a reset
+ *
+ * If the row cannot be saved, saving stops and the rowsource is
+ * executed again on reset.
+ */
+static void
+rasqal_rowsource_save_row(rasqal_rowsource* rowsource, rasqal_row* row)
+{
+  if(!rowsource->row_store)
+    rowsource->row_store = rasqal_new_row_store(rowsource->world, 0);
+
+  if(rowsource->row_store &&
+     !rasqal_row_store_add_row(rowsource->row_store, row))
+    return;
+
+  RASQAL_DEBUG3("%s rowsource %p failed to save a row, not saving rows\n",
+                rowsource->handler->name, rowsource);
+  if(rowsource->row_store) {
+    rasqal_free_row_store(rowsource->row_store);
+    rowsource->row_store = NULL;
+  }
+  rowsource->flags &= ~RASQAL_ROWSOURCE_FLAGS_SAVE_ROWS;
+}
+
+
 /**
  * rasqal_rowsource_read_row:
  * @rowsource: rasqal rowsource
@@ -250,23 +283,7 @@ rasqal_rowsource_read_row(rasqal_rowsource *rowsource)
   if(!rowsource || rowsource->finished)
     return NULL;
 
-  if(rowsource->flags & RASQAL_ROWSOURCE_FLAGS_SAVED_ROWS) {
-    /* return row from saved rows sequence at offset */
-    row = (rasqal_row*)raptor_sequence_get_at(rowsource->rows_sequence,
-                                              rowsource->offset++);
-#ifdef RASQAL_DEBUG
-    RASQAL_DEBUG3("%s rowsource %p returned saved row:  ",
-                  rowsource->handler->name, rowsource);
-    if(row)
-      rasqal_row_print(row, stderr);
-    else
-      fputs("NONE", stderr);
-    fputs("\n", stderr);
-#endif      
-    if(row)
-      row = rasqal_new_row_from_row(row);
-    /* row is owned by us */
-  } else {
+  if(!(rowsource->flags & RASQAL_ROWSOURCE_FLAGS_SAVED_ROWS)) {
     if(rasqal_rowsource_ensure_variables(rowsource))
       return NULL;
 
@@ -274,27 +291,24 @@ rasqal_rowsource_read_row(rasqal_rowsource *rowsource)
       row = rowsource->handler->read_row(rowsource, rowsource->user_data);
       /* row is owned by us */
 
-      if(row && rowsource->flags & RASQAL_ROWSOURCE_FLAGS_SAVE_ROWS) {
-        if(!rowsource->rows_sequence) {
-          rowsource->rows_sequence = raptor_new_sequence((raptor_data_free_handler)rasqal_free_row,
-                                                         (raptor_data_print_handler)rasqal_row_print);
-          rowsource->offset = 0;
-        }
-        /* copy to save it away */
-        row = rasqal_new_row_from_row(row);
-        raptor_sequence_push(rowsource->rows_sequence, row);
-      }
+      if(row && rowsource->flags & RASQAL_ROWSOURCE_FLAGS_SAVE_ROWS)
+        rasqal_rowsource_save_row(rowsource, row);
     } else {
       if(!rowsource->rows_sequence) {
         raptor_sequence* seq;
         
         seq = rasqal_rowsource_read_all_rows(rowsource);
-        if(rowsource->rows_sequence)
-          raptor_free_sequence(rowsource->rows_sequence);
-        /* rows_sequence now owns all rows */
-        rowsource->rows_sequence = seq;
-
-        rowsource->offset = 0;
+        if(rowsource->flags & RASQAL_ROWSOURCE_FLAGS_SAVED_ROWS) {
+          /* all rows were saved so return them from there */
+          if(seq)
+            raptor_free_sequence(seq);
+          if(rowsource->row_store)
+            rasqal_row_store_rewind(rowsource->row_store);
+        } else {
+          /* rows_sequence now owns all rows */
+          rowsource->rows_sequence = seq;
+          rowsource->offset = 0;
+        }
       }
       
       if(rowsource->rows_sequence) {
@@ -307,6 +321,22 @@ rasqal_rowsource_read_row(rasqal_rowsource *rowsource)
       }
     }
   }
+
+  if(rowsource->flags & RASQAL_ROWSOURCE_FLAGS_SAVED_ROWS) {
+    /* return next row from saved rows */
+    if(rowsource->row_store)
+      row = rasqal_row_store_read_row(rowsource->row_store, rowsource);
+#ifdef RASQAL_DEBUG
+    RASQAL_DEBUG3("%s rowsource %p returned saved row:  ",
+                  rowsource->handler->name, rowsource);
+    if(row)
+      rasqal_row_print(row, stderr);
+    else
+      fputs("NONE", stderr);
+    fputs("\n", stderr);
+#endif      
+    /* row is owned by us */
+  }
   
   if(!row) {
     rowsource->finished = 1;
@@ -372,15 +402,28 @@ rasqal_rowsource_read_all_rows(rasqal_rowsource *rowsource)
     return NULL;
 
   if(rowsource->flags & RASQAL_ROWSOURCE_FLAGS_SAVED_ROWS) {
-    raptor_sequence* new_seq;
+    rasqal_row* row;
 
     /* Return a complete copy of all previously saved rows */
-    seq = rowsource->rows_sequence;
-    new_seq = rasqal_row_sequence_copy(seq);
+    seq = raptor_new_sequence((raptor_data_free_handler)rasqal_free_row,
+                              (raptor_data_print_handler)rasqal_row_print);
+    if(!seq)
+      return NULL;
+
+    if(rowsource->row_store) {
+      if(rasqal_row_store_rewind(rowsource->row_store)) {
+        raptor_free_sequence(seq);
+        return NULL;
+      }
+
+      while((row = rasqal_row_store_read_row(rowsource->row_store, rowsource)))
+        raptor_sequence_push(seq, row);
+    }
+
     RASQAL_DEBUG4("%s rowsource %p returning a sequence of %d saved rows\n",
                   rowsource->handler->name, rowsource,
-                  raptor_sequence_size(new_seq));
-    return new_seq;
+                  raptor_sequence_size(seq));
+    return seq;
   }
 
   /* Execute */
@@ -428,16 +471,23 @@ rasqal_rowsource_read_all_rows(rasqal_rowsource *rowsource)
   }
 
   done:
-  if(seq && rowsource->flags & RASQAL_ROWSOURCE_FLAGS_SAVE_ROWS) {
-    raptor_sequence* new_seq;
+  if(seq && rowsource->flags & RASQAL_ROWSOURCE_FLAGS_SAVE_ROWS &&
+     !(rowsource->flags & RASQAL_ROWSOURCE_FLAGS_SAVED_ROWS)) {
+    rasqal_row* row;
+    int i;
 
     /* Save a complete copy of all rows */
-    new_seq = rasqal_row_sequence_copy(seq);
     RASQAL_DEBUG4("%s rowsource %p saving a sequence of %d rows\n",
                   rowsource->handler->name, rowsource,
-                  raptor_sequence_size(new_seq));
-    rowsource->rows_sequence = new_seq;
-    rowsource->flags |= RASQAL_ROWSOURCE_FLAGS_SAVED_ROWS;
+                  raptor_sequence_size(seq));
+    for(i = 0; (row = (rasqal_row*)raptor_sequence_get_at(seq, i)); i++) {
+      rasqal_rowsource_save_row(rowsource, row);
+      if(!(rowsource->flags & RASQAL_ROWSOURCE_FLAGS_SAVE_ROWS))
+        break;
+    }
+
+    if(rowsource->flags & RASQAL_ROWSOURCE_FLAGS_SAVE_ROWS)
+      rowsource->flags |= RASQAL_ROWSOURCE_FLAGS_SAVED_ROWS;
   }
   
   RASQAL_DEBUG4("%s rowsource %p returning a sequence of %d rows\n",
@@ -447,6 +497,107 @@ rasqal_rowsource_read_all_rows(rasqal_rowsource *rowsource)
 }
 
 
+/*
+ * rasqal_rowsource_has_read_batch:
+ * @rowsource: rasqal rowsource
+ *
+ * INTERNAL - Check if a rowsource reads batches itself
+ *
+ * Return value: non-0 if rasqal_rowsource_read_batch() uses the handler read_batch
+ */
+int
+rasqal_rowsource_has_read_batch(rasqal_rowsource *rowsource)
+{
+  return (rowsource->handler->version >= 2 && rowsource->handler->read_batch &&
+          !(rowsource->flags & (RASQAL_ROWSOURCE_FLAGS_SAVE_ROWS |
+                                RASQAL_ROWSOURCE_FLAGS_SAVED_ROWS)));
+}
+
+
+/**
+ * rasqal_rowsource_read_batch:
+ * @rowsource: rasqal rowsource
+ * @batch: batch made for @rowsource by rasqal_new_row_batch()
+ *
+ * Read the next block of rows from a rowsource into a batch
+ *
+ * Any rows already in @batch are removed first.  Rowsources without
+ * a read_batch handler are read a row at a time.
+ *
+ * Some rowsources keep their position in the values of the variables
+ * they bind, so the variables are bound to the last row of @batch
+ * before reading more.  Pass the same @batch to continue reading and
+ * clear it with rasqal_row_batch_clear() when resetting @rowsource.
+ *
+ * Return value: number of rows read, 0 when no more rows are available or <0 on failure
+ **/
+int
+rasqal_rowsource_read_batch(rasqal_rowsource *rowsource,
+                            rasqal_row_batch* batch)
+{
+  int count;
+
+  if(!rowsource || !batch || batch->rowsource != rowsource)
+    return -1;
+
+  if(batch->count > 0) {
+    if(rasqal_row_batch_bind_row(batch, batch->count - 1))
+      return -1;
+    rasqal_row_batch_clear(batch);
+  }
+
+  if(rowsource->finished)
+    return 0;
+
+  if(rasqal_rowsource_ensure_variables(rowsource))
+    return -1;
+
+  if(rasqal_rowsource_has_read_batch(rowsource)) {
+    int i;
+
+    count = rowsource->handler->read_batch(rowsource, rowsource->user_data,
+                                           batch);
+    if(count < 0)
+      return count;
+
+    if(!count) {
+      rowsource->finished = 1;
+      return 0;
+    }
+
+    rowsource->count += count;
+
+    /* Generate a group around all rows if there are no groups returned */
+    if(rowsource->generate_group) {
+      for(i = 0; i < count; i++) {
+        if(batch->group_ids[i] < 0)
+          batch->group_ids[i] = 0;
+      }
+    }
+  } else {
+    while(batch->count < batch->capacity) {
+      rasqal_row* row;
+      int rc;
+
+      row = rasqal_rowsource_read_row(rowsource);
+      if(!row)
+        break;
+
+      rc = rasqal_row_batch_add_row(batch, row);
+      rasqal_free_row(row);
+      if(rc)
+        return -1;
+    }
+    count = batch->count;
+  }
+
+  RASQAL_DEBUG4("%s rowsource %p returned a batch of %d rows\n",
+                rowsource->handler->name, rowsource, count);
+
+  return count;
+}
+
+
 /**
  * rasqal_rowsource_get_size:
  * @rowsource: rasqal rowsource
@@ -627,17 +778,24 @@ rasqal_rowsource_reset(rasqal_rowsource* rowsource)
   rowsource->finished = 0;
   rowsource->count = 0;
 
-  if(rowsource->handler->reset)
-    return rowsource->handler->reset(rowsource, rowsource->user_data);
-
   if(rowsource->flags & RASQAL_ROWSOURCE_FLAGS_SAVED_ROWS) {
     RASQAL_DEBUG3("%s rowsource %p resetting to use saved rows\n", 
                   rowsource->handler->name, rowsource);
-    rowsource->offset = 0;
-  } else {
-    RASQAL_DEBUG3("WARNING: %s rowsource %p has no reset and there are no saved rows\n",
-                  rowsource->handler->name, rowsource);
+    return rowsource->row_store ?
+      rasqal_row_store_rewind(rowsource->row_store) : 0;
   }
+
+  if(rowsource->row_store) {
+    /* reset before all rows were read so save them again */
+    rasqal_free_row_store(rowsource->row_store);
+    rowsource->row_store = NULL;
+  }
+
+  if(rowsource->handler->reset)
+    return rowsource->handler->reset(rowsource, rowsource->user_data);
+
+  RASQAL_DEBUG3("WARNING: %s rowsource %p has no reset and there are no saved rows\n",
+                rowsource->handler->name, rowsource);
   return 0;
 }
 
@@ -653,6 +811,26 @@ rasqal_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource, int offset)
 }
 
 
+/**
+ * rasqal_rowsource_get_order:
+ * @rowsource: rasqal rowsource
+ *
+ * INTERNAL - Get the variable a rowsource returns rows in ascending order of
+ *
+ * The order is that of ORDER BY ASC(variable) with unbound values
+ * first.
+ *
+ * Return value: shared variable or NULL if the rows are in no known order
+ */
+rasqal_variable*
+rasqal_rowsource_get_order(rasqal_rowsource* rowsource)
+{
+  if(rowsource->handler->version >= 2 && rowsource->handler->get_order)
+    return rowsource->handler->get_order(rowsource, rowsource->user_data);
+  return NULL;
+}
+
+
 /**
  * rasqal_rowsource_visit:
  * @node: #rasqal_rowsource row source
@@ -699,6 +877,61 @@ rasqal_rowsource_visit(rasqal_rowsource* rowsource,
 }
 
 
+/**
+ * rasqal_rowsource_set_outer_variables:
+ * @rowsource: rasqal rowsource
+ * @variables: sequence of #rasqal_variable
+ *
+ * INTERNAL - Tell a rowsource which variables an outer join binds before reading
+ *
+ * After every rasqal_rowsource_reset() the outer join binds
+ * @variables to the values of its current row, or to NULL, before
+ * reading.  A rowsource that accepts them may then return only the
+ * rows compatible with those values.  Rowsources that replay saved
+ * rows on reset cannot do this.
+ *
+ * Return value: 0 if the outer values will be used, non-0 otherwise
+ */
+int
+rasqal_rowsource_set_outer_variables(rasqal_rowsource* rowsource,
+                                     raptor_sequence* variables)
+{
+  if(rowsource->flags & (RASQAL_ROWSOURCE_FLAGS_SAVE_ROWS |
+                         RASQAL_ROWSOURCE_FLAGS_SAVED_ROWS))
+    return 1;
+
+  if(rowsource->handler->version >= 2 &&
+     rowsource->handler->set_outer_variables &&
+     !rowsource->handler->set_outer_variables(rowsource, rowsource->user_data,
+                                              variables)) {
+    rowsource->flags |= RASQAL_ROWSOURCE_FLAGS_CORRELATED;
+    return 0;
+  }
+
+  return 1;
+}
+
+
+/*
+ * rasqal_rowsource_set_correlated:
+ * @rowsource: rasqal rowsource
+ *
+ * INTERNAL - Mark a rowsource as reading values bound outside it
+ *
+ * Such a rowsource is never materialized for repeated reads since
+ * its rows may differ after each reset.
+ *
+ * Return value: 0
+ */
+int
+rasqal_rowsource_set_correlated(rasqal_rowsource* rowsource)
+{
+  rowsource->flags |= RASQAL_ROWSOURCE_FLAGS_CORRELATED;
+
+  return 0;
+}
+
+
 static int
 rasqal_rowsource_visitor_set_origin(rasqal_rowsource* rowsource,
                                     void *user_data)
@@ -750,9 +983,76 @@ rasqal_rowsource_visitor_set_requirements(rasqal_rowsource* rowsource,
 }
 
 
+static int
+rasqal_rowsource_visitor_estimate_cost(rasqal_rowsource* rowsource,
+                                       void *user_data)
+{
+  int* cost_p = (int*)user_data;
+
+  (*cost_p)++;
+
+  return 0;
+}
+
+
+/*
+ * rasqal_rowsource_should_materialize:
+ * @rowsource: rasqal rowsource
+ *
+ * INTERNAL - Decide if a repeatedly reset rowsource should save its rows
+ *
+ * A correlated rowsource, one using outer variables or marked by
+ * rasqal_rowsource_set_correlated(), returns different rows after
+ * each reset so must be executed again.  Otherwise the rows are the same every time
+ * and they are saved when the subtree is estimated to cost more to
+ * execute than to replay: when it is more than a single rowsource.
+ *
+ * Return value: non-0 to save the rows
+ */
+static int
+rasqal_rowsource_should_materialize(rasqal_rowsource* rowsource)
+{
+  int cost = 0;
+
+  if(rowsource->flags & RASQAL_ROWSOURCE_FLAGS_CORRELATED)
+    return 0;
+
+  rasqal_rowsource_visit(rowsource, rasqal_rowsource_visitor_estimate_cost,
+                         &cost);
+  RASQAL_DEBUG4("%s rowsource %p has estimated cost %d\n",
+                rowsource->handler->name, rowsource, cost);
+
+  return cost >= RASQAL_ROWSOURCE_MATERIALIZE_COST;
+}
+
+
+/**
+ * rasqal_rowsource_set_requirements:
+ * @rowsource: rasqal rowsource
+ * @flags: bit flags of RASQAL_ROWSOURCE_REQUIRE_*
+ *
+ * INTERNAL - Tell a rowsource tree how it will be read
+ *
+ * With RASQAL_ROWSOURCE_REQUIRE_RESET, rowsources in the tree that
+ * have no reset handler save their rows for replay.  Adding
+ * RASQAL_ROWSOURCE_REQUIRE_REPEAT also saves the rows of the whole
+ * tree when rasqal_rowsource_should_materialize() decides replaying
+ * is cheaper than executing it again.  Saved rows are held in a
+ * #rasqal_row_store that spills to disk past its memory limit.
+ *
+ * Return value: non-0 on failure
+ */
 int
 rasqal_rowsource_set_requirements(rasqal_rowsource* rowsource, unsigned int flags)
 {
+  if((flags & RASQAL_ROWSOURCE_REQUIRE_REPEAT) &&
+     rasqal_rowsource_should_materialize(rowsource)) {
+    RASQAL_DEBUG3("setting %s rowsource %p to save rows for repeated reads\n",
+                  rowsource->handler->name, rowsource);
+    rowsource->flags |= RASQAL_ROWSOURCE_FLAGS_SAVE_ROWS;
+    return 0;
+  }
+
   return rasqal_rowsource_visit(rowsource, 
                                 rasqal_rowsource_visitor_set_requirements,
                                 &flags);
@@ -63,23 +63,48 @@ typedef struct
   /* agg expression */
   rasqal_expression* expr;
   
-  /* aggregation function execution user data as created by
-   * rasqal_builtin_agg_expression_execute_init() and destroyed by
-   * rasqal_builtin_agg_expression_execute_finish().
-   */
-  void* agg_user_data;
-
   /* (shared) output variable for this expression pointing into
    * aggregation rowsource context vars_seq */
   rasqal_variable* variable;
 
   /* sequence of aggregate function arguments */
   raptor_sequence* exprs_seq;
-
-  /* map for distincting literal values */
-  rasqal_map* map;
 } rasqal_agg_expr_data;
 
+
+/*
+ * rasqal_agg_group:
+ *
+ * INTERNAL - aggregation state for one group
+ *
+ * Holds the running state of every aggregate expression for one
+ * group so that input rows can be stepped and then discarded.
+ */
+typedef struct
+{
+  /* Key of this group (seq of literals) or NULL when the input
+   * rowsource is already grouped */
+  raptor_sequence* literals;
+
+  /* sequence of values from the first input row to copy/sample through */
+  raptor_sequence* input_values;
+
+  /* number of agg expressions (size of arrays below) */
+  int expr_count;
+
+  /* array of aggregation function execution user data as created by
+   * rasqal_builtin_agg_expression_execute_init() and destroyed by
+   * rasqal_builtin_agg_expression_execute_finish().
+   */
+  void** agg_user_data;
+
+  /* array of maps for distincting literal values (NULL if not DISTINCT) */
+  rasqal_map** maps;
+
+  /* number of rows stepped into this group */
+  int step_count;
+} rasqal_agg_group;
+
   
 /*
  * rasqal_aggregation_rowsource_context:
@@ -119,15 +144,21 @@ typedef struct
   /* output row offset */
   int offset;
 
-  /* sequence of values from input rowsource to copy/sample through */
-  raptor_sequence* input_values;
-
-  /* number of variables/values on input rowsource to copy/sample through
-   * (size of @input_values) */
+  /* number of variables/values on input rowsource to copy/sample through */
   int input_values_count;
 
-  /* step into current group */
-  int step_count;
+  /* current group state when the input rowsource is already grouped */
+  rasqal_agg_group* group;
+
+  /* GROUP BY expressions when rows are grouped here as they are read
+   * (or NULL when the input rowsource is already grouped) */
+  raptor_sequence* group_exprs_seq;
+
+  /* avltree of #rasqal_agg_group keyed by GROUP BY literals */
+  raptor_avltree* groups;
+
+  /* iterator into groups tree above */
+  raptor_avltree_iterator* groups_iterator;
 } rasqal_aggregation_rowsource_context;
 
 
@@ -407,6 +438,325 @@ rasqal_builtin_agg_expression_execute_result(void* user_data)
 
 
 
+static void
+rasqal_free_agg_group(rasqal_agg_group* group)
+{
+  int i;
+
+  if(!group)
+    return;
+
+  for(i = 0; i < group->expr_count; i++) {
+    if(group->agg_user_data && group->agg_user_data[i])
+      rasqal_builtin_agg_expression_execute_finish(group->agg_user_data[i]);
+
+    if(group->maps && group->maps[i])
+      rasqal_free_map(group->maps[i]);
+  }
+
+  if(group->agg_user_data)
+    RASQAL_FREE(void**, group->agg_user_data);
+
+  if(group->maps)
+    RASQAL_FREE(rasqal_map**, group->maps);
+
+  if(group->literals)
+    raptor_free_sequence(group->literals);
+
+  if(group->input_values)
+    raptor_free_sequence(group->input_values);
+
+  RASQAL_FREE(rasqal_agg_group, group);
+}
+
+
+/*
+ * rasqal_agg_group_init_maps:
+ * @group: group
+ * @con: aggregation rowsource context
+ *
+ * INTERNAL - Create empty distinct maps for DISTINCT aggregate expressions
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_agg_group_init_maps(rasqal_agg_group* group,
+                           rasqal_aggregation_rowsource_context* con)
+{
+  int i;
+
+  for(i = 0; i < con->expr_count; i++) {
+    rasqal_agg_expr_data* expr_data = &con->expr_data[i];
+
+    if(group->maps[i]) {
+      rasqal_free_map(group->maps[i]);
+      group->maps[i] = NULL;
+    }
+
+    if(expr_data->expr->flags & RASQAL_EXPR_FLAG_DISTINCT) {
+      group->maps[i] = rasqal_new_literal_sequence_sort_map(1 /* is_distinct */,
+                                                            0 /* compare_flags */);
+      if(!group->maps[i])
+        return 1;
+    }
+  }
+
+  return 0;
+}
+
+
+/*
+ * rasqal_new_agg_group:
+ * @rowsource: aggregation rowsource
+ * @con: aggregation rowsource context
+ * @literals: group key sequence of literals (or NULL)
+ *
+ * INTERNAL - Create a new empty aggregation group state
+ *
+ * The @literals sequence becomes owned by the new group, even on failure.
+ *
+ * Return value: new group or NULL on failure
+ */
+static rasqal_agg_group*
+rasqal_new_agg_group(rasqal_rowsource* rowsource,
+                     rasqal_aggregation_rowsource_context* con,
+                     raptor_sequence* literals)
+{
+  rasqal_agg_group* group;
+  size_t count = RASQAL_GOOD_CAST(size_t, con->expr_count);
+  int i;
+
+  group = RASQAL_CALLOC(rasqal_agg_group*, 1, sizeof(*group));
+  if(!group) {
+    if(literals)
+      raptor_free_sequence(literals);
+    return NULL;
+  }
+
+  group->literals = literals;
+  group->expr_count = con->expr_count;
+
+  group->input_values = raptor_new_sequence((raptor_data_free_handler)rasqal_free_literal,
+                                            (raptor_data_print_handler)rasqal_literal_print);
+  group->agg_user_data = RASQAL_CALLOC(void**, count ? count : 1,
+                                       sizeof(void*));
+  group->maps = RASQAL_CALLOC(rasqal_map**, count ? count : 1,
+                              sizeof(rasqal_map*));
+  if(!group->input_values || !group->agg_user_data || !group->maps)
+    goto fail;
+
+  for(i = 0; i < con->expr_count; i++) {
+    group->agg_user_data[i] = rasqal_builtin_agg_expression_execute_init(rowsource->world,
+                                                                         con->expr_data[i].expr);
+    if(!group->agg_user_data[i])
+      goto fail;
+  }
+
+  if(rasqal_agg_group_init_maps(group, con))
+    goto fail;
+
+  return group;
+
+  fail:
+  rasqal_free_agg_group(group);
+  return NULL;
+}
+
+
+/*
+ * rasqal_agg_group_reset:
+ * @group: group
+ * @con: aggregation rowsource context
+ *
+ * INTERNAL - Reset aggregation group state to start a new group
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_agg_group_reset(rasqal_agg_group* group,
+                       rasqal_aggregation_rowsource_context* con)
+{
+  int i;
+
+  for(i = 0; i < group->expr_count; i++) {
+    if(rasqal_builtin_agg_expression_execute_reset(group->agg_user_data[i]))
+      return 1;
+  }
+
+  group->step_count = 0;
+
+  return rasqal_agg_group_init_maps(group, con);
+}
+
+
+static int
+rasqal_agg_group_compare(const void *a, const void *b)
+{
+  rasqal_agg_group* group_a = (rasqal_agg_group*)a;
+  rasqal_agg_group* group_b = (rasqal_agg_group*)b;
+
+  return rasqal_literal_sequence_compare(RASQAL_COMPARE_URI,
+                                         group_a->literals, group_b->literals);
+}
+
+
+/*
+ * rasqal_aggregation_rowsource_step_group:
+ * @rowsource: aggregation rowsource
+ * @con: aggregation rowsource context
+ * @group: group to update
+ * @row: input row (variables must already be bound)
+ *
+ * INTERNAL - Step the aggregate expressions of a group over one input row
+ *
+ * The @row is not used after this returns and may be freed.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_aggregation_rowsource_step_group(rasqal_rowsource* rowsource,
+                                        rasqal_aggregation_rowsource_context* con,
+                                        rasqal_agg_group* group,
+                                        rasqal_row* row)
+{
+  int error = 0;
+  int i;
+
+  if(!group->step_count) {
+    /* copy first value row from input rowsource */
+    for(i = 0; i < con->input_values_count; i++) {
+      rasqal_literal* value;
+
+      value = rasqal_new_literal_from_literal(row->values[i]);
+      raptor_sequence_set_at(group->input_values, i, value);
+    }
+  }
+
+  group->step_count++;
+
+  for(i = 0; i < con->expr_count; i++) {
+    rasqal_agg_expr_data* expr_data = &con->expr_data[i];
+    rasqal_map* map = group->maps[i];
+    raptor_sequence* seq;
+
+    /* SPARQL Aggregation uses ListEvalE() to evaluate - ignoring
+     * errors and filtering out expressions that fail
+     */
+    seq = rasqal_expression_sequence_evaluate(rowsource->query,
+                                              expr_data->exprs_seq,
+                                              /* ignore_errors */ 1,
+                                              &error);
+    if(error)
+      continue;
+
+    if(map) {
+      if(rasqal_literal_sequence_sort_map_add_literal_sequence(map, seq)) {
+        /* duplicate found
+         *
+         * The above function just freed seq so no data is lost
+         */
+        continue;
+      }
+    }
+
+#ifdef RASQAL_DEBUG
+    RASQAL_DEBUG2("Aggregation expr %d step over literals: ", i);
+    raptor_sequence_print(seq, DEBUG_FH);
+    fputc('\n', DEBUG_FH);
+#endif
+
+    error = rasqal_builtin_agg_expression_execute_step(group->agg_user_data[i],
+                                                       seq);
+    /* when DISTINCTing, seq remains owned by the map
+     * otherwise seq is local and must be freed
+     */
+    if(!map)
+      raptor_free_sequence(seq);
+
+    if(error) {
+      RASQAL_DEBUG2("Aggregation expr %d returned error\n", i);
+      error = 0;
+    }
+  }
+
+  return error;
+}
+
+
+/*
+ * rasqal_aggregation_rowsource_group_result:
+ * @rowsource: aggregation rowsource
+ * @con: aggregation rowsource context
+ * @group: finished group
+ *
+ * INTERNAL - Make the output row for a finished group
+ *
+ * Moves the sampled input values out of @group and binds the
+ * aggregate result variables.
+ *
+ * Return value: new row or NULL on failure
+ */
+static rasqal_row*
+rasqal_aggregation_rowsource_group_result(rasqal_rowsource* rowsource,
+                                          rasqal_aggregation_rowsource_context* con,
+                                          rasqal_agg_group* group)
+{
+  rasqal_row* row;
+  int offset = 0;
+  int i;
+
+  row = rasqal_new_row(rowsource);
+  if(!row)
+    return NULL;
+
+  /* Copy scalar results through */
+  for(i = 0; i < con->input_values_count; i++) {
+    rasqal_literal* result;
+
+    /* Reset: get and delete any stored input rowsource literal */
+    result = (rasqal_literal*)raptor_sequence_delete_at(group->input_values, i);
+
+    rasqal_row_set_value_at(row, offset, result);
+    if(result)
+      rasqal_free_literal(result);
+
+    offset++;
+  }
+
+
+  /* Set aggregate results */
+  for(i = 0; i < con->expr_count; i++) {
+    rasqal_literal* result;
+    rasqal_variable* v;
+
+    /* Calculate the result because the input ended or a new group started */
+    result = rasqal_builtin_agg_expression_execute_result(group->agg_user_data[i]);
+
+#ifdef RASQAL_DEBUG
+    RASQAL_DEBUG2("Aggregation %d ending group with result: ", i);
+    rasqal_literal_print(result, DEBUG_FH);
+    fputc('\n', DEBUG_FH);
+#endif
+
+    v = rasqal_rowsource_get_variable_by_offset(rowsource, offset);
+    result = rasqal_new_literal_from_literal(result);
+    /* it is OK to bind to NULL */
+    rasqal_variable_set_value(v, result);
+
+    rasqal_row_set_value_at(row, offset, result);
+
+    if(result)
+      rasqal_free_literal(result);
+
+    offset++;
+  }
+
+  row->offset = con->offset++;
+
+  return row;
+}
+
+
 static int
 rasqal_aggregation_rowsource_init(rasqal_rowsource* rowsource, void *user_data)
 {
@@ -414,16 +764,14 @@ rasqal_aggregation_rowsource_init(rasqal_rowsource* rowsource, void *user_data)
 
   con = (rasqal_aggregation_rowsource_context*)user_data;
 
-  con->input_values = raptor_new_sequence((raptor_data_free_handler)rasqal_free_literal,
-                                          (raptor_data_print_handler)rasqal_literal_print);
-    
-
   con->last_group_id = -1;
   con->offset = 0;
-  con->step_count = 0;
   
-  if(rasqal_rowsource_request_grouping(con->rowsource))
-    return 1;
+  /* rows are grouped here when there are GROUP BY expressions */
+  if(!con->group_exprs_seq) {
+    if(rasqal_rowsource_request_grouping(con->rowsource))
+      return 1;
+  }
   
   return 0;
 }
@@ -437,23 +785,26 @@ rasqal_aggregation_rowsource_finish(rasqal_rowsource* rowsource,
 
   con = (rasqal_aggregation_rowsource_context*)user_data;
 
+  if(con->groups_iterator)
+    raptor_free_avltree_iterator(con->groups_iterator);
+
+  if(con->groups)
+    raptor_free_avltree(con->groups);
+
+  if(con->group)
+    rasqal_free_agg_group(con->group);
+
   if(con->expr_data) {
     int i;
 
     for(i = 0; i < con->expr_count; i++) {
       rasqal_agg_expr_data* expr_data = &con->expr_data[i];
 
-      if(expr_data->agg_user_data)
-        rasqal_builtin_agg_expression_execute_finish(expr_data->agg_user_data);
-
       if(expr_data->exprs_seq)
         raptor_free_sequence(expr_data->exprs_seq);
 
       if(expr_data->expr)
         rasqal_free_expression(expr_data->expr);
-
-      if(expr_data->map)
-        rasqal_free_map(expr_data->map);
     }
 
     RASQAL_FREE(rasqal_agg_expr_data, con->expr_data);
@@ -465,15 +816,15 @@ rasqal_aggregation_rowsource_finish(rasqal_rowsource* rowsource,
   if(con->vars_seq)
     raptor_free_sequence(con->vars_seq);
 
+  if(con->group_exprs_seq)
+    raptor_free_sequence(con->group_exprs_seq);
+
   if(con->rowsource)
     rasqal_free_rowsource(con->rowsource);
   
   if(con->saved_row)
     rasqal_free_row(con->saved_row);
 
-  if(con->input_values)
-    raptor_free_sequence(con->input_values);
-
   RASQAL_FREE(rasqal_aggregation_rowsource_context, con);
 
   return 0;
@@ -512,6 +863,148 @@ rasqal_aggregation_rowsource_ensure_variables(rasqal_rowsource* rowsource,
 }
 
 
+/*
+ * rasqal_aggregation_rowsource_process_groups:
+ * @rowsource: aggregation rowsource
+ * @con: aggregation rowsource context
+ *
+ * INTERNAL - Read all input rows, grouping and aggregating as they arrive
+ *
+ * Each input row is evaluated against the GROUP BY expressions,
+ * stepped into the aggregate state of its group and then freed so
+ * only one state per group is kept, not the group rows.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_aggregation_rowsource_process_groups(rasqal_rowsource* rowsource,
+                                            rasqal_aggregation_rowsource_context* con)
+{
+  rasqal_query* query = rowsource->query;
+  rasqal_agg_group* group;
+  rasqal_row* row;
+
+  con->groups = raptor_new_avltree(rasqal_agg_group_compare,
+                                   (raptor_data_free_handler)rasqal_free_agg_group,
+                                   /* flags */ 0);
+  if(!con->groups)
+    return 1;
+
+  while((row = rasqal_rowsource_read_row(con->rowsource))) {
+    raptor_sequence* literal_seq;
+    rasqal_agg_group key;
+
+    rasqal_row_bind_variables(row, query->vars_table);
+
+    literal_seq = rasqal_expression_sequence_evaluate(query,
+                                                      con->group_exprs_seq,
+                                                      /* ignore_errors */ 0,
+                                                      /* error_p */ NULL);
+    if(!literal_seq) {
+      RASQAL_DEBUG1("Aggregation GROUP BY expression evaluation failed\n");
+      rasqal_free_row(row);
+      return 1;
+    }
+
+    memset(&key, '\0', sizeof(key));
+    key.literals = literal_seq;
+
+    group = (rasqal_agg_group*)raptor_avltree_search(con->groups, &key);
+    if(group)
+      raptor_free_sequence(literal_seq);
+    else {
+      /* New Group - owns literal_seq */
+      group = rasqal_new_agg_group(rowsource, con, literal_seq);
+      if(!group) {
+        rasqal_free_row(row);
+        return 1;
+      }
+
+      /* after this, group is owned by con->groups */
+      if(raptor_avltree_add(con->groups, group)) {
+        rasqal_free_row(row);
+        return 1;
+      }
+    }
+
+    if(rasqal_aggregation_rowsource_step_group(rowsource, con, group, row)) {
+      rasqal_free_row(row);
+      return 1;
+    }
+    rasqal_free_row(row);
+  }
+
+  if(!raptor_avltree_size(con->groups)) {
+    /* No input rows: aggregate over one group of one empty row as
+     * the GROUP BY rowsource does */
+    raptor_sequence* literal_seq;
+
+    literal_seq = raptor_new_sequence((raptor_data_free_handler)rasqal_free_literal,
+                                      (raptor_data_print_handler)rasqal_literal_print);
+    if(!literal_seq)
+      return 1;
+
+    group = rasqal_new_agg_group(rowsource, con, literal_seq);
+    if(!group || raptor_avltree_add(con->groups, group))
+      return 1;
+
+    row = rasqal_new_row(con->rowsource);
+    if(!row)
+      return 1;
+
+    rasqal_row_bind_variables(row, query->vars_table);
+    if(rasqal_aggregation_rowsource_step_group(rowsource, con, group, row)) {
+      rasqal_free_row(row);
+      return 1;
+    }
+    rasqal_free_row(row);
+  }
+
+  con->groups_iterator = raptor_new_avltree_iterator(con->groups,
+                                                     NULL, NULL,
+                                                     1);
+  if(!con->groups_iterator)
+    return 1;
+
+  return 0;
+}
+
+
+static rasqal_row*
+rasqal_aggregation_rowsource_read_grouped_row(rasqal_rowsource* rowsource,
+                                              rasqal_aggregation_rowsource_context* con)
+{
+  rasqal_agg_group* group;
+  rasqal_row* row = NULL;
+
+  if(!con->groups) {
+    if(rasqal_aggregation_rowsource_process_groups(rowsource, con)) {
+      con->finished = 1;
+      return NULL;
+    }
+  }
+
+  group = (rasqal_agg_group*)raptor_avltree_iterator_get(con->groups_iterator);
+  if(group) {
+    row = rasqal_aggregation_rowsource_group_result(rowsource, con, group);
+    raptor_avltree_iterator_next(con->groups_iterator);
+  }
+
+  if(!row) {
+    /* No more groups (or failure) - release all group state */
+    con->finished = 1;
+
+    raptor_free_avltree_iterator(con->groups_iterator);
+    con->groups_iterator = NULL;
+
+    raptor_free_avltree(con->groups);
+    con->groups = NULL;
+  }
+
+  return row;
+}
+
+
 static rasqal_row*
 rasqal_aggregation_rowsource_read_row(rasqal_rowsource* rowsource,
                                       void *user_data)
@@ -525,6 +1018,9 @@ rasqal_aggregation_rowsource_read_row(rasqal_rowsource* rowsource,
   if(con->finished)
     return NULL;
   
+  if(con->group_exprs_seq)
+    return rasqal_aggregation_rowsource_read_grouped_row(rowsource, con);
+
 
   /* Iterate over input rows until last row seen or group done */
   while(1) {
@@ -543,8 +1039,6 @@ rasqal_aggregation_rowsource_read_row(rasqal_rowsource* rowsource,
 
 
     if(con->last_group_id != row->group_id) {
-      int i;
-      
       if(!con->saved_row && con->last_group_id >= 0) {
         /* Existing aggregation is done - return result */
 
@@ -557,16 +1051,6 @@ rasqal_aggregation_rowsource_read_row(rasqal_rowsource* rowsource,
         fputc('\n', DEBUG_FH);
 #endif
 
-        /* Empty distinct maps */
-        for(i = 0; i < con->expr_count; i++) {
-          rasqal_agg_expr_data* expr_data = &con->expr_data[i];
-
-          if(expr_data->map) {
-            rasqal_free_map(expr_data->map);
-            expr_data->map = NULL;
-          }
-        }
-      
         break;
       }
 
@@ -581,33 +1065,14 @@ rasqal_aggregation_rowsource_read_row(rasqal_rowsource* rowsource,
 
       /* next time this function is called we continue here */
 
-      for(i = 0; i < con->expr_count; i++) {
-        rasqal_agg_expr_data* expr_data = &con->expr_data[i];
-
-        if(!expr_data->agg_user_data) {
-          /* init once */
-          expr_data->agg_user_data = rasqal_builtin_agg_expression_execute_init(rowsource->world,
-                                                                                expr_data->expr);
-          
-          if(!expr_data->agg_user_data) {
-            error = 1;
-            break;
-          }
-        }
-
-        /* Init map for each group */
-        if(expr_data->expr->flags & RASQAL_EXPR_FLAG_DISTINCT) {
-          expr_data->map = rasqal_new_literal_sequence_sort_map(1 /* is_distinct */,
-                                                                0 /* compare_flags */);
-          if(!expr_data->map) {
-            error = 1;
-            break;
-          }
+      if(!con->group) {
+        /* init once */
+        con->group = rasqal_new_agg_group(rowsource, con, NULL);
+        if(!con->group) {
+          error = 1;
+          break;
         }
       }
-      
-      if(error)
-        break;
 
       con->last_group_id = row->group_id;
     } /* end if handling change of group ID */
@@ -619,66 +1084,8 @@ rasqal_aggregation_rowsource_read_row(rasqal_rowsource* rowsource,
     /* Evaluate the expressions giving a sequence of literals to 
      * run the aggregation step over.
      */
-    if(1) {
-      int i;
-
-      if(!con->step_count) {
-        /* copy first value row from input rowsource */
-        for(i = 0; i < con->input_values_count; i++) {
-          rasqal_literal* value;
-          
-          value = rasqal_new_literal_from_literal(row->values[i]);
-          raptor_sequence_set_at(con->input_values, i, value);
-        }
-      }
-
-      con->step_count++;
-      
-      for(i = 0; i < con->expr_count; i++) {
-        rasqal_agg_expr_data* expr_data = &con->expr_data[i];
-        raptor_sequence* seq;
-        
-        /* SPARQL Aggregation uses ListEvalE() to evaluate - ignoring
-         * errors and filtering out expressions that fail
-         */
-        seq = rasqal_expression_sequence_evaluate(rowsource->query,
-                                                  expr_data->exprs_seq,
-                                                  /* ignore_errors */ 1,
-                                                  &error);
-        if(error)
-          continue;
-
-        if(expr_data->map) {
-          if(rasqal_literal_sequence_sort_map_add_literal_sequence(expr_data->map, 
-                                                                   seq)) {
-            /* duplicate found
-             *
-             * The above function just freed seq so no data is lost
-             */
-            continue;
-          }
-        }
-
-#ifdef RASQAL_DEBUG
-        RASQAL_DEBUG2("Aggregation expr %d step over literals: ", i);
-        raptor_sequence_print(seq, DEBUG_FH);
-        fputc('\n', DEBUG_FH);
-#endif
-
-        error = rasqal_builtin_agg_expression_execute_step(expr_data->agg_user_data,
-                                                           seq);
-        /* when DISTINCTing, seq remains owned by the map
-         * otherwise seq is local and must be freed
-         */
-        if(!expr_data->map)
-          raptor_free_sequence(seq);
-
-        if(error) {
-          RASQAL_DEBUG2("Aggregation expr %d returned error\n", i);
-          error = 0;
-        }
-      }
-    }
+    error = rasqal_aggregation_rowsource_step_group(rowsource, con,
+                                                    con->group, row);
 
     rasqal_free_row(row); row = NULL;
     
@@ -695,64 +1102,14 @@ rasqal_aggregation_rowsource_read_row(rasqal_rowsource* rowsource,
       row = NULL;
     }
   } else if (con->last_group_id >= 0) {
-    int offset = 0;
-    int i;
-
     /* Generate result row and reset for next group */
-    row = rasqal_new_row(rowsource);
-
-    /* Copy scalar results through */
-    for(i = 0; i < con->input_values_count; i++) {
-      rasqal_literal* result;
-
-      /* Reset: get and delete any stored input rowsource literal */
-      result = (rasqal_literal*)raptor_sequence_delete_at(con->input_values, i);
-
-      rasqal_row_set_value_at(row, offset, result);
-      rasqal_free_literal(result);
-      
-      offset++;
-    }
-
-
-    /* Set aggregate results */
-    for(i = 0; i < con->expr_count; i++) {
-      rasqal_literal* result;
-      rasqal_agg_expr_data* expr_data = &con->expr_data[i];
-      rasqal_variable* v;
-      
-      /* Calculate the result because the input ended or a new group started */
-      result = rasqal_builtin_agg_expression_execute_result(expr_data->agg_user_data);
-  
-#ifdef RASQAL_DEBUG
-      RASQAL_DEBUG2("Aggregation %d ending group with result: ", i);
-      rasqal_literal_print(result, DEBUG_FH);
-      fputc('\n', DEBUG_FH);
-#endif
-      
-      v = rasqal_rowsource_get_variable_by_offset(rowsource, offset);
-      result = rasqal_new_literal_from_literal(result);
-      /* it is OK to bind to NULL */
-      rasqal_variable_set_value(v, result);
-
-      rasqal_row_set_value_at(row, offset, result);
-        
-      if(result)
-        rasqal_free_literal(result);
-    
-      offset++;
+    row = rasqal_aggregation_rowsource_group_result(rowsource, con, con->group);
 
-      if(rasqal_builtin_agg_expression_execute_reset(expr_data->agg_user_data)) {
+    if(rasqal_agg_group_reset(con->group, con)) {
+      if(row)
         rasqal_free_row(row);
-        row = NULL;
-        break;
-      }
+      row = NULL;
     }
-
-    con->step_count = 0;
-      
-    if(row)
-      row->offset = con->offset++;
   }
 
   
@@ -786,6 +1143,9 @@ static const rasqal_rowsource_handler rasqal_aggregation_rowsource_handler = {
   /* .set_requirements = */ NULL,
   /* .get_inner_rowsource = */ rasqal_aggregation_rowsource_get_inner_rowsource,
   /* .set_origin = */ NULL,
+  /* .read_batch = */ NULL,
+  /* .get_order = */ NULL,
+  /* .set_outer_variables = */ NULL,
 };
 
 
@@ -793,14 +1153,28 @@ static const rasqal_rowsource_handler rasqal_aggregation_rowsource_handler = {
  * rasqal_new_aggregation_rowsource:
  * @world: world
  * @query: query
- * @rowsource: input (grouped) rowsource - typically constructed by rasqal_new_groupby_rowsource()
+ * @rowsource: input rowsource - grouped and typically constructed by rasqal_new_groupby_rowsource() when @group_exprs_seq is NULL
+ * @group_exprs_seq: sequence of GROUP BY #rasqal_expression to group @rowsource by (or NULL)
  * @exprs_seq: sequence of #rasqal_expression
  * @vars_seq: sequence of #rasqal_variable to bind in output rows
  *
  * INTERNAL - Create a new rowsource for a aggregration
  *
- * The @rowsource becomes owned by the new rowsource.  The @exprs_seq
- * and @vars_seq are not. 
+ * The @rowsource becomes owned by the new rowsource.  The
+ * @group_exprs_seq, @exprs_seq and @vars_seq are not.
+ *
+ * When @group_exprs_seq is given, the input rows are grouped as
+ * they are read and each row is freed as soon as it has been
+ * stepped into its group aggregate state, so memory use depends on
+ * the number of groups rather than the number of rows.  This is
+ * only possible when rasqal_aggregation_expressions_can_stream()
+ * is true for @exprs_seq.
+ *
+ * All groups are aggregated in the calling thread.  The rows are not
+ * partitioned over worker threads because evaluating the GROUP BY
+ * and aggregate expressions binds values into the query variables
+ * shared by the whole execution and literal reference counts are not
+ * atomic.
  *
  * For example with the SPARQL 1.1 example queries
  *
@@ -826,6 +1200,7 @@ static const rasqal_rowsource_handler rasqal_aggregation_rowsource_handler = {
 rasqal_rowsource*
 rasqal_new_aggregation_rowsource(rasqal_world *world, rasqal_query* query,
                                  rasqal_rowsource* rowsource,
+                                 raptor_sequence* group_exprs_seq,
                                  raptor_sequence* exprs_seq,
                                  raptor_sequence* vars_seq)
 {
@@ -855,6 +1230,12 @@ rasqal_new_aggregation_rowsource(rasqal_world *world, rasqal_query* query,
 
   con->exprs_seq = exprs_seq;
   con->vars_seq = vars_seq;
+
+  if(group_exprs_seq) {
+    con->group_exprs_seq = rasqal_expression_copy_expression_sequence(group_exprs_seq);
+    if(!con->group_exprs_seq)
+      goto fail;
+  }
   
   /* allocate per-expr data */
   con->expr_count = size;
@@ -909,6 +1290,138 @@ rasqal_new_aggregation_rowsource(rasqal_world *world, rasqal_query* query,
   return NULL;
 }
 
+
+/**
+ * rasqal_aggregation_expressions_can_stream:
+ * @exprs_seq: sequence of aggregate #rasqal_expression
+ *
+ * INTERNAL - Check if aggregate expressions can be computed as rows stream in
+ *
+ * The built-in aggregates (AVG, COUNT, GROUP_CONCAT, MAX, MIN,
+ * SAMPLE, SUM) keep a running state so they do not need the rows
+ * of a group to be retained.  Any other aggregate needs the
+ * grouped input from rasqal_new_groupby_rowsource().
+ *
+ * Return value: non-0 if all the expressions can be streamed
+ */
+int
+rasqal_aggregation_expressions_can_stream(raptor_sequence* exprs_seq)
+{
+  rasqal_expression* expr;
+  int i;
+
+  if(!exprs_seq)
+    return 0;
+
+  for(i = 0;
+      (expr = (rasqal_expression*)raptor_sequence_get_at(exprs_seq, i));
+      i++) {
+    switch(expr->op) {
+      case RASQAL_EXPR_AVG:
+      case RASQAL_EXPR_COUNT:
+      case RASQAL_EXPR_GROUP_CONCAT:
+      case RASQAL_EXPR_MAX:
+      case RASQAL_EXPR_MIN:
+      case RASQAL_EXPR_SAMPLE:
+      case RASQAL_EXPR_SUM:
+        break;
+
+      case RASQAL_EXPR_UNKNOWN:
+      case RASQAL_EXPR_AND:
+      case RASQAL_EXPR_OR:
+      case RASQAL_EXPR_EQ:
+      case RASQAL_EXPR_NEQ:
+      case RASQAL_EXPR_LT:
+      case RASQAL_EXPR_GT:
+      case RASQAL_EXPR_LE:
+      case RASQAL_EXPR_GE:
+      case RASQAL_EXPR_UMINUS:
+      case RASQAL_EXPR_PLUS:
+      case RASQAL_EXPR_MINUS:
+      case RASQAL_EXPR_STAR:
+      case RASQAL_EXPR_SLASH:
+      case RASQAL_EXPR_REM:
+      case RASQAL_EXPR_STR_EQ:
+      case RASQAL_EXPR_STR_NEQ:
+      case RASQAL_EXPR_STR_MATCH:
+      case RASQAL_EXPR_STR_NMATCH:
+      case RASQAL_EXPR_TILDE:
+      case RASQAL_EXPR_BANG:
+      case RASQAL_EXPR_LITERAL:
+      case RASQAL_EXPR_FUNCTION:
+      case RASQAL_EXPR_BOUND:
+      case RASQAL_EXPR_STR:
+      case RASQAL_EXPR_LANG:
+      case RASQAL_EXPR_DATATYPE:
+      case RASQAL_EXPR_ISURI:
+      case RASQAL_EXPR_ISBLANK:
+      case RASQAL_EXPR_ISLITERAL:
+      case RASQAL_EXPR_CAST:
+      case RASQAL_EXPR_ORDER_COND_ASC:
+      case RASQAL_EXPR_ORDER_COND_DESC:
+      case RASQAL_EXPR_LANGMATCHES:
+      case RASQAL_EXPR_REGEX:
+      case RASQAL_EXPR_GROUP_COND_ASC:
+      case RASQAL_EXPR_GROUP_COND_DESC:
+      case RASQAL_EXPR_VARSTAR:
+      case RASQAL_EXPR_SAMETERM:
+      case RASQAL_EXPR_COALESCE:
+      case RASQAL_EXPR_IF:
+      case RASQAL_EXPR_URI:
+      case RASQAL_EXPR_IRI:
+      case RASQAL_EXPR_STRLANG:
+      case RASQAL_EXPR_STRDT:
+      case RASQAL_EXPR_BNODE:
+      case RASQAL_EXPR_IN:
+      case RASQAL_EXPR_NOT_IN:
+      case RASQAL_EXPR_ISNUMERIC:
+      case RASQAL_EXPR_YEAR:
+      case RASQAL_EXPR_MONTH:
+      case RASQAL_EXPR_DAY:
+      case RASQAL_EXPR_HOURS:
+      case RASQAL_EXPR_MINUTES:
+      case RASQAL_EXPR_SECONDS:
+      case RASQAL_EXPR_TIMEZONE:
+      case RASQAL_EXPR_CURRENT_DATETIME:
+      case RASQAL_EXPR_NOW:
+      case RASQAL_EXPR_FROM_UNIXTIME:
+      case RASQAL_EXPR_TO_UNIXTIME:
+      case RASQAL_EXPR_CONCAT:
+      case RASQAL_EXPR_STRLEN:
+      case RASQAL_EXPR_SUBSTR:
+      case RASQAL_EXPR_UCASE:
+      case RASQAL_EXPR_LCASE:
+      case RASQAL_EXPR_STRSTARTS:
+      case RASQAL_EXPR_STRENDS:
+      case RASQAL_EXPR_CONTAINS:
+      case RASQAL_EXPR_ENCODE_FOR_URI:
+      case RASQAL_EXPR_TZ:
+      case RASQAL_EXPR_RAND:
+      case RASQAL_EXPR_ABS:
+      case RASQAL_EXPR_ROUND:
+      case RASQAL_EXPR_CEIL:
+      case RASQAL_EXPR_FLOOR:
+      case RASQAL_EXPR_MD5:
+      case RASQAL_EXPR_SHA1:
+      case RASQAL_EXPR_SHA224:
+      case RASQAL_EXPR_SHA256:
+      case RASQAL_EXPR_SHA384:
+      case RASQAL_EXPR_SHA512:
+      case RASQAL_EXPR_STRBEFORE:
+      case RASQAL_EXPR_STRAFTER:
+      case RASQAL_EXPR_REPLACE:
+      case RASQAL_EXPR_UUID:
+      case RASQAL_EXPR_STRUUID:
+      case RASQAL_EXPR_EXISTS:
+      case RASQAL_EXPR_NOT_EXISTS:
+      default:
+        return 0;
+    }
+  }
+
+  return 1;
+}
+
 #endif /* not STANDALONE */
 
 
@@ -1084,7 +1597,8 @@ main(int argc, char *argv[])
   rasqal_rowsource *input_rs = NULL;
   raptor_sequence* vars_seq = NULL;
   raptor_sequence* exprs_seq = NULL;
-  int test_id;
+  raptor_sequence* group_exprs_seq = NULL;
+  int run;
 
   world = rasqal_new_world();
   if(!world || rasqal_world_open(world)) {
@@ -1096,7 +1610,11 @@ main(int argc, char *argv[])
 
   vt = query->vars_table;
   
-  for(test_id = 0; test_id < AGGREGATION_TESTS_COUNT; test_id++) {
+  /* Run every test twice: first over pre-grouped input rows and then
+   * grouping by ?x inside the aggregation rowsource */
+  for(run = 0; run < 2 * AGGREGATION_TESTS_COUNT; run++) {
+    int test_id = run % AGGREGATION_TESTS_COUNT;
+    int grouping = (run >= AGGREGATION_TESTS_COUNT);
     int input_vars_count = test_data[test_id].input_vars;
     int output_rows_count = test_data[test_id].output_rows;
     int output_vars_count = test_data[test_id].output_vars;
@@ -1126,11 +1644,13 @@ main(int argc, char *argv[])
 
     row_seq = rasqal_new_row_sequence(world, vt, test_data[test_id].data,
                                       test_data[test_id].input_vars, &vars_seq);
-    if(row_seq) {
+    if(row_seq && !grouping) {
       for(i = 0; i < test_data[test_id].input_rows; i++) {
         rasqal_row* row = (rasqal_row*)raptor_sequence_get_at(row_seq, i);
         row->group_id = input_group_ids[i];
       }
+    }
+    if(row_seq) {
       
       input_rs = rasqal_new_rowsequence_rowsource(world, query, vt, 
                                                   row_seq, vars_seq);
@@ -1200,13 +1720,46 @@ main(int argc, char *argv[])
     /* output_var is now owned by vars_seq */
     output_var = NULL;
 
+    if(grouping) {
+      rasqal_variable* v;
+      rasqal_literal *l = NULL;
+      rasqal_expression* e = NULL;
+
+      /* GROUP BY ?x */
+      v = rasqal_variables_table_get_by_name(vt, RASQAL_VARIABLE_TYPE_NORMAL,
+                                             RASQAL_GOOD_CAST(const unsigned char*, "x"));
+      if(v) {
+        v = rasqal_new_variable_from_variable(v);
+        l = rasqal_new_variable_literal(world, v);
+      }
+      if(l)
+        e = rasqal_new_literal_expression(world, l);
+
+      group_exprs_seq = raptor_new_sequence((raptor_data_free_handler)rasqal_free_expression,
+                                            (raptor_data_print_handler)rasqal_expression_print);
+      if(!e || !group_exprs_seq) {
+        fprintf(stderr, "%s: failed to create GROUP BY expressions\n",
+                program);
+        if(e)
+          rasqal_free_expression(e);
+        failures++;
+        goto tidy;
+      }
+      raptor_sequence_push(group_exprs_seq, e);
+    }
+
     rowsource = rasqal_new_aggregation_rowsource(world, query, input_rs,
+                                                 group_exprs_seq,
                                                  exprs_seq, vars_seq);
     /* input_rs is now owned by rowsource */
     input_rs = NULL;
     /* these are no longer needed; agg rowsource made copies */
     raptor_free_sequence(exprs_seq); exprs_seq = NULL;
     raptor_free_sequence(vars_seq); vars_seq = NULL;
+    if(group_exprs_seq) {
+      raptor_free_sequence(group_exprs_seq);
+      group_exprs_seq = NULL;
+    }
 
     if(!rowsource) {
       fprintf(stderr, "%s: failed to create aggregation rowsource\n", program);
@@ -1397,6 +1950,8 @@ main(int argc, char *argv[])
     raptor_free_sequence(exprs_seq);
   if(vars_seq)
     raptor_free_sequence(vars_seq);
+  if(group_exprs_seq)
+    raptor_free_sequence(group_exprs_seq);
   if(expr_args_seq)
     raptor_free_sequence(expr_args_seq);
   if(rowsource)
@@ -46,6 +46,11 @@ typedef struct
   /* bindings object */
   rasqal_bindings* bindings;
 
+  /* references to the rows of @bindings when this rowsource was made
+   * so that rasqal_query_set_bindings_rows() does not change the rows
+   * of an execution that has already started */
+  raptor_sequence* rows;
+
   /* bindings row offset */
   int offset;
 } rasqal_bindings_rowsource_context;
@@ -104,6 +109,9 @@ rasqal_bindings_rowsource_finish(rasqal_rowsource* rowsource, void *user_data)
 
   if(con->bindings)
     rasqal_free_bindings(con->bindings);
+
+  if(con->rows)
+    raptor_free_sequence(con->rows);
   
   RASQAL_FREE(rasqal_bindings_rowsource_context, con);
 
@@ -119,7 +127,9 @@ rasqal_bindings_rowsource_read_row(rasqal_rowsource* rowsource, void *user_data)
   
   con = (rasqal_bindings_rowsource_context*)user_data;
 
-  row = rasqal_bindings_get_row(con->bindings, con->offset++);
+  row = (rasqal_row*)raptor_sequence_get_at(con->rows, con->offset++);
+  if(row)
+    row = rasqal_new_row_from_row(row);
   
   return row;
 }
@@ -150,6 +160,9 @@ static const rasqal_rowsource_handler rasqal_bindings_rowsource_handler = {
   /* .set_requirements = */ NULL,
   /* .get_inner_rowsource = */ NULL,
   /* .set_origin =       */ NULL,
+  /* .read_batch =       */ NULL,
+  /* .get_order =        */ NULL,
+  /* .set_outer_variables = */ NULL,
 };
 
 
@@ -173,7 +186,9 @@ rasqal_new_bindings_rowsource(rasqal_world *world,
                               rasqal_bindings* bindings)
 {
   rasqal_bindings_rowsource_context *con;
+  rasqal_row* row;
   int flags = 0;
+  int i;
   
   if(!world || !query || !bindings)
     goto fail;
@@ -185,6 +200,23 @@ rasqal_new_bindings_rowsource(rasqal_world *world,
   con->bindings = bindings;
   con->offset = 0;
 
+  con->rows = raptor_new_sequence((raptor_data_free_handler)rasqal_free_row,
+                                  (raptor_data_print_handler)rasqal_row_print);
+  if(!con->rows) {
+    rasqal_bindings_rowsource_finish(NULL, con);
+    return NULL;
+  }
+
+  for(i = 0;
+      bindings->rows &&
+        (row = (rasqal_row*)raptor_sequence_get_at(bindings->rows, i));
+      i++) {
+    if(raptor_sequence_push(con->rows, rasqal_new_row_from_row(row))) {
+      rasqal_bindings_rowsource_finish(NULL, con);
+      return NULL;
+    }
+  }
+
   return rasqal_new_rowsource_from_handler(world, query,
                                            con,
                                            &rasqal_bindings_rowsource_handler,
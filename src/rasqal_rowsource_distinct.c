@@ -43,14 +43,36 @@
 
 #define DEBUG_FH stderr
 
+/* initial number of slots in the seen rows table; must be a power of 2 */
+#define RASQAL_DISTINCT_TABLE_INITIAL_SIZE 64
+
+
+/*
+ * rasqal_distinct_entry:
+ * @hash: hash of the row values
+ * @row: row or NULL if the slot is empty
+ *
+ * INTERNAL - one slot of the open addressing table of seen rows
+ */
+typedef struct {
+  uint64_t hash;
+  rasqal_row* row;
+} rasqal_distinct_entry;
+
 
 typedef struct 
 {
   /* inner rowsource to distinct */
   rasqal_rowsource *rowsource;
 
-  /* map for distincting row values */
-  rasqal_map* map;
+  /* table of rows returned so far */
+  rasqal_distinct_entry* table;
+
+  /* number of slots in @table; a power of 2 */
+  size_t table_size;
+
+  /* number of rows in @table */
+  size_t rows_count;
 
   /* offset into results for current row */
   int offset;
@@ -58,18 +80,38 @@ typedef struct
 } rasqal_distinct_rowsource_context;
 
 
+static void
+rasqal_distinct_rowsource_free_table(rasqal_distinct_rowsource_context* con)
+{
+  size_t i;
+
+  if(!con->table)
+    return;
+
+  for(i = 0; i < con->table_size; i++) {
+    if(con->table[i].row)
+      rasqal_free_row(con->table[i].row);
+  }
+
+  RASQAL_FREE(rasqal_distinct_entry*, con->table);
+  con->table = NULL;
+}
+
+
 static int
 rasqal_distinct_rowsource_init_common(rasqal_rowsource* rowsource, void *user_data)
 {
-  rasqal_query *query = rowsource->query;
   rasqal_distinct_rowsource_context *con;
 
   con = (rasqal_distinct_rowsource_context*)user_data;
   
   con->offset = 0;
 
-  con->map = rasqal_engine_new_rowsort_map(1, query->compare_flags, NULL);
-  if(!con->map)
+  con->table_size = RASQAL_DISTINCT_TABLE_INITIAL_SIZE;
+  con->rows_count = 0;
+  con->table = RASQAL_CALLOC(rasqal_distinct_entry*, con->table_size,
+                             sizeof(*con->table));
+  if(!con->table)
     return 1;
 
   return 0;
@@ -115,8 +157,7 @@ rasqal_distinct_rowsource_finish(rasqal_rowsource* rowsource, void *user_data)
   if(con->rowsource)
     rasqal_free_rowsource(con->rowsource);
   
-  if(con->map)
-    rasqal_free_map(con->map);
+  rasqal_distinct_rowsource_free_table(con);
 
   RASQAL_FREE(rasqal_distinct_rowsource_context, con);
 
@@ -124,6 +165,92 @@ rasqal_distinct_rowsource_finish(rasqal_rowsource* rowsource, void *user_data)
 }
 
 
+/*
+ * rasqal_distinct_rowsource_grow_table:
+ * @con: distinct rowsource context
+ *
+ * INTERNAL - Double the size of the seen rows table
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_distinct_rowsource_grow_table(rasqal_distinct_rowsource_context* con)
+{
+  size_t new_size = con->table_size << 1;
+  rasqal_distinct_entry* new_table;
+  size_t i;
+
+  new_table = RASQAL_CALLOC(rasqal_distinct_entry*, new_size,
+                            sizeof(*new_table));
+  if(!new_table)
+    return 1;
+
+  for(i = 0; i < con->table_size; i++) {
+    size_t slot;
+
+    if(!con->table[i].row)
+      continue;
+
+    slot = RASQAL_GOOD_CAST(size_t, con->table[i].hash) & (new_size - 1);
+    while(new_table[slot].row)
+      slot = (slot + 1) & (new_size - 1);
+    new_table[slot] = con->table[i];
+  }
+
+  RASQAL_FREE(rasqal_distinct_entry*, con->table);
+  con->table = new_table;
+  con->table_size = new_size;
+
+  return 0;
+}
+
+
+/*
+ * rasqal_distinct_rowsource_add_row:
+ * @con: distinct rowsource context
+ * @row: row
+ *
+ * INTERNAL - Add a row to the seen rows table unless an equal row is there
+ *
+ * Rows are equal when all their values are equal RDF terms.  The
+ * table keeps its own reference to @row.
+ *
+ * Return value: 0 if @row was added, >0 if it is a duplicate or <0 on failure
+ */
+static int
+rasqal_distinct_rowsource_add_row(rasqal_distinct_rowsource_context* con,
+                                  rasqal_row* row)
+{
+  uint64_t hash;
+  size_t slot;
+
+  /* keep the table at most half full */
+  if((con->rows_count + 1) << 1 > con->table_size) {
+    if(rasqal_distinct_rowsource_grow_table(con))
+      return -1;
+  }
+
+  /* hash agrees with rasqal_literal_array_equals() below */
+  hash = rasqal_row_hash(row, RASQAL_COMPARE_RDF);
+
+  for(slot = RASQAL_GOOD_CAST(size_t, hash) & (con->table_size - 1);
+      con->table[slot].row;
+      slot = (slot + 1) & (con->table_size - 1)) {
+    rasqal_row* seen = con->table[slot].row;
+
+    if(con->table[slot].hash == hash && seen->size == row->size &&
+       rasqal_literal_array_equals(seen->values, row->values, row->size))
+      return 1;
+  }
+
+  con->table[slot].hash = hash;
+  con->table[slot].row = rasqal_new_row_from_row(row);
+  con->rows_count++;
+
+  return 0;
+}
+
+
 static rasqal_row*
 rasqal_distinct_rowsource_read_row(rasqal_rowsource* rowsource, void *user_data)
 {
@@ -139,16 +266,23 @@ rasqal_distinct_rowsource_read_row(rasqal_rowsource* rowsource, void *user_data)
     if(!row)
       break;
 
-    result = rasqal_engine_rowsort_map_add_row(con->map, row);
+    result = rasqal_distinct_rowsource_add_row(con, row);
+    if(result < 0) {
+      rasqal_free_row(row);
+      row = NULL;
+      break;
+    }
+
     RASQAL_DEBUG2("row is %s\n", result ? "not distinct" : "distinct");
 
     if(!result)
       /* row was distinct (not a duplicate) so return it */
       break;
+
+    rasqal_free_row(row);
   }
 
   if(row) {
-    row = rasqal_new_row_from_row(row);
     rasqal_row_set_rowsource(row, rowsource);
     row->offset = con->offset++;
   }
@@ -165,8 +299,7 @@ rasqal_distinct_rowsource_reset(rasqal_rowsource* rowsource, void *user_data)
 
   con = (rasqal_distinct_rowsource_context*)user_data;
 
-  if(con->map)
-    rasqal_free_map(con->map);
+  rasqal_distinct_rowsource_free_table(con);
 
   rc = rasqal_distinct_rowsource_init_common(rowsource, user_data);
   if(rc)
@@ -176,6 +309,18 @@ rasqal_distinct_rowsource_reset(rasqal_rowsource* rowsource, void *user_data)
 }
 
 
+static rasqal_variable*
+rasqal_distinct_rowsource_get_order(rasqal_rowsource* rowsource,
+                                    void *user_data)
+{
+  rasqal_distinct_rowsource_context *con;
+  con = (rasqal_distinct_rowsource_context*)user_data;
+
+  /* first rows of each distinct value keep their inner order */
+  return rasqal_rowsource_get_order(con->rowsource);
+}
+
+
 static rasqal_rowsource*
 rasqal_distinct_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource,
                                               void *user_data, int offset)
@@ -190,7 +335,7 @@ rasqal_distinct_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource,
 
 
 static const rasqal_rowsource_handler rasqal_distinct_rowsource_handler = {
-  /* .version =          */ 1,
+  /* .version =          */ 2,
   "distinct",
   /* .init =             */ rasqal_distinct_rowsource_init,
   /* .finish =           */ rasqal_distinct_rowsource_finish,
@@ -201,6 +346,9 @@ static const rasqal_rowsource_handler rasqal_distinct_rowsource_handler = {
   /* .set_requirements = */ NULL,
   /* .get_inner_rowsource = */ rasqal_distinct_rowsource_get_inner_rowsource,
   /* .set_origin =       */ NULL,
+  /* .read_batch =       */ NULL,
+  /* .get_order =        */ rasqal_distinct_rowsource_get_order,
+  /* .set_outer_variables = */ NULL
 };
 
 
@@ -0,0 +1,706 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_rowsource_exists.c - Rasqal FILTER EXISTS rowsource class
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#include <raptor.h>
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+
+#define DEBUG_FH stderr
+
+/* correlated values are compared as RDF terms */
+#define RASQAL_EXISTS_COMPARE_FLAGS (RASQAL_COMPARE_RDF | RASQAL_COMPARE_URI)
+
+
+/*
+ * rasqal_exists_memo:
+ * @size: number of correlated variables
+ * @values: values of the correlated variables (NULL when unbound)
+ * @present: non-0 if the pattern has a solution for these values
+ *
+ * INTERNAL - remembered EXISTS result for one tuple of correlated values
+ */
+typedef struct {
+  int size;
+  rasqal_literal** values;
+  int present;
+} rasqal_exists_memo;
+
+
+typedef struct
+{
+  rasqal_triples_source* triples_source;
+
+  /* rows to filter */
+  rasqal_rowsource* left;
+
+  /* rowsource of the EXISTS pattern */
+  rasqal_rowsource* inner;
+
+  /* EXISTS pattern; shared with the expression */
+  rasqal_graph_pattern* gp;
+
+  /* non-0 for NOT EXISTS (anti-join) */
+  int negate;
+
+  /* left variables mentioned in the EXISTS pattern */
+  int correlated_count;
+  int* correlated_offsets;
+
+  /* results seen so far keyed on the correlated values */
+  raptor_avltree* memo;
+
+  /* key of the current left row; values are not owned */
+  rasqal_exists_memo key;
+
+  /* pattern triple when the pattern is one triple that becomes
+   * fully constant once the correlated variables are substituted
+   */
+  rasqal_triple* single_triple;
+
+  int failed;
+
+  /* row offset for read_row() */
+  int offset;
+} rasqal_exists_rowsource_context;
+
+
+static void
+rasqal_free_exists_memo(rasqal_exists_memo* memo)
+{
+  int i;
+
+  if(!memo)
+    return;
+
+  if(memo->values) {
+    for(i = 0; i < memo->size; i++) {
+      if(memo->values[i])
+        rasqal_free_literal(memo->values[i]);
+    }
+    RASQAL_FREE(rasqal_literal**, memo->values);
+  }
+
+  RASQAL_FREE(rasqal_exists_memo, memo);
+}
+
+
+/*
+ * rasqal_exists_memo_compare:
+ * @a: pointer to first #rasqal_exists_memo
+ * @b: pointer to second #rasqal_exists_memo
+ *
+ * INTERNAL - compare two memo keys; unbound values sort first
+ *
+ * Return value: <0, 0 or >0 comparison
+ */
+static int
+rasqal_exists_memo_compare(const void* a, const void* b)
+{
+  rasqal_exists_memo* memo_a = (rasqal_exists_memo*)a;
+  rasqal_exists_memo* memo_b = (rasqal_exists_memo*)b;
+  int i;
+
+  for(i = 0; i < memo_a->size; i++) {
+    rasqal_literal* l_a = memo_a->values[i];
+    rasqal_literal* l_b = memo_b->values[i];
+    int error = 0;
+    int result;
+
+    if(!l_a || !l_b) {
+      if(l_a == l_b)
+        continue;
+      return l_a ? 1 : -1;
+    }
+
+    result = rasqal_literal_compare(l_a, l_b, RASQAL_EXISTS_COMPARE_FLAGS,
+                                    &error);
+    if(error)
+      return 1;
+    if(result)
+      return result;
+  }
+
+  return 0;
+}
+
+
+typedef struct {
+  rasqal_variable* v;
+  int found;
+} rasqal_exists_mentions_state;
+
+
+static int
+rasqal_exists_triple_mentions_variable(rasqal_triple* t, rasqal_variable* v)
+{
+  return rasqal_literal_as_variable(t->subject) == v ||
+         (t->predicate && rasqal_literal_as_variable(t->predicate) == v) ||
+         rasqal_literal_as_variable(t->object) == v ||
+         (t->origin && rasqal_literal_as_variable(t->origin) == v);
+}
+
+
+static int
+rasqal_exists_variables_sequence_contains(raptor_sequence* seq,
+                                          rasqal_variable* v)
+{
+  rasqal_variable* v2;
+  int i;
+
+  for(i = 0; (v2 = (rasqal_variable*)raptor_sequence_get_at(seq, i)); i++) {
+    if(v2 == v)
+      return 1;
+  }
+
+  return 0;
+}
+
+
+/*
+ * rasqal_exists_graph_pattern_mentions_variable_visit:
+ * @query: query
+ * @gp: graph pattern
+ * @user_data: #rasqal_exists_mentions_state
+ *
+ * INTERNAL - graph pattern visitor to find a variable mention
+ *
+ * Return value: non-0 to stop the visit when the variable is found
+ */
+static int
+rasqal_exists_graph_pattern_mentions_variable_visit(rasqal_query* query,
+                                                    rasqal_graph_pattern* gp,
+                                                    void* user_data)
+{
+  rasqal_exists_mentions_state* st = (rasqal_exists_mentions_state*)user_data;
+  rasqal_triple* t;
+  int i;
+
+  switch(gp->op) {
+    case RASQAL_GRAPH_PATTERN_OPERATOR_BASIC:
+    case RASQAL_GRAPH_PATTERN_OPERATOR_PATH:
+      for(i = 0; (t = rasqal_graph_pattern_get_triple(gp, i)); i++) {
+        if(rasqal_exists_triple_mentions_variable(t, st->v)) {
+          st->found = 1;
+          break;
+        }
+      }
+      break;
+
+    case RASQAL_GRAPH_PATTERN_OPERATOR_GRAPH:
+      if(gp->origin && rasqal_literal_as_variable(gp->origin) == st->v)
+        st->found = 1;
+      break;
+
+    case RASQAL_GRAPH_PATTERN_OPERATOR_FILTER:
+    case RASQAL_GRAPH_PATTERN_OPERATOR_LET:
+      if(gp->var == st->v ||
+         (gp->filter_expression &&
+          rasqal_expression_mentions_variable(gp->filter_expression, st->v)))
+        st->found = 1;
+      break;
+
+    case RASQAL_GRAPH_PATTERN_OPERATOR_SELECT:
+      /* only projected variables are visible outside a sub-SELECT */
+      if(gp->projection && gp->projection->variables &&
+         rasqal_exists_variables_sequence_contains(gp->projection->variables,
+                                                   st->v))
+        st->found = 1;
+      break;
+
+    case RASQAL_GRAPH_PATTERN_OPERATOR_VALUES:
+      if(gp->bindings &&
+         rasqal_exists_variables_sequence_contains(gp->bindings->variables,
+                                                   st->v))
+        st->found = 1;
+      break;
+
+    case RASQAL_GRAPH_PATTERN_OPERATOR_OPTIONAL:
+    case RASQAL_GRAPH_PATTERN_OPERATOR_UNION:
+    case RASQAL_GRAPH_PATTERN_OPERATOR_GROUP:
+    case RASQAL_GRAPH_PATTERN_OPERATOR_SERVICE:
+    case RASQAL_GRAPH_PATTERN_OPERATOR_MINUS:
+    case RASQAL_GRAPH_PATTERN_OPERATOR_UNKNOWN:
+      break;
+  }
+
+  return st->found;
+}
+
+
+/*
+ * rasqal_exists_graph_pattern_single_triple:
+ * @gp: EXISTS graph pattern
+ *
+ * INTERNAL - Get the triple of a pattern that is a single triple
+ *
+ * Return value: the triple or NULL if the pattern is anything else
+ */
+static rasqal_triple*
+rasqal_exists_graph_pattern_single_triple(rasqal_graph_pattern* gp)
+{
+  rasqal_triple* t;
+
+  while(gp->op == RASQAL_GRAPH_PATTERN_OPERATOR_GROUP) {
+    if(!gp->graph_patterns || raptor_sequence_size(gp->graph_patterns) != 1)
+      return NULL;
+    gp = (rasqal_graph_pattern*)raptor_sequence_get_at(gp->graph_patterns, 0);
+  }
+
+  if(gp->op != RASQAL_GRAPH_PATTERN_OPERATOR_BASIC ||
+     gp->start_column != gp->end_column)
+    return NULL;
+
+  t = rasqal_graph_pattern_get_triple(gp, 0);
+  if(!t || t->origin)
+    return NULL;
+
+  return t;
+}
+
+
+static int
+rasqal_exists_rowsource_init(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_exists_rowsource_context* con;
+
+  con = (rasqal_exists_rowsource_context*)user_data;
+
+  con->failed = 0;
+  con->offset = 0;
+
+  return 0;
+}
+
+
+static int
+rasqal_exists_rowsource_finish(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_exists_rowsource_context* con;
+  con = (rasqal_exists_rowsource_context*)user_data;
+
+  if(con->left)
+    rasqal_free_rowsource(con->left);
+
+  if(con->inner)
+    rasqal_free_rowsource(con->inner);
+
+  if(con->correlated_offsets)
+    RASQAL_FREE(intarray, con->correlated_offsets);
+
+  if(con->memo)
+    raptor_free_avltree(con->memo);
+
+  if(con->key.values)
+    RASQAL_FREE(rasqal_literal**, con->key.values);
+
+  RASQAL_FREE(rasqal_exists_rowsource_context, con);
+
+  return 0;
+}
+
+
+static int
+rasqal_exists_rowsource_ensure_variables(rasqal_rowsource* rowsource,
+                                         void *user_data)
+{
+  rasqal_exists_rowsource_context* con;
+  rasqal_exists_mentions_state st;
+  int left_size;
+  int i;
+
+  con = (rasqal_exists_rowsource_context*)user_data;
+
+  if(rasqal_rowsource_ensure_variables(con->left))
+    return 1;
+
+  if(rasqal_rowsource_ensure_variables(con->inner))
+    return 1;
+
+  /* result rows have exactly the left variables */
+  rowsource->size = 0;
+  if(rasqal_rowsource_copy_variables(rowsource, con->left))
+    return 1;
+
+  left_size = rasqal_rowsource_get_size(con->left);
+  if(left_size > 0) {
+    con->correlated_offsets = RASQAL_CALLOC(int*,
+                                            RASQAL_GOOD_CAST(size_t, left_size),
+                                            sizeof(int));
+    con->key.values = RASQAL_CALLOC(rasqal_literal**,
+                                    RASQAL_GOOD_CAST(size_t, left_size),
+                                    sizeof(rasqal_literal*));
+    if(!con->correlated_offsets || !con->key.values)
+      return 1;
+  }
+
+  con->correlated_count = 0;
+  for(i = 0; i < left_size; i++) {
+    st.v = rasqal_rowsource_get_variable_by_offset(con->left, i);
+    if(!st.v)
+      return 1;
+
+    st.found = 0;
+    rasqal_graph_pattern_visit(rowsource->query, con->gp,
+                               rasqal_exists_graph_pattern_mentions_variable_visit,
+                               &st);
+    if(st.found)
+      con->correlated_offsets[con->correlated_count++] = i;
+  }
+  con->key.size = con->correlated_count;
+
+  con->memo = raptor_new_avltree(rasqal_exists_memo_compare,
+                                 (raptor_data_free_handler)rasqal_free_exists_memo,
+                                 /* flags */ 0);
+  if(!con->memo)
+    return 1;
+
+  /* A single triple can be checked with the triples source directly
+   * if every variable in it comes from the left rows.
+   */
+  con->single_triple = NULL;
+  if(con->triples_source && con->triples_source->triple_present) {
+    rasqal_triple* t = rasqal_exists_graph_pattern_single_triple(con->gp);
+
+    if(t) {
+      rasqal_literal* parts[3];
+      int usable = 1;
+
+      parts[0] = t->subject;
+      parts[1] = t->predicate;
+      parts[2] = t->object;
+      for(i = 0; i < 3; i++) {
+        rasqal_variable* v = rasqal_literal_as_variable(parts[i]);
+
+        if(v && rasqal_rowsource_get_variable_offset_by_name(con->left,
+                                                             v->name) < 0) {
+          usable = 0;
+          break;
+        }
+      }
+
+      if(usable)
+        con->single_triple = t;
+    }
+  }
+
+  RASQAL_DEBUG4("exists rowsource %p has %d correlated variables%s\n",
+                rowsource, con->correlated_count,
+                con->single_triple ? " and a single triple" : "");
+
+  return 0;
+}
+
+
+/*
+ * rasqal_exists_rowsource_triple_present:
+ * @con: exists rowsource context
+ * @present_p: pointer to store the result
+ *
+ * INTERNAL - Check the single triple pattern with the current bindings
+ *
+ * Return value: non-0 if some variable is unbound and the check
+ * could not be made
+ */
+static int
+rasqal_exists_rowsource_triple_present(rasqal_exists_rowsource_context* con,
+                                       int* present_p)
+{
+  rasqal_triple t;
+  rasqal_literal** parts[3];
+  rasqal_triple* pattern = con->single_triple;
+  int i;
+
+  memset(&t, '\0', sizeof(t));
+  t.subject = pattern->subject;
+  t.predicate = pattern->predicate;
+  t.object = pattern->object;
+
+  parts[0] = &t.subject;
+  parts[1] = &t.predicate;
+  parts[2] = &t.object;
+  for(i = 0; i < 3; i++) {
+    rasqal_variable* v = rasqal_literal_as_variable(*parts[i]);
+
+    if(v) {
+      if(!v->value)
+        return 1;
+      *parts[i] = v->value;
+    }
+  }
+
+  *present_p = rasqal_triples_source_triple_present(con->triples_source, &t);
+
+  return 0;
+}
+
+
+/*
+ * rasqal_exists_rowsource_evaluate:
+ * @con: exists rowsource context
+ * @row: left row with its variables bound
+ * @present_p: pointer to store the result
+ *
+ * INTERNAL - Check if the EXISTS pattern has a solution for a left row
+ *
+ * Results are remembered for each tuple of correlated values so the
+ * pattern is evaluated once per distinct tuple.  Evaluation stops at
+ * the first solution.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_exists_rowsource_evaluate(rasqal_exists_rowsource_context* con,
+                                 rasqal_row* row, int* present_p)
+{
+  rasqal_exists_memo* memo;
+  int present = 0;
+  int i;
+
+  for(i = 0; i < con->correlated_count; i++)
+    con->key.values[i] = row->values[con->correlated_offsets[i]];
+
+  memo = (rasqal_exists_memo*)raptor_avltree_search(con->memo, &con->key);
+  if(memo) {
+    *present_p = memo->present;
+    return 0;
+  }
+
+  if(!con->single_triple ||
+     rasqal_exists_rowsource_triple_present(con, &present)) {
+    rasqal_row* inner_row;
+
+    /* the pattern uses the current values of correlated variables */
+    if(rasqal_rowsource_reset(con->inner))
+      return 1;
+
+    inner_row = rasqal_rowsource_read_row(con->inner);
+    if(inner_row) {
+      present = 1;
+      rasqal_free_row(inner_row);
+    }
+  }
+
+  memo = RASQAL_CALLOC(rasqal_exists_memo*, 1, sizeof(*memo));
+  if(!memo)
+    return 1;
+
+  memo->size = con->correlated_count;
+  memo->present = present;
+  if(memo->size) {
+    memo->values = RASQAL_CALLOC(rasqal_literal**,
+                                 RASQAL_GOOD_CAST(size_t, memo->size),
+                                 sizeof(rasqal_literal*));
+    if(!memo->values) {
+      rasqal_free_exists_memo(memo);
+      return 1;
+    }
+
+    for(i = 0; i < memo->size; i++) {
+      if(con->key.values[i])
+        memo->values[i] = rasqal_new_literal_from_literal(con->key.values[i]);
+    }
+  }
+
+  if(raptor_avltree_add(con->memo, memo))
+    return 1;
+
+  *present_p = present;
+
+  return 0;
+}
+
+
+static rasqal_row*
+rasqal_exists_rowsource_read_row(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_exists_rowsource_context* con;
+  rasqal_row* row = NULL;
+
+  con = (rasqal_exists_rowsource_context*)user_data;
+
+  if(con->failed)
+    return NULL;
+
+  while(1) {
+    int present = 0;
+
+    row = rasqal_rowsource_read_row(con->left);
+    if(!row)
+      break;
+
+    rasqal_row_bind_variables(row, rowsource->query->vars_table);
+
+    if(rasqal_exists_rowsource_evaluate(con, row, &present)) {
+      con->failed = 1;
+      rasqal_free_row(row);
+      return NULL;
+    }
+
+    if(present != con->negate)
+      break;
+
+#ifdef RASQAL_DEBUG
+    RASQAL_DEBUG2("rowsource %p removed left row : ", rowsource);
+    rasqal_row_print(row, DEBUG_FH);
+    fputc('\n', DEBUG_FH);
+#endif
+
+    rasqal_free_row(row);
+  }
+
+  if(row) {
+    rasqal_row_set_rowsource(row, rowsource);
+    row->offset = con->offset++;
+
+    /* the pattern may have bound other variables */
+    rasqal_row_bind_variables(row, rowsource->query->vars_table);
+  }
+
+  return row;
+}
+
+
+static int
+rasqal_exists_rowsource_reset(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_exists_rowsource_context* con;
+
+  con = (rasqal_exists_rowsource_context*)user_data;
+
+  con->failed = 0;
+  con->offset = 0;
+
+  /* the data does not change during execution so the memo is kept */
+  return rasqal_rowsource_reset(con->left);
+}
+
+
+static rasqal_rowsource*
+rasqal_exists_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource,
+                                            void *user_data, int offset)
+{
+  rasqal_exists_rowsource_context *con;
+  con = (rasqal_exists_rowsource_context*)user_data;
+
+  if(offset == 0)
+    return con->left;
+  else if(offset == 1)
+    return con->inner;
+  else
+    return NULL;
+}
+
+
+static const rasqal_rowsource_handler rasqal_exists_rowsource_handler = {
+  /* .version = */ 1,
+  "exists",
+  /* .init = */ rasqal_exists_rowsource_init,
+  /* .finish = */ rasqal_exists_rowsource_finish,
+  /* .ensure_variables = */ rasqal_exists_rowsource_ensure_variables,
+  /* .read_row = */ rasqal_exists_rowsource_read_row,
+  /* .read_all_rows = */ NULL,
+  /* .reset = */ rasqal_exists_rowsource_reset,
+  /* .set_requirements = */ NULL,
+  /* .get_inner_rowsource = */ rasqal_exists_rowsource_get_inner_rowsource,
+  /* .set_origin = */ NULL,
+  /* .read_batch = */ NULL,
+  /* .get_order = */ NULL,
+  /* .set_outer_variables = */ NULL,
+};
+
+
+/**
+ * rasqal_new_exists_rowsource:
+ * @world: world object
+ * @query: query object
+ * @triples_source: triples source for single triple checks (or NULL)
+ * @left: input rowsource to filter
+ * @inner: rowsource of the EXISTS pattern
+ * @gp: EXISTS graph pattern
+ * @negate: non-0 for NOT EXISTS
+ *
+ * INTERNAL - create a new FILTER EXISTS / NOT EXISTS rowsource
+ *
+ * Returns the rows of @left for which the @inner pattern has a
+ * solution (a semi-join) or, if @negate is set, has no solution (an
+ * anti-join).  Variables of @left mentioned in @gp are substituted
+ * into the pattern from each left row.  The pattern is read up to its
+ * first solution and the result is remembered for each tuple of
+ * values of those variables.
+ *
+ * The @left and @inner rowsources become owned by the rowsource.
+ *
+ * Return value: new rowsource or NULL on failure
+ */
+rasqal_rowsource*
+rasqal_new_exists_rowsource(rasqal_world *world,
+                            rasqal_query* query,
+                            rasqal_triples_source* triples_source,
+                            rasqal_rowsource* left,
+                            rasqal_rowsource* inner,
+                            rasqal_graph_pattern* gp,
+                            int negate)
+{
+  rasqal_exists_rowsource_context* con;
+  int flags = 0;
+
+  if(!world || !query || !left || !inner || !gp)
+    goto fail;
+
+  con = RASQAL_CALLOC(rasqal_exists_rowsource_context*, 1, sizeof(*con));
+  if(!con)
+    goto fail;
+
+  con->triples_source = triples_source;
+  con->left = left;
+  con->inner = inner;
+  con->gp = gp;
+  con->negate = negate ? 1 : 0;
+
+  return rasqal_new_rowsource_from_handler(world, query,
+                                           con,
+                                           &rasqal_exists_rowsource_handler,
+                                           query->vars_table,
+                                           flags);
+
+  fail:
+  if(left)
+    rasqal_free_rowsource(left);
+  if(inner)
+    rasqal_free_rowsource(inner);
+  return NULL;
+}
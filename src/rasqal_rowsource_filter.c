@@ -37,6 +37,16 @@
 
 #include <raptor.h>
 
+/* for fabs() */
+#ifdef HAVE_MATH_H
+#include <math.h>
+#endif
+
+/* for DBL_EPSILON */
+#ifdef HAVE_FLOAT_H
+#include <float.h>
+#endif
+
 #include "rasqal.h"
 #include "rasqal_internal.h"
 
@@ -44,6 +54,54 @@
 #define DEBUG_FH stderr
 
 
+#ifndef STANDALONE
+
+/*
+ * Filter kernel: a comparison of one inner rowsource column with a
+ * constant that is evaluated over a whole batch at once.  A FILTER
+ * expression that is a conjunction of such comparisons is run as a
+ * sequence of kernels over native values decoded from the columns.
+ */
+typedef enum {
+  RASQAL_FILTER_KERNEL_INTEGER,
+  RASQAL_FILTER_KERNEL_DOUBLE,
+  RASQAL_FILTER_KERNEL_URI
+} rasqal_filter_kernel_type;
+
+typedef struct
+{
+  rasqal_filter_kernel_type type;
+
+  /* EQ, NEQ, LT, GT, LE or GE with the column on the left */
+  rasqal_op op;
+
+  /* inner rowsource column */
+  int column;
+
+  /* constant */
+  int integer;
+  double number;
+  raptor_uri* uri;
+} rasqal_filter_kernel;
+
+
+/* row states while running kernels over a batch */
+#define RASQAL_FILTER_ROW_FAIL 0
+#define RASQAL_FILTER_ROW_PASS 1
+#define RASQAL_FILTER_ROW_EVALUATE 2
+
+/* kinds of decoded kernel values */
+#define RASQAL_FILTER_KIND_NONE 0
+#define RASQAL_FILTER_KIND_INTEGER 1
+#define RASQAL_FILTER_KIND_DOUBLE 2
+#define RASQAL_FILTER_KIND_URI_EQUAL 3
+#define RASQAL_FILTER_KIND_URI_DIFFERENT 4
+
+/* kernel comparison results other than -1, 0 and 1 */
+#define RASQAL_FILTER_CMP_UNORDERED 3
+#define RASQAL_FILTER_CMP_UNKNOWN 4
+
+
 typedef struct 
 {
   /* inner rowsource to filter */
@@ -54,6 +112,26 @@ typedef struct
 
   /* offset into results for current row */
   int offset;
+
+  /* batch of inner rowsource rows for read_batch() */
+  rasqal_row_batch* input;
+
+  /* kernels for the comparisons in the expression */
+  rasqal_filter_kernel* kernels;
+  int kernels_count;
+
+  /* non-0 if the kernels are the whole expression */
+  int kernels_complete;
+
+  /* non-0 once the expression has been checked for kernels */
+  int kernels_compiled;
+
+  /* per input row work arrays for the kernels */
+  signed char* states;
+  signed char* kinds;
+  signed char* cmps;
+  int* integers;
+  double* numbers;
   
 } rasqal_filter_rowsource_context;
 
@@ -96,6 +174,27 @@ rasqal_filter_rowsource_finish(rasqal_rowsource* rowsource, void *user_data)
   if(con->expr)
     rasqal_free_expression(con->expr);
 
+  if(con->input)
+    rasqal_free_row_batch(con->input);
+
+  if(con->kernels)
+    RASQAL_FREE(rasqal_filter_kernel*, con->kernels);
+
+  if(con->states)
+    RASQAL_FREE(signed char*, con->states);
+
+  if(con->kinds)
+    RASQAL_FREE(signed char*, con->kinds);
+
+  if(con->cmps)
+    RASQAL_FREE(signed char*, con->cmps);
+
+  if(con->integers)
+    RASQAL_FREE(int*, con->integers);
+
+  if(con->numbers)
+    RASQAL_FREE(double*, con->numbers);
+
   RASQAL_FREE(rasqal_filter_rowsource_context, con);
 
   return 0;
@@ -168,16 +267,577 @@ rasqal_filter_rowsource_read_row(rasqal_rowsource* rowsource, void *user_data)
 }
 
 
+static rasqal_op
+rasqal_filter_op_reverse(rasqal_op op)
+{
+  switch(op) {
+    case RASQAL_EXPR_LT:
+      return RASQAL_EXPR_GT;
+    case RASQAL_EXPR_GT:
+      return RASQAL_EXPR_LT;
+    case RASQAL_EXPR_LE:
+      return RASQAL_EXPR_GE;
+    case RASQAL_EXPR_GE:
+      return RASQAL_EXPR_LE;
+    default:
+      /* EQ and NEQ are symmetric; other operators never reach here */
+      return op;
+  }
+}
+
+
+/*
+ * rasqal_filter_rowsource_compile_kernel:
+ * @con: filter rowsource context
+ * @e: expression
+ * @kernel: kernel to fill in
+ *
+ * INTERNAL - Make a kernel for a variable compared with a numeric or URI constant
+ *
+ * Return value: non-0 if @e is not a comparison a kernel can run
+ */
+static int
+rasqal_filter_rowsource_compile_kernel(rasqal_filter_rowsource_context* con,
+                                       rasqal_expression* e,
+                                       rasqal_filter_kernel* kernel)
+{
+  rasqal_expression* var_e;
+  rasqal_literal* constant;
+  rasqal_op op = e->op;
+
+  if(op != RASQAL_EXPR_EQ && op != RASQAL_EXPR_NEQ &&
+     op != RASQAL_EXPR_LT && op != RASQAL_EXPR_GT &&
+     op != RASQAL_EXPR_LE && op != RASQAL_EXPR_GE)
+    return 1;
+
+  if(e->arg1->op != RASQAL_EXPR_LITERAL || e->arg2->op != RASQAL_EXPR_LITERAL)
+    return 1;
+
+  if(e->arg1->literal->type == RASQAL_LITERAL_VARIABLE) {
+    var_e = e->arg1;
+    constant = e->arg2->literal;
+  } else {
+    var_e = e->arg2;
+    constant = e->arg1->literal;
+    op = rasqal_filter_op_reverse(op);
+  }
+
+  if(var_e->literal->type != RASQAL_LITERAL_VARIABLE)
+    return 1;
+
+  kernel->column = rasqal_rowsource_get_variable_offset_by_name(con->rowsource,
+                                                                var_e->literal->value.variable->name);
+  if(kernel->column < 0)
+    return 1;
+
+  kernel->op = op;
+
+  switch(constant->type) {
+    case RASQAL_LITERAL_INTEGER:
+    case RASQAL_LITERAL_INTEGER_SUBTYPE:
+      kernel->type = RASQAL_FILTER_KERNEL_INTEGER;
+      kernel->integer = constant->value.integer;
+      kernel->number = (double)constant->value.integer;
+      break;
+
+    case RASQAL_LITERAL_DOUBLE:
+    case RASQAL_LITERAL_FLOAT:
+      kernel->type = RASQAL_FILTER_KERNEL_DOUBLE;
+      kernel->number = constant->value.floating;
+      break;
+
+    case RASQAL_LITERAL_URI:
+      if(op != RASQAL_EXPR_EQ && op != RASQAL_EXPR_NEQ)
+        return 1;
+      kernel->type = RASQAL_FILTER_KERNEL_URI;
+      kernel->uri = constant->value.uri;
+      break;
+
+    default:
+      /* other constant types are left to expression evaluation */
+      return 1;
+  }
+
+  return 0;
+}
+
+
+/*
+ * rasqal_filter_rowsource_compile_conjunction:
+ * @con: filter rowsource context
+ * @e: expression
+ *
+ * INTERNAL - Add kernels for the comparisons in a conjunction
+ *
+ * Return value: number of conjuncts that did not become kernels
+ */
+static int
+rasqal_filter_rowsource_compile_conjunction(rasqal_filter_rowsource_context* con,
+                                            rasqal_expression* e)
+{
+  if(e->op == RASQAL_EXPR_AND)
+    return rasqal_filter_rowsource_compile_conjunction(con, e->arg1) +
+           rasqal_filter_rowsource_compile_conjunction(con, e->arg2);
+
+  if(rasqal_filter_rowsource_compile_kernel(con, e,
+                                            &con->kernels[con->kernels_count]))
+    return 1;
+
+  con->kernels_count++;
+  return 0;
+}
+
+
+static int
+rasqal_filter_expression_count_conjuncts(rasqal_expression* e)
+{
+  if(e->op == RASQAL_EXPR_AND)
+    return rasqal_filter_expression_count_conjuncts(e->arg1) +
+           rasqal_filter_expression_count_conjuncts(e->arg2);
+  return 1;
+}
+
+
+/*
+ * rasqal_filter_rowsource_compile_kernels:
+ * @con: filter rowsource context
+ * @capacity: input batch capacity
+ *
+ * INTERNAL - Find the kernels for the filter expression
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_filter_rowsource_compile_kernels(rasqal_filter_rowsource_context* con,
+                                        int capacity)
+{
+  int size;
+  int residual;
+
+  con->kernels_compiled = 1;
+
+  size = rasqal_filter_expression_count_conjuncts(con->expr);
+  con->kernels = RASQAL_CALLOC(rasqal_filter_kernel*, RASQAL_GOOD_CAST(size_t, size),
+                               sizeof(rasqal_filter_kernel));
+  if(!con->kernels)
+    return 1;
+
+  residual = rasqal_filter_rowsource_compile_conjunction(con, con->expr);
+  con->kernels_complete = !residual;
+
+  RASQAL_DEBUG3("filter expression has %d kernels and %d other conjuncts\n",
+                con->kernels_count, residual);
+
+  if(!con->kernels_count)
+    return 0;
+
+  con->states = RASQAL_CALLOC(signed char*, RASQAL_GOOD_CAST(size_t, capacity),
+                              sizeof(signed char));
+  con->kinds = RASQAL_CALLOC(signed char*, RASQAL_GOOD_CAST(size_t, capacity),
+                             sizeof(signed char));
+  con->cmps = RASQAL_CALLOC(signed char*, RASQAL_GOOD_CAST(size_t, capacity),
+                            sizeof(signed char));
+  con->integers = RASQAL_CALLOC(int*, RASQAL_GOOD_CAST(size_t, capacity),
+                                sizeof(int));
+  con->numbers = RASQAL_CALLOC(double*, RASQAL_GOOD_CAST(size_t, capacity),
+                               sizeof(double));
+  if(!con->states || !con->kinds || !con->cmps || !con->integers || !con->numbers)
+    return 1;
+
+  return 0;
+}
+
+
+/*
+ * rasqal_filter_kernel_decode:
+ * @kernel: kernel
+ * @batch: batch
+ * @count: number of rows
+ * @states: row states
+ * @kinds: decoded value kinds array to fill
+ * @integers: integer values array to fill
+ * @numbers: double values array to fill
+ *
+ * INTERNAL - Decode a batch column into native values for a kernel
+ *
+ * The kinds are RASQAL_FILTER_KIND_INTEGER for integer values
+ * compared with an integer constant, RASQAL_FILTER_KIND_DOUBLE for
+ * other numeric values and RASQAL_FILTER_KIND_NONE for anything the
+ * kernel cannot compare.  URI kernels compare while decoding and
+ * store the result in @kinds as RASQAL_FILTER_KIND_URI_EQUAL or
+ * RASQAL_FILTER_KIND_URI_DIFFERENT.
+ */
+static void
+rasqal_filter_kernel_decode(rasqal_filter_kernel* kernel,
+                            rasqal_row_batch* batch, int count,
+                            const signed char* states,
+                            signed char* kinds,
+                            int* integers, double* numbers)
+{
+  int r;
+
+  for(r = 0; r < count; r++) {
+    rasqal_literal* l = RASQAL_ROW_BATCH_VALUE(batch, kernel->column, r);
+
+    kinds[r] = RASQAL_FILTER_KIND_NONE;
+    integers[r] = 0;
+    numbers[r] = 0.0;
+
+    if(!l || states[r] != RASQAL_FILTER_ROW_PASS)
+      continue;
+
+    switch(l->type) {
+      case RASQAL_LITERAL_URI:
+        if(kernel->type == RASQAL_FILTER_KERNEL_URI)
+          kinds[r] = raptor_uri_equals(l->value.uri, kernel->uri) ?
+            RASQAL_FILTER_KIND_URI_EQUAL : RASQAL_FILTER_KIND_URI_DIFFERENT;
+        break;
+
+      case RASQAL_LITERAL_INTEGER:
+      case RASQAL_LITERAL_INTEGER_SUBTYPE:
+        if(kernel->type == RASQAL_FILTER_KERNEL_INTEGER) {
+          integers[r] = l->value.integer;
+          kinds[r] = RASQAL_FILTER_KIND_INTEGER;
+        } else if(kernel->type == RASQAL_FILTER_KERNEL_DOUBLE) {
+          numbers[r] = (double)l->value.integer;
+          kinds[r] = RASQAL_FILTER_KIND_DOUBLE;
+        }
+        break;
+
+      case RASQAL_LITERAL_DOUBLE:
+      case RASQAL_LITERAL_FLOAT:
+        if(kernel->type != RASQAL_FILTER_KERNEL_URI) {
+          numbers[r] = l->value.floating;
+          kinds[r] = RASQAL_FILTER_KIND_DOUBLE;
+        }
+        break;
+
+      case RASQAL_LITERAL_UNKNOWN:
+      case RASQAL_LITERAL_BLANK:
+      case RASQAL_LITERAL_STRING:
+      case RASQAL_LITERAL_XSD_STRING:
+      case RASQAL_LITERAL_BOOLEAN:
+      case RASQAL_LITERAL_DECIMAL:
+      case RASQAL_LITERAL_DATE:
+      case RASQAL_LITERAL_DATETIME:
+      case RASQAL_LITERAL_UDT:
+      case RASQAL_LITERAL_PATTERN:
+      case RASQAL_LITERAL_QNAME:
+      case RASQAL_LITERAL_VARIABLE:
+      default:
+        break;
+    }
+  }
+}
+
+
+/*
+ * rasqal_filter_kernel_compare:
+ * @kernel: kernel
+ * @count: number of rows
+ * @kinds: decoded value kinds
+ * @integers: decoded integer values
+ * @numbers: decoded double values
+ * @cmps: comparison results array to fill
+ *
+ * INTERNAL - Compare a decoded column with the kernel constant
+ *
+ * The integer and double loops run branch free over every row of
+ * the plain arrays and the results are picked by kind afterwards.
+ * rasqal_literal_compare() compares doubles approximately so values
+ * close enough to the constant to be affected by that are left
+ * RASQAL_FILTER_CMP_UNKNOWN for the expression to decide.
+ */
+static void
+rasqal_filter_kernel_compare(rasqal_filter_kernel* kernel, int count,
+                             const signed char* kinds,
+                             const int* integers, const double* numbers,
+                             signed char* cmps)
+{
+  double c = kernel->number;
+  double abs_c = fabs(c);
+  int r;
+
+  if(kernel->type == RASQAL_FILTER_KERNEL_URI) {
+    for(r = 0; r < count; r++) {
+      if(kinds[r] == RASQAL_FILTER_KIND_URI_EQUAL)
+        cmps[r] = 0;
+      else if(kinds[r] == RASQAL_FILTER_KIND_URI_DIFFERENT)
+        cmps[r] = RASQAL_FILTER_CMP_UNORDERED;
+      else
+        cmps[r] = RASQAL_FILTER_CMP_UNKNOWN;
+    }
+    return;
+  }
+
+  for(r = 0; r < count; r++) {
+    double d = numbers[r] - c;
+    double abs_n = fabs(numbers[r]);
+    double band = 2.0 * RASQAL_DOUBLE_EPSILON * (abs_n > abs_c ? abs_n : abs_c);
+    int above = (d > band);
+    int below = (d < -band);
+
+    /* near the constant or NaN: neither above nor below */
+    cmps[r] = (signed char)((above | below) ? (above - below) : RASQAL_FILTER_CMP_UNKNOWN);
+  }
+
+  if(kernel->type == RASQAL_FILTER_KERNEL_INTEGER) {
+    int ic = kernel->integer;
+
+    for(r = 0; r < count; r++) {
+      signed char icmp = (signed char)((integers[r] > ic) - (integers[r] < ic));
+
+      if(kinds[r] == RASQAL_FILTER_KIND_INTEGER)
+        cmps[r] = icmp;
+    }
+  }
+
+  for(r = 0; r < count; r++) {
+    if(kinds[r] == RASQAL_FILTER_KIND_NONE)
+      cmps[r] = RASQAL_FILTER_CMP_UNKNOWN;
+  }
+}
+
+
+/*
+ * rasqal_filter_kernel_apply:
+ * @kernel: kernel
+ * @count: number of rows
+ * @cmps: comparison results
+ * @states: row states to update
+ *
+ * INTERNAL - Update row states from kernel comparison results
+ */
+static void
+rasqal_filter_kernel_apply(rasqal_filter_kernel* kernel, int count,
+                           const signed char* cmps, signed char* states)
+{
+  int r;
+
+  for(r = 0; r < count; r++) {
+    int cmp = cmps[r];
+    int pass;
+
+    if(states[r] != RASQAL_FILTER_ROW_PASS)
+      continue;
+
+    if(cmp == RASQAL_FILTER_CMP_UNKNOWN) {
+      states[r] = RASQAL_FILTER_ROW_EVALUATE;
+      continue;
+    }
+
+    switch(kernel->op) {
+      case RASQAL_EXPR_EQ:
+        pass = (cmp == 0);
+        break;
+      case RASQAL_EXPR_NEQ:
+        pass = (cmp != 0);
+        break;
+      case RASQAL_EXPR_LT:
+        pass = (cmp == -1);
+        break;
+      case RASQAL_EXPR_GT:
+        pass = (cmp == 1);
+        break;
+      case RASQAL_EXPR_LE:
+        pass = (cmp == -1 || cmp == 0);
+        break;
+      case RASQAL_EXPR_GE:
+        pass = (cmp == 1 || cmp == 0);
+        break;
+      default:
+        /* only comparison operators are compiled into kernels */
+        pass = 0;
+        break;
+    }
+
+    if(!pass)
+      states[r] = RASQAL_FILTER_ROW_FAIL;
+  }
+}
+
+
+/*
+ * rasqal_filter_rowsource_run_kernels:
+ * @con: filter rowsource context
+ * @count: number of rows in the input batch
+ *
+ * INTERNAL - Run the kernels over the input batch setting the row states
+ */
+static void
+rasqal_filter_rowsource_run_kernels(rasqal_filter_rowsource_context* con,
+                                    int count)
+{
+  int pass_state;
+  int k;
+  int r;
+
+  for(r = 0; r < count; r++)
+    con->states[r] = RASQAL_FILTER_ROW_PASS;
+
+  for(k = 0; k < con->kernels_count; k++) {
+    rasqal_filter_kernel* kernel = &con->kernels[k];
+
+    rasqal_filter_kernel_decode(kernel, con->input, count, con->states,
+                                con->kinds, con->integers, con->numbers);
+    rasqal_filter_kernel_compare(kernel, count, con->kinds, con->integers,
+                                 con->numbers, con->cmps);
+    rasqal_filter_kernel_apply(kernel, count, con->cmps, con->states);
+  }
+
+  /* rows passing every kernel still need any other conjuncts */
+  pass_state = con->kernels_complete ? RASQAL_FILTER_ROW_PASS :
+    RASQAL_FILTER_ROW_EVALUATE;
+  for(r = 0; r < count; r++) {
+    if(con->states[r] == RASQAL_FILTER_ROW_PASS)
+      con->states[r] = (signed char)pass_state;
+  }
+}
+
+
+/*
+ * rasqal_filter_rowsource_evaluate:
+ * @rowsource: filter rowsource
+ * @con: filter rowsource context
+ * @r: row in the input batch
+ *
+ * INTERNAL - Evaluate the filter expression over an input batch row
+ *
+ * Return value: boolean result with errors false, or <0 on failure
+ */
+static int
+rasqal_filter_rowsource_evaluate(rasqal_rowsource* rowsource,
+                                 rasqal_filter_rowsource_context* con,
+                                 int r)
+{
+  rasqal_query *query = rowsource->query;
+  rasqal_literal* result;
+  int bresult;
+  int error = 0;
+
+  if(rasqal_row_batch_bind_row(con->input, r))
+    return -1;
+
+  result = rasqal_expression_evaluate2(con->expr, query->eval_context,
+                                       &error);
+  if(error)
+    return 0;
+
+  bresult = rasqal_literal_as_boolean(result, &error);
+  rasqal_free_literal(result);
+
+  return error ? 0 : bresult;
+}
+
+
+/*
+ * rasqal_filter_rowsource_read_batch:
+ *
+ * INTERNAL - read a batch of rows that pass the filter
+ *
+ * Runs the filter kernels over a batch of inner rows and evaluates
+ * the expression only for the rows the kernels could not decide.
+ * The passing rows are copied into @batch, reading further inner
+ * batches until at least one row passes or the inner rowsource ends.
+ */
+static int
+rasqal_filter_rowsource_read_batch(rasqal_rowsource* rowsource,
+                                   void *user_data,
+                                   rasqal_row_batch* batch)
+{
+  rasqal_filter_rowsource_context *con;
+
+  con = (rasqal_filter_rowsource_context*)user_data;
+
+  if(!con->input) {
+    con->input = rasqal_new_row_batch(con->rowsource, batch->capacity);
+    if(!con->input)
+      return -1;
+  }
+
+  if(!con->kernels_compiled &&
+     rasqal_filter_rowsource_compile_kernels(con, con->input->capacity))
+    return -1;
+
+  while(!batch->count) {
+    int count;
+    int r;
+
+    count = rasqal_rowsource_read_batch(con->rowsource, con->input);
+    if(count <= 0)
+      return count;
+
+    if(con->kernels_count)
+      rasqal_filter_rowsource_run_kernels(con, count);
+
+    for(r = 0; r < count; r++) {
+      int bresult;
+      int index;
+
+      if(!con->kernels_count ||
+         con->states[r] == RASQAL_FILTER_ROW_EVALUATE) {
+        bresult = rasqal_filter_rowsource_evaluate(rowsource, con, r);
+        if(bresult < 0)
+          return -1;
+      } else
+        bresult = (con->states[r] == RASQAL_FILTER_ROW_PASS);
+
+      if(!bresult)
+        continue;
+
+      index = rasqal_row_batch_new_row(batch);
+      if(index < 0)
+        return -1;
+
+      /* filter variables are the inner variables in the same order */
+      rasqal_row_batch_merge_values(batch, index, con->input, r, NULL);
+      batch->offsets[index] = con->offset++;
+      batch->group_ids[index] = con->input->group_ids[r];
+    }
+  }
+
+  return batch->count;
+}
+
+
 static int
 rasqal_filter_rowsource_reset(rasqal_rowsource* rowsource, void *user_data)
 {
   rasqal_filter_rowsource_context *con;
   con = (rasqal_filter_rowsource_context*)user_data;
 
+  if(con->input)
+    rasqal_row_batch_clear(con->input);
+
   return rasqal_rowsource_reset(con->rowsource);
 }
 
 
+static rasqal_variable*
+rasqal_filter_rowsource_get_order(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_filter_rowsource_context *con;
+  con = (rasqal_filter_rowsource_context*)user_data;
+
+  /* rows keep their inner order */
+  return rasqal_rowsource_get_order(con->rowsource);
+}
+
+
+static int
+rasqal_filter_rowsource_set_outer_variables(rasqal_rowsource* rowsource,
+                                            void *user_data,
+                                            raptor_sequence* variables)
+{
+  rasqal_filter_rowsource_context *con;
+  con = (rasqal_filter_rowsource_context*)user_data;
+
+  /* rows failing the outer values are not compatible with the outer
+   * row whether they pass the filter or not */
+  return rasqal_rowsource_set_outer_variables(con->rowsource, variables);
+}
+
+
 static rasqal_rowsource*
 rasqal_filter_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource,
                                             void *user_data, int offset)
@@ -192,7 +852,7 @@ rasqal_filter_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource,
 
 
 static const rasqal_rowsource_handler rasqal_filter_rowsource_handler = {
-  /* .version =          */ 1,
+  /* .version =          */ 2,
   "filter",
   /* .init =             */ rasqal_filter_rowsource_init,
   /* .finish =           */ rasqal_filter_rowsource_finish,
@@ -203,6 +863,9 @@ static const rasqal_rowsource_handler rasqal_filter_rowsource_handler = {
   /* .set_requirements = */ NULL,
   /* .get_inner_rowsource = */ rasqal_filter_rowsource_get_inner_rowsource,
   /* .set_origin =       */ NULL,
+  /* .read_batch =       */ rasqal_filter_rowsource_read_batch,
+  /* .get_order =        */ rasqal_filter_rowsource_get_order,
+  /* .set_outer_variables = */ rasqal_filter_rowsource_set_outer_variables
 };
 
 
@@ -251,3 +914,238 @@ rasqal_new_filter_rowsource(rasqal_world *world,
     rasqal_free_expression(expr);
   return NULL;
 }
+
+
+
+#endif /* not STANDALONE */
+
+
+
+#ifdef STANDALONE
+
+/* one more prototype */
+int main(int argc, char *argv[]);
+
+
+#define EX_X "http://example.org/x"
+#define EX_Y "http://example.org/y"
+
+const char* const filter_data_2x6_rows[] =
+{
+  /* 2 variable names and 6 rows */
+  "a",   NULL, "b",   NULL,
+  /* row 1 data */
+  "1",   NULL, NULL,  EX_X,
+  /* row 2 data */
+  "2",   NULL, NULL,  EX_Y,
+  /* row 3 data */
+  "3",   NULL, NULL,  EX_X,
+  /* row 4 data */
+  "4",   NULL, NULL,  EX_Y,
+  /* row 5 data */
+  "5",   NULL, NULL,  EX_X,
+  /* row 6 data - not a number so the kernels leave it to the expression */
+  "six", NULL, NULL,  EX_Y,
+  /* end of data */
+  NULL, NULL, NULL, NULL
+};
+
+/* batches of 4 rows so the rows cross a batch boundary */
+#define TEST_BATCH_SIZE 4
+
+
+static rasqal_expression*
+filter_test_variable(rasqal_world* world, rasqal_variables_table* vt,
+                     const char* name)
+{
+  rasqal_variable* v;
+
+  v = rasqal_variables_table_get_by_name(vt, RASQAL_VARIABLE_TYPE_NORMAL,
+                                         RASQAL_GOOD_CAST(const unsigned char*, name));
+  if(!v)
+    return NULL;
+
+  v = rasqal_new_variable_from_variable(v);
+  return rasqal_new_literal_expression(world,
+                                       rasqal_new_variable_literal(world, v));
+}
+
+
+static rasqal_expression*
+filter_test_integer(rasqal_world* world, int i)
+{
+  return rasqal_new_literal_expression(world,
+                                       rasqal_new_integer_literal(world, RASQAL_LITERAL_INTEGER, i));
+}
+
+
+static rasqal_expression*
+filter_test_uri(rasqal_world* world, const char* uri_string)
+{
+  raptor_uri* uri;
+
+  uri = raptor_new_uri(world->raptor_world_ptr,
+                       RASQAL_GOOD_CAST(const unsigned char*, uri_string));
+  return rasqal_new_literal_expression(world,
+                                       rasqal_new_uri_literal(world, uri));
+}
+
+
+static rasqal_expression*
+filter_test_and(rasqal_world* world, rasqal_expression* e1,
+                rasqal_expression* e2)
+{
+  return rasqal_new_2op_expression(world, RASQAL_EXPR_AND, e1, e2);
+}
+
+
+/*
+ * filter_test_count:
+ *
+ * Return the number of rows passing filter @test_index over the
+ * test data read in batches or <0 on failure
+ */
+static int
+filter_test_count(rasqal_world* world, int test_index)
+{
+  rasqal_query* query = NULL;
+  rasqal_variables_table* vt;
+  raptor_sequence* seq = NULL;
+  raptor_sequence* vars_seq = NULL;
+  rasqal_rowsource* input_rs = NULL;
+  rasqal_rowsource* rowsource = NULL;
+  rasqal_row_batch* batch = NULL;
+  rasqal_expression* expr = NULL;
+  int total = -1;
+  int count;
+
+  query = rasqal_new_query(world, "sparql", NULL);
+  if(!query)
+    goto tidy;
+
+  vt = query->vars_table;
+
+  seq = rasqal_new_row_sequence(world, vt, filter_data_2x6_rows, 2, &vars_seq);
+  if(!seq)
+    goto tidy;
+
+  input_rs = rasqal_new_rowsequence_rowsource(world, query, vt, seq, vars_seq);
+  /* vars_seq and seq are now owned by input_rs */
+  vars_seq = seq = NULL;
+  if(!input_rs)
+    goto tidy;
+
+  switch(test_index) {
+    case 0:
+      /* ?a >= 2 && 4 >= ?a && ?b = <x> - kernels only */
+      expr = filter_test_and(world,
+                             filter_test_and(world,
+                                             rasqal_new_2op_expression(world, RASQAL_EXPR_GE,
+                                                                       filter_test_variable(world, vt, "a"),
+                                                                       filter_test_integer(world, 2)),
+                                             rasqal_new_2op_expression(world, RASQAL_EXPR_GE,
+                                                                       filter_test_integer(world, 4),
+                                                                       filter_test_variable(world, vt, "a"))),
+                             rasqal_new_2op_expression(world, RASQAL_EXPR_EQ,
+                                                       filter_test_variable(world, vt, "b"),
+                                                       filter_test_uri(world, EX_X)));
+      break;
+
+    case 1:
+      /* isURI(?b) && ?b != <y> && ?a < 4 - kernels and an expression */
+      expr = filter_test_and(world,
+                             filter_test_and(world,
+                                             rasqal_new_1op_expression(world, RASQAL_EXPR_ISURI,
+                                                                       filter_test_variable(world, vt, "b")),
+                                             rasqal_new_2op_expression(world, RASQAL_EXPR_NEQ,
+                                                                       filter_test_variable(world, vt, "b"),
+                                                                       filter_test_uri(world, EX_Y))),
+                             rasqal_new_2op_expression(world, RASQAL_EXPR_LT,
+                                                       filter_test_variable(world, vt, "a"),
+                                                       filter_test_integer(world, 4)));
+      break;
+
+    default:
+      /* ?a = 5 */
+      expr = rasqal_new_2op_expression(world, RASQAL_EXPR_EQ,
+                                       filter_test_variable(world, vt, "a"),
+                                       filter_test_integer(world, 5));
+      break;
+  }
+  if(!expr)
+    goto tidy;
+
+  rowsource = rasqal_new_filter_rowsource(world, query, input_rs, expr);
+  /* input_rs is now owned by rowsource and both are freed on failure */
+  input_rs = NULL;
+  if(!rowsource) {
+    expr = NULL;
+    goto tidy;
+  }
+
+  batch = rasqal_new_row_batch(rowsource, TEST_BATCH_SIZE);
+  if(!batch)
+    goto tidy;
+
+  total = 0;
+  while((count = rasqal_rowsource_read_batch(rowsource, batch)) > 0)
+    total += count;
+
+  if(count < 0)
+    total = -1;
+
+  tidy:
+  if(batch)
+    rasqal_free_row_batch(batch);
+  if(expr)
+    rasqal_free_expression(expr);
+  if(seq)
+    raptor_free_sequence(seq);
+  if(vars_seq)
+    raptor_free_sequence(vars_seq);
+  if(input_rs)
+    rasqal_free_rowsource(input_rs);
+  if(rowsource)
+    rasqal_free_rowsource(rowsource);
+  if(query)
+    rasqal_free_query(query);
+
+  return total;
+}
+
+
+#define FILTER_TESTS_COUNT 3
+
+static const int filter_tests_expected_counts[FILTER_TESTS_COUNT] = {
+  1, 2, 1
+};
+
+
+int
+main(int argc, char *argv[]) 
+{
+  const char *program = rasqal_basename(argv[0]);
+  rasqal_world* world = NULL;
+  int failures = 0;
+  int i;
+
+  world = rasqal_new_world(); rasqal_world_open(world);
+
+  for(i = 0; i < FILTER_TESTS_COUNT; i++) {
+    int count = filter_test_count(world, i);
+    int expected_count = filter_tests_expected_counts[i];
+
+    if(count != expected_count) {
+      fprintf(stderr, "%s: filter test %d returned %d rows, expected %d\n",
+              program, i, count, expected_count);
+      failures++;
+    }
+  }
+
+  if(world)
+    rasqal_free_world(world);
+
+  return failures;
+}
+
+#endif /* STANDALONE */
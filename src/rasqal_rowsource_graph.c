@@ -78,17 +78,21 @@ typedef struct
   /* GRAPH literal constant URI or variable */
   rasqal_variable* var;
 
-  /* dataset graph offset */
-  int dg_offset;
-  
-  /* number of graphs total */
-  int dg_size;
+  /* graph names in the dataset: sequence of #raptor_uri */
+  raptor_sequence* graph_names;
+
+  /* offset of the current graph name in @graph_names */
+  int graph_offset;
   
   /* row offset for read_row() */
   int offset;
 
   int finished;
 
+  /* non-0 if the inner rowsource binds the variable from the data in
+   * one pass instead of being read once per graph */
+  int bind_from_data;
+
 } rasqal_graph_rowsource_context;
 
 
@@ -96,45 +100,71 @@ static int
 rasqal_graph_next_dg(rasqal_graph_rowsource_context *con) 
 {
   rasqal_query *query = con->rowsource->query;
-  rasqal_data_graph *dg;
+  raptor_uri* name_uri;
+  rasqal_literal *o;
 
   con->finished = 0;
 
-  while(1) {
-    rasqal_literal *o;
+  con->graph_offset++;
+  name_uri = (raptor_uri*)raptor_sequence_get_at(con->graph_names,
+                                                 con->graph_offset);
+  if(!name_uri) {
+    con->finished = 1;
+    return con->finished;
+  }
 
-    con->dg_offset++;
-    dg = rasqal_query_get_data_graph(query, con->dg_offset);
-    if(!dg) {
-      con->finished = 1;
-      break;
-    }
-    
-    if(!dg->name_uri)
-      continue;
-    
-    o = rasqal_new_uri_literal(query->world, raptor_uri_copy(dg->name_uri));
-    if(!o) {
-      RASQAL_DEBUG1("Failed to create new URI literal\n");
-      con->finished = 1;
-      break;
-    }
+  o = rasqal_new_uri_literal(query->world, raptor_uri_copy(name_uri));
+  if(!o) {
+    RASQAL_DEBUG1("Failed to create new URI literal\n");
+    con->finished = 1;
+    return con->finished;
+  }
 
-    RASQAL_DEBUG2("Using data graph URI literal <%s>\n",
-                  rasqal_literal_as_string(o));
-    
-    rasqal_rowsource_set_origin(con->rowsource, o);
+  RASQAL_DEBUG2("Using data graph URI literal <%s>\n",
+                rasqal_literal_as_string(o));
 
-    /* this passes ownership of o to con->var */
-    rasqal_variable_set_value(con->var, o);
-      
-    break;
-  }
+  rasqal_rowsource_set_origin(con->rowsource, o);
+
+  /* this passes ownership of o to con->var */
+  rasqal_variable_set_value(con->var, o);
 
   return con->finished;
 }
 
 
+/*
+ * rasqal_graph_rowsource_init_graph_names:
+ * @con: graph rowsource context
+ * @query: query
+ *
+ * INTERNAL - Collect the names of the graphs in the query dataset
+ *
+ * These are the names of named data graphs and the graph names of
+ * quads in data graphs held in memory.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_graph_rowsource_init_graph_names(rasqal_graph_rowsource_context *con,
+                                        rasqal_query* query)
+{
+  rasqal_data_graph *dg;
+  int i;
+
+  con->graph_names = raptor_new_sequence((raptor_data_free_handler)raptor_free_uri,
+                                         NULL);
+  if(!con->graph_names)
+    return 1;
+
+  for(i = 0; (dg = rasqal_query_get_data_graph(query, i)); i++) {
+    if(rasqal_data_graph_add_graph_names(dg, con->graph_names))
+      return 1;
+  }
+
+  return 0;
+}
+
+
 static int
 rasqal_graph_rowsource_init(rasqal_rowsource* rowsource, void *user_data)
 {
@@ -147,12 +177,16 @@ rasqal_graph_rowsource_init(rasqal_rowsource* rowsource, void *user_data)
   if(!seq)
     return 1;
 
-  con->dg_size = raptor_sequence_size(seq);
-  
   con->finished = 0;
-  con->dg_offset = -1;
+  con->graph_offset = -1;
   con->offset = 0;
 
+  if(con->bind_from_data)
+    return 0;
+
+  if(rasqal_graph_rowsource_init_graph_names(con, rowsource->query))
+    return 1;
+
   /* Do not care if finished at this stage (it is not an
    * error). rasqal_graph_rowsource_read_row() will deal with
    * returning NULL for an empty result.
@@ -174,6 +208,9 @@ rasqal_graph_rowsource_finish(rasqal_rowsource* rowsource, void *user_data)
   
   rasqal_variable_set_value(con->var, NULL);
 
+  if(con->graph_names)
+    raptor_free_sequence(con->graph_names);
+
   RASQAL_FREE(rasqal_graph_rowsource_context, con);
 
   return 0;
@@ -214,6 +251,11 @@ rasqal_graph_rowsource_read_row(rasqal_rowsource* rowsource, void *user_data)
     row = rasqal_rowsource_read_row(con->rowsource);
     if(row)
       break;
+
+    if(con->bind_from_data) {
+      con->finished = 1;
+      break;
+    }
     
     if(rasqal_graph_next_dg(con)) {
       con->finished = 1;
@@ -260,10 +302,11 @@ rasqal_graph_rowsource_reset(rasqal_rowsource* rowsource, void *user_data)
   con = (rasqal_graph_rowsource_context*)user_data;
 
   con->finished = 0;
-  con->dg_offset = -1;
+  con->graph_offset = -1;
   con->offset = 0;
 
-  rasqal_graph_next_dg(con);
+  if(!con->bind_from_data)
+    rasqal_graph_next_dg(con);
   
   return rasqal_rowsource_reset(con->rowsource);
 }
@@ -294,6 +337,9 @@ static const rasqal_rowsource_handler rasqal_graph_rowsource_handler = {
   /* .set_requirements = */ NULL,
   /* .get_inner_rowsource = */ rasqal_graph_rowsource_get_inner_rowsource,
   /* .set_origin =       */ NULL,
+  /* .read_batch =       */ NULL,
+  /* .get_order =        */ NULL,
+  /* .set_outer_variables = */ NULL,
 };
 
 
@@ -303,18 +349,24 @@ static const rasqal_rowsource_handler rasqal_graph_rowsource_handler = {
  * @query: query object
  * @rowsource: input rowsource
  * @var: graph variable
+ * @bind_from_data: non-0 if @rowsource binds @var itself
  *
  * INTERNAL - create a new GRAPH rowsource that binds a variable
  *
  * The @rowsource becomes owned by the new rowsource
  *
+ * When @bind_from_data is set, @rowsource has been given @var as its
+ * origin and binds it from the graph of each matched triple, so it is
+ * read once over all graphs rather than once per named graph.
+ *
  * Return value: new rowsource or NULL on failure
  */
 rasqal_rowsource*
 rasqal_new_graph_rowsource(rasqal_world *world,
                            rasqal_query *query,
                            rasqal_rowsource* rowsource,
-                           rasqal_variable *var)
+                           rasqal_variable *var,
+                           int bind_from_data)
 {
   rasqal_graph_rowsource_context *con;
   int flags = 0;
@@ -328,6 +380,7 @@ rasqal_new_graph_rowsource(rasqal_world *world,
 
   con->rowsource = rowsource;
   con->var = var;
+  con->bind_from_data = bind_from_data;
 
   return rasqal_new_rowsource_from_handler(world, query,
                                            con,
@@ -455,6 +455,9 @@ static const rasqal_rowsource_handler rasqal_groupby_rowsource_handler = {
   /* .set_requirements = */ NULL,
   /* .get_inner_rowsource = */ rasqal_groupby_rowsource_get_inner_rowsource,
   /* .set_origin = */ NULL,
+  /* .read_batch = */ NULL,
+  /* .get_order = */ NULL,
+  /* .set_outer_variables = */ NULL,
 };
 
 
@@ -86,6 +86,27 @@ typedef struct
 
   /* join expression constant boolean value or < 0 if not valid */
   int constant_join_condition;
+
+  /* batches of left and right rows for read_batch() */
+  rasqal_row_batch* left_batch;
+  rasqal_row_batch* right_batch;
+
+  /* current left row and next right row in the batches */
+  int left_index;
+  int right_index;
+
+  /* right variables bound to the left row values before reading the
+   * right rowsource or NULL if the right rowsource does not use them */
+  raptor_sequence* outer_variables;
+
+  /* left row offsets of @outer_variables */
+  int* outer_map;
+
+  /* values of @outer_variables before they were bound */
+  rasqal_literal** outer_saved;
+
+  /* non-0 if @outer_variables are bound and @outer_saved are set */
+  int outer_bound;
 } rasqal_join_rowsource_context;
 
 
@@ -150,8 +171,8 @@ rasqal_join_rowsource_init(rasqal_rowsource* rowsource, void *user_data)
     con->constant_join_condition = bresult;
   }
 
+  /* right requirements depend on correlation, set in ensure_variables */
   rasqal_rowsource_set_requirements(con->left, RASQAL_ROWSOURCE_REQUIRE_RESET);
-  rasqal_rowsource_set_requirements(con->right, RASQAL_ROWSOURCE_REQUIRE_RESET);
   
   vars_table = con->left->vars_table;
   con->rc_map = rasqal_new_row_compatible(vars_table, con->left, con->right);
@@ -167,6 +188,33 @@ rasqal_join_rowsource_init(rasqal_rowsource* rowsource, void *user_data)
 }
 
 
+/*
+ * rasqal_join_rowsource_restore_outer_variables:
+ * @con: join rowsource context
+ *
+ * INTERNAL - Restore the outer variables to their values before they were bound
+ */
+static void
+rasqal_join_rowsource_restore_outer_variables(rasqal_join_rowsource_context* con)
+{
+  rasqal_variable* v;
+  int i;
+
+  if(!con->outer_bound)
+    return;
+
+  for(i = 0;
+      (v = (rasqal_variable*)raptor_sequence_get_at(con->outer_variables, i));
+      i++) {
+    /* takes ownership of the saved value */
+    rasqal_variable_set_value(v, con->outer_saved[i]);
+    con->outer_saved[i] = NULL;
+  }
+
+  con->outer_bound = 0;
+}
+
+
 static int
 rasqal_join_rowsource_finish(rasqal_rowsource* rowsource, void *user_data)
 {
@@ -190,6 +238,23 @@ rasqal_join_rowsource_finish(rasqal_rowsource* rowsource, void *user_data)
   
   if(con->rc_map)
     rasqal_free_row_compatible(con->rc_map);
+
+  if(con->left_batch)
+    rasqal_free_row_batch(con->left_batch);
+
+  if(con->right_batch)
+    rasqal_free_row_batch(con->right_batch);
+
+  rasqal_join_rowsource_restore_outer_variables(con);
+
+  if(con->outer_variables)
+    raptor_free_sequence(con->outer_variables);
+
+  if(con->outer_map)
+    RASQAL_FREE(int, con->outer_map);
+
+  if(con->outer_saved)
+    RASQAL_FREE(rasqal_literal**, con->outer_saved);
   
   RASQAL_FREE(rasqal_join_rowsource_context, con);
 
@@ -197,6 +262,144 @@ rasqal_join_rowsource_finish(rasqal_rowsource* rowsource, void *user_data)
 }
 
 
+/*
+ * rasqal_join_rowsource_init_outer_variables:
+ * @con: join rowsource context
+ *
+ * INTERNAL - Pass the variables shared with the left rowsource into the right
+ *
+ * If the right rowsource accepts them, the left row values are bound
+ * after each reset of the right rowsource so that it returns only
+ * matching rows, an index nested loop join, rather than every row
+ * for rasqal_row_compatible_check() to reject.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_join_rowsource_init_outer_variables(rasqal_join_rowsource_context* con)
+{
+  raptor_sequence* seq;
+  int size;
+  int count = 0;
+  int i;
+
+  size = rasqal_rowsource_get_size(con->right);
+  if(size <= 0)
+    return 0;
+
+  seq = raptor_new_sequence((raptor_data_free_handler)rasqal_free_variable,
+                            (raptor_data_print_handler)rasqal_variable_print);
+  if(!seq)
+    return 1;
+
+  con->outer_map = RASQAL_CALLOC(int*, RASQAL_GOOD_CAST(size_t, size),
+                                 sizeof(int));
+  if(!con->outer_map)
+    goto fail;
+
+  con->outer_saved = RASQAL_CALLOC(rasqal_literal**,
+                                   RASQAL_GOOD_CAST(size_t, size),
+                                   sizeof(rasqal_literal*));
+  if(!con->outer_saved)
+    goto fail;
+
+  for(i = 0; i < size; i++) {
+    rasqal_variable* v;
+    int offset;
+
+    v = rasqal_rowsource_get_variable_by_offset(con->right, i);
+    if(!v)
+      break;
+
+    offset = rasqal_rowsource_get_variable_offset_by_name(con->left, v->name);
+    if(offset < 0)
+      continue;
+
+    if(raptor_sequence_push(seq, rasqal_new_variable_from_variable(v)))
+      goto fail;
+    con->outer_map[count++] = offset;
+  }
+
+  if(count && !rasqal_rowsource_set_outer_variables(con->right, seq)) {
+    RASQAL_DEBUG2("right rowsource uses %d left row values\n", count);
+    con->outer_variables = seq;
+    return 0;
+  }
+
+  raptor_free_sequence(seq);
+  return 0;
+
+  fail:
+  raptor_free_sequence(seq);
+  return 1;
+}
+
+
+/*
+ * rasqal_join_rowsource_bind_outer_variables:
+ * @con: join rowsource context
+ * @left_row: left row or NULL to use @left_batch
+ * @left_batch: left batch
+ * @left_index: left row in @left_batch
+ *
+ * INTERNAL - Bind the outer variables to the current left row values
+ *
+ * Only URI and blank node values are bound.  The right rowsource
+ * matches values as RDF terms but rasqal_row_compatible_check()
+ * compares literals by value so literal values are left unbound for
+ * the right rowsource to bind itself.
+ *
+ * The values the variables had before are kept for
+ * rasqal_join_rowsource_restore_outer_variables() when the right
+ * rowsource is finished for this left row.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_join_rowsource_bind_outer_variables(rasqal_join_rowsource_context* con,
+                                           rasqal_row* left_row,
+                                           rasqal_row_batch* left_batch,
+                                           int left_index)
+{
+  rasqal_variable* v;
+  int i;
+
+  if(!con->outer_bound) {
+    for(i = 0;
+        (v = (rasqal_variable*)raptor_sequence_get_at(con->outer_variables, i));
+        i++)
+      con->outer_saved[i] = rasqal_new_literal_from_literal(v->value);
+
+    con->outer_bound = 1;
+  }
+
+  for(i = 0;
+      (v = (rasqal_variable*)raptor_sequence_get_at(con->outer_variables, i));
+      i++) {
+    rasqal_literal* value;
+    int offset = con->outer_map[i];
+
+    if(left_row)
+      value = left_row->values[offset];
+    else
+      value = RASQAL_ROW_BATCH_VALUE(left_batch, offset, left_index);
+
+    if(value && (value->type == RASQAL_LITERAL_URI ||
+                 value->type == RASQAL_LITERAL_BLANK)) {
+      value = rasqal_new_literal_from_literal(value);
+      if(!value)
+        return 1;
+    } else
+      value = NULL;
+
+    rasqal_variable_set_value(v, value);
+  }
+
+  return 0;
+}
+
+
+
 static int
 rasqal_join_rowsource_ensure_variables(rasqal_rowsource* rowsource,
                                         void *user_data)
@@ -240,6 +443,14 @@ rasqal_join_rowsource_ensure_variables(rasqal_rowsource* rowsource,
     con->right_map[i] = offset;
   }
 
+  if(rasqal_join_rowsource_init_outer_variables(con))
+    return 1;
+
+  /* the right rowsource is read again for every left row */
+  rasqal_rowsource_set_requirements(con->right,
+                                    RASQAL_ROWSOURCE_REQUIRE_RESET |
+                                    RASQAL_ROWSOURCE_REQUIRE_REPEAT);
+
   return 0;
 }
 
@@ -344,6 +555,13 @@ rasqal_join_rowsource_read_row(rasqal_rowsource* rowsource, void *user_data)
       con->right_rows_joined_count = 0;
 
       rasqal_rowsource_reset(con->right);
+
+      if(con->outer_variables &&
+         rasqal_join_rowsource_bind_outer_variables(con, con->left_row,
+                                                    NULL, 0)) {
+        con->failed = 1;
+        return NULL;
+      }
     }
 
 
@@ -359,6 +577,7 @@ rasqal_join_rowsource_read_row(rasqal_rowsource* rowsource, void *user_data)
 
     if(!right_row && con->state == JS_READ_RIGHT) {
       /* right has finished */
+      rasqal_join_rowsource_restore_outer_variables(con);
 
       /* restart left */
       con->state = JS_START;
@@ -501,6 +720,242 @@ rasqal_join_rowsource_read_row(rasqal_rowsource* rowsource, void *user_data)
 }
 
 
+/*
+ * rasqal_join_rowsource_add_merged_row:
+ * @rowsource: join rowsource
+ * @con: join rowsource context
+ * @batch: batch to add the row to
+ * @right_index: row in the right batch or <0 for the left row only
+ *
+ * INTERNAL - Add the merge of the current left row and a right row to a batch
+ *
+ * Return value: index of the new row in @batch or <0 on failure
+ */
+static int
+rasqal_join_rowsource_add_merged_row(rasqal_rowsource* rowsource,
+                                     rasqal_join_rowsource_context* con,
+                                     rasqal_row_batch* batch,
+                                     int right_index)
+{
+  int index;
+
+  index = rasqal_row_batch_new_row(batch);
+  if(index < 0)
+    return -1;
+
+  /* left variables are first in the same order */
+  rasqal_row_batch_merge_values(batch, index, con->left_batch, con->left_index,
+                                NULL);
+  if(right_index >= 0)
+    rasqal_row_batch_merge_values(batch, index, con->right_batch, right_index,
+                                  con->right_map);
+
+  batch->offsets[index] = con->offset++;
+
+  return index;
+}
+
+
+/*
+ * rasqal_join_rowsource_remove_last_row:
+ * @batch: batch
+ *
+ * INTERNAL - Remove the last row added to a batch
+ */
+static void
+rasqal_join_rowsource_remove_last_row(rasqal_row_batch* batch)
+{
+  int index = --batch->count;
+  int c;
+
+  for(c = 0; c < batch->size; c++) {
+    rasqal_literal** value_p = &RASQAL_ROW_BATCH_VALUE(batch, c, index);
+    if(*value_p) {
+      rasqal_free_literal(*value_p);
+      *value_p = NULL;
+    }
+  }
+}
+
+
+/*
+ * rasqal_join_rowsource_evaluate_merged_row:
+ * @rowsource: join rowsource
+ * @con: join rowsource context
+ * @batch: batch holding the merged row
+ * @index: merged row in @batch
+ *
+ * INTERNAL - Evaluate the join expression over a merged row
+ *
+ * Return value: boolean result; errors are false
+ */
+static int
+rasqal_join_rowsource_evaluate_merged_row(rasqal_rowsource* rowsource,
+                                          rasqal_join_rowsource_context* con,
+                                          rasqal_row_batch* batch,
+                                          int index)
+{
+  rasqal_query *query = rowsource->query;
+  rasqal_literal *result;
+  int bresult;
+  int error = 0;
+
+  if(rasqal_row_batch_bind_row(batch, index))
+    return 0;
+
+  result = rasqal_expression_evaluate2(con->expr, query->eval_context, &error);
+  if(error)
+    return 0;
+
+  bresult = rasqal_literal_as_boolean(result, &error);
+  rasqal_free_literal(result);
+
+  return error ? 0 : bresult;
+}
+
+
+/*
+ * rasqal_join_rowsource_read_batch:
+ *
+ * INTERNAL - read a batch of joined rows
+ *
+ * The same nested loop join as rasqal_join_rowsource_read_row() but
+ * reading the left and right rowsources a batch at a time and
+ * writing the merged values straight into @batch without making
+ * intermediate rows.  The join expression is evaluated over the
+ * merged row once it is in @batch.
+ */
+static int
+rasqal_join_rowsource_read_batch(rasqal_rowsource* rowsource,
+                                 void *user_data,
+                                 rasqal_row_batch* batch)
+{
+  rasqal_join_rowsource_context* con;
+
+  con = (rasqal_join_rowsource_context*)user_data;
+
+  if(con->failed || con->state == JS_FINISHED)
+    return 0;
+
+  if(!con->left_batch) {
+    con->left_batch = rasqal_new_row_batch(con->left, batch->capacity);
+    con->right_batch = rasqal_new_row_batch(con->right, batch->capacity);
+    if(!con->left_batch || !con->right_batch)
+      goto failed;
+    con->left_index = -1;
+  }
+
+  /* rows bound since the last call may have replaced the left values
+   * that the right rowsource depends on */
+  if(con->state == JS_READ_RIGHT &&
+     rasqal_row_batch_bind_row(con->left_batch, con->left_index))
+    goto failed;
+
+  while(batch->count < batch->capacity) {
+    int index;
+    int right_index;
+    int bresult = 1;
+
+    if(con->state == JS_START) {
+      /* next left row */
+      if(con->left_index + 1 < con->left_batch->count)
+        con->left_index++;
+      else {
+        int count = rasqal_rowsource_read_batch(con->left, con->left_batch);
+        if(count < 0)
+          goto failed;
+
+        if(!count) {
+          con->state = JS_FINISHED;
+          break;
+        }
+        con->left_index = 0;
+      }
+
+      if(rasqal_row_batch_bind_row(con->left_batch, con->left_index))
+        goto failed;
+
+      con->state = JS_INIT_RIGHT;
+    }
+
+    if(con->state == JS_INIT_RIGHT) {
+      /* start right */
+      con->right_rows_joined_count = 0;
+
+      rasqal_rowsource_reset(con->right);
+      rasqal_row_batch_clear(con->right_batch);
+      con->right_index = 0;
+
+      if(con->outer_variables &&
+         rasqal_join_rowsource_bind_outer_variables(con, NULL,
+                                                    con->left_batch,
+                                                    con->left_index))
+        goto failed;
+
+      con->state = JS_READ_RIGHT;
+    }
+
+    if(con->right_index >= con->right_batch->count) {
+      int count = rasqal_rowsource_read_batch(con->right, con->right_batch);
+      if(count < 0)
+        goto failed;
+
+      con->right_index = 0;
+
+      if(!count) {
+        /* right has finished so restart left */
+        rasqal_join_rowsource_restore_outer_variables(con);
+        con->state = JS_START;
+
+        /* LEFT JOIN - add left row if no right row joined */
+        if(!con->right_rows_joined_count &&
+           con->join_type == RASQAL_JOIN_TYPE_LEFT) {
+          con->right_rows_joined_count++;
+          if(rasqal_join_rowsource_add_merged_row(rowsource, con, batch, -1) < 0)
+            goto failed;
+        }
+        continue;
+      }
+    }
+
+    right_index = con->right_index++;
+
+    if(!rasqal_row_compatible_check_batch(con->rc_map,
+                                          con->left_batch, con->left_index,
+                                          con->right_batch, right_index))
+      continue;
+
+    /* constant join expression value is known before merging */
+    if(!con->constant_join_condition)
+      continue;
+
+    index = rasqal_join_rowsource_add_merged_row(rowsource, con, batch,
+                                                 right_index);
+    if(index < 0)
+      goto failed;
+
+    if(con->constant_join_condition < 0 && con->expr)
+      bresult = rasqal_join_rowsource_evaluate_merged_row(rowsource, con,
+                                                          batch, index);
+
+    if(!bresult) {
+      /* take the merged row back out */
+      rasqal_join_rowsource_remove_last_row(batch);
+      con->offset--;
+      continue;
+    }
+
+    con->right_rows_joined_count++;
+  }
+
+  return batch->count;
+
+  failed:
+  con->failed = 1;
+  return -1;
+}
+
+
 static int
 rasqal_join_rowsource_reset(rasqal_rowsource* rowsource, void *user_data)
 {
@@ -509,8 +964,15 @@ rasqal_join_rowsource_reset(rasqal_rowsource* rowsource, void *user_data)
   
   con = (rasqal_join_rowsource_context*)user_data;
 
+  rasqal_join_rowsource_restore_outer_variables(con);
+
   con->state = JS_START;
   con->failed = 0;
+
+  if(con->left_batch) {
+    rasqal_row_batch_clear(con->left_batch);
+    con->left_index = -1;
+  }
   
   rc = rasqal_rowsource_reset(con->left);
   if(rc)
@@ -537,7 +999,7 @@ rasqal_join_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource,
 
 
 static const rasqal_rowsource_handler rasqal_join_rowsource_handler = {
-  /* .version = */ 1,
+  /* .version = */ 2,
   "join",
   /* .init = */ rasqal_join_rowsource_init,
   /* .finish = */ rasqal_join_rowsource_finish,
@@ -548,6 +1010,9 @@ static const rasqal_rowsource_handler rasqal_join_rowsource_handler = {
   /* .set_requirements = */ NULL,
   /* .get_inner_rowsource = */ rasqal_join_rowsource_get_inner_rowsource,
   /* .set_origin = */ NULL,
+  /* .read_batch = */ rasqal_join_rowsource_read_batch,
+  /* .get_order = */ NULL,
+  /* .set_outer_variables = */ NULL
 };
 
 
@@ -671,6 +1136,300 @@ const join_test_config_type join_test_config[JOIN_TESTS_COUNT] = {
 const char* const join_result_vars[] = { "a" , "b" , "c", "d" };
 
 
+/* one left row with a literal b matching no right row */
+const char* const join_3_data_2x1_rows[] =
+{
+  /* 2 variable names and 1 row */
+  "a",   NULL, "b",     NULL,
+  /* row 1 data */
+  "bob", NULL, "green", NULL,
+  /* end of data */
+  NULL, NULL, NULL, NULL
+};
+
+/* one left row with a URI b matching the second right row */
+const char* const join_4_data_2x1_rows[] =
+{
+  /* 2 variable names and 1 row */
+  "a",   NULL, "b",  NULL,
+  /* row 1 data */
+  "bob", NULL, NULL, "http://example.org/blue",
+  /* end of data */
+  NULL, NULL, NULL, NULL
+};
+
+const char* const join_4_data_3x2_rows[] =
+{
+  /* 3 variable names and 2 rows */
+  "b",  NULL,                     "c",      NULL, "d",      NULL,
+  /* row 1 data */
+  NULL, "http://example.org/red",  "orange", NULL, "yellow", NULL,
+  /* row 2 data */
+  NULL, "http://example.org/blue", "indigo", NULL, "violet", NULL,
+  /* end of data */
+  NULL, NULL, NULL, NULL, NULL, NULL
+};
+
+
+#define OUTER_TESTS_COUNT 2
+
+static const struct {
+  const char* const* left_data;
+  const char* const* right_data;
+  /* rows returned by the join */
+  int expected_rows;
+  /* right rows read while b was bound by the join */
+  int expected_bound_count;
+} outer_test_config[OUTER_TESTS_COUNT] = {
+  /* literal values are not bound for the right rowsource */
+  { join_3_data_2x1_rows, join_2_data_3x2_rows, 0, 0 },
+  /* URI values are bound for the right rowsource */
+  { join_4_data_2x1_rows, join_4_data_3x2_rows, 1, 2 }
+};
+
+
+/*
+ * Right rowsource that accepts the outer variables and returns only
+ * the rows of an inner rowsource matching their values as a triple
+ * pattern does.
+ */
+typedef struct {
+  rasqal_rowsource* rowsource;
+
+  /* outer variable or NULL */
+  rasqal_variable* key;
+
+  /* rows read while @key had a value */
+  int bound_count;
+} join_lookup_context;
+
+
+static int
+join_lookup_finish(rasqal_rowsource* rowsource, void *user_data)
+{
+  join_lookup_context* con = (join_lookup_context*)user_data;
+
+  if(con->rowsource)
+    rasqal_free_rowsource(con->rowsource);
+  if(con->key)
+    rasqal_free_variable(con->key);
+  RASQAL_FREE(join_lookup_context, con);
+
+  return 0;
+}
+
+
+static int
+join_lookup_ensure_variables(rasqal_rowsource* rowsource, void *user_data)
+{
+  join_lookup_context* con = (join_lookup_context*)user_data;
+
+  if(rasqal_rowsource_ensure_variables(con->rowsource))
+    return 1;
+
+  rowsource->size = 0;
+  return rasqal_rowsource_copy_variables(rowsource, con->rowsource);
+}
+
+
+static rasqal_row*
+join_lookup_read_row(rasqal_rowsource* rowsource, void *user_data)
+{
+  join_lookup_context* con = (join_lookup_context*)user_data;
+  rasqal_row* row;
+
+  while((row = rasqal_rowsource_read_row(con->rowsource))) {
+    int offset;
+
+    if(!con->key || !con->key->value)
+      break;
+
+    con->bound_count++;
+    offset = rasqal_rowsource_get_variable_offset_by_name(rowsource,
+                                                          con->key->name);
+    if(rasqal_literal_equals(row->values[offset], con->key->value))
+      break;
+
+    rasqal_free_row(row);
+  }
+
+  return row;
+}
+
+
+static int
+join_lookup_reset(rasqal_rowsource* rowsource, void *user_data)
+{
+  join_lookup_context* con = (join_lookup_context*)user_data;
+
+  return rasqal_rowsource_reset(con->rowsource);
+}
+
+
+static int
+join_lookup_set_outer_variables(rasqal_rowsource* rowsource, void *user_data,
+                                raptor_sequence* variables)
+{
+  join_lookup_context* con = (join_lookup_context*)user_data;
+  rasqal_variable* v;
+
+  v = (rasqal_variable*)raptor_sequence_get_at(variables, 0);
+  if(!v)
+    return 1;
+
+  con->key = rasqal_new_variable_from_variable(v);
+  return 0;
+}
+
+
+static const rasqal_rowsource_handler join_lookup_handler = {
+  /* .version = */ 2,
+  "lookup",
+  /* .init = */ NULL,
+  /* .finish = */ join_lookup_finish,
+  /* .ensure_variables = */ join_lookup_ensure_variables,
+  /* .read_row = */ join_lookup_read_row,
+  /* .read_all_rows = */ NULL,
+  /* .reset = */ join_lookup_reset,
+  /* .set_requirements = */ NULL,
+  /* .get_inner_rowsource = */ NULL,
+  /* .set_origin = */ NULL,
+  /* .read_batch = */ NULL,
+  /* .get_order = */ NULL,
+  /* .set_outer_variables = */ join_lookup_set_outer_variables
+};
+
+
+/*
+ * join_test_outer_variables:
+ *
+ * Test that only URI and blank node left values are bound for a right
+ * rowsource that uses the outer variables and that the previous value
+ * is restored.
+ */
+static int
+join_test_outer_variables(rasqal_world* world, rasqal_query* query,
+                          int test_index, const char* program)
+{
+  rasqal_variables_table* vt = query->vars_table;
+  rasqal_rowsource *rowsource = NULL;
+  rasqal_rowsource *left_rs = NULL;
+  rasqal_rowsource *right_rs = NULL;
+  raptor_sequence* seq = NULL;
+  raptor_sequence* vars_seq = NULL;
+  join_lookup_context* con = NULL;
+  join_lookup_context* lookup;
+  rasqal_variable* b;
+  rasqal_literal* saved;
+  rasqal_row* row;
+  int count;
+  int failures = 0;
+
+  seq = rasqal_new_row_sequence(world, vt,
+                                outer_test_config[test_index].left_data, 2,
+                                &vars_seq);
+  if(!seq)
+    goto fail;
+  left_rs = rasqal_new_rowsequence_rowsource(world, query, vt, seq, vars_seq);
+  /* vars_seq and seq are now owned by left_rs */
+  vars_seq = seq = NULL;
+  if(!left_rs)
+    goto fail;
+
+  con = RASQAL_CALLOC(join_lookup_context*, 1, sizeof(*con));
+  if(!con)
+    goto fail;
+  seq = rasqal_new_row_sequence(world, vt,
+                                outer_test_config[test_index].right_data, 3,
+                                &vars_seq);
+  if(!seq)
+    goto fail;
+  con->rowsource = rasqal_new_rowsequence_rowsource(world, query, vt, seq,
+                                                    vars_seq);
+  /* vars_seq and seq are now owned by con->rowsource */
+  vars_seq = seq = NULL;
+  if(!con->rowsource)
+    goto fail;
+
+  right_rs = rasqal_new_rowsource_from_handler(world, query, con,
+                                               &join_lookup_handler, vt, 0);
+  /* con is now owned by right_rs */
+  lookup = con;
+  con = NULL;
+  if(!right_rs)
+    goto fail;
+
+  rowsource = rasqal_new_join_rowsource(world, query, left_rs, right_rs,
+                                        RASQAL_JOIN_TYPE_NATURAL, NULL);
+  /* left_rs and right_rs are now owned by rowsource */
+  left_rs = right_rs = NULL;
+  if(!rowsource)
+    goto fail;
+
+  b = rasqal_variables_table_get_by_name(vt, RASQAL_VARIABLE_TYPE_NORMAL,
+                                         RASQAL_GOOD_CAST(const unsigned char*, "b"));
+  saved = rasqal_new_numeric_literal_from_long(world, RASQAL_LITERAL_INTEGER,
+                                               42);
+  if(!b || !saved) {
+    if(saved)
+      rasqal_free_literal(saved);
+    goto fail;
+  }
+  rasqal_variable_set_value(b, saved);
+
+  count = 0;
+  while((row = rasqal_rowsource_read_row(rowsource))) {
+    count++;
+    rasqal_free_row(row);
+  }
+
+  if(count != outer_test_config[test_index].expected_rows) {
+    fprintf(stderr,
+            "%s: outer variables join %d returned %d rows, expected %d\n",
+            program, test_index, count,
+            outer_test_config[test_index].expected_rows);
+    failures++;
+  }
+
+  if(lookup->bound_count != outer_test_config[test_index].expected_bound_count) {
+    fprintf(stderr,
+            "%s: outer variables join %d read %d right rows with b bound, expected %d\n",
+            program, test_index, lookup->bound_count,
+            outer_test_config[test_index].expected_bound_count);
+    failures++;
+  }
+
+  if(b->value != saved) {
+    fprintf(stderr,
+            "%s: outer variables join %d did not restore the value of b\n",
+            program, test_index);
+    failures++;
+  }
+
+  rasqal_variable_set_value(b, NULL);
+  rasqal_free_rowsource(rowsource);
+
+  return failures;
+
+  fail:
+  fprintf(stderr, "%s: failed to create outer variables join\n", program);
+  if(seq)
+    raptor_free_sequence(seq);
+  if(vars_seq)
+    raptor_free_sequence(vars_seq);
+  if(con)
+    join_lookup_finish(NULL, con);
+  if(left_rs)
+    rasqal_free_rowsource(left_rs);
+  if(right_rs)
+    rasqal_free_rowsource(right_rs);
+  if(rowsource)
+    rasqal_free_rowsource(rowsource);
+
+  return 1;
+}
+
+
 int
 main(int argc, char *argv[]) 
 {
@@ -813,6 +1572,12 @@ main(int argc, char *argv[])
     
     /* end test_count loop */
   }
+
+  for(test_count = 0; test_count < OUTER_TESTS_COUNT; test_count++) {
+    fprintf(stderr, "%s: test outer variables join %d\n", program,
+            test_count);
+    failures += join_test_outer_variables(world, query, test_count, program);
+  }
   
   tidy:
   if(seq)
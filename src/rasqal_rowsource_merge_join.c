@@ -0,0 +1,960 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_rowsource_merge_join.c - Rasqal merge join rowsource class
+ *
+ * Copyright (C) 2008-2012, David Beckett http://www.dajobe.org/
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#include <raptor.h>
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+
+#define DEBUG_FH stderr
+
+
+#ifndef STANDALONE
+
+typedef enum {
+  /* not yet read any rows */
+  MJS_START,
+  /* merging the left rows with blocks of right rows of the same key */
+  MJS_MERGE,
+  /* matching the current left row against the right block */
+  MJS_MERGE_BLOCK,
+  /* nested loop over all rows since a key was unbound */
+  MJS_NESTED,
+  MJS_FINISHED
+} rasqal_merge_join_state;
+
+
+typedef struct
+{
+  /* inner rowsources, both in ascending order of key */
+  rasqal_rowsource* left;
+  rasqal_rowsource* right;
+
+  /* join key variable */
+  rasqal_variable* key;
+
+  /* offsets of key in left and right rows */
+  int left_key;
+  int right_key;
+
+  /* array size of right rowsource size: [right offset] = join offset */
+  int* right_map;
+
+  /* join expression or NULL */
+  rasqal_expression *expr;
+
+  rasqal_row_compatible* rc_map;
+
+  rasqal_merge_join_state state;
+
+  /* current left row */
+  rasqal_row* left_row;
+
+  /* right rows all with the same key and the next row to try */
+  raptor_sequence* right_block;
+  int block_index;
+
+  /* first right row after the block or NULL when right is finished */
+  rasqal_row* right_next;
+
+  /* all rows for MJS_NESTED and the current positions */
+  raptor_sequence* left_rows;
+  raptor_sequence* right_rows;
+  int left_index;
+  int right_index;
+
+  /* offset into results for current row */
+  int offset;
+
+  int failed;
+} rasqal_merge_join_rowsource_context;
+
+
+static int
+rasqal_merge_join_rowsource_init(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_merge_join_rowsource_context* con;
+
+  con = (rasqal_merge_join_rowsource_context*)user_data;
+
+  con->state = MJS_START;
+
+  con->rc_map = rasqal_new_row_compatible(con->left->vars_table,
+                                          con->left, con->right);
+  if(!con->rc_map)
+    return -1;
+
+  return 0;
+}
+
+
+static void
+rasqal_merge_join_rowsource_clear(rasqal_merge_join_rowsource_context* con)
+{
+  if(con->left_row) {
+    rasqal_free_row(con->left_row);
+    con->left_row = NULL;
+  }
+
+  if(con->right_next) {
+    rasqal_free_row(con->right_next);
+    con->right_next = NULL;
+  }
+
+  if(con->right_block) {
+    raptor_free_sequence(con->right_block);
+    con->right_block = NULL;
+  }
+
+  if(con->left_rows) {
+    raptor_free_sequence(con->left_rows);
+    con->left_rows = NULL;
+  }
+
+  if(con->right_rows) {
+    raptor_free_sequence(con->right_rows);
+    con->right_rows = NULL;
+  }
+
+  con->block_index = 0;
+  con->left_index = 0;
+  con->right_index = 0;
+}
+
+
+static int
+rasqal_merge_join_rowsource_finish(rasqal_rowsource* rowsource,
+                                   void *user_data)
+{
+  rasqal_merge_join_rowsource_context* con;
+  con = (rasqal_merge_join_rowsource_context*)user_data;
+
+  rasqal_merge_join_rowsource_clear(con);
+
+  if(con->left)
+    rasqal_free_rowsource(con->left);
+
+  if(con->right)
+    rasqal_free_rowsource(con->right);
+
+  if(con->key)
+    rasqal_free_variable(con->key);
+
+  if(con->right_map)
+    RASQAL_FREE(int, con->right_map);
+
+  if(con->expr)
+    rasqal_free_expression(con->expr);
+
+  if(con->rc_map)
+    rasqal_free_row_compatible(con->rc_map);
+
+  RASQAL_FREE(rasqal_merge_join_rowsource_context, con);
+
+  return 0;
+}
+
+
+static int
+rasqal_merge_join_rowsource_ensure_variables(rasqal_rowsource* rowsource,
+                                             void *user_data)
+{
+  rasqal_merge_join_rowsource_context* con;
+  int map_size;
+  int i;
+
+  con = (rasqal_merge_join_rowsource_context*)user_data;
+
+  if(rasqal_rowsource_ensure_variables(con->left))
+    return 1;
+
+  if(rasqal_rowsource_ensure_variables(con->right))
+    return 1;
+
+  con->left_key = rasqal_rowsource_get_variable_offset_by_name(con->left,
+                                                               con->key->name);
+  con->right_key = rasqal_rowsource_get_variable_offset_by_name(con->right,
+                                                                con->key->name);
+  if(con->left_key < 0 || con->right_key < 0)
+    return 1;
+
+  map_size = rasqal_rowsource_get_size(con->right);
+  con->right_map = RASQAL_MALLOC(int*, RASQAL_GOOD_CAST(size_t,
+                                                        sizeof(int) * RASQAL_GOOD_CAST(size_t, map_size)));
+  if(!con->right_map)
+    return 1;
+
+  rowsource->size = 0;
+
+  /* copy in variables from left rowsource */
+  if(rasqal_rowsource_copy_variables(rowsource, con->left))
+    return 1;
+
+  /* add any new variables not already seen from right rowsource */
+  for(i = 0; i < map_size; i++) {
+    rasqal_variable* v;
+    int offset;
+
+    v = rasqal_rowsource_get_variable_by_offset(con->right, i);
+    if(!v)
+      break;
+    offset = rasqal_rowsource_add_variable(rowsource, v);
+    if(offset < 0)
+      return 1;
+
+    con->right_map[i] = offset;
+  }
+
+  return 0;
+}
+
+
+/*
+ * rasqal_merge_join_rowsource_compare_keys:
+ *
+ * INTERNAL - compare key values as ORDER BY ASC does
+ *
+ * Uses the order keys of the values as the sort does, so values of
+ * types that do not compare with rasqal_literal_array_compare() are
+ * still ordered by type and not taken as equal.
+ */
+static int
+rasqal_merge_join_rowsource_compare_keys(rasqal_rowsource* rowsource,
+                                         rasqal_literal* left_value,
+                                         rasqal_literal* right_value)
+{
+  int compare_flags = rowsource->query->compare_flags;
+  unsigned char* left_key;
+  unsigned char* right_key = NULL;
+  size_t left_len = 0;
+  size_t right_len = 0;
+  int left_complete = 0;
+  int right_complete = 0;
+  int decided = 0;
+  int result = 0;
+
+  left_key = rasqal_literal_array_to_order_key(&left_value, NULL, 1,
+                                               compare_flags,
+                                               &left_len, &left_complete);
+  if(left_key)
+    right_key = rasqal_literal_array_to_order_key(&right_value, NULL, 1,
+                                                  compare_flags,
+                                                  &right_len, &right_complete);
+
+  if(left_key && right_key) {
+    size_t len = (left_len < right_len) ? left_len : right_len;
+
+    result = memcmp(left_key, right_key, len);
+    decided = (result || (left_complete && right_complete));
+  }
+
+  if(left_key)
+    RASQAL_FREE(char*, left_key);
+  if(right_key)
+    RASQAL_FREE(char*, right_key);
+
+  if(!decided)
+    result = rasqal_literal_array_compare(&left_value, &right_value, NULL, 1,
+                                          compare_flags);
+
+  return result;
+}
+
+
+/*
+ * rasqal_merge_join_rowsource_merge:
+ * @rowsource: merge join rowsource
+ * @con: merge join context
+ * @left_row: left row
+ * @right_row: right row
+ *
+ * INTERNAL - Make the joined row of a left row and a right row
+ *
+ * Return value: new row, NULL if the rows do not join, or NULL and
+ * sets con->failed on failure
+ */
+static rasqal_row*
+rasqal_merge_join_rowsource_merge(rasqal_rowsource* rowsource,
+                                  rasqal_merge_join_rowsource_context* con,
+                                  rasqal_row* left_row,
+                                  rasqal_row* right_row)
+{
+  rasqal_query *query = rowsource->query;
+  rasqal_row *row;
+  int i;
+
+  if(!rasqal_row_compatible_check(con->rc_map, left_row, right_row))
+    return NULL;
+
+  row = rasqal_new_row_for_size(rowsource->world, rowsource->size);
+  if(!row) {
+    con->failed = 1;
+    return NULL;
+  }
+
+  rasqal_row_set_rowsource(row, rowsource);
+
+  for(i = 0; i < left_row->size; i++)
+    row->values[i] = rasqal_new_literal_from_literal(left_row->values[i]);
+
+  for(i = 0; i < right_row->size; i++) {
+    int dest_i = con->right_map[i];
+    if(!row->values[dest_i])
+      row->values[dest_i] = rasqal_new_literal_from_literal(right_row->values[i]);
+  }
+
+  if(con->expr) {
+    rasqal_literal *result;
+    int bresult = 0;
+    int error = 0;
+
+    rasqal_row_bind_variables(row, query->vars_table);
+
+    result = rasqal_expression_evaluate2(con->expr, query->eval_context,
+                                         &error);
+    if(!error) {
+      bresult = rasqal_literal_as_boolean(result, &error);
+      if(error)
+        bresult = 0;
+      rasqal_free_literal(result);
+    }
+
+    if(!bresult) {
+      rasqal_free_row(row);
+      return NULL;
+    }
+  }
+
+  row->offset = con->offset++;
+
+  return row;
+}
+
+
+/*
+ * rasqal_merge_join_rowsource_read_rest:
+ * @rowsource: inner rowsource
+ * @first_row: row already read from @rowsource
+ *
+ * INTERNAL - Make a sequence of a row and all remaining rows of a rowsource
+ *
+ * Return value: new sequence owning @first_row or NULL on failure
+ */
+static raptor_sequence*
+rasqal_merge_join_rowsource_read_rest(rasqal_rowsource* rowsource,
+                                      rasqal_row* first_row)
+{
+  raptor_sequence* seq;
+  rasqal_row* row;
+
+  seq = raptor_new_sequence((raptor_data_free_handler)rasqal_free_row,
+                            (raptor_data_print_handler)rasqal_row_print);
+  if(!seq) {
+    rasqal_free_row(first_row);
+    return NULL;
+  }
+
+  for(row = first_row; row; row = rasqal_rowsource_read_row(rowsource)) {
+    if(raptor_sequence_push(seq, row)) {
+      raptor_free_sequence(seq);
+      return NULL;
+    }
+  }
+
+  return seq;
+}
+
+
+/*
+ * rasqal_merge_join_rowsource_start_nested:
+ * @con: merge join context
+ *
+ * INTERNAL - Read all rows for a nested loop join
+ *
+ * Unbound keys order first and join with any key so when the first
+ * row of either side has one, the join is done as a nested loop.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_merge_join_rowsource_start_nested(rasqal_merge_join_rowsource_context* con)
+{
+  con->left_rows = rasqal_merge_join_rowsource_read_rest(con->left,
+                                                         con->left_row);
+  con->left_row = NULL;
+
+  con->right_rows = rasqal_merge_join_rowsource_read_rest(con->right,
+                                                          con->right_next);
+  con->right_next = NULL;
+
+  if(!con->left_rows || !con->right_rows)
+    return 1;
+
+  con->left_index = 0;
+  con->right_index = 0;
+  con->state = MJS_NESTED;
+
+  RASQAL_DEBUG3("merge join of %d x %d rows as a nested loop\n",
+                raptor_sequence_size(con->left_rows),
+                raptor_sequence_size(con->right_rows));
+
+  return 0;
+}
+
+
+/*
+ * rasqal_merge_join_rowsource_read_block:
+ * @rowsource: merge join rowsource
+ * @con: merge join context
+ *
+ * INTERNAL - Move con->right_next and all following right rows with the same key into the right block
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_merge_join_rowsource_read_block(rasqal_rowsource* rowsource,
+                                       rasqal_merge_join_rowsource_context* con)
+{
+  rasqal_literal* key_value;
+
+  if(con->right_block)
+    raptor_free_sequence(con->right_block);
+
+  con->right_block = raptor_new_sequence((raptor_data_free_handler)rasqal_free_row,
+                                         (raptor_data_print_handler)rasqal_row_print);
+  if(!con->right_block)
+    return 1;
+
+  key_value = con->right_next->values[con->right_key];
+  if(raptor_sequence_push(con->right_block, con->right_next)) {
+    con->right_next = NULL;
+    return 1;
+  }
+  con->right_next = NULL;
+
+  while(1) {
+    rasqal_row* row = rasqal_rowsource_read_row(con->right);
+    if(!row)
+      break;
+
+    if(rasqal_merge_join_rowsource_compare_keys(rowsource, key_value,
+                                                row->values[con->right_key])) {
+      con->right_next = row;
+      break;
+    }
+
+    if(raptor_sequence_push(con->right_block, row))
+      return 1;
+  }
+
+  con->block_index = 0;
+
+  return 0;
+}
+
+
+static rasqal_row*
+rasqal_merge_join_rowsource_read_row(rasqal_rowsource* rowsource,
+                                     void *user_data)
+{
+  rasqal_merge_join_rowsource_context* con;
+  rasqal_row* row = NULL;
+
+  con = (rasqal_merge_join_rowsource_context*)user_data;
+
+  if(con->failed || con->state == MJS_FINISHED)
+    return NULL;
+
+  if(con->state == MJS_START) {
+    con->left_row = rasqal_rowsource_read_row(con->left);
+    if(con->left_row)
+      con->right_next = rasqal_rowsource_read_row(con->right);
+
+    if(!con->left_row || !con->right_next) {
+      con->state = MJS_FINISHED;
+      return NULL;
+    }
+
+    if(!con->left_row->values[con->left_key] ||
+       !con->right_next->values[con->right_key]) {
+      if(rasqal_merge_join_rowsource_start_nested(con))
+        goto failed;
+    } else
+      con->state = MJS_MERGE;
+  }
+
+  while(con->state == MJS_NESTED) {
+    rasqal_row* left_row;
+    rasqal_row* right_row;
+
+    if(con->right_index >= raptor_sequence_size(con->right_rows)) {
+      con->left_index++;
+      con->right_index = 0;
+    }
+
+    left_row = (rasqal_row*)raptor_sequence_get_at(con->left_rows,
+                                                   con->left_index);
+    if(!left_row) {
+      con->state = MJS_FINISHED;
+      break;
+    }
+
+    right_row = (rasqal_row*)raptor_sequence_get_at(con->right_rows,
+                                                    con->right_index++);
+    row = rasqal_merge_join_rowsource_merge(rowsource, con,
+                                            left_row, right_row);
+    if(row)
+      return row;
+    if(con->failed)
+      return NULL;
+  }
+
+  while(con->state == MJS_MERGE || con->state == MJS_MERGE_BLOCK) {
+    int cmp;
+
+    if(con->state == MJS_MERGE_BLOCK) {
+      rasqal_row* right_row;
+
+      right_row = (rasqal_row*)raptor_sequence_get_at(con->right_block,
+                                                      con->block_index++);
+      if(right_row) {
+        row = rasqal_merge_join_rowsource_merge(rowsource, con,
+                                                con->left_row, right_row);
+        if(row)
+          return row;
+        if(con->failed)
+          return NULL;
+        continue;
+      }
+
+      /* block done for this left row; the next may have the same key */
+      rasqal_free_row(con->left_row);
+      con->left_row = rasqal_rowsource_read_row(con->left);
+      if(!con->left_row) {
+        con->state = MJS_FINISHED;
+        break;
+      }
+      con->state = MJS_MERGE;
+
+      cmp = rasqal_merge_join_rowsource_compare_keys(rowsource,
+                                                     con->left_row->values[con->left_key],
+                                                     ((rasqal_row*)raptor_sequence_get_at(con->right_block, 0))->values[con->right_key]);
+      if(!cmp) {
+        con->block_index = 0;
+        con->state = MJS_MERGE_BLOCK;
+        continue;
+      }
+    }
+
+    /* find the next block with the key of the left row */
+    if(!con->right_next) {
+      con->state = MJS_FINISHED;
+      break;
+    }
+
+    cmp = rasqal_merge_join_rowsource_compare_keys(rowsource,
+                                                   con->left_row->values[con->left_key],
+                                                   con->right_next->values[con->right_key]);
+    if(cmp < 0) {
+      /* no right rows for this left key */
+      rasqal_free_row(con->left_row);
+      con->left_row = rasqal_rowsource_read_row(con->left);
+      if(!con->left_row) {
+        con->state = MJS_FINISHED;
+        break;
+      }
+    } else if(cmp > 0) {
+      /* no left rows for this right key */
+      rasqal_free_row(con->right_next);
+      con->right_next = rasqal_rowsource_read_row(con->right);
+    } else {
+      if(rasqal_merge_join_rowsource_read_block(rowsource, con))
+        goto failed;
+      con->state = MJS_MERGE_BLOCK;
+    }
+  }
+
+  return NULL;
+
+  failed:
+  con->failed = 1;
+  return NULL;
+}
+
+
+static int
+rasqal_merge_join_rowsource_reset(rasqal_rowsource* rowsource,
+                                  void *user_data)
+{
+  rasqal_merge_join_rowsource_context* con;
+  int rc;
+
+  con = (rasqal_merge_join_rowsource_context*)user_data;
+
+  rasqal_merge_join_rowsource_clear(con);
+
+  con->state = MJS_START;
+  con->failed = 0;
+
+  rc = rasqal_rowsource_reset(con->left);
+  if(rc)
+    return rc;
+
+  return rasqal_rowsource_reset(con->right);
+}
+
+
+static rasqal_rowsource*
+rasqal_merge_join_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource,
+                                                void *user_data, int offset)
+{
+  rasqal_merge_join_rowsource_context *con;
+  con = (rasqal_merge_join_rowsource_context*)user_data;
+
+  if(offset == 0)
+    return con->left;
+  else if(offset == 1)
+    return con->right;
+  else
+    return NULL;
+}
+
+
+static const rasqal_rowsource_handler rasqal_merge_join_rowsource_handler = {
+  /* .version = */ 1,
+  "merge join",
+  /* .init = */ rasqal_merge_join_rowsource_init,
+  /* .finish = */ rasqal_merge_join_rowsource_finish,
+  /* .ensure_variables = */ rasqal_merge_join_rowsource_ensure_variables,
+  /* .read_row = */ rasqal_merge_join_rowsource_read_row,
+  /* .read_all_rows = */ NULL,
+  /* .reset = */ rasqal_merge_join_rowsource_reset,
+  /* .set_requirements = */ NULL,
+  /* .get_inner_rowsource = */ rasqal_merge_join_rowsource_get_inner_rowsource,
+  /* .set_origin = */ NULL,
+  /* .read_batch = */ NULL,
+  /* .get_order = */ NULL,
+  /* .set_outer_variables = */ NULL,
+};
+
+
+/**
+ * rasqal_new_merge_join_rowsource:
+ * @world: world
+ * @query: query
+ * @left: left (first) rowsource in ascending order of @key
+ * @right: right (second) rowsource in ascending order of @key
+ * @key: join variable
+ * @expr: join expression to filter result rows (or NULL)
+ *
+ * INTERNAL - create a new natural JOIN of rowsources sorted on a key
+ *
+ * Both rowsources are read once in step, joining each left row with
+ * the block of right rows that have the same key.  The order of the
+ * inputs is as given by rasqal_rowsource_get_order() so unbound keys
+ * come first; the join falls back to a nested loop over all the rows
+ * if there are any.
+ *
+ * The @left and @right rowsources become owned by the rowsource.
+ *
+ * Return value: new rowsource or NULL on failure
+ */
+rasqal_rowsource*
+rasqal_new_merge_join_rowsource(rasqal_world *world,
+                                rasqal_query* query,
+                                rasqal_rowsource* left,
+                                rasqal_rowsource* right,
+                                rasqal_variable* key,
+                                rasqal_expression *expr)
+{
+  rasqal_merge_join_rowsource_context* con;
+  int flags = 0;
+
+  if(!world || !query || !left || !right || !key)
+    goto fail;
+
+  con = RASQAL_CALLOC(rasqal_merge_join_rowsource_context*, 1, sizeof(*con));
+  if(!con)
+    goto fail;
+
+  con->left = left;
+  con->right = right;
+  con->key = rasqal_new_variable_from_variable(key);
+  con->expr = rasqal_new_expression_from_expression(expr);
+
+  return rasqal_new_rowsource_from_handler(world, query,
+                                           con,
+                                           &rasqal_merge_join_rowsource_handler,
+                                           query->vars_table,
+                                           flags);
+
+  fail:
+  if(left)
+    rasqal_free_rowsource(left);
+  if(right)
+    rasqal_free_rowsource(right);
+  return NULL;
+}
+
+
+#endif /* not STANDALONE */
+
+
+
+#ifdef STANDALONE
+
+/* one more prototype */
+int main(int argc, char *argv[]);
+
+
+/* both in ascending order of a */
+
+const char* const merge_join_1_data_2x5_rows[] =
+{
+  /* 2 variable names and 5 rows */
+  "a",  NULL, "b",     NULL,
+  /* row 1 data */
+  "1",  NULL, "red",   NULL,
+  /* row 2 data */
+  "2",  NULL, "blue",  NULL,
+  /* row 3 data */
+  "2",  NULL, "green", NULL,
+  /* row 4 data */
+  "4",  NULL, "black", NULL,
+  /* row 5 data */
+  "5",  NULL, "white", NULL,
+  /* end of data */
+  NULL, NULL, NULL, NULL
+};
+
+const char* const merge_join_2_data_2x4_rows[] =
+{
+  /* 2 variable names and 4 rows */
+  "a",  NULL, "c",      NULL,
+  /* row 1 data */
+  "2",  NULL, "orange", NULL,
+  /* row 2 data */
+  "3",  NULL, "indigo", NULL,
+  /* row 3 data */
+  "5",  NULL, "yellow", NULL,
+  /* row 4 data */
+  "5",  NULL, "violet", NULL,
+  /* end of data */
+  NULL, NULL, NULL, NULL
+};
+
+/* right with an unbound key first so the join is a nested loop */
+const char* const merge_join_3_data_2x3_rows[] =
+{
+  /* 2 variable names and 3 rows */
+  "a",  NULL, "c",      NULL,
+  /* row 1 data */
+  NULL, NULL, "grey",   NULL,
+  /* row 2 data */
+  "2",  NULL, "orange", NULL,
+  /* row 3 data */
+  "4",  NULL, "indigo", NULL,
+  /* end of data */
+  NULL, NULL, NULL, NULL
+};
+
+
+/* a string key which orders after all numbers */
+const char* const merge_join_4_data_2x1_rows[] =
+{
+  /* 2 variable names and 1 row */
+  "a",  NULL, "b",      NULL,
+  /* row 1 data */
+  "x",  NULL, "red",    NULL,
+  /* end of data */
+  NULL, NULL, NULL, NULL
+};
+
+/* numbers then a string in ascending order of a */
+const char* const merge_join_5_data_2x3_rows[] =
+{
+  /* 2 variable names and 3 rows */
+  "a",  NULL, "c",      NULL,
+  /* row 1 data */
+  "5",  NULL, "orange", NULL,
+  /* row 2 data */
+  "7",  NULL, "indigo", NULL,
+  /* row 3 data */
+  "x",  NULL, "yellow", NULL,
+  /* end of data */
+  NULL, NULL, NULL, NULL
+};
+
+
+typedef struct {
+  const char* const* left_data;
+  const char* const* right_data;
+  int expected;
+} merge_join_test_config_type;
+
+#define MERGE_JOIN_TESTS_COUNT 3
+const merge_join_test_config_type merge_join_test_config[MERGE_JOIN_TESTS_COUNT] = {
+  /* a=2 twice by once and a=5 once by twice */
+  { merge_join_1_data_2x5_rows, merge_join_2_data_2x4_rows, 4 },
+  /* unbound a with all 5, a=2 twice and a=4 once */
+  { merge_join_1_data_2x5_rows, merge_join_3_data_2x3_rows, 8 },
+  /* a="x" once by once after skipping the numbers */
+  { merge_join_4_data_2x1_rows, merge_join_5_data_2x3_rows, 1 }
+};
+
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  rasqal_rowsource *rowsource = NULL;
+  rasqal_rowsource *left_rs = NULL;
+  rasqal_rowsource *right_rs = NULL;
+  rasqal_world* world = NULL;
+  rasqal_query* query = NULL;
+  int count;
+  raptor_sequence* seq = NULL;
+  int failures = 0;
+  rasqal_variables_table* vt;
+  raptor_sequence* vars_seq = NULL;
+  rasqal_variable* key;
+  int test_count;
+
+  world = rasqal_new_world(); rasqal_world_open(world);
+
+  query = rasqal_new_query(world, "sparql", NULL);
+
+  vt = query->vars_table;
+
+  for(test_count = 0; test_count < MERGE_JOIN_TESTS_COUNT; test_count++) {
+    int expected_count = merge_join_test_config[test_count].expected;
+
+    seq = rasqal_new_row_sequence(world, vt,
+                                  merge_join_test_config[test_count].left_data,
+                                  2, &vars_seq);
+    if(!seq) {
+      fprintf(stderr, "%s: failed to create left sequence\n", program);
+      failures++;
+      goto tidy;
+    }
+
+    left_rs = rasqal_new_rowsequence_rowsource(world, query, vt, seq, vars_seq);
+    if(!left_rs) {
+      fprintf(stderr, "%s: failed to create left rowsource\n", program);
+      failures++;
+      goto tidy;
+    }
+    /* vars_seq and seq are now owned by left_rs */
+    vars_seq = seq = NULL;
+
+    seq = rasqal_new_row_sequence(world, vt,
+                                  merge_join_test_config[test_count].right_data,
+                                  2, &vars_seq);
+    if(!seq) {
+      fprintf(stderr, "%s: failed to create right sequence\n", program);
+      failures++;
+      goto tidy;
+    }
+
+    right_rs = rasqal_new_rowsequence_rowsource(world, query, vt, seq, vars_seq);
+    if(!right_rs) {
+      fprintf(stderr, "%s: failed to create right rowsource\n", program);
+      failures++;
+      goto tidy;
+    }
+    /* vars_seq and seq are now owned by right_rs */
+    vars_seq = seq = NULL;
+
+    key = rasqal_variables_table_get_by_name(vt, RASQAL_VARIABLE_TYPE_NORMAL,
+                                             RASQAL_GOOD_CAST(const unsigned char*, "a"));
+
+    rowsource = rasqal_new_merge_join_rowsource(world, query, left_rs, right_rs,
+                                                key, NULL);
+    /* left_rs and right_rs are now owned by rowsource */
+    left_rs = right_rs = NULL;
+    if(!rowsource) {
+      fprintf(stderr, "%s: failed to create merge join rowsource\n", program);
+      failures++;
+      goto tidy;
+    }
+
+    seq = rasqal_rowsource_read_all_rows(rowsource);
+    if(!seq) {
+      fprintf(stderr,
+              "%s: read_rows returned a NULL seq for a merge join rowsource\n",
+              program);
+      failures++;
+      goto tidy;
+    }
+    count = raptor_sequence_size(seq);
+    if(count != expected_count) {
+      fprintf(stderr,
+              "%s: test #%d read_rows returned %d rows for a merge join rowsource, expected %d\n",
+              program, test_count, count, expected_count);
+      failures++;
+      goto tidy;
+    }
+
+#ifdef RASQAL_DEBUG
+    rasqal_rowsource_print_row_sequence(rowsource, seq, DEBUG_FH);
+#endif
+
+    raptor_free_sequence(seq); seq = NULL;
+    rasqal_free_rowsource(rowsource); rowsource = NULL;
+  }
+
+  tidy:
+  if(seq)
+    raptor_free_sequence(seq);
+  if(vars_seq)
+    raptor_free_sequence(vars_seq);
+  if(left_rs)
+    rasqal_free_rowsource(left_rs);
+  if(right_rs)
+    rasqal_free_rowsource(right_rs);
+  if(rowsource)
+    rasqal_free_rowsource(rowsource);
+  if(query)
+    rasqal_free_query(query);
+  if(world)
+    rasqal_free_world(world);
+
+  return failures;
+}
+
+#endif /* STANDALONE */
@@ -0,0 +1,942 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_rowsource_minus.c - Rasqal MINUS rowsource class
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#include <raptor.h>
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+
+#define DEBUG_FH stderr
+
+#ifndef STANDALONE
+
+/* terms are compared as RDF terms, as for SPARQL solution compatibility */
+#define RASQAL_MINUS_COMPARE_FLAGS RASQAL_COMPARE_RDF
+
+/* initial number of slots in the complete keys table; must be a power of 2 */
+#define RASQAL_MINUS_TABLE_INITIAL_SIZE 64
+
+
+/*
+ * rasqal_minus_key:
+ * @size: number of shared variables
+ * @values: values of the shared variables (NULL when unbound)
+ * @hash: hash of @values
+ *
+ * INTERNAL - values of the shared variables from one right row
+ */
+typedef struct {
+  int size;
+  rasqal_literal** values;
+  uint64_t hash;
+} rasqal_minus_key;
+
+
+typedef struct
+{
+  rasqal_rowsource* left;
+
+  rasqal_rowsource* right;
+
+  /* number of variables in both left and right rowsources */
+  int shared_count;
+
+  /* offsets of shared variables in left rows and right rows */
+  int* left_offsets;
+  int* right_offsets;
+
+  /* open addressing table of keys of right rows with all shared
+   * variables bound; NULL slots are empty */
+  rasqal_minus_key** keys;
+
+  /* number of slots in @keys; a power of 2 */
+  size_t keys_size;
+
+  /* number of keys in @keys */
+  size_t keys_count;
+
+  /* keys of right rows with some shared variables unbound */
+  raptor_sequence* partial_keys;
+
+  /* non-0 when the right rowsource has been read into the index */
+  int indexed;
+
+  /* key of the current left row; values are not owned */
+  rasqal_minus_key left_key;
+
+  int failed;
+
+  /* row offset for read_row() */
+  int offset;
+} rasqal_minus_rowsource_context;
+
+
+static void
+rasqal_free_minus_key(rasqal_minus_key* key)
+{
+  int i;
+
+  if(!key)
+    return;
+
+  if(key->values) {
+    for(i = 0; i < key->size; i++) {
+      if(key->values[i])
+        rasqal_free_literal(key->values[i]);
+    }
+    RASQAL_FREE(rasqal_literal**, key->values);
+  }
+
+  RASQAL_FREE(rasqal_minus_key, key);
+}
+
+
+/*
+ * rasqal_minus_key_equals:
+ * @a: first key
+ * @b: second key
+ *
+ * INTERNAL - check if two complete keys have equal values
+ *
+ * Return value: non-0 if equal
+ */
+static int
+rasqal_minus_key_equals(rasqal_minus_key* a, rasqal_minus_key* b)
+{
+  int i;
+
+  for(i = 0; i < a->size; i++) {
+    int error = 0;
+
+    if(!rasqal_literal_equals_flags(a->values[i], b->values[i],
+                                    RASQAL_MINUS_COMPARE_FLAGS, &error) ||
+       error)
+      return 0;
+  }
+
+  return 1;
+}
+
+
+/*
+ * rasqal_minus_key_matches:
+ * @left_key: key of left row
+ * @right_key: key of right row
+ *
+ * INTERNAL - check if a right row removes a left row
+ *
+ * Following SPARQL 1.1 MINUS, a left row is removed by a right row
+ * that is compatible with it and that binds at least one variable
+ * that the left row also binds.
+ *
+ * Return value: non-0 if the rows are compatible with shared domain
+ */
+static int
+rasqal_minus_key_matches(rasqal_minus_key* left_key,
+                         rasqal_minus_key* right_key)
+{
+  int shared = 0;
+  int i;
+
+  for(i = 0; i < left_key->size; i++) {
+    int error = 0;
+
+    if(!left_key->values[i] || !right_key->values[i])
+      continue;
+
+    if(!rasqal_literal_equals_flags(left_key->values[i], right_key->values[i],
+                                    RASQAL_MINUS_COMPARE_FLAGS, &error) ||
+       error)
+      return 0;
+
+    shared = 1;
+  }
+
+  return shared;
+}
+
+
+static int
+rasqal_minus_rowsource_init(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_minus_rowsource_context* con;
+
+  con = (rasqal_minus_rowsource_context*)user_data;
+
+  con->failed = 0;
+  con->offset = 0;
+
+  return 0;
+}
+
+
+static int
+rasqal_minus_rowsource_finish(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_minus_rowsource_context* con;
+  con = (rasqal_minus_rowsource_context*)user_data;
+
+  if(con->left)
+    rasqal_free_rowsource(con->left);
+
+  if(con->right)
+    rasqal_free_rowsource(con->right);
+
+  if(con->left_offsets)
+    RASQAL_FREE(intarray, con->left_offsets);
+
+  if(con->right_offsets)
+    RASQAL_FREE(intarray, con->right_offsets);
+
+  if(con->keys) {
+    size_t i;
+
+    for(i = 0; i < con->keys_size; i++) {
+      if(con->keys[i])
+        rasqal_free_minus_key(con->keys[i]);
+    }
+    RASQAL_FREE(rasqal_minus_key**, con->keys);
+  }
+
+  if(con->partial_keys)
+    raptor_free_sequence(con->partial_keys);
+
+  if(con->left_key.values)
+    RASQAL_FREE(rasqal_literal**, con->left_key.values);
+
+  RASQAL_FREE(rasqal_minus_rowsource_context, con);
+
+  return 0;
+}
+
+
+static int
+rasqal_minus_rowsource_ensure_variables(rasqal_rowsource* rowsource,
+                                        void *user_data)
+{
+  rasqal_minus_rowsource_context* con;
+  int right_size;
+  int i;
+
+  con = (rasqal_minus_rowsource_context*)user_data;
+
+  if(rasqal_rowsource_ensure_variables(con->left))
+    return 1;
+
+  if(rasqal_rowsource_ensure_variables(con->right))
+    return 1;
+
+  /* result rows have exactly the left variables */
+  rowsource->size = 0;
+  if(rasqal_rowsource_copy_variables(rowsource, con->left))
+    return 1;
+
+  right_size = rasqal_rowsource_get_size(con->right);
+  if(right_size > 0) {
+    con->left_offsets = RASQAL_CALLOC(int*, RASQAL_GOOD_CAST(size_t, right_size),
+                                      sizeof(int));
+    con->right_offsets = RASQAL_CALLOC(int*, RASQAL_GOOD_CAST(size_t, right_size),
+                                       sizeof(int));
+    if(!con->left_offsets || !con->right_offsets)
+      return 1;
+  }
+
+  con->shared_count = 0;
+  for(i = 0; i < right_size; i++) {
+    rasqal_variable* v;
+    int offset;
+
+    v = rasqal_rowsource_get_variable_by_offset(con->right, i);
+    if(!v)
+      return 1;
+
+    offset = rasqal_rowsource_get_variable_offset_by_name(con->left, v->name);
+    if(offset < 0)
+      continue;
+
+    con->left_offsets[con->shared_count] = offset;
+    con->right_offsets[con->shared_count] = i;
+    con->shared_count++;
+  }
+
+  if(con->shared_count) {
+    con->left_key.size = con->shared_count;
+    con->left_key.values = RASQAL_CALLOC(rasqal_literal**,
+                                         RASQAL_GOOD_CAST(size_t, con->shared_count),
+                                         sizeof(rasqal_literal*));
+    if(!con->left_key.values)
+      return 1;
+  }
+
+  RASQAL_DEBUG3("minus rowsource %p has %d shared variables\n", rowsource,
+                con->shared_count);
+
+  return 0;
+}
+
+
+/*
+ * rasqal_minus_rowsource_find_key:
+ * @con: minus rowsource context
+ * @key: complete key with its hash set
+ *
+ * INTERNAL - Find the slot of a complete key in the keys table
+ *
+ * Return value: slot holding an equal key or the empty slot where it belongs
+ */
+static size_t
+rasqal_minus_rowsource_find_key(rasqal_minus_rowsource_context* con,
+                                rasqal_minus_key* key)
+{
+  size_t slot;
+
+  for(slot = RASQAL_GOOD_CAST(size_t, key->hash) & (con->keys_size - 1);
+      con->keys[slot];
+      slot = (slot + 1) & (con->keys_size - 1)) {
+    if(con->keys[slot]->hash == key->hash &&
+       rasqal_minus_key_equals(con->keys[slot], key))
+      break;
+  }
+
+  return slot;
+}
+
+
+/*
+ * rasqal_minus_rowsource_grow_keys:
+ * @con: minus rowsource context
+ *
+ * INTERNAL - Double the size of the keys table
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_minus_rowsource_grow_keys(rasqal_minus_rowsource_context* con)
+{
+  size_t new_size = con->keys_size << 1;
+  rasqal_minus_key** new_keys;
+  size_t i;
+
+  new_keys = RASQAL_CALLOC(rasqal_minus_key**, new_size, sizeof(*new_keys));
+  if(!new_keys)
+    return 1;
+
+  for(i = 0; i < con->keys_size; i++) {
+    rasqal_minus_key* key = con->keys[i];
+    size_t slot;
+
+    if(!key)
+      continue;
+
+    slot = RASQAL_GOOD_CAST(size_t, key->hash) & (new_size - 1);
+    while(new_keys[slot])
+      slot = (slot + 1) & (new_size - 1);
+    new_keys[slot] = key;
+  }
+
+  RASQAL_FREE(rasqal_minus_key**, con->keys);
+  con->keys = new_keys;
+  con->keys_size = new_size;
+
+  return 0;
+}
+
+
+/*
+ * rasqal_minus_rowsource_build_index:
+ * @rowsource: minus rowsource
+ * @con: minus rowsource context
+ *
+ * INTERNAL - Read all right rows into an index of shared variable values
+ *
+ * Right rows with every shared variable bound go into a hash table
+ * keyed on the shared values so that a left row with all shared
+ * variables bound needs one lookup.  The remaining right rows are
+ * kept in a list and checked one by one.  Duplicate keys are dropped.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_minus_rowsource_build_index(rasqal_rowsource* rowsource,
+                                   rasqal_minus_rowsource_context* con)
+{
+  con->keys_size = RASQAL_MINUS_TABLE_INITIAL_SIZE;
+  con->keys_count = 0;
+  con->keys = RASQAL_CALLOC(rasqal_minus_key**, con->keys_size,
+                            sizeof(*con->keys));
+  con->partial_keys = raptor_new_sequence((raptor_data_free_handler)rasqal_free_minus_key,
+                                          NULL);
+  if(!con->keys || !con->partial_keys)
+    return 1;
+
+  while(1) {
+    rasqal_row* row;
+    rasqal_minus_key* key;
+    int complete = 1;
+    int bound = 0;
+    int i;
+
+    row = rasqal_rowsource_read_row(con->right);
+    if(!row)
+      break;
+
+    key = RASQAL_CALLOC(rasqal_minus_key*, 1, sizeof(*key));
+    if(!key) {
+      rasqal_free_row(row);
+      return 1;
+    }
+    key->size = con->shared_count;
+    key->values = RASQAL_CALLOC(rasqal_literal**,
+                                RASQAL_GOOD_CAST(size_t, con->shared_count),
+                                sizeof(rasqal_literal*));
+    if(!key->values) {
+      rasqal_free_minus_key(key);
+      rasqal_free_row(row);
+      return 1;
+    }
+
+    for(i = 0; i < con->shared_count; i++) {
+      rasqal_literal* l = row->values[con->right_offsets[i]];
+
+      if(l) {
+        key->values[i] = rasqal_new_literal_from_literal(l);
+        bound++;
+      } else
+        complete = 0;
+    }
+
+    /* hash agrees with rasqal_minus_key_equals() */
+    key->hash = rasqal_row_hash_by_offsets(row, con->right_offsets,
+                                           con->shared_count,
+                                           RASQAL_MINUS_COMPARE_FLAGS);
+
+    rasqal_free_row(row);
+
+    if(!bound) {
+      /* disjoint domain with every left row so never removes one */
+      rasqal_free_minus_key(key);
+    } else if(complete) {
+      size_t slot;
+
+      /* keep the table at most half full */
+      if((con->keys_count + 1) << 1 > con->keys_size &&
+         rasqal_minus_rowsource_grow_keys(con)) {
+        rasqal_free_minus_key(key);
+        return 1;
+      }
+
+      slot = rasqal_minus_rowsource_find_key(con, key);
+      if(con->keys[slot])
+        rasqal_free_minus_key(key);
+      else {
+        con->keys[slot] = key;
+        con->keys_count++;
+      }
+    } else {
+      if(raptor_sequence_push(con->partial_keys, key))
+        return 1;
+    }
+  }
+
+  RASQAL_DEBUG4("minus rowsource %p indexed %d complete and %d partial right rows\n",
+                rowsource, RASQAL_GOOD_CAST(int, con->keys_count),
+                raptor_sequence_size(con->partial_keys));
+
+  con->indexed = 1;
+
+  return 0;
+}
+
+
+/*
+ * rasqal_minus_rowsource_is_removed:
+ * @con: minus rowsource context
+ * @row: left row
+ *
+ * INTERNAL - check if any right row removes a left row
+ *
+ * Return value: non-0 if @row is not part of the result
+ */
+static int
+rasqal_minus_rowsource_is_removed(rasqal_minus_rowsource_context* con,
+                                  rasqal_row* row)
+{
+  rasqal_minus_key* left_key = &con->left_key;
+  rasqal_minus_key* key;
+  int complete = 1;
+  int bound = 0;
+  int i;
+
+  for(i = 0; i < con->shared_count; i++) {
+    rasqal_literal* l = row->values[con->left_offsets[i]];
+
+    left_key->values[i] = l;
+    if(l)
+      bound++;
+    else
+      complete = 0;
+  }
+
+  if(!bound)
+    return 0;
+
+  if(complete) {
+    left_key->hash = rasqal_row_hash_by_offsets(row, con->left_offsets,
+                                                con->shared_count,
+                                                RASQAL_MINUS_COMPARE_FLAGS);
+    if(con->keys[rasqal_minus_rowsource_find_key(con, left_key)])
+      return 1;
+  } else {
+    /* some shared variables unbound: a complete right row matches
+     * on the bound subset so scan them all
+     */
+    size_t slot;
+
+    for(slot = 0; slot < con->keys_size; slot++) {
+      key = con->keys[slot];
+      if(key && rasqal_minus_key_matches(left_key, key))
+        return 1;
+    }
+  }
+
+  for(i = 0; (key = (rasqal_minus_key*)raptor_sequence_get_at(con->partial_keys, i)); i++) {
+    if(rasqal_minus_key_matches(left_key, key))
+      return 1;
+  }
+
+  return 0;
+}
+
+
+static rasqal_row*
+rasqal_minus_rowsource_read_row(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_minus_rowsource_context* con;
+  rasqal_row* row = NULL;
+
+  con = (rasqal_minus_rowsource_context*)user_data;
+
+  if(con->failed)
+    return NULL;
+
+  if(con->shared_count && !con->indexed) {
+    if(rasqal_minus_rowsource_build_index(rowsource, con)) {
+      con->failed = 1;
+      return NULL;
+    }
+  }
+
+  while(1) {
+    row = rasqal_rowsource_read_row(con->left);
+    if(!row)
+      break;
+
+    /* with no shared variables every domain is disjoint */
+    if(!con->shared_count || !rasqal_minus_rowsource_is_removed(con, row))
+      break;
+
+#ifdef RASQAL_DEBUG
+    RASQAL_DEBUG2("rowsource %p removed left row : ", rowsource);
+    rasqal_row_print(row, DEBUG_FH);
+    fputc('\n', DEBUG_FH);
+#endif
+
+    rasqal_free_row(row);
+  }
+
+  if(row) {
+    rasqal_row_set_rowsource(row, rowsource);
+    row->offset = con->offset++;
+
+    rasqal_row_bind_variables(row, rowsource->query->vars_table);
+  }
+
+  return row;
+}
+
+
+static int
+rasqal_minus_rowsource_reset(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_minus_rowsource_context* con;
+
+  con = (rasqal_minus_rowsource_context*)user_data;
+
+  con->failed = 0;
+  con->offset = 0;
+
+  /* the right rows do not depend on the left rows so the index is kept */
+  return rasqal_rowsource_reset(con->left);
+}
+
+
+static rasqal_rowsource*
+rasqal_minus_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource,
+                                           void *user_data, int offset)
+{
+  rasqal_minus_rowsource_context *con;
+  con = (rasqal_minus_rowsource_context*)user_data;
+
+  if(offset == 0)
+    return con->left;
+  else if(offset == 1)
+    return con->right;
+  else
+    return NULL;
+}
+
+
+static const rasqal_rowsource_handler rasqal_minus_rowsource_handler = {
+  /* .version = */ 1,
+  "minus",
+  /* .init = */ rasqal_minus_rowsource_init,
+  /* .finish = */ rasqal_minus_rowsource_finish,
+  /* .ensure_variables = */ rasqal_minus_rowsource_ensure_variables,
+  /* .read_row = */ rasqal_minus_rowsource_read_row,
+  /* .read_all_rows = */ NULL,
+  /* .reset = */ rasqal_minus_rowsource_reset,
+  /* .set_requirements = */ NULL,
+  /* .get_inner_rowsource = */ rasqal_minus_rowsource_get_inner_rowsource,
+  /* .set_origin = */ NULL,
+  /* .read_batch = */ NULL,
+  /* .get_order = */ NULL,
+  /* .set_outer_variables = */ NULL,
+};
+
+
+/**
+ * rasqal_new_minus_rowsource:
+ * @world: world object
+ * @query: query object
+ * @left: input left (first) rowsource
+ * @right: input right (second) rowsource
+ *
+ * INTERNAL - create a new MINUS over two rowsources
+ *
+ * Returns the rows of @left that are not removed by a row of @right
+ * using SPARQL 1.1 MINUS semantics.  The right rowsource is read once
+ * into an index keyed on the variables shared with the left rowsource
+ * and the left rows are then streamed through it, so the cost is
+ * linear in the input sizes when shared variables are bound.
+ *
+ * The @left and @right rowsources become owned by the rowsource.
+ *
+ * Return value: new rowsource or NULL on failure
+ */
+rasqal_rowsource*
+rasqal_new_minus_rowsource(rasqal_world *world,
+                           rasqal_query* query,
+                           rasqal_rowsource* left,
+                           rasqal_rowsource* right)
+{
+  rasqal_minus_rowsource_context* con;
+  int flags = 0;
+
+  if(!world || !query || !left || !right)
+    goto fail;
+
+  con = RASQAL_CALLOC(rasqal_minus_rowsource_context*, 1, sizeof(*con));
+  if(!con)
+    goto fail;
+
+  con->left = left;
+  con->right = right;
+
+  return rasqal_new_rowsource_from_handler(world, query,
+                                           con,
+                                           &rasqal_minus_rowsource_handler,
+                                           query->vars_table,
+                                           flags);
+
+  fail:
+  if(left)
+    rasqal_free_rowsource(left);
+  if(right)
+    rasqal_free_rowsource(right);
+  return NULL;
+}
+
+
+#endif /* not STANDALONE */
+
+
+
+#ifdef STANDALONE
+
+/* one more prototype */
+int main(int argc, char *argv[]);
+
+
+const char* const minus_1_data_2x4_rows[] =
+{
+  /* 2 variable names and 4 rows */
+  "a",   NULL, "b",   NULL,
+  /* row 1 data */
+  "foo", NULL, "red", NULL,
+  /* row 2 data */
+  "baz", NULL, "blue", NULL,
+  /* row 3 data */
+  "bob", NULL, "green", NULL,
+  /* row 4 data */
+  "sue", NULL, NULL, NULL,
+  /* end of data */
+  NULL, NULL, NULL, NULL
+};
+
+
+/* minus on b */
+
+const char* const minus_2_data_2x3_rows[] =
+{
+  /* 2 variable names and 3 rows */
+  "b",     NULL, "c",      NULL,
+  /* row 1 data */
+  "red",   NULL, "orange", NULL,
+  /* row 2 data */
+  "blue",  NULL, "indigo", NULL,
+  /* row 3 data */
+  NULL,    NULL, "violet", NULL,
+  /* end of data */
+  NULL, NULL, NULL, NULL
+};
+
+
+/* no shared variables */
+
+const char* const minus_3_data_1x2_rows[] =
+{
+  /* 1 variable name and 2 rows */
+  "d",     NULL,
+  /* row 1 data */
+  "red",   NULL,
+  /* row 2 data */
+  "blue",  NULL,
+  /* end of data */
+  NULL, NULL
+};
+
+
+/* minus on b with a duplicated key */
+
+const char* const minus_4_data_2x3_rows[] =
+{
+  /* 2 variable names and 3 rows */
+  "b",     NULL, "c",      NULL,
+  /* row 1 data */
+  "red",   NULL, "orange", NULL,
+  /* row 2 data */
+  "green", NULL, "yellow", NULL,
+  /* row 3 data */
+  "red",   NULL, "indigo", NULL,
+  /* end of data */
+  NULL, NULL, NULL, NULL
+};
+
+
+typedef struct {
+  const char* const* right_data;
+  int right_vars_count;
+  int expected;
+} minus_test_config_type;
+
+#define MINUS_TESTS_COUNT 3
+const minus_test_config_type minus_test_config[MINUS_TESTS_COUNT] = {
+  /* removes red and blue; unbound b and disjoint domains are kept */
+  { minus_2_data_2x3_rows, 2, 2 },
+  /* disjoint domains remove nothing */
+  { minus_3_data_1x2_rows, 1, 4 },
+  /* removes red and green once each whatever the duplicates */
+  { minus_4_data_2x3_rows, 2, 2 }
+};
+
+
+#define EXPECTED_COLUMNS_COUNT 2
+const char* const minus_result_vars[] = { "a" , "b" };
+
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  rasqal_rowsource *rowsource = NULL;
+  rasqal_rowsource *left_rs = NULL;
+  rasqal_rowsource *right_rs = NULL;
+  rasqal_world* world = NULL;
+  rasqal_query* query = NULL;
+  int count;
+  raptor_sequence* seq = NULL;
+  int failures = 0;
+  rasqal_variables_table* vt;
+  int size;
+  int i;
+  raptor_sequence* vars_seq = NULL;
+  int test_count;
+
+  world = rasqal_new_world(); rasqal_world_open(world);
+
+  query = rasqal_new_query(world, "sparql", NULL);
+
+  vt = query->vars_table;
+
+  for(test_count = 0; test_count < MINUS_TESTS_COUNT; test_count++) {
+    const minus_test_config_type* config = &minus_test_config[test_count];
+    int vars_count;
+
+    fprintf(stderr, "%s: test #%d\n", program, test_count);
+
+    vars_count = 2;
+    seq = rasqal_new_row_sequence(world, vt, minus_1_data_2x4_rows,
+                                  vars_count, &vars_seq);
+    if(!seq) {
+      fprintf(stderr,
+              "%s: failed to create left sequence of %d vars\n", program,
+              vars_count);
+      failures++;
+      goto tidy;
+    }
+
+    left_rs = rasqal_new_rowsequence_rowsource(world, query, vt, seq, vars_seq);
+    if(!left_rs) {
+      fprintf(stderr, "%s: failed to create left rowsource\n", program);
+      failures++;
+      goto tidy;
+    }
+    /* vars_seq and seq are now owned by left_rs */
+    vars_seq = seq = NULL;
+
+    vars_count = config->right_vars_count;
+    seq = rasqal_new_row_sequence(world, vt, config->right_data, vars_count,
+                                  &vars_seq);
+    if(!seq) {
+      fprintf(stderr,
+              "%s: failed to create right sequence of %d vars\n", program,
+              vars_count);
+      failures++;
+      goto tidy;
+    }
+
+    right_rs = rasqal_new_rowsequence_rowsource(world, query, vt, seq, vars_seq);
+    if(!right_rs) {
+      fprintf(stderr, "%s: failed to create right rowsource\n", program);
+      failures++;
+      goto tidy;
+    }
+    /* vars_seq and seq are now owned by right_rs */
+    vars_seq = seq = NULL;
+
+    rowsource = rasqal_new_minus_rowsource(world, query, left_rs, right_rs);
+    if(!rowsource) {
+      fprintf(stderr, "%s: failed to create minus rowsource\n", program);
+      failures++;
+      goto tidy;
+    }
+    /* left_rs and right_rs are now owned by rowsource */
+    left_rs = right_rs = NULL;
+
+    seq = rasqal_rowsource_read_all_rows(rowsource);
+    if(!seq) {
+      fprintf(stderr,
+              "%s: read_rows returned a NULL seq for a minus rowsource\n",
+              program);
+      failures++;
+      goto tidy;
+    }
+    count = raptor_sequence_size(seq);
+    if(count != config->expected) {
+      fprintf(stderr,
+              "%s: read_rows returned %d rows for a minus rowsource, expected %d\n",
+              program, count, config->expected);
+      failures++;
+      goto tidy;
+    }
+
+    size = rasqal_rowsource_get_size(rowsource);
+    if(size != EXPECTED_COLUMNS_COUNT) {
+      fprintf(stderr,
+              "%s: read_rows returned %d columns (variables) for a minus rowsource, expected %d\n",
+              program, size, EXPECTED_COLUMNS_COUNT);
+      failures++;
+      goto tidy;
+    }
+    for(i = 0; i < EXPECTED_COLUMNS_COUNT; i++) {
+      rasqal_variable* v;
+      const char* name = NULL;
+      const char *expected_name = minus_result_vars[i];
+
+      v = rasqal_rowsource_get_variable_by_offset(rowsource, i);
+      if(!v) {
+        fprintf(stderr,
+              "%s: read_rows had NULL column (variable) #%d expected %s\n",
+                program, i, expected_name);
+        failures++;
+        goto tidy;
+      }
+      name = RASQAL_GOOD_CAST(const char*, v->name);
+      if(strcmp(name, expected_name)) {
+        fprintf(stderr,
+              "%s: read_rows returned column (variable) #%d %s but expected %s\n",
+                program, i, name, expected_name);
+        failures++;
+        goto tidy;
+      }
+    }
+
+#ifdef RASQAL_DEBUG
+    rasqal_rowsource_print_row_sequence(rowsource, seq, DEBUG_FH);
+#endif
+
+    raptor_free_sequence(seq); seq = NULL;
+    rasqal_free_rowsource(rowsource); rowsource = NULL;
+  }
+
+  tidy:
+  if(seq)
+    raptor_free_sequence(seq);
+  if(left_rs)
+    rasqal_free_rowsource(left_rs);
+  if(right_rs)
+    rasqal_free_rowsource(right_rs);
+  if(rowsource)
+    rasqal_free_rowsource(rowsource);
+  if(query)
+    rasqal_free_query(query);
+  if(world)
+    rasqal_free_world(world);
+
+  return failures;
+}
+
+#endif /* STANDALONE */
@@ -0,0 +1,1221 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_rowsource_path.c - Rasqal property path rowsource class
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#include <raptor.h>
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+
+#define DEBUG_FH stderr
+
+/* path nodes are compared as RDF terms */
+#define RASQAL_PATH_COMPARE_FLAGS (RASQAL_COMPARE_RDF | RASQAL_COMPARE_URI)
+
+
+/*
+ * rasqal_path_node_set:
+ * @tree: the nodes for membership tests and owner of the literals or
+ *   NULL if duplicates are kept
+ * @nodes: the nodes in the order they were added; owns the literals
+ *   if @tree is NULL
+ *
+ * INTERNAL - set or multiset of RDF terms reached by a path
+ *
+ * Nodes may be added while @nodes is being walked by index, which
+ * is how the breadth first search queue is kept.
+ */
+typedef struct {
+  raptor_avltree* tree;
+  raptor_sequence* nodes;
+} rasqal_path_node_set;
+
+
+/*
+ * rasqal_path_edges:
+ * @node: node at one end of the edges
+ * @neighbours: sequence of #rasqal_literal nodes at the other ends
+ *
+ * INTERNAL - adjacency list of one node for one predicate
+ */
+typedef struct {
+  rasqal_literal* node;
+  raptor_sequence* neighbours;
+} rasqal_path_edges;
+
+
+/*
+ * rasqal_path_link_index:
+ * @predicate: predicate IRI
+ * @forward: #rasqal_path_edges from subjects to objects
+ * @backward: #rasqal_path_edges from objects to subjects
+ * @nodes: all subjects and objects of triples with @predicate
+ *
+ * INTERNAL - edges of the graph for one predicate
+ */
+typedef struct {
+  rasqal_literal* predicate;
+  raptor_avltree* forward;
+  raptor_avltree* backward;
+  rasqal_path_node_set* nodes;
+} rasqal_path_link_index;
+
+
+typedef struct {
+  rasqal_literal* subject;
+  rasqal_literal* object;
+} rasqal_path_solution;
+
+
+typedef struct
+{
+  /* source of triple pattern matches */
+  rasqal_triples_source* triples_source;
+
+  /* sequence of triples SHARED with query */
+  raptor_sequence* triples;
+
+  /* column of the property path triple in @triples */
+  int column;
+
+  /* the property path triple */
+  rasqal_triple* triple;
+
+  /* variables at the ends of the path bound here (or NULL) */
+  rasqal_variable* subject_var;
+  rasqal_variable* object_var;
+
+  /* GRAPH origin to use */
+  rasqal_literal *origin;
+
+  /* sequence of #rasqal_path_link_index built on first use of each
+   * predicate and kept over resets */
+  raptor_sequence* indexes;
+
+  /* all nodes of the graph; only built for paths that can have zero
+   * length when neither end is fixed */
+  rasqal_path_node_set* graph_nodes;
+
+  /* private variables for scanning the triples source */
+  rasqal_variables_table* scan_vars_table;
+  rasqal_literal* scan_literals[3];
+
+  /* sequence of #rasqal_path_solution for the current reset */
+  raptor_sequence* solutions;
+  int solutions_index;
+
+  int failed;
+
+  /* row offset for read_row() */
+  int offset;
+} rasqal_path_rowsource_context;
+
+
+static int
+rasqal_path_node_compare(const void* a, const void* b)
+{
+  int error = 0;
+
+  return rasqal_literal_compare((rasqal_literal*)a, (rasqal_literal*)b,
+                                RASQAL_PATH_COMPARE_FLAGS, &error);
+}
+
+
+static void
+rasqal_free_path_node_set(rasqal_path_node_set* set)
+{
+  if(!set)
+    return;
+
+  if(set->nodes)
+    raptor_free_sequence(set->nodes);
+  if(set->tree)
+    raptor_free_avltree(set->tree);
+
+  RASQAL_FREE(rasqal_path_node_set, set);
+}
+
+
+/*
+ * rasqal_new_path_node_set:
+ * @distinct: non-0 for a set, 0 for a multiset that keeps duplicates
+ *
+ * INTERNAL - Constructor for an empty node set
+ *
+ * Return value: new node set or NULL on failure
+ */
+static rasqal_path_node_set*
+rasqal_new_path_node_set(int distinct)
+{
+  rasqal_path_node_set* set;
+
+  set = RASQAL_CALLOC(rasqal_path_node_set*, 1, sizeof(*set));
+  if(!set)
+    return NULL;
+
+  if(distinct) {
+    set->tree = raptor_new_avltree(rasqal_path_node_compare,
+                                   (raptor_data_free_handler)rasqal_free_literal,
+                                   /* flags */ 0);
+    if(!set->tree)
+      goto fail;
+
+    set->nodes = raptor_new_sequence(NULL,
+                                     (raptor_data_print_handler)rasqal_literal_print);
+  } else
+    set->nodes = raptor_new_sequence((raptor_data_free_handler)rasqal_free_literal,
+                                     (raptor_data_print_handler)rasqal_literal_print);
+  if(!set->nodes)
+    goto fail;
+
+  return set;
+
+  fail:
+  rasqal_free_path_node_set(set);
+  return NULL;
+}
+
+
+/*
+ * rasqal_path_node_set_add:
+ * @set: node set
+ * @node: node to add (copied)
+ *
+ * INTERNAL - Add a node to a node set
+ *
+ * A set only adds a node that is not already present.
+ *
+ * Return value: <0 on failure, 0 if added, >0 if already present
+ */
+static int
+rasqal_path_node_set_add(rasqal_path_node_set* set, rasqal_literal* node)
+{
+  if(set->tree && raptor_avltree_search(set->tree, node))
+    return 1;
+
+  node = rasqal_new_literal_from_literal(node);
+  if(!node)
+    return -1;
+
+  if(set->tree && raptor_avltree_add(set->tree, node))
+    return -1;
+
+  if(raptor_sequence_push(set->nodes, node))
+    return -1;
+
+  return 0;
+}
+
+
+/*
+ * rasqal_path_node_set_count:
+ * @set: node set
+ * @node: node
+ *
+ * INTERNAL - Count how many times a node is in a node set
+ *
+ * Return value: number of times @node was added; at most 1 for a set
+ */
+static int
+rasqal_path_node_set_count(rasqal_path_node_set* set, rasqal_literal* node)
+{
+  rasqal_literal* n;
+  int count = 0;
+  int i;
+
+  if(set->tree)
+    return raptor_avltree_search(set->tree, node) != NULL;
+
+  for(i = 0; (n = (rasqal_literal*)raptor_sequence_get_at(set->nodes, i)); i++) {
+    if(!rasqal_path_node_compare(n, node))
+      count++;
+  }
+
+  return count;
+}
+
+
+static void
+rasqal_free_path_edges(rasqal_path_edges* edges)
+{
+  if(!edges)
+    return;
+
+  if(edges->node)
+    rasqal_free_literal(edges->node);
+  if(edges->neighbours)
+    raptor_free_sequence(edges->neighbours);
+
+  RASQAL_FREE(rasqal_path_edges, edges);
+}
+
+
+static int
+rasqal_path_edges_compare(const void* a, const void* b)
+{
+  return rasqal_path_node_compare(((rasqal_path_edges*)a)->node,
+                                  ((rasqal_path_edges*)b)->node);
+}
+
+
+/*
+ * rasqal_path_edges_add:
+ * @tree: tree of #rasqal_path_edges
+ * @from: node to add an edge from
+ * @to: node to add an edge to
+ *
+ * INTERNAL - Add an edge to an adjacency tree
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_path_edges_add(raptor_avltree* tree,
+                      rasqal_literal* from, rasqal_literal* to)
+{
+  rasqal_path_edges key;
+  rasqal_path_edges* edges;
+
+  key.node = from;
+  key.neighbours = NULL;
+  edges = (rasqal_path_edges*)raptor_avltree_search(tree, &key);
+  if(!edges) {
+    edges = RASQAL_CALLOC(rasqal_path_edges*, 1, sizeof(*edges));
+    if(!edges)
+      return 1;
+
+    edges->node = rasqal_new_literal_from_literal(from);
+    edges->neighbours = raptor_new_sequence((raptor_data_free_handler)rasqal_free_literal,
+                                            (raptor_data_print_handler)rasqal_literal_print);
+    if(!edges->node || !edges->neighbours) {
+      rasqal_free_path_edges(edges);
+      return 1;
+    }
+
+    if(raptor_avltree_add(tree, edges))
+      return 1;
+  }
+
+  to = rasqal_new_literal_from_literal(to);
+  if(!to)
+    return 1;
+
+  return raptor_sequence_push(edges->neighbours, to);
+}
+
+
+static void
+rasqal_free_path_link_index(rasqal_path_link_index* index)
+{
+  if(!index)
+    return;
+
+  if(index->predicate)
+    rasqal_free_literal(index->predicate);
+  if(index->forward)
+    raptor_free_avltree(index->forward);
+  if(index->backward)
+    raptor_free_avltree(index->backward);
+  if(index->nodes)
+    rasqal_free_path_node_set(index->nodes);
+
+  RASQAL_FREE(rasqal_path_link_index, index);
+}
+
+
+static void
+rasqal_free_path_solution(rasqal_path_solution* solution)
+{
+  if(!solution)
+    return;
+
+  if(solution->subject)
+    rasqal_free_literal(solution->subject);
+  if(solution->object)
+    rasqal_free_literal(solution->object);
+
+  RASQAL_FREE(rasqal_path_solution, solution);
+}
+
+
+/*
+ * rasqal_path_can_be_empty:
+ * @path: property path
+ *
+ * INTERNAL - Test if a path matches zero length paths
+ *
+ * Return value: non-0 if every node reaches itself by @path
+ */
+static int
+rasqal_path_can_be_empty(rasqal_path* path)
+{
+  switch(path->op) {
+    case RASQAL_PATH_OPERATOR_ZERO_OR_ONE:
+    case RASQAL_PATH_OPERATOR_ZERO_OR_MORE:
+      return 1;
+
+    case RASQAL_PATH_OPERATOR_INVERSE:
+    case RASQAL_PATH_OPERATOR_ONE_OR_MORE:
+      return rasqal_path_can_be_empty(path->path1);
+
+    case RASQAL_PATH_OPERATOR_SEQUENCE:
+      return rasqal_path_can_be_empty(path->path1) &&
+             rasqal_path_can_be_empty(path->path2);
+
+    case RASQAL_PATH_OPERATOR_ALTERNATIVE:
+      return rasqal_path_can_be_empty(path->path1) ||
+             rasqal_path_can_be_empty(path->path2);
+
+    case RASQAL_PATH_OPERATOR_LINK:
+    default:
+      return 0;
+  }
+}
+
+
+/*
+ * rasqal_path_rowsource_scan:
+ * @query: query
+ * @con: path rowsource context
+ * @predicate: predicate to match (or NULL for all triples)
+ * @index: link index to add the edges to (or NULL)
+ * @nodes: node set to add the subjects and objects to
+ *
+ * INTERNAL - Scan the triples source once for a predicate
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_path_rowsource_scan(rasqal_query* query,
+                           rasqal_path_rowsource_context* con,
+                           rasqal_literal* predicate,
+                           rasqal_path_link_index* index,
+                           rasqal_path_node_set* nodes)
+{
+  rasqal_triple t;
+  rasqal_triple_meta m;
+  rasqal_variable* s_var = rasqal_literal_as_variable(con->scan_literals[0]);
+  rasqal_variable* o_var = rasqal_literal_as_variable(con->scan_literals[2]);
+  int rc = 0;
+
+  memset(&t, '\0', sizeof(t));
+  memset(&m, '\0', sizeof(m));
+
+  t.subject = con->scan_literals[0];
+  t.predicate = predicate ? predicate : con->scan_literals[1];
+  t.object = con->scan_literals[2];
+  t.origin = con->origin ? con->origin : con->triple->origin;
+
+  m.parts = RASQAL_TRIPLE_SUBJECT | RASQAL_TRIPLE_OBJECT;
+  if(!predicate)
+    m.parts = (rasqal_triple_parts)(m.parts | RASQAL_TRIPLE_PREDICATE);
+
+  m.triples_match = rasqal_new_triples_match(query, con->triples_source,
+                                             &m, &t);
+  if(!m.triples_match)
+    return 1;
+
+  while(!rasqal_triples_match_is_end(m.triples_match)) {
+    if(rasqal_triples_match_bind_match(m.triples_match, m.bindings,
+                                       m.parts)) {
+      rasqal_literal* s = s_var->value;
+      rasqal_literal* o = o_var->value;
+
+      if(index &&
+         (rasqal_path_edges_add(index->forward, s, o) ||
+          rasqal_path_edges_add(index->backward, o, s))) {
+        rc = 1;
+        break;
+      }
+
+      if(rasqal_path_node_set_add(nodes, s) < 0 ||
+         rasqal_path_node_set_add(nodes, o) < 0) {
+        rc = 1;
+        break;
+      }
+    }
+
+    rasqal_triples_match_next_match(m.triples_match);
+  }
+
+  /* frees the match and unbinds the scan variables */
+  rasqal_reset_triple_meta(&m);
+
+  return rc;
+}
+
+
+/*
+ * rasqal_path_rowsource_get_index:
+ * @query: query
+ * @con: path rowsource context
+ * @predicate: predicate IRI
+ *
+ * INTERNAL - Get the edge index for a predicate, building it on first use
+ *
+ * Return value: index or NULL on failure
+ */
+static rasqal_path_link_index*
+rasqal_path_rowsource_get_index(rasqal_query* query,
+                                rasqal_path_rowsource_context* con,
+                                rasqal_literal* predicate)
+{
+  rasqal_path_link_index* index;
+  int i;
+
+  if(!con->indexes) {
+    con->indexes = raptor_new_sequence((raptor_data_free_handler)rasqal_free_path_link_index,
+                                       NULL);
+    if(!con->indexes)
+      return NULL;
+  }
+
+  for(i = 0;
+      (index = (rasqal_path_link_index*)raptor_sequence_get_at(con->indexes, i));
+      i++) {
+    if(rasqal_literal_equals(index->predicate, predicate))
+      return index;
+  }
+
+  index = RASQAL_CALLOC(rasqal_path_link_index*, 1, sizeof(*index));
+  if(!index)
+    return NULL;
+
+  index->predicate = rasqal_new_literal_from_literal(predicate);
+  index->forward = raptor_new_avltree(rasqal_path_edges_compare,
+                                      (raptor_data_free_handler)rasqal_free_path_edges,
+                                      /* flags */ 0);
+  index->backward = raptor_new_avltree(rasqal_path_edges_compare,
+                                       (raptor_data_free_handler)rasqal_free_path_edges,
+                                       /* flags */ 0);
+  index->nodes = rasqal_new_path_node_set(1);
+  if(!index->predicate || !index->forward || !index->backward ||
+     !index->nodes) {
+    rasqal_free_path_link_index(index);
+    return NULL;
+  }
+
+  if(rasqal_path_rowsource_scan(query, con, predicate, index, index->nodes)) {
+    rasqal_free_path_link_index(index);
+    return NULL;
+  }
+
+  RASQAL_DEBUG3("path rowsource %p indexed %d nodes\n", RASQAL_GOOD_CAST(void*, con),
+                raptor_sequence_size(index->nodes->nodes));
+
+  if(raptor_sequence_push(con->indexes, index))
+    return NULL;
+
+  return index;
+}
+
+
+static int rasqal_path_rowsource_eval(rasqal_query* query, rasqal_path_rowsource_context* con, rasqal_path* path, rasqal_literal* node, int forward, rasqal_path_node_set* result);
+
+
+/*
+ * rasqal_path_rowsource_closure:
+ * @query: query
+ * @con: path rowsource context
+ * @path: path to repeat
+ * @node: start node
+ * @forward: non-0 to follow the path forwards from @node
+ * @zero: non-0 to include @node itself (zero repetitions)
+ * @result: node set to add the reached nodes to
+ *
+ * INTERNAL - Breadth first search for the nodes reached by repeating a path
+ *
+ * Every node is expanded once however many ways it is reached so
+ * cycles in the graph terminate the search, and each reached node is
+ * added to @result once.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_path_rowsource_closure(rasqal_query* query,
+                              rasqal_path_rowsource_context* con,
+                              rasqal_path* path, rasqal_literal* node,
+                              int forward, int zero,
+                              rasqal_path_node_set* result)
+{
+  rasqal_path_node_set* visited;
+  rasqal_literal* n;
+  int rc = 1;
+  int i;
+
+  visited = rasqal_new_path_node_set(1);
+  if(!visited)
+    return 1;
+
+  if(zero && rasqal_path_node_set_add(visited, node) < 0)
+    goto tidy;
+
+  /* the visited nodes in the order they were reached are the queue */
+  i = zero ? 1 : 0;
+  for(n = zero ? (rasqal_literal*)raptor_sequence_get_at(visited->nodes, 0) : node;
+      n;
+      n = (rasqal_literal*)raptor_sequence_get_at(visited->nodes, i++)) {
+    if(rasqal_path_rowsource_eval(query, con, path, n, forward, visited))
+      goto tidy;
+  }
+
+  for(i = 0; (n = (rasqal_literal*)raptor_sequence_get_at(visited->nodes, i)); i++) {
+    if(rasqal_path_node_set_add(result, n) < 0)
+      goto tidy;
+  }
+
+  rc = 0;
+
+  tidy:
+  rasqal_free_path_node_set(visited);
+
+  return rc;
+}
+
+
+/*
+ * rasqal_path_rowsource_eval:
+ * @query: query
+ * @con: path rowsource context
+ * @path: path
+ * @node: start node
+ * @forward: non-0 to follow @path forwards from @node, 0 to follow it
+ *   backwards to the nodes that reach @node
+ * @result: node set to add the reached nodes to
+ *
+ * INTERNAL - Find the nodes reached by a path from a node
+ *
+ * A node is added once for each way @path reaches it, as sequence
+ * and alternative paths are joins and unions of their parts, but the
+ * repeated paths `?`, `*` and `+` reach each node once.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_path_rowsource_eval(rasqal_query* query,
+                           rasqal_path_rowsource_context* con,
+                           rasqal_path* path, rasqal_literal* node,
+                           int forward, rasqal_path_node_set* result)
+{
+  rasqal_path_link_index* index;
+  rasqal_path_edges key;
+  rasqal_path_edges* edges;
+  rasqal_path_node_set* nodes;
+  rasqal_literal* n;
+  int rc = 0;
+  int i;
+
+  switch(path->op) {
+    case RASQAL_PATH_OPERATOR_LINK:
+      index = rasqal_path_rowsource_get_index(query, con, path->iri);
+      if(!index)
+        return 1;
+
+      key.node = node;
+      key.neighbours = NULL;
+      edges = (rasqal_path_edges*)raptor_avltree_search(forward ? index->forward : index->backward, &key);
+      if(edges) {
+        for(i = 0;
+            (n = (rasqal_literal*)raptor_sequence_get_at(edges->neighbours, i));
+            i++) {
+          if(rasqal_path_node_set_add(result, n) < 0)
+            return 1;
+        }
+      }
+      break;
+
+    case RASQAL_PATH_OPERATOR_INVERSE:
+      rc = rasqal_path_rowsource_eval(query, con, path->path1, node,
+                                      !forward, result);
+      break;
+
+    case RASQAL_PATH_OPERATOR_SEQUENCE:
+      /* every way of reaching a middle node continues from it */
+      nodes = rasqal_new_path_node_set(0);
+      if(!nodes)
+        return 1;
+
+      rc = rasqal_path_rowsource_eval(query, con,
+                                      forward ? path->path1 : path->path2,
+                                      node, forward, nodes);
+      for(i = 0;
+          !rc && (n = (rasqal_literal*)raptor_sequence_get_at(nodes->nodes, i));
+          i++) {
+        rc = rasqal_path_rowsource_eval(query, con,
+                                        forward ? path->path2 : path->path1,
+                                        n, forward, result);
+      }
+
+      rasqal_free_path_node_set(nodes);
+      break;
+
+    case RASQAL_PATH_OPERATOR_ALTERNATIVE:
+      rc = rasqal_path_rowsource_eval(query, con, path->path1, node,
+                                      forward, result) ||
+           rasqal_path_rowsource_eval(query, con, path->path2, node,
+                                      forward, result);
+      break;
+
+    case RASQAL_PATH_OPERATOR_ZERO_OR_ONE:
+      nodes = rasqal_new_path_node_set(1);
+      if(!nodes)
+        return 1;
+
+      rc = (rasqal_path_node_set_add(nodes, node) < 0) ||
+           rasqal_path_rowsource_eval(query, con, path->path1, node,
+                                      forward, nodes);
+      for(i = 0;
+          !rc && (n = (rasqal_literal*)raptor_sequence_get_at(nodes->nodes, i));
+          i++) {
+        if(rasqal_path_node_set_add(result, n) < 0)
+          rc = 1;
+      }
+
+      rasqal_free_path_node_set(nodes);
+      break;
+
+    case RASQAL_PATH_OPERATOR_ZERO_OR_MORE:
+    case RASQAL_PATH_OPERATOR_ONE_OR_MORE:
+      rc = rasqal_path_rowsource_closure(query, con, path->path1, node,
+                                         forward,
+                                         (path->op == RASQAL_PATH_OPERATOR_ZERO_OR_MORE),
+                                         result);
+      break;
+
+    default:
+      RASQAL_DEBUG2("Unknown path operator %u\n", path->op);
+      rc = 1;
+      break;
+  }
+
+  return rc;
+}
+
+
+/*
+ * rasqal_path_rowsource_add_start_nodes:
+ * @query: query
+ * @con: path rowsource context
+ * @path: path
+ * @starts: node set to add to
+ *
+ * INTERNAL - Find the candidate start nodes when neither end is fixed
+ *
+ * A path that can have zero length starts from every node in the
+ * graph, otherwise only nodes with an edge for one of the path
+ * predicates can start a path.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_path_rowsource_add_start_nodes(rasqal_query* query,
+                                      rasqal_path_rowsource_context* con,
+                                      rasqal_path* path,
+                                      rasqal_path_node_set* starts)
+{
+  rasqal_path_node_set* nodes;
+  rasqal_literal* n;
+  int i;
+
+  if(path->op == RASQAL_PATH_OPERATOR_LINK) {
+    rasqal_path_link_index* index;
+
+    index = rasqal_path_rowsource_get_index(query, con, path->iri);
+    if(!index)
+      return 1;
+    nodes = index->nodes;
+  } else if(rasqal_path_can_be_empty(path)) {
+    if(!con->graph_nodes) {
+      con->graph_nodes = rasqal_new_path_node_set(1);
+      if(!con->graph_nodes)
+        return 1;
+
+      if(rasqal_path_rowsource_scan(query, con, NULL, NULL,
+                                    con->graph_nodes)) {
+        rasqal_free_path_node_set(con->graph_nodes);
+        con->graph_nodes = NULL;
+        return 1;
+      }
+    }
+    nodes = con->graph_nodes;
+  } else {
+    if(rasqal_path_rowsource_add_start_nodes(query, con, path->path1, starts))
+      return 1;
+    if(path->path2 &&
+       rasqal_path_rowsource_add_start_nodes(query, con, path->path2, starts))
+      return 1;
+    return 0;
+  }
+
+  for(i = 0; (n = (rasqal_literal*)raptor_sequence_get_at(nodes->nodes, i)); i++) {
+    if(rasqal_path_node_set_add(starts, n) < 0)
+      return 1;
+  }
+
+  return 0;
+}
+
+
+static int
+rasqal_path_rowsource_add_solution(rasqal_path_rowsource_context* con,
+                                   rasqal_literal* subject,
+                                   rasqal_literal* object)
+{
+  rasqal_path_solution* solution;
+
+  solution = RASQAL_CALLOC(rasqal_path_solution*, 1, sizeof(*solution));
+  if(!solution)
+    return 1;
+
+  solution->subject = rasqal_new_literal_from_literal(subject);
+  solution->object = rasqal_new_literal_from_literal(object);
+  if(!solution->subject || !solution->object) {
+    rasqal_free_path_solution(solution);
+    return 1;
+  }
+
+  return raptor_sequence_push(con->solutions, solution);
+}
+
+
+/*
+ * rasqal_path_rowsource_term_value:
+ * @con: path rowsource context
+ * @term: subject or object of the path triple
+ *
+ * INTERNAL - Get the fixed value of a path end
+ *
+ * Return value: constant, value of a variable bound outside this
+ * pattern or NULL if the end is not fixed
+ */
+static rasqal_literal*
+rasqal_path_rowsource_term_value(rasqal_path_rowsource_context* con,
+                                 rasqal_literal* term)
+{
+  rasqal_variable* v = rasqal_literal_as_variable(term);
+
+  if(!v)
+    return term;
+
+  if(v == con->subject_var || v == con->object_var)
+    return NULL;
+
+  return v->value;
+}
+
+
+/*
+ * rasqal_path_rowsource_evaluate:
+ * @query: query
+ * @con: path rowsource context
+ *
+ * INTERNAL - Find all solutions of the path triple for the current values
+ *
+ * The search starts from the subject when it is fixed, otherwise
+ * from the object following the path backwards, otherwise from
+ * every candidate start node.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_path_rowsource_evaluate(rasqal_query* query,
+                               rasqal_path_rowsource_context* con)
+{
+  rasqal_triple* t = con->triple;
+  rasqal_path* path = t->path;
+  rasqal_literal* subject;
+  rasqal_literal* object;
+  rasqal_path_node_set* starts = NULL;
+  rasqal_path_node_set* ends = NULL;
+  rasqal_literal* s;
+  rasqal_literal* o;
+  int same_variable;
+  int rc = 1;
+  int i;
+  int j;
+
+  subject = rasqal_path_rowsource_term_value(con, t->subject);
+  object = rasqal_path_rowsource_term_value(con, t->object);
+  same_variable = (rasqal_literal_as_variable(t->subject) &&
+                   rasqal_literal_as_variable(t->subject) == rasqal_literal_as_variable(t->object));
+
+  con->solutions = raptor_new_sequence((raptor_data_free_handler)rasqal_free_path_solution,
+                                       NULL);
+  if(!con->solutions)
+    return 1;
+  con->solutions_index = 0;
+
+  if(!subject && object) {
+    starts = rasqal_new_path_node_set(0);
+    if(!starts ||
+       rasqal_path_rowsource_eval(query, con, path, object, 0, starts))
+      goto tidy;
+
+    for(i = 0; (s = (rasqal_literal*)raptor_sequence_get_at(starts->nodes, i)); i++) {
+      if(rasqal_path_rowsource_add_solution(con, s, object))
+        goto tidy;
+    }
+
+    rc = 0;
+    goto tidy;
+  }
+
+  starts = rasqal_new_path_node_set(1);
+  if(!starts)
+    goto tidy;
+
+  if(subject) {
+    if(rasqal_path_node_set_add(starts, subject) < 0)
+      goto tidy;
+  } else {
+    if(rasqal_path_rowsource_add_start_nodes(query, con, path, starts))
+      goto tidy;
+  }
+
+  for(i = 0; (s = (rasqal_literal*)raptor_sequence_get_at(starts->nodes, i)); i++) {
+    ends = rasqal_new_path_node_set(0);
+    if(!ends ||
+       rasqal_path_rowsource_eval(query, con, path, s, 1, ends))
+      goto tidy;
+
+    if(object || same_variable) {
+      int count;
+
+      o = object ? object : s;
+      for(count = rasqal_path_node_set_count(ends, o); count > 0; count--) {
+        if(rasqal_path_rowsource_add_solution(con, s, o))
+          goto tidy;
+      }
+    } else {
+      for(j = 0; (o = (rasqal_literal*)raptor_sequence_get_at(ends->nodes, j)); j++) {
+        if(rasqal_path_rowsource_add_solution(con, s, o))
+          goto tidy;
+      }
+    }
+
+    rasqal_free_path_node_set(ends);
+    ends = NULL;
+  }
+
+  rc = 0;
+
+  tidy:
+  if(starts)
+    rasqal_free_path_node_set(starts);
+  if(ends)
+    rasqal_free_path_node_set(ends);
+
+  RASQAL_DEBUG3("path rowsource %p found %d solutions\n", RASQAL_GOOD_CAST(void*, con),
+                raptor_sequence_size(con->solutions));
+
+  return rc;
+}
+
+
+static int
+rasqal_path_rowsource_init(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_query *query = rowsource->query;
+  rasqal_path_rowsource_context *con;
+  rasqal_variable* v;
+  static const char* const scan_names[3] = { "s", "p", "o" };
+  int i;
+
+  con = (rasqal_path_rowsource_context*)user_data;
+
+  con->triple = (rasqal_triple*)raptor_sequence_get_at(con->triples,
+                                                        con->column);
+  if(!con->triple || !con->triple->path)
+    return 1;
+
+  if((v = rasqal_literal_as_variable(con->triple->subject)) &&
+     (rasqal_query_variable_bound_in_triple(query, v, con->column) & RASQAL_TRIPLE_SUBJECT))
+    con->subject_var = v;
+
+  if((v = rasqal_literal_as_variable(con->triple->object)) &&
+     v != con->subject_var &&
+     (rasqal_query_variable_bound_in_triple(query, v, con->column) & RASQAL_TRIPLE_OBJECT))
+    con->object_var = v;
+
+  if(con->subject_var) {
+    v = rasqal_new_variable_from_variable(con->subject_var);
+    if(raptor_sequence_push(rowsource->variables_sequence, v))
+      return 1;
+  }
+  if(con->object_var) {
+    v = rasqal_new_variable_from_variable(con->object_var);
+    if(raptor_sequence_push(rowsource->variables_sequence, v))
+      return 1;
+  }
+
+  con->scan_vars_table = rasqal_new_variables_table(rowsource->world);
+  if(!con->scan_vars_table)
+    return 1;
+
+  for(i = 0; i < 3; i++) {
+    v = rasqal_variables_table_add2(con->scan_vars_table,
+                                    RASQAL_VARIABLE_TYPE_NORMAL,
+                                    RASQAL_GOOD_CAST(const unsigned char*, scan_names[i]),
+                                    0, NULL);
+    if(!v)
+      return 1;
+
+    con->scan_literals[i] = rasqal_new_variable_literal(rowsource->world, v);
+    if(!con->scan_literals[i])
+      return 1;
+  }
+
+  con->offset = 0;
+
+  return 0;
+}
+
+
+static int
+rasqal_path_rowsource_ensure_variables(rasqal_rowsource* rowsource,
+                                       void *user_data)
+{
+  rowsource->size = raptor_sequence_size(rowsource->variables_sequence);
+
+  return 0;
+}
+
+
+static int
+rasqal_path_rowsource_finish(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_path_rowsource_context *con;
+  int i;
+
+  con = (rasqal_path_rowsource_context*)user_data;
+
+  if(con->solutions)
+    raptor_free_sequence(con->solutions);
+
+  if(con->indexes)
+    raptor_free_sequence(con->indexes);
+
+  if(con->graph_nodes)
+    rasqal_free_path_node_set(con->graph_nodes);
+
+  for(i = 0; i < 3; i++) {
+    if(con->scan_literals[i])
+      rasqal_free_literal(con->scan_literals[i]);
+  }
+
+  if(con->scan_vars_table)
+    rasqal_free_variables_table(con->scan_vars_table);
+
+  if(con->origin)
+    rasqal_free_literal(con->origin);
+
+  RASQAL_FREE(rasqal_path_rowsource_context, con);
+
+  return 0;
+}
+
+
+static rasqal_row*
+rasqal_path_rowsource_read_row(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_path_rowsource_context *con;
+  rasqal_path_solution* solution;
+  rasqal_row* row;
+  int i;
+
+  con = (rasqal_path_rowsource_context*)user_data;
+
+  if(con->failed)
+    return NULL;
+
+  if(!con->solutions &&
+     rasqal_path_rowsource_evaluate(rowsource->query, con)) {
+    con->failed = 1;
+    return NULL;
+  }
+
+  solution = (rasqal_path_solution*)raptor_sequence_get_at(con->solutions,
+                                                           con->solutions_index);
+  if(!solution)
+    return NULL;
+  con->solutions_index++;
+
+  if(con->subject_var)
+    rasqal_variable_set_value(con->subject_var,
+                              rasqal_new_literal_from_literal(solution->subject));
+  if(con->object_var)
+    rasqal_variable_set_value(con->object_var,
+                              rasqal_new_literal_from_literal(solution->object));
+
+  row = rasqal_new_row(rowsource);
+  if(!row)
+    return NULL;
+
+  for(i = 0; i < row->size; i++) {
+    rasqal_variable* v;
+    v = rasqal_rowsource_get_variable_by_offset(rowsource, i);
+    if(row->values[i])
+      rasqal_free_literal(row->values[i]);
+    row->values[i] = rasqal_new_literal_from_literal(v->value);
+  }
+
+  row->offset = con->offset++;
+
+  return row;
+}
+
+
+static int
+rasqal_path_rowsource_reset(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_path_rowsource_context *con;
+
+  con = (rasqal_path_rowsource_context*)user_data;
+
+  /* solutions depend on the values of the variables bound outside,
+   * the edge indexes do not */
+  if(con->solutions) {
+    raptor_free_sequence(con->solutions);
+    con->solutions = NULL;
+  }
+  con->solutions_index = 0;
+  con->failed = 0;
+
+  if(con->subject_var)
+    rasqal_variable_set_value(con->subject_var, NULL);
+  if(con->object_var)
+    rasqal_variable_set_value(con->object_var, NULL);
+
+  return 0;
+}
+
+
+static int
+rasqal_path_rowsource_set_origin(rasqal_rowsource *rowsource,
+                                 void *user_data,
+                                 rasqal_literal *origin)
+{
+  rasqal_path_rowsource_context *con;
+
+  con = (rasqal_path_rowsource_context*)user_data;
+
+  if(con->origin && origin && rasqal_literal_equals(con->origin, origin))
+    return 0;
+
+  if(con->origin)
+    rasqal_free_literal(con->origin);
+  con->origin = rasqal_new_literal_from_literal(origin);
+
+  /* edges of another graph */
+  if(con->indexes) {
+    raptor_free_sequence(con->indexes);
+    con->indexes = NULL;
+  }
+  if(con->graph_nodes) {
+    rasqal_free_path_node_set(con->graph_nodes);
+    con->graph_nodes = NULL;
+  }
+
+  return 0;
+}
+
+
+static const rasqal_rowsource_handler rasqal_path_rowsource_handler = {
+  /* .version = */ 1,
+  "property path",
+  /* .init = */ rasqal_path_rowsource_init,
+  /* .finish = */ rasqal_path_rowsource_finish,
+  /* .ensure_variables = */ rasqal_path_rowsource_ensure_variables,
+  /* .read_row = */ rasqal_path_rowsource_read_row,
+  /* .read_all_rows = */ NULL,
+  /* .reset = */ rasqal_path_rowsource_reset,
+  /* .set_requirements = */ NULL,
+  /* .get_inner_rowsource = */ NULL,
+  /* .set_origin = */ rasqal_path_rowsource_set_origin,
+  /* .read_batch = */ NULL,
+  /* .get_order = */ NULL,
+  /* .set_outer_variables = */ NULL
+};
+
+
+/**
+ * rasqal_new_path_rowsource:
+ * @world: world object
+ * @query: query object
+ * @triples_source: shared triples source
+ * @triples: shared triples sequence
+ * @column: column of the property path triple in @triples
+ *
+ * INTERNAL - create a new property path rowsource
+ *
+ * Returns the (subject, object) pairs connected by the path of the
+ * triple, binding the end variables that are first bound here.  The
+ * graph edges for each predicate in the path are read from the
+ * triples source once into forward and backward adjacency trees on
+ * first use and kept for all later resets, so a path inside a join
+ * costs one scan per predicate rather than one per left row.
+ * Repeated paths are evaluated by breadth first search that expands
+ * every node once.  A (subject, object) pair is returned once for
+ * each way the sequence and alternative parts of the path join it,
+ * while the `?`, `*` and `+` parts reach each node once.
+ *
+ * Return value: new rowsource or NULL on failure
+ */
+rasqal_rowsource*
+rasqal_new_path_rowsource(rasqal_world *world,
+                          rasqal_query *query,
+                          rasqal_triples_source* triples_source,
+                          raptor_sequence* triples,
+                          int column)
+{
+  rasqal_path_rowsource_context *con;
+  int flags = 0;
+
+  if(!world || !query || !triples_source || !triples)
+    return NULL;
+
+  con = RASQAL_CALLOC(rasqal_path_rowsource_context*, 1, sizeof(*con));
+  if(!con)
+    return NULL;
+
+  con->triples_source = triples_source;
+  con->triples = triples;
+  con->column = column;
+
+  return rasqal_new_rowsource_from_handler(world, query,
+                                           con,
+                                           &rasqal_path_rowsource_handler,
+                                           query->vars_table,
+                                           flags);
+}
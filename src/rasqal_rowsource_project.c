@@ -57,6 +57,9 @@ typedef struct
   /* variables projection array: [output row var index]=input row var index */
   int* projection;
 
+  /* batch of inner rowsource rows for read_batch() */
+  rasqal_row_batch* input;
+
 } rasqal_project_rowsource_context;
 
 
@@ -126,6 +129,9 @@ rasqal_project_rowsource_finish(rasqal_rowsource* rowsource, void *user_data)
   
   if(con->projection)
     RASQAL_FREE(int*, con->projection);
+
+  if(con->input)
+    rasqal_free_row_batch(con->input);
   
   RASQAL_FREE(rasqal_project_rowsource_context, con);
 
@@ -197,16 +203,116 @@ rasqal_project_rowsource_read_row(rasqal_rowsource* rowsource, void *user_data)
 }
 
 
+/*
+ * rasqal_project_rowsource_read_batch:
+ *
+ * INTERNAL - read a batch of projected rows
+ *
+ * Copies the projected columns of a batch of inner rows into
+ * @batch.  The inner row is only bound to the variables when there
+ * is a projection expression to evaluate over it.
+ */
+static int
+rasqal_project_rowsource_read_batch(rasqal_rowsource* rowsource,
+                                    void *user_data,
+                                    rasqal_row_batch* batch)
+{
+  rasqal_query *query = rowsource->query;
+  rasqal_project_rowsource_context *con;
+  int count;
+  int r;
+
+  con = (rasqal_project_rowsource_context*)user_data;
+
+  if(!con->input) {
+    con->input = rasqal_new_row_batch(con->rowsource, batch->capacity);
+    if(!con->input)
+      return -1;
+  }
+
+  count = rasqal_rowsource_read_batch(con->rowsource, con->input);
+  if(count <= 0)
+    return count;
+
+  for(r = 0; r < count; r++) {
+    int index;
+    int bound = 0;
+    int i;
+
+    index = rasqal_row_batch_new_row(batch);
+    if(index < 0)
+      return -1;
+
+    batch->offsets[index] = con->input->offsets[r];
+
+    for(i = 0; i < rowsource->size; i++) {
+      int offset = con->projection[i];
+      rasqal_variable* v;
+      int error = 0;
+
+      if(offset >= 0) {
+        rasqal_literal* l = RASQAL_ROW_BATCH_VALUE(con->input, offset, r);
+        if(l)
+          RASQAL_ROW_BATCH_VALUE(batch, i, index) = rasqal_new_literal_from_literal(l);
+        continue;
+      }
+
+      v = (rasqal_variable*)raptor_sequence_get_at(con->projection_variables, i);
+      if(!v || !v->expression)
+        continue;
+
+      if(!bound) {
+        if(rasqal_row_batch_bind_row(con->input, r))
+          return -1;
+        bound = 1;
+      }
+
+      if(v->value)
+        rasqal_free_literal(v->value);
+
+      v->value = rasqal_expression_evaluate2(v->expression,
+                                             query->eval_context,
+                                             &error);
+      /* FIXME: Errors are ignored - as for read_row */
+      if(!error && v->value)
+        RASQAL_ROW_BATCH_VALUE(batch, i, index) = rasqal_new_literal_from_literal(v->value);
+    }
+  }
+
+  return batch->count;
+}
+
+
 static int
 rasqal_project_rowsource_reset(rasqal_rowsource* rowsource, void *user_data)
 {
   rasqal_project_rowsource_context *con;
   con = (rasqal_project_rowsource_context*)user_data;
 
+  if(con->input)
+    rasqal_row_batch_clear(con->input);
+
   return rasqal_rowsource_reset(con->rowsource);
 }
 
 
+static rasqal_variable*
+rasqal_project_rowsource_get_order(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_project_rowsource_context *con;
+  rasqal_variable* v;
+
+  con = (rasqal_project_rowsource_context*)user_data;
+
+  /* rows keep their inner order if the variable is projected */
+  v = rasqal_rowsource_get_order(con->rowsource);
+  if(v && rasqal_rowsource_get_variable_offset_by_name(rowsource, v->name) < 0)
+    v = NULL;
+
+  return v;
+}
+
+
 static rasqal_rowsource*
 rasqal_project_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource,
                                              void *user_data, int offset)
@@ -221,7 +327,7 @@ rasqal_project_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource,
 
 
 static const rasqal_rowsource_handler rasqal_project_rowsource_handler = {
-  /* .version =          */ 1,
+  /* .version =          */ 2,
   "project",
   /* .init =             */ rasqal_project_rowsource_init,
   /* .finish =           */ rasqal_project_rowsource_finish,
@@ -232,6 +338,9 @@ static const rasqal_rowsource_handler rasqal_project_rowsource_handler = {
   /* .set_requirements = */ NULL,
   /* .get_inner_rowsource = */ rasqal_project_rowsource_get_inner_rowsource,
   /* .set_origin =       */ NULL,
+  /* .read_batch =       */ rasqal_project_rowsource_read_batch,
+  /* .get_order =        */ rasqal_project_rowsource_get_order,
+  /* .set_outer_variables = */ NULL
 };
 
 
@@ -0,0 +1,441 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_rowsource_reduced.c - Rasqal REDUCED rowsource class
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#include <raptor.h>
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+
+#define DEBUG_FH stderr
+
+#ifndef STANDALONE
+
+/* number of recent rows remembered; must be a power of 2 */
+#define RASQAL_REDUCED_CACHE_SIZE 1024
+
+
+/*
+ * rasqal_reduced_cache_entry:
+ * @hash: hash of the row values
+ * @row: row or NULL if the entry is empty
+ *
+ * INTERNAL - one slot of the direct-mapped recent rows cache
+ */
+typedef struct {
+  uint64_t hash;
+  rasqal_row* row;
+} rasqal_reduced_cache_entry;
+
+
+typedef struct
+{
+  /* inner rowsource to reduce */
+  rasqal_rowsource *rowsource;
+
+  /* direct-mapped cache of recently returned rows */
+  rasqal_reduced_cache_entry* cache;
+
+  /* offset into results for current row */
+  int offset;
+} rasqal_reduced_rowsource_context;
+
+
+static void
+rasqal_reduced_rowsource_clear_cache(rasqal_reduced_rowsource_context* con)
+{
+  int i;
+
+  for(i = 0; i < RASQAL_REDUCED_CACHE_SIZE; i++) {
+    if(con->cache[i].row) {
+      rasqal_free_row(con->cache[i].row);
+      con->cache[i].row = NULL;
+    }
+  }
+}
+
+
+static int
+rasqal_reduced_rowsource_init(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_reduced_rowsource_context *con;
+
+  con = (rasqal_reduced_rowsource_context*)user_data;
+
+  con->offset = 0;
+
+  con->cache = RASQAL_CALLOC(rasqal_reduced_cache_entry*,
+                             RASQAL_REDUCED_CACHE_SIZE, sizeof(*con->cache));
+  if(!con->cache)
+    return 1;
+
+  return 0;
+}
+
+
+static int
+rasqal_reduced_rowsource_ensure_variables(rasqal_rowsource* rowsource,
+                                          void *user_data)
+{
+  rasqal_reduced_rowsource_context* con;
+
+  con = (rasqal_reduced_rowsource_context*)user_data;
+
+  rasqal_rowsource_ensure_variables(con->rowsource);
+
+  rowsource->size = 0;
+  rasqal_rowsource_copy_variables(rowsource, con->rowsource);
+
+  return 0;
+}
+
+
+static int
+rasqal_reduced_rowsource_finish(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_reduced_rowsource_context *con;
+  con = (rasqal_reduced_rowsource_context*)user_data;
+
+  if(con->rowsource)
+    rasqal_free_rowsource(con->rowsource);
+
+  if(con->cache) {
+    rasqal_reduced_rowsource_clear_cache(con);
+    RASQAL_FREE(rasqal_reduced_cache_entry*, con->cache);
+  }
+
+  RASQAL_FREE(rasqal_reduced_rowsource_context, con);
+
+  return 0;
+}
+
+
+static rasqal_row*
+rasqal_reduced_rowsource_read_row(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_reduced_rowsource_context *con;
+  rasqal_row *row = NULL;
+
+  con = (rasqal_reduced_rowsource_context*)user_data;
+
+  while(1) {
+    rasqal_reduced_cache_entry* entry;
+    uint64_t hash;
+
+    row = rasqal_rowsource_read_row(con->rowsource);
+    if(!row)
+      break;
+
+    /* hash agrees with rasqal_literal_array_equals() below */
+    hash = rasqal_row_hash(row, RASQAL_COMPARE_RDF);
+    entry = &con->cache[hash & (RASQAL_REDUCED_CACHE_SIZE - 1)];
+
+    if(entry->row && entry->hash == hash &&
+       entry->row->size == row->size &&
+       rasqal_literal_array_equals(entry->row->values, row->values,
+                                   row->size)) {
+      RASQAL_DEBUG1("row is a recent duplicate\n");
+      rasqal_free_row(row);
+      continue;
+    }
+
+    /* remember this row in place of whatever was in the slot */
+    if(entry->row)
+      rasqal_free_row(entry->row);
+    entry->hash = hash;
+    entry->row = rasqal_new_row_from_row(row);
+    break;
+  }
+
+  if(row) {
+    rasqal_row_set_rowsource(row, rowsource);
+    row->offset = con->offset++;
+  }
+
+  return row;
+}
+
+
+static int
+rasqal_reduced_rowsource_reset(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_reduced_rowsource_context *con;
+
+  con = (rasqal_reduced_rowsource_context*)user_data;
+
+  rasqal_reduced_rowsource_clear_cache(con);
+  con->offset = 0;
+
+  return rasqal_rowsource_reset(con->rowsource);
+}
+
+
+static rasqal_rowsource*
+rasqal_reduced_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource,
+                                             void *user_data, int offset)
+{
+  rasqal_reduced_rowsource_context *con;
+  con = (rasqal_reduced_rowsource_context*)user_data;
+
+  if(offset == 0)
+    return con->rowsource;
+  return NULL;
+}
+
+
+static const rasqal_rowsource_handler rasqal_reduced_rowsource_handler = {
+  /* .version =          */ 1,
+  "reduced",
+  /* .init =             */ rasqal_reduced_rowsource_init,
+  /* .finish =           */ rasqal_reduced_rowsource_finish,
+  /* .ensure_variables = */ rasqal_reduced_rowsource_ensure_variables,
+  /* .read_row =         */ rasqal_reduced_rowsource_read_row,
+  /* .read_all_rows =    */ NULL,
+  /* .reset =            */ rasqal_reduced_rowsource_reset,
+  /* .set_requirements = */ NULL,
+  /* .get_inner_rowsource = */ rasqal_reduced_rowsource_get_inner_rowsource,
+  /* .set_origin =       */ NULL,
+  /* .read_batch =       */ NULL,
+  /* .get_order =        */ NULL,
+  /* .set_outer_variables = */ NULL,
+};
+
+
+/**
+ * rasqal_new_reduced_rowsource:
+ * @world: world object
+ * @query: query object
+ * @rowsource: input rowsource
+ *
+ * INTERNAL - create a new REDUCED rowsource
+ *
+ * Drops rows equal to a recently returned row using a fixed size
+ * direct-mapped cache of rows, so memory use is constant and rows
+ * are returned as soon as they are read.  Duplicates that are far
+ * apart or whose hashes collide may be returned, as REDUCED allows.
+ *
+ * The @rowsource becomes owned by the new rowsource
+ *
+ * Return value: new rowsource or NULL on failure
+ */
+rasqal_rowsource*
+rasqal_new_reduced_rowsource(rasqal_world *world,
+                             rasqal_query *query,
+                             rasqal_rowsource* rowsource)
+{
+  rasqal_reduced_rowsource_context *con;
+  int flags = 0;
+
+  if(!world || !query || !rowsource)
+    goto fail;
+
+  con = RASQAL_CALLOC(rasqal_reduced_rowsource_context*, 1, sizeof(*con));
+  if(!con)
+    goto fail;
+
+  con->rowsource = rowsource;
+
+  return rasqal_new_rowsource_from_handler(world, query,
+                                           con,
+                                           &rasqal_reduced_rowsource_handler,
+                                           query->vars_table,
+                                           flags);
+
+  fail:
+  if(rowsource)
+    rasqal_free_rowsource(rowsource);
+  return NULL;
+}
+
+
+#endif /* not STANDALONE */
+
+
+
+#ifdef STANDALONE
+
+/* one more prototype */
+int main(int argc, char *argv[]);
+
+
+const char* const reduced_1_data_2x7_rows[] =
+{
+  /* 2 variable names and 7 rows */
+  "a",   NULL, "b",   NULL,
+  /* row 1 data */
+  "foo", NULL, "red", NULL,
+  /* row 2 data */
+  "foo", NULL, "red", NULL,
+  /* row 3 data */
+  "baz", NULL, "blue", NULL,
+  /* row 4 data */
+  "baz", NULL, "blue", NULL,
+  /* row 5 data */
+  "baz", NULL, "blue", NULL,
+  /* row 6 data */
+  "sue", NULL, NULL, NULL,
+  /* row 7 data */
+  "sue", NULL, NULL, NULL,
+  /* end of data */
+  NULL, NULL, NULL, NULL
+};
+
+
+/* duplicates next to each other are always in the cache */
+#define EXPECTED_ROWS_COUNT 3
+
+#define EXPECTED_COLUMNS_COUNT 2
+const char* const reduced_result_vars[] = { "a" , "b" };
+
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  rasqal_rowsource *rowsource = NULL;
+  rasqal_rowsource *input_rs = NULL;
+  rasqal_world* world = NULL;
+  rasqal_query* query = NULL;
+  int count;
+  raptor_sequence* seq = NULL;
+  int failures = 0;
+  rasqal_variables_table* vt;
+  int size;
+  int i;
+  raptor_sequence* vars_seq = NULL;
+  int vars_count;
+
+  world = rasqal_new_world(); rasqal_world_open(world);
+
+  query = rasqal_new_query(world, "sparql", NULL);
+
+  vt = query->vars_table;
+
+  vars_count = 2;
+  seq = rasqal_new_row_sequence(world, vt, reduced_1_data_2x7_rows,
+                                vars_count, &vars_seq);
+  if(!seq) {
+    fprintf(stderr, "%s: failed to create sequence of %d vars\n", program,
+            vars_count);
+    failures++;
+    goto tidy;
+  }
+
+  input_rs = rasqal_new_rowsequence_rowsource(world, query, vt, seq, vars_seq);
+  if(!input_rs) {
+    fprintf(stderr, "%s: failed to create rowsequence rowsource\n", program);
+    failures++;
+    goto tidy;
+  }
+  /* vars_seq and seq are now owned by input_rs */
+  vars_seq = seq = NULL;
+
+  rowsource = rasqal_new_reduced_rowsource(world, query, input_rs);
+  if(!rowsource) {
+    fprintf(stderr, "%s: failed to create reduced rowsource\n", program);
+    failures++;
+    goto tidy;
+  }
+  /* input_rs is now owned by rowsource */
+  input_rs = NULL;
+
+  seq = rasqal_rowsource_read_all_rows(rowsource);
+  if(!seq) {
+    fprintf(stderr,
+            "%s: read_rows returned a NULL seq for a reduced rowsource\n",
+            program);
+    failures++;
+    goto tidy;
+  }
+  count = raptor_sequence_size(seq);
+  if(count != EXPECTED_ROWS_COUNT) {
+    fprintf(stderr,
+            "%s: read_rows returned %d rows for a reduced rowsource, expected %d\n",
+            program, count, EXPECTED_ROWS_COUNT);
+    failures++;
+    goto tidy;
+  }
+
+  size = rasqal_rowsource_get_size(rowsource);
+  if(size != EXPECTED_COLUMNS_COUNT) {
+    fprintf(stderr,
+            "%s: read_rows returned %d columns (variables) for a reduced rowsource, expected %d\n",
+            program, size, EXPECTED_COLUMNS_COUNT);
+    failures++;
+    goto tidy;
+  }
+  for(i = 0; i < EXPECTED_COLUMNS_COUNT; i++) {
+    rasqal_variable* v;
+    const char* name = NULL;
+    const char *expected_name = reduced_result_vars[i];
+
+    v = rasqal_rowsource_get_variable_by_offset(rowsource, i);
+    if(!v) {
+      fprintf(stderr,
+              "%s: read_rows had NULL column (variable) #%d expected %s\n",
+              program, i, expected_name);
+      failures++;
+      goto tidy;
+    }
+    name = RASQAL_GOOD_CAST(const char*, v->name);
+    if(strcmp(name, expected_name)) {
+      fprintf(stderr,
+              "%s: read_rows returned column (variable) #%d %s but expected %s\n",
+              program, i, name, expected_name);
+      failures++;
+      goto tidy;
+    }
+  }
+
+#ifdef RASQAL_DEBUG
+  rasqal_rowsource_print_row_sequence(rowsource, seq, DEBUG_FH);
+#endif
+
+  tidy:
+  if(seq)
+    raptor_free_sequence(seq);
+  if(input_rs)
+    rasqal_free_rowsource(input_rs);
+  if(rowsource)
+    rasqal_free_rowsource(rowsource);
+  if(query)
+    rasqal_free_query(query);
+  if(world)
+    rasqal_free_world(world);
+
+  return failures;
+}
+
+#endif /* STANDALONE */
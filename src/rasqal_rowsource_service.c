@@ -149,6 +149,9 @@ static const rasqal_rowsource_handler rasqal_service_rowsource_handler = {
   /* .set_preserve = */ NULL,
   /* .get_inner_rowsource = */ NULL,
   /* .set_origin = */ NULL,
+  /* .read_batch = */ NULL,
+  /* .get_order = */ NULL,
+  /* .set_outer_variables = */ NULL,
 };
 
 
@@ -57,6 +57,12 @@ typedef struct
 
   /* offset for output row */
   int output_offset;
+
+  /* batch of inner rowsource rows for read_batch() */
+  rasqal_row_batch* input;
+
+  /* non-0 when read_batch() has gone beyond the result range */
+  int finished;
 } rasqal_slice_rowsource_context;
 
 
@@ -102,6 +108,9 @@ rasqal_slice_rowsource_finish(rasqal_rowsource* rowsource, void *user_data)
 
   if(con->rowsource)
     rasqal_free_rowsource(con->rowsource);
+
+  if(con->input)
+    rasqal_free_row_batch(con->input);
   
   RASQAL_FREE(rasqal_slice_rowsource_context, con);
 
@@ -154,6 +163,84 @@ rasqal_slice_rowsource_read_row(rasqal_rowsource* rowsource, void *user_data)
 }
 
 
+/*
+ * rasqal_slice_rowsource_read_batch:
+ *
+ * INTERNAL - read a batch of rows in the result range
+ *
+ * The inner batch is no larger than the last row of the range so a
+ * LIMIT smaller than the batch size does not read extra inner rows.
+ */
+static int
+rasqal_slice_rowsource_read_batch(rasqal_rowsource* rowsource,
+                                  void *user_data,
+                                  rasqal_row_batch* batch)
+{
+  rasqal_slice_rowsource_context *con;
+
+  con = (rasqal_slice_rowsource_context*)user_data;
+
+  if(con->finished)
+    return 0;
+
+  if(!con->input) {
+    int capacity = batch->capacity;
+
+    if(con->row_limit >= 0) {
+      int last = con->row_limit + (con->row_offset > 0 ? con->row_offset : 0);
+      if(last < capacity)
+        capacity = last > 0 ? last : 1;
+    }
+
+    con->input = rasqal_new_row_batch(con->rowsource, capacity);
+    if(!con->input)
+      return -1;
+  }
+
+  while(!batch->count && !con->finished) {
+    int count;
+    int r;
+
+    count = rasqal_rowsource_read_batch(con->rowsource, con->input);
+    if(count <= 0)
+      return count;
+
+    for(r = 0; r < count; r++) {
+      int check;
+      int index;
+
+      check = rasqal_query_check_limit_offset_core(con->input_offset,
+                                                   con->row_limit,
+                                                   con->row_offset);
+      con->input_offset++;
+
+      /* finished if beyond result range */
+      if(check > 0) {
+        con->finished = 1;
+        break;
+      }
+
+      /* before the start of result range */
+      if(check < 0)
+        continue;
+
+      index = rasqal_row_batch_new_row(batch);
+      if(index < 0)
+        return -1;
+
+      rasqal_row_batch_merge_values(batch, index, con->input, r, NULL);
+      batch->offsets[index] = con->output_offset++;
+      batch->group_ids[index] = con->input->group_ids[r];
+    }
+
+    RASQAL_DEBUG4("slice rowsource %p kept %d rows of an input batch of %d\n",
+                  rowsource, batch->count, count);
+  }
+
+  return batch->count;
+}
+
+
 static int
 rasqal_slice_rowsource_reset(rasqal_rowsource* rowsource, void *user_data)
 {
@@ -163,11 +250,26 @@ rasqal_slice_rowsource_reset(rasqal_rowsource* rowsource, void *user_data)
 
   con->input_offset = 1;
   con->output_offset = 1;
+  con->finished = 0;
+
+  if(con->input)
+    rasqal_row_batch_clear(con->input);
 
   return rasqal_rowsource_reset(con->rowsource);
 }
 
 
+static rasqal_variable*
+rasqal_slice_rowsource_get_order(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_slice_rowsource_context *con;
+  con = (rasqal_slice_rowsource_context*)user_data;
+
+  /* rows keep their inner order */
+  return rasqal_rowsource_get_order(con->rowsource);
+}
+
+
 static rasqal_rowsource*
 rasqal_slice_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource,
                                             void *user_data, int offset)
@@ -183,7 +285,7 @@ rasqal_slice_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource,
 
 
 static const rasqal_rowsource_handler rasqal_slice_rowsource_handler = {
-  /* .version =          */ 1,
+  /* .version =          */ 2,
   "slice",
   /* .init =             */ rasqal_slice_rowsource_init,
   /* .finish =           */ rasqal_slice_rowsource_finish,
@@ -194,6 +296,9 @@ static const rasqal_rowsource_handler rasqal_slice_rowsource_handler = {
   /* .set_requirements = */ NULL,
   /* .get_inner_rowsource = */ rasqal_slice_rowsource_get_inner_rowsource,
   /* .set_origin =       */ NULL,
+  /* .read_batch =       */ rasqal_slice_rowsource_read_batch,
+  /* .get_order =        */ rasqal_slice_rowsource_get_order,
+  /* .set_outer_variables = */ NULL
 };
 
 
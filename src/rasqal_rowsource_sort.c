@@ -83,9 +83,12 @@ rasqal_sort_rowsource_init(rasqal_rowsource* rowsource, void *user_data)
   
   con->map = NULL;
 
-  if(con->order_size > 0 ) {
-    /* make a row:NULL map in order to sort or do distinct
+  if(con->order_size > 0 && con->distinct) {
+    /* make a row:NULL map in order to sort and do distinct
      * FIXME: should DISTINCT be separate? 
+     *
+     * Without DISTINCT the rows are sorted as a sequence in
+     * rasqal_sort_rowsource_process()
      */
     con->map = rasqal_engine_new_rowsort_map(con->distinct,
                                              query->compare_flags,
@@ -127,14 +130,35 @@ rasqal_sort_rowsource_process(rasqal_rowsource* rowsource,
       return 1;
     }
 
-    rasqal_engine_rowsort_calculate_order_values(rowsource->query, con->order_seq, row);
+    rasqal_engine_rowsort_calculate_order_values(rowsource->query, con->order_seq, row,
+                                                 con->distinct);
 
     row->offset = offset;
 
+    if(!con->map) {
+      /* after this, row is owned by seq */
+      if(raptor_sequence_push(con->seq, row))
+        return 1;
+      offset++;
+      continue;
+    }
+
     /* after this, row is owned by map */
     if(!rasqal_engine_rowsort_map_add_row(con->map, row))
       offset++;
   }
+
+  if(!con->map) {
+    raptor_sequence* seq;
+
+    seq = rasqal_engine_rowsort_sort_sequence(con->seq,
+                                              rowsource->query->compare_flags,
+                                              con->order_seq);
+    raptor_free_sequence(con->seq);
+    con->seq = seq;
+
+    return seq ? 0 : 1;
+  }
   
 #ifdef RASQAL_DEBUG
   fputs("resulting ", DEBUG_FH);
@@ -216,6 +240,44 @@ rasqal_sort_rowsource_read_all_rows(rasqal_rowsource* rowsource,
 }
 
 
+/*
+ * rasqal_sort_rowsource_get_order:
+ *
+ * INTERNAL - get the variable of a first ORDER BY condition on a plain
+ * variable in ascending order
+ *
+ * DISTINCT sorting compares as RDF terms so it is not ORDER BY order.
+ */
+static rasqal_variable*
+rasqal_sort_rowsource_get_order(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_sort_rowsource_context *con;
+  rasqal_expression* e;
+  rasqal_variable* v;
+
+  con = (rasqal_sort_rowsource_context*)user_data;
+
+  if(con->order_size <= 0 || con->distinct)
+    return NULL;
+
+  e = (rasqal_expression*)raptor_sequence_get_at(con->order_seq, 0);
+  if(e->op == RASQAL_EXPR_ORDER_COND_DESC)
+    return NULL;
+  if(e->op == RASQAL_EXPR_ORDER_COND_ASC)
+    e = e->arg1;
+
+  if(e->op != RASQAL_EXPR_LITERAL ||
+     e->literal->type != RASQAL_LITERAL_VARIABLE)
+    return NULL;
+
+  v = e->literal->value.variable;
+  if(rasqal_rowsource_get_variable_offset_by_name(rowsource, v->name) < 0)
+    return NULL;
+
+  return v;
+}
+
+
 static rasqal_rowsource*
 rasqal_sort_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource,
                                           void *user_data, int offset)
@@ -230,7 +292,7 @@ rasqal_sort_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource,
 
  
 static const rasqal_rowsource_handler rasqal_sort_rowsource_handler = {
-  /* .version =          */ 1,
+  /* .version =          */ 2,
   "sort",
   /* .init =             */ rasqal_sort_rowsource_init,
   /* .finish =           */ rasqal_sort_rowsource_finish,
@@ -241,6 +303,9 @@ static const rasqal_rowsource_handler rasqal_sort_rowsource_handler = {
   /* .set_requirements = */ NULL,
   /* .get_inner_rowsource = */ rasqal_sort_rowsource_get_inner_rowsource,
   /* .set_origin =       */ NULL,
+  /* .read_batch =       */ NULL,
+  /* .get_order =        */ rasqal_sort_rowsource_get_order,
+  /* .set_outer_variables = */ NULL
 };
 
 
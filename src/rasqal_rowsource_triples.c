@@ -48,9 +48,13 @@ typedef struct
   /* source of triple pattern matches */
   rasqal_triples_source* triples_source;
 
-  /* sequence of triple SHARED with query */
+  /* sequence of triple SHARED with query or owned here when
+   * @triples_owned is set */
   raptor_sequence* triples;
 
+  /* non-0 if @triples is a copy owned by this rowsource */
+  int triples_owned;
+
   /* current column being iterated */
   int column;
 
@@ -67,6 +71,10 @@ typedef struct
   /* An array of items, one per triple pattern in the sequence */
   rasqal_triple_meta* triple_meta;
 
+  /* An array of triple pattern columns in the order they are matched;
+   * triple_meta[i] is for column order[i] */
+  int* order;
+
   /* offset into results for current row */
   int offset;
   
@@ -75,9 +83,261 @@ typedef struct
   
   /* GRAPH origin to use */
   rasqal_literal *origin;
+
+  /* variables bound by an outer join before reading or NULL */
+  raptor_sequence* outer_variables;
+
+  /* non-0 if the match order must be chosen again before matching */
+  int replan;
 } rasqal_triples_rowsource_context;
 
 
+/*
+ * rasqal_triples_rowsource_variable_is_outer:
+ * @con: triples rowsource context
+ * @v: variable
+ *
+ * INTERNAL - Test if a variable currently has a value from an outer join
+ *
+ * Return value: non-0 if @v is an outer variable with a value
+ */
+static int
+rasqal_triples_rowsource_variable_is_outer(rasqal_triples_rowsource_context* con,
+                                           rasqal_variable* v)
+{
+  int i;
+  rasqal_variable* ov;
+
+  if(!con->outer_variables || !v->value)
+    return 0;
+
+  for(i = 0;
+      (ov = (rasqal_variable*)raptor_sequence_get_at(con->outer_variables, i));
+      i++) {
+    if(ov == v)
+      return 1;
+  }
+
+  return 0;
+}
+
+
+/*
+ * rasqal_triples_rowsource_variable_is_bound:
+ * @query: query
+ * @con: triples rowsource context
+ * @v: variable
+ *
+ * INTERNAL - Test if a variable is bound by any triple pattern in this rowsource
+ *
+ * Variables only used here but bound elsewhere are never bound by
+ * matching.
+ *
+ * Return value: non-0 if bound
+ */
+static int
+rasqal_triples_rowsource_variable_is_bound(rasqal_query* query,
+                                           rasqal_triples_rowsource_context* con,
+                                           rasqal_variable* v)
+{
+  int column;
+
+  for(column = con->start_column; column <= con->end_column; column++) {
+    if(rasqal_query_variable_bound_in_triple(query, v, column) & RASQAL_TRIPLE_SPO)
+      return 1;
+  }
+
+  return 0;
+}
+
+
+/*
+ * rasqal_triples_rowsource_variable_seen:
+ * @con: triples rowsource context
+ * @v: variable
+ * @count: number of triple patterns in the match order to check
+ *
+ * INTERNAL - Test if a variable is in the first @count triple patterns matched
+ *
+ * Return value: non-0 if the variable appears in the subject,
+ * predicate or object of an earlier triple pattern
+ */
+static int
+rasqal_triples_rowsource_variable_seen(rasqal_triples_rowsource_context* con,
+                                       rasqal_variable* v, int count)
+{
+  int i;
+
+  for(i = 0; i < count; i++) {
+    rasqal_triple *t;
+
+    t = (rasqal_triple*)raptor_sequence_get_at(con->triples, con->order[i]);
+    if(rasqal_literal_as_variable(t->subject) == v ||
+       rasqal_literal_as_variable(t->predicate) == v ||
+       rasqal_literal_as_variable(t->object) == v)
+      return 1;
+  }
+
+  return 0;
+}
+
+
+/*
+ * rasqal_triples_rowsource_term_is_fixed:
+ * @query: query
+ * @con: triples rowsource context
+ * @term: triple pattern term
+ * @count: number of triple patterns already in the match order
+ *
+ * INTERNAL - Test if a triple term has a known value when it is matched
+ *
+ * Return value: non-0 if @term is a constant, a variable with a value
+ * from an outer join or a variable bound by an earlier triple pattern
+ */
+static int
+rasqal_triples_rowsource_term_is_fixed(rasqal_query* query,
+                                       rasqal_triples_rowsource_context* con,
+                                       rasqal_literal* term, int count)
+{
+  rasqal_variable* v = rasqal_literal_as_variable(term);
+
+  if(!v || rasqal_triples_rowsource_variable_is_outer(con, v))
+    return 1;
+
+  return rasqal_triples_rowsource_variable_is_bound(query, con, v) &&
+         rasqal_triples_rowsource_variable_seen(con, v, count);
+}
+
+
+/*
+ * rasqal_triples_rowsource_order_triples:
+ * @query: query
+ * @con: triples rowsource context
+ *
+ * INTERNAL - Choose the order the triple patterns are matched in
+ *
+ * Each triple pattern is matched once for every solution of the
+ * patterns before it, so the patterns with the most fixed terms are
+ * matched first.  A fixed term is a constant or a variable bound by
+ * an already chosen pattern, which also keeps patterns joined to
+ * the earlier ones ahead of unconnected ones.  A fixed subject
+ * counts most then the object then the predicate.  Ties keep the
+ * query order.
+ */
+static void
+rasqal_triples_rowsource_order_triples(rasqal_query* query,
+                                       rasqal_triples_rowsource_context* con)
+{
+  int count;
+  int column;
+
+  for(count = 0; count < con->triples_count; count++)
+    con->order[count] = -1;
+
+  for(count = 0; count < con->triples_count; count++) {
+    int best_column = -1;
+    int best_score = -1;
+
+    for(column = con->start_column; column <= con->end_column; column++) {
+      rasqal_triple *t;
+      int score = 0;
+      int i;
+
+      for(i = 0; i < count; i++) {
+        if(con->order[i] == column)
+          break;
+      }
+      if(i < count)
+        /* already ordered */
+        continue;
+
+      t = (rasqal_triple*)raptor_sequence_get_at(con->triples, column);
+      if(rasqal_triples_rowsource_term_is_fixed(query, con, t->subject, count))
+        score += 4;
+      if(rasqal_triples_rowsource_term_is_fixed(query, con, t->object, count))
+        score += 2;
+      if(rasqal_triples_rowsource_term_is_fixed(query, con, t->predicate, count))
+        score += 1;
+
+      if(score > best_score) {
+        best_score = score;
+        best_column = column;
+      }
+    }
+
+    con->order[count] = best_column;
+    RASQAL_DEBUG4("triple pattern column %d matched at position %d (score %d)\n",
+                  best_column, count, best_score);
+  }
+}
+
+
+/*
+ * rasqal_triples_rowsource_plan:
+ * @query: query
+ * @con: triples rowsource context
+ *
+ * INTERNAL - Choose the match order and the parts each triple pattern binds
+ *
+ * Variables with values from an outer join are matched as constants
+ * and never bound here.  When the origin set by
+ * rasqal_triples_rowsource_set_origin() is a variable, the first
+ * triple pattern binds it.
+ */
+static void
+rasqal_triples_rowsource_plan(rasqal_query* query,
+                              rasqal_triples_rowsource_context* con)
+{
+  int i;
+
+  rasqal_triples_rowsource_order_triples(query, con);
+
+  /* A variable is bound by the first triple pattern in match order
+   * that mentions it */
+  for(i = 0; i < con->triples_count; i++) {
+    rasqal_triple_meta *m;
+    rasqal_triple *t;
+    rasqal_variable* v;
+    int column;
+
+    m = &con->triple_meta[i];
+
+    m->parts = (rasqal_triple_parts)0;
+
+    column = con->order[i];
+    t = (rasqal_triple*)raptor_sequence_get_at(con->triples, column);
+    
+    if((v = rasqal_literal_as_variable(t->subject)) &&
+       !rasqal_triples_rowsource_variable_is_outer(con, v) &&
+       rasqal_triples_rowsource_variable_is_bound(query, con, v) &&
+       !rasqal_triples_rowsource_variable_seen(con, v, i))
+      m->parts = (rasqal_triple_parts)(m->parts | RASQAL_TRIPLE_SUBJECT);
+    
+    if((v = rasqal_literal_as_variable(t->predicate)) &&
+       !rasqal_triples_rowsource_variable_is_outer(con, v) &&
+       rasqal_triples_rowsource_variable_is_bound(query, con, v) &&
+       !rasqal_triples_rowsource_variable_seen(con, v, i))
+      m->parts = (rasqal_triple_parts)(m->parts | RASQAL_TRIPLE_PREDICATE);
+    
+    if((v = rasqal_literal_as_variable(t->object)) &&
+       !rasqal_triples_rowsource_variable_is_outer(con, v) &&
+       rasqal_triples_rowsource_variable_is_bound(query, con, v) &&
+       !rasqal_triples_rowsource_variable_seen(con, v, i))
+      m->parts = (rasqal_triple_parts)(m->parts | RASQAL_TRIPLE_OBJECT);
+
+    /* A GRAPH variable origin is bound from the data by the first
+     * triple pattern and matched as a constant by the rest */
+    if(!i && con->origin &&
+       (v = rasqal_literal_as_variable(con->origin)) &&
+       !rasqal_triples_rowsource_variable_is_outer(con, v))
+      m->parts = (rasqal_triple_parts)(m->parts | RASQAL_TRIPLE_ORIGIN);
+
+    RASQAL_DEBUG4("triple pattern column %d has parts %s (%u)\n", column,
+                  rasqal_engine_get_parts_string(m->parts), m->parts);
+  }
+}
+
+
 static int
 rasqal_triples_rowsource_init(rasqal_rowsource* rowsource, void *user_data)
 {
@@ -111,33 +371,7 @@ rasqal_triples_rowsource_init(rasqal_rowsource* rowsource, void *user_data)
 
   con->column = con->start_column;
 
-  for(column = con->start_column; column <= con->end_column; column++) {
-    rasqal_triple_meta *m;
-    rasqal_triple *t;
-    rasqal_variable* v;
-
-    m = &con->triple_meta[column - con->start_column];
-
-    m->parts = (rasqal_triple_parts)0;
-
-    t = (rasqal_triple*)raptor_sequence_get_at(con->triples, column);
-    
-    if((v = rasqal_literal_as_variable(t->subject)) &&
-       rasqal_query_variable_bound_in_triple(query, v, column) & RASQAL_TRIPLE_SUBJECT)
-      m->parts = (rasqal_triple_parts)(m->parts | RASQAL_TRIPLE_SUBJECT);
-    
-    if((v = rasqal_literal_as_variable(t->predicate)) &&
-       rasqal_query_variable_bound_in_triple(query, v, column) & RASQAL_TRIPLE_PREDICATE)
-      m->parts = (rasqal_triple_parts)(m->parts | RASQAL_TRIPLE_PREDICATE);
-    
-    if((v = rasqal_literal_as_variable(t->object)) &&
-       rasqal_query_variable_bound_in_triple(query, v, column) & RASQAL_TRIPLE_OBJECT)
-      m->parts = (rasqal_triple_parts)(m->parts | RASQAL_TRIPLE_OBJECT);
-
-    RASQAL_DEBUG4("triple pattern column %d has parts %s (%u)\n", column,
-                  rasqal_engine_get_parts_string(m->parts), m->parts);
-
-  }
+  rasqal_triples_rowsource_plan(query, con);
   
   return rc;
 }
@@ -174,9 +408,18 @@ rasqal_triples_rowsource_finish(rasqal_rowsource* rowsource, void *user_data)
     RASQAL_FREE(rasqal_triple_meta, con->triple_meta);
   }
 
+  if(con->order)
+    RASQAL_FREE(intarray, con->order);
+
   if(con->origin)
     rasqal_free_literal(con->origin);
 
+  if(con->triples_owned && con->triples)
+    raptor_free_sequence(con->triples);
+
+  if(con->outer_variables)
+    raptor_free_sequence(con->outer_variables);
+
   RASQAL_FREE(rasqal_triples_rowsource_context, con);
 
   return 0;
@@ -189,13 +432,20 @@ rasqal_triples_rowsource_get_next_row(rasqal_rowsource* rowsource,
 {
   rasqal_query *query = rowsource->query;
   rasqal_engine_error error = RASQAL_ENGINE_OK;
+
+  if(con->replan) {
+    /* outer values are bound now or the origin changed */
+    rasqal_triples_rowsource_plan(query, con);
+    con->replan = 0;
+  }
   
   while(con->column >= con->start_column) {
     rasqal_triple_meta *m;
     rasqal_triple *t;
 
     m = &con->triple_meta[con->column - con->start_column];
-    t = (rasqal_triple*)raptor_sequence_get_at(con->triples, con->column);
+    t = (rasqal_triple*)raptor_sequence_get_at(con->triples,
+                                               con->order[con->column - con->start_column]);
 
     error = RASQAL_ENGINE_OK;
 
@@ -336,6 +586,10 @@ rasqal_triples_rowsource_reset(rasqal_rowsource* rowsource, void *user_data)
     rasqal_reset_triple_meta(m);
   }
 
+  /* the outer join binds new values after the reset */
+  if(con->outer_variables)
+    con->replan = 1;
+
   return 0;
 }
 
@@ -353,6 +607,30 @@ rasqal_triples_rowsource_set_origin(rasqal_rowsource *rowsource,
     rasqal_free_literal(con->origin);
   con->origin = rasqal_new_literal_from_literal(origin);
 
+  if(!con->triples_owned) {
+    raptor_sequence* triples;
+
+    /* Copy the triples so the origin is not set in the triples
+     * shared with the query and other executions of it */
+    triples = raptor_new_sequence((raptor_data_free_handler)rasqal_free_triple,
+                                  (raptor_data_print_handler)rasqal_triple_print);
+    if(!triples)
+      return 1;
+
+    for(column = con->start_column; column <= con->end_column; column++) {
+      rasqal_triple *t;
+      t = (rasqal_triple*)raptor_sequence_get_at(con->triples, column);
+      t = rasqal_new_triple_from_triple(t);
+      if(!t || raptor_sequence_set_at(triples, column, t)) {
+        raptor_free_sequence(triples);
+        return 1;
+      }
+    }
+
+    con->triples = triples;
+    con->triples_owned = 1;
+  }
+
   for(column = con->start_column; column <= con->end_column; column++) {
     rasqal_triple *t;
     t = (rasqal_triple*)raptor_sequence_get_at(con->triples, column);
@@ -360,13 +638,60 @@ rasqal_triples_rowsource_set_origin(rasqal_rowsource *rowsource,
       rasqal_free_literal(t->origin);
     t->origin = rasqal_new_literal_from_literal(con->origin);
   }
+
+  /* a variable origin changes the parts bound */
+  con->replan = 1;
   
   return 0;
 }
 
 
+/*
+ * rasqal_triples_rowsource_set_outer_variables:
+ *
+ * INTERNAL - use values bound by an outer join as triple pattern constants
+ *
+ * Turns the nested loop join above into an index nested loop join:
+ * the triples source is asked only for triples matching the outer
+ * row instead of returning every match for the join to check.
+ */
+static int
+rasqal_triples_rowsource_set_outer_variables(rasqal_rowsource* rowsource,
+                                             void *user_data,
+                                             raptor_sequence* variables)
+{
+  rasqal_triples_rowsource_context *con;
+  rasqal_variable* v;
+  int i;
+
+  con = (rasqal_triples_rowsource_context*)user_data;
+
+  for(i = 0; (v = (rasqal_variable*)raptor_sequence_get_at(variables, i)); i++) {
+    int offset;
+
+    offset = rasqal_rowsource_get_variable_offset_by_name(rowsource, v->name);
+    if(offset < 0)
+      continue;
+
+    if(!con->outer_variables) {
+      con->outer_variables = raptor_new_sequence((raptor_data_free_handler)rasqal_free_variable,
+                                                 (raptor_data_print_handler)rasqal_variable_print);
+      if(!con->outer_variables)
+        return 1;
+    }
+
+    v = rasqal_rowsource_get_variable_by_offset(rowsource, offset);
+    if(raptor_sequence_push(con->outer_variables,
+                            rasqal_new_variable_from_variable(v)))
+      return 1;
+  }
+
+  return con->outer_variables ? 0 : 1;
+}
+
+
 static const rasqal_rowsource_handler rasqal_triples_rowsource_handler = {
-  /* .version = */ 1,
+  /* .version = */ 2,
   "triple pattern",
   /* .init = */ rasqal_triples_rowsource_init,
   /* .finish = */ rasqal_triples_rowsource_finish,
@@ -376,7 +701,10 @@ static const rasqal_rowsource_handler rasqal_triples_rowsource_handler = {
   /* .reset = */ rasqal_triples_rowsource_reset,
   /* .set_requirements = */ NULL,
   /* .get_inner_rowsource = */ NULL,
-  /* .set_origin = */ rasqal_triples_rowsource_set_origin
+  /* .set_origin = */ rasqal_triples_rowsource_set_origin,
+  /* .read_batch = */ NULL,
+  /* .get_order = */ NULL,
+  /* .set_outer_variables = */ rasqal_triples_rowsource_set_outer_variables
 };
 
 
@@ -424,7 +752,9 @@ rasqal_new_triples_rowsource(rasqal_world *world,
 
   con->triple_meta = RASQAL_CALLOC(rasqal_triple_meta*, RASQAL_GOOD_CAST(size_t, con->triples_count),
                                    sizeof(rasqal_triple_meta));
-  if(!con->triple_meta) {
+  con->order = RASQAL_CALLOC(int*, RASQAL_GOOD_CAST(size_t, con->triples_count),
+                             sizeof(int));
+  if(!con->triple_meta || !con->order) {
     rasqal_triples_rowsource_finish(NULL, con);
     return NULL;
   }
@@ -42,7 +42,87 @@
 #include <rasqal.h>
 #include <rasqal_internal.h>
 
-#include "ssort.h"
+/* Runs this short are sorted by insertion before merging */
+#define RASQAL_SORT_INSERTION_SIZE 16
+
+
+/*
+ * rasqal_sort_insertion:
+ * @array: array of pointers
+ * @size: number of entries
+ * @compare: comparison function taking pointers to two entries
+ * @user_data: user data for @compare
+ *
+ * INTERNAL - Stable insertion sort of a short array
+ */
+static void
+rasqal_sort_insertion(void** array, size_t size,
+                      raptor_data_compare_arg_handler compare,
+                      void* user_data)
+{
+  size_t i;
+
+  for(i = 1; i < size; i++) {
+    void* entry = array[i];
+    size_t j = i;
+
+    while(j > 0 && compare(&array[j - 1], &entry, user_data) > 0) {
+      array[j] = array[j - 1];
+      j--;
+    }
+    array[j] = entry;
+  }
+}
+
+
+/*
+ * rasqal_sort_merge:
+ * @array: array of pointers
+ * @tmp: work array of at least @size / 2 + 1 entries
+ * @size: number of entries
+ * @compare: comparison function taking pointers to two entries
+ * @user_data: user data for @compare
+ *
+ * INTERNAL - Stable merge sort
+ *
+ * Halves that are already in order are not merged so sorted input
+ * takes O(n) comparisons.
+ */
+static void
+rasqal_sort_merge(void** array, void** tmp, size_t size,
+                  raptor_data_compare_arg_handler compare,
+                  void* user_data)
+{
+  size_t half;
+  size_t i, j, k;
+
+  if(size <= RASQAL_SORT_INSERTION_SIZE) {
+    rasqal_sort_insertion(array, size, compare, user_data);
+    return;
+  }
+
+  half = size / 2;
+  rasqal_sort_merge(array, tmp, half, compare, user_data);
+  rasqal_sort_merge(array + half, tmp, size - half, compare, user_data);
+
+  if(compare(&array[half - 1], &array[half], user_data) <= 0)
+    return;
+
+  /* merge the left half copied to tmp with the right half in place;
+   * taking from the left on ties keeps the sort stable */
+  memcpy(tmp, array, half * sizeof(void*));
+  i = 0;
+  j = half;
+  k = 0;
+  while(i < half && j < size) {
+    if(compare(&array[j], &tmp[i], user_data) < 0)
+      array[k++] = array[j++];
+    else
+      array[k++] = tmp[i++];
+  }
+  while(i < half)
+    array[k++] = tmp[i++];
+}
 
 
 /*
@@ -54,6 +134,10 @@
  * INTERNAL - Sort the entries in a sequence and return the sort
  * order as an array of pointers (NULL terminated)
  *
+ * The sort is a stable merge sort: entries that @compare finds equal
+ * stay in sequence order.  @compare is called with pointers to the
+ * array entries as for qsort_r().
+ *
  * Return value: array or NULL on failure (or sequence is empty)
  */
 void**
@@ -74,11 +158,23 @@ rasqal_sequence_as_sorted(raptor_sequence* seq,
 
   if(size) {
     size_t i;
+    void** tmp = NULL;
 
     for(i = 0; i < size; i++)
       array[i] = raptor_sequence_get_at(seq, RASQAL_GOOD_CAST(int, i));
 
-    rasqal_ssort_r(array, size, sizeof(void*), compare, user_data);
+    if(size > RASQAL_SORT_INSERTION_SIZE) {
+      tmp = RASQAL_CALLOC(void**, size / 2 + 1, sizeof(void*));
+      if(!tmp) {
+        RASQAL_FREE(void*, array);
+        return NULL;
+      }
+    }
+
+    rasqal_sort_merge(array, tmp, size, compare, user_data);
+
+    if(tmp)
+      RASQAL_FREE(void*, tmp);
   }
 
   return array;
@@ -96,6 +96,7 @@ rasqal_new_triple_from_triple(rasqal_triple* t)
     newt->subject = rasqal_new_literal_from_literal(t->subject);
     newt->predicate = rasqal_new_literal_from_literal(t->predicate);
     newt->object = rasqal_new_literal_from_literal(t->object);
+    newt->path = rasqal_new_path_from_path(t->path);
   }
 
   return newt;
@@ -122,6 +123,8 @@ rasqal_free_triple(rasqal_triple* t)
     rasqal_free_literal(t->object);
   if(t->origin)
     rasqal_free_literal(t->origin);
+  if(t->path)
+    rasqal_free_path(t->path);
   RASQAL_FREE(rasqal_triple, t);
 }
 
@@ -144,7 +147,10 @@ rasqal_triple_write(rasqal_triple* t, raptor_iostream* iostr)
   raptor_iostream_counted_string_write("triple(", 7, iostr);
   rasqal_literal_write(t->subject, iostr);
   raptor_iostream_counted_string_write(", ", 2, iostr);
-  rasqal_literal_write(t->predicate, iostr);
+  if(t->path)
+    rasqal_path_write(t->path, iostr);
+  else
+    rasqal_literal_write(t->predicate, iostr);
   raptor_iostream_counted_string_write(", ", 2, iostr);
   rasqal_literal_write(t->object, iostr);
   raptor_iostream_write_byte(')', iostr);
@@ -176,7 +182,10 @@ rasqal_triple_print(rasqal_triple* t, FILE* fh)
   fputs("triple(", fh);
   rasqal_literal_print(t->subject, fh);
   fputs(", ", fh);
-  rasqal_literal_print(t->predicate, fh);
+  if(t->path)
+    rasqal_path_print(t->path, fh);
+  else
+    rasqal_literal_print(t->predicate, fh);
   fputs(", ", fh);
   rasqal_literal_print(t->object, fh);
   fputc(')', fh);
@@ -141,7 +141,22 @@ rasqal_new_triples_source(rasqal_query* query)
 {
   rasqal_triples_source_factory* rtsf = &query->world->triples_source_factory;
   rasqal_triples_source* rts;
+  rasqal_data_graph* dg;
   int rc = 0;
+  int i;
+
+  /* Other triples sources only know how to read data graph URIs and
+   * iostreams so would silently find no triples in memory */
+  if(!rasqal_raptor_is_triples_source_factory(rtsf)) {
+    for(i = 0; (dg = rasqal_query_get_data_graph(query, i)); i++) {
+      if(dg->triples) {
+        rasqal_log_error_simple(query->world, RAPTOR_LOG_LEVEL_ERROR,
+                                &query->locator,
+                                "Data graphs held in memory need the built-in triples source.");
+        return NULL;
+      }
+    }
+  }
   
   rts = RASQAL_CALLOC(rasqal_triples_source*, 1, sizeof(*rts));
   if(!rts)
@@ -275,7 +290,8 @@ rasqal_new_triples_match(rasqal_query* query,
     rtm->is_exact = 1;
     if(rasqal_literal_as_variable(t->predicate) ||
        rasqal_literal_as_variable(t->subject) ||
-       rasqal_literal_as_variable(t->object))
+       rasqal_literal_as_variable(t->object) ||
+       (t->origin && rasqal_literal_as_variable(t->origin)))
       rtm->is_exact = 0;
 
     if(rtm->is_exact) {
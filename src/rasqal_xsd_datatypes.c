@@ -591,33 +591,75 @@ rasqal_xsd_finish(rasqal_world* world)
  
 
   
+/*
+ * rasqal_xsd_datatype_offset_to_type:
+ * @i: offset into world xsd_datatype_uris
+ *
+ * INTERNAL - Get the literal type for an XSD datatype URI table offset
+ *
+ * Return value: type or RASQAL_LITERAL_UNKNOWN if not a recognised offset
+ */
+static rasqal_literal_type
+rasqal_xsd_datatype_offset_to_type(int i)
+{
+  if(i >= RASQAL_GOOD_CAST(int, RASQAL_LITERAL_FIRST_XSD) &&
+     i < RASQAL_GOOD_CAST(int, XSD_INTEGER_DERIVED_FIRST))
+    return (rasqal_literal_type)i;
+
+  if(i >= RASQAL_GOOD_CAST(int, XSD_INTEGER_DERIVED_FIRST) &&
+     i <= RASQAL_GOOD_CAST(int, XSD_INTEGER_DERIVED_LAST))
+    return RASQAL_LITERAL_INTEGER_SUBTYPE;
+
+  /* DATE is not in the range FIRST_XSD .. INTEGER_DERIVED_LAST */
+  if(i == RASQAL_GOOD_CAST(int, XSD_DATE_OFFSET))
+    return RASQAL_LITERAL_DATE;
+
+  return RASQAL_LITERAL_UNKNOWN;
+}
+
+
+/*
+ * rasqal_xsd_datatype_uri_to_type:
+ * @world: world
+ * @uri: datatype URI
+ *
+ * INTERNAL - Get the literal type of a datatype URI
+ *
+ * URIs are usually interned by raptor so the datatype URI objects
+ * are checked by pointer first.  Otherwise only URIs in the XSD
+ * namespace are compared by local name.
+ *
+ * Return value: type or RASQAL_LITERAL_UNKNOWN if not an XSD datatype
+ */
 rasqal_literal_type
 rasqal_xsd_datatype_uri_to_type(rasqal_world* world, raptor_uri* uri)
 {
   int i;
-  rasqal_literal_type native_type = RASQAL_LITERAL_UNKNOWN;
-  
+  const unsigned char* uri_string;
+  size_t uri_len;
+  const unsigned char* ns_string;
+  size_t ns_len;
+
   if(!uri || !world->xsd_datatype_uris)
-    return native_type;
-  
-  for(i = RASQAL_GOOD_CAST(int, RASQAL_LITERAL_FIRST_XSD); i <= RASQAL_GOOD_CAST(int, XSD_INTEGER_DERIVED_LAST); i++) {
-    if(raptor_uri_equals(uri, world->xsd_datatype_uris[i])) {
-      if(i >= XSD_INTEGER_DERIVED_FIRST)
-        native_type = RASQAL_LITERAL_INTEGER_SUBTYPE;
-      else
-        native_type = (rasqal_literal_type)i;
-      break;
-    }
+    return RASQAL_LITERAL_UNKNOWN;
+
+  for(i = RASQAL_GOOD_CAST(int, RASQAL_LITERAL_FIRST_XSD); i < SPARQL_XSD_NAMES_COUNT; i++) {
+    if(uri == world->xsd_datatype_uris[i])
+      return rasqal_xsd_datatype_offset_to_type(i);
   }
 
-  if(native_type == RASQAL_LITERAL_UNKNOWN) {
-    /* DATE is not in the range FIRST_XSD .. INTEGER_DERIVED_LAST */
-    i = RASQAL_GOOD_CAST(int, XSD_DATE_OFFSET);
-    if(raptor_uri_equals(uri, world->xsd_datatype_uris[i]))
-      native_type = RASQAL_LITERAL_DATE;
+  uri_string = raptor_uri_as_counted_string(uri, &uri_len);
+  ns_string = raptor_uri_as_counted_string(world->xsd_namespace_uri, &ns_len);
+  if(uri_len <= ns_len || memcmp(uri_string, ns_string, ns_len))
+    return RASQAL_LITERAL_UNKNOWN;
+
+  uri_string += ns_len;
+  for(i = RASQAL_GOOD_CAST(int, RASQAL_LITERAL_FIRST_XSD); i < SPARQL_XSD_NAMES_COUNT; i++) {
+    if(!strcmp(RASQAL_GOOD_CAST(const char*, uri_string), sparql_xsd_names[i]))
+      return rasqal_xsd_datatype_offset_to_type(i);
   }
 
-  return native_type;
+  return RASQAL_LITERAL_UNKNOWN;
 }
 
 
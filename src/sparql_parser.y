@@ -120,6 +120,25 @@ free_uri_applies(sparql_uri_applies* ua)
 
 
 
+/* Property paths can only be used in query patterns, not templates */
+static int
+sparql_triples_have_path(raptor_sequence* triples)
+{
+  rasqal_triple* t;
+  int i;
+
+  if(!triples)
+    return 0;
+
+  for(i = 0; (t = (rasqal_triple*)raptor_sequence_get_at(triples, i)); i++) {
+    if(t->path)
+      return 1;
+  }
+
+  return 0;
+}
+
+
 static sparql_op_expr*
 new_op_expr(rasqal_op op, rasqal_expression *expr)
 {
@@ -215,20 +234,25 @@ print_op_expr(sparql_op_expr* oe, FILE* fh)
   rasqal_bindings* bindings;
   sparql_uri_applies* uri_applies;
   sparql_op_expr* op_expr;
+  rasqal_path* path;
 }
 
 
 /*
  * shift/reduce conflicts
  * FIXME: document this
- *  35 total
+ *  37 total
  *
  *   7 shift/reduce are OPTIONAL/GRAPH/FILTER/SERVICE/MINUS/LET/{
  *      after a TriplesBlockOpt has been accepted but before a
  *      GraphPatternListOpt.  Choice is made to reduce with GraphPatternListOpt.
+ *
+ *   2 shift/reduce are '(' starting a property path Verb after a
+ *      TriplesNode or ';' where the PropertyList may be empty.
+ *      Choice is made to shift into the path.
  * 
  */
-%expect 35
+%expect 37
 
 /* word symbols */
 %token SELECT FROM WHERE
@@ -256,7 +280,7 @@ print_op_expr(sparql_op_expr* oe, FILE* fh)
 %token TO ADD MOVE COPY ALL
 %token COALESCE
 %token AS IF
-%token NOT IN
+%token NOT IN EXISTS
 %token BINDINGS UNDEF SERVICE MINUS
 %token YEAR MONTH DAY HOURS MINUTES SECONDS TIMEZONE TZ
 %token STRLEN SUBSTR UCASE LCASE STRSTARTS STRENDS CONTAINS ENCODE_FOR_URI CONCAT
@@ -274,6 +298,8 @@ print_op_expr(sparql_op_expr* oe, FILE* fh)
 
 %token ',' '(' ')' '[' ']' '{' '}'
 %token '?' '$'
+%token '|' '^'
+%token PATH_ZERO_OR_ONE
 
 %token HATHAT "^^"
 
@@ -404,6 +430,9 @@ print_op_expr(sparql_op_expr* oe, FILE* fh)
 
 %type <op_expr> AdExOpUnaryExpression MuExOpUnaryExpression
 
+%type <path> Path PathAlternative PathSequence PathEltOrInverse PathElt
+%type <path> PathPrimary
+
 
 %destructor {
   if($$)
@@ -514,6 +543,12 @@ SeparatorOpt
 }
 Var VarName SelectTerm AsVarOpt
 
+%destructor {
+  if($$)
+    rasqal_free_path($$);
+}
+Path PathAlternative PathSequence PathEltOrInverse PathElt PathPrimary
+
 %destructor {
   if($$)
     rasqal_free_data_graph($$);
@@ -3899,8 +3934,12 @@ PropertyListNotEmpty: Verb ObjectList PropertyListTailOpt
     size = raptor_sequence_size(seq);
     for(i = 0; i < size; i++) {
       t2 = (rasqal_triple*)raptor_sequence_get_at(seq, i);
-      if(!t2->predicate)
-        t2->predicate = (rasqal_literal*)rasqal_new_literal_from_literal(predicate);
+      if(!t2->predicate && !t2->path) {
+        if(predicate)
+          t2->predicate = (rasqal_literal*)rasqal_new_literal_from_literal(predicate);
+        else
+          t2->path = rasqal_new_path_from_path($1->path);
+      }
     }
   
 #if defined(RASQAL_DEBUG) && RASQAL_DEBUG > 1  
@@ -4068,19 +4107,127 @@ Object: GraphNode
 
 
 /* SPARQL Grammar: Verb */
-Verb: VarOrIRIref
+Verb: Var
 {
   $$ = rasqal_new_formula(rq->world);
   if(!$$) {
     if($1)
-      rasqal_free_literal($1);
+      rasqal_free_variable($1);
     YYERROR_MSG("Verb 1: cannot create formula");
   }
-  $$->value = $1;
+  $$->value = rasqal_new_variable_literal(rq->world, $1);
+  if(!$$->value) {
+    rasqal_free_formula($$);
+    $$ = NULL;
+    YYERROR_MSG("Verb 1: cannot create literal");
+  }
+}
+| Path
+{
+  $$ = rasqal_new_formula(rq->world);
+  if(!$$) {
+    if($1)
+      rasqal_free_path($1);
+    YYERROR_MSG("Verb 2: cannot create formula");
+  }
+
+  if(rasqal_path_is_link($1)) {
+    /* a single IRI is a plain triple pattern predicate */
+    $$->value = rasqal_new_literal_from_literal($1->iri);
+    rasqal_free_path($1);
+  } else
+    $$->path = $1;
+}
+;
+
+
+/* SPARQL 1.1 Grammar: Path */
+Path: PathAlternative
+{
+  $$ = $1;
+}
+;
+
+
+/* SPARQL 1.1 Grammar: PathAlternative */
+PathAlternative: PathSequence
+{
+  $$ = $1;
+}
+| PathAlternative '|' PathSequence
+{
+  $$ = rasqal_new_path(RASQAL_PATH_OPERATOR_ALTERNATIVE, $1, $3);
+  if(!$$)
+    YYERROR_MSG("PathAlternative: cannot create path");
+}
+;
+
+
+/* SPARQL 1.1 Grammar: PathSequence */
+PathSequence: PathEltOrInverse
+{
+  $$ = $1;
+}
+| PathSequence '/' PathEltOrInverse
+{
+  $$ = rasqal_new_path(RASQAL_PATH_OPERATOR_SEQUENCE, $1, $3);
+  if(!$$)
+    YYERROR_MSG("PathSequence: cannot create path");
+}
+;
+
+
+/* SPARQL 1.1 Grammar: PathEltOrInverse */
+PathEltOrInverse: PathElt
+{
+  $$ = $1;
+}
+| '^' PathElt
+{
+  $$ = rasqal_new_path(RASQAL_PATH_OPERATOR_INVERSE, $2, NULL);
+  if(!$$)
+    YYERROR_MSG("PathEltOrInverse: cannot create path");
+}
+;
+
+
+/* SPARQL 1.1 Grammar: PathElt and PathMod */
+PathElt: PathPrimary
+{
+  $$ = $1;
+}
+| PathPrimary PATH_ZERO_OR_ONE
+{
+  $$ = rasqal_new_path(RASQAL_PATH_OPERATOR_ZERO_OR_ONE, $1, NULL);
+  if(!$$)
+    YYERROR_MSG("PathElt: cannot create path");
+}
+| PathPrimary '*'
+{
+  $$ = rasqal_new_path(RASQAL_PATH_OPERATOR_ZERO_OR_MORE, $1, NULL);
+  if(!$$)
+    YYERROR_MSG("PathElt: cannot create path");
+}
+| PathPrimary '+'
+{
+  $$ = rasqal_new_path(RASQAL_PATH_OPERATOR_ONE_OR_MORE, $1, NULL);
+  if(!$$)
+    YYERROR_MSG("PathElt: cannot create path");
+}
+;
+
+
+/* SPARQL 1.1 Grammar: PathPrimary */
+PathPrimary: IRIref
+{
+  $$ = rasqal_new_link_path($1);
+  if(!$$)
+    YYERROR_MSG("PathPrimary 1: cannot create path");
 }
 | A
 {
   raptor_uri *uri;
+  rasqal_literal *l;
 
 #if defined(RASQAL_DEBUG) && RASQAL_DEBUG > 1  
   fprintf(DEBUG_FH, "verb Verb=rdf:type (a)\n");
@@ -4089,18 +4236,17 @@ Verb: VarOrIRIref
   uri = raptor_new_uri_for_rdf_concept(rq->world->raptor_world_ptr,
                                        RASQAL_GOOD_CAST(const unsigned char*, "type"));
   if(!uri)
-    YYERROR_MSG("Verb 2: uri for rdf concept type failed");
-  $$ = rasqal_new_formula(rq->world);
-  if(!$$) {
-    raptor_free_uri(uri);
-    YYERROR_MSG("Verb 2: cannot create formula");
-  }
-  $$->value = rasqal_new_uri_literal(rq->world, uri);
-  if(!$$->value) {
-    rasqal_free_formula($$);
-    $$ = NULL;
-    YYERROR_MSG("Verb 2: cannot create uri literal");
-  }
+    YYERROR_MSG("PathPrimary 2: uri for rdf concept type failed");
+  l = rasqal_new_uri_literal(rq->world, uri);
+  if(!l)
+    YYERROR_MSG("PathPrimary 2: cannot create uri literal");
+  $$ = rasqal_new_link_path(l);
+  if(!$$)
+    YYERROR_MSG("PathPrimary 2: cannot create path");
+}
+| '(' Path ')'
+{
+  $$ = $2;
 }
 ;
 
@@ -5195,6 +5341,18 @@ BuiltInCall: STR '(' Expression ')'
   if(!$$)
     YYERROR_MSG("BuiltInCall 7q: cannot create expr");
 }
+| EXISTS GroupGraphPattern
+{
+  $$ = rasqal_new_exists_expression(rq->world, RASQAL_EXPR_EXISTS, $2);
+  if(!$$)
+    YYERROR_MSG("BuiltInCall 7r: cannot create expr");
+}
+| NOT EXISTS GroupGraphPattern
+{
+  $$ = rasqal_new_exists_expression(rq->world, RASQAL_EXPR_NOT_EXISTS, $3);
+  if(!$$)
+    YYERROR_MSG("BuiltInCall 7s: cannot create expr");
+}
 | StringExpression
 {
   $$ = $1;
@@ -5787,6 +5945,26 @@ rasqal_sparql_query_language_prepare(rasqal_query* rdf_query)
     return 1;
   }
 
+  if(sparql_triples_have_path(rdf_query->constructs)) {
+    sparql_query_error(rdf_query, "SPARQL property paths are not allowed in templates");
+    return 1;
+  }
+
+  if(rdf_query->updates) {
+    rasqal_update_operation* update;
+    int i;
+
+    for(i = 0;
+        (update = (rasqal_update_operation*)raptor_sequence_get_at(rdf_query->updates, i));
+        i++) {
+      if(sparql_triples_have_path(update->insert_templates) ||
+         sparql_triples_have_path(update->delete_templates)) {
+        sparql_query_error(rdf_query, "SPARQL property paths are not allowed in templates");
+        return 1;
+      }
+    }
+  }
+
   /* SPARQL: Turn [] into anonymous variables */
   if(rasqal_query_build_anonymous_variables(rdf_query))
     return 1;